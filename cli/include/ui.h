@@ -37,7 +37,8 @@ void run_ui(struct FileNode* currentDir);
 void print_file_info(const struct FileNode* node);
 
 /**
-    * Prints directory's and it's content's information.
+    * Prints directory's and it's content's information,
+    * children are listed in order of name.
     *
     * @param[in] directory The directory which content information
     * will be printed.
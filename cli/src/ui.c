@@ -11,9 +11,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "../../library/include/file_node_funcs.h"
+#include <time.h>
+#include "../../library/include/wsfs.h"
 #include "../../library/include/wsfs_macros.h"
 
+#define LIST_BATCH_SIZE 64 // amount of children read from directory at once
+
 void run_ui(struct FileNode* currentDir) {
     while (1) {
         puts("");
@@ -30,9 +33,11 @@ void run_ui(struct FileNode* currentDir) {
             break;
 
         case 'g': // go into directory
-            printf("Enter directory name: ");
-            read_line(name, MAX_NAME_SIZE);
-            struct FileNode* newCurrentDir = find_file_node_in_curr_dir(currentDir, name);
+            printf("Enter directory path: ");
+            char dirPath[BUFFER_SIZE];
+            read_line(dirPath, BUFFER_SIZE);
+            struct FileNode* lookupStart = dirPath[0] == '\\' ? get_root_node() : currentDir;
+            struct FileNode* newCurrentDir = wsfs_lookup_path(lookupStart, dirPath, LOOKUP_FOLLOW_INTERMEDIATE);
             change_current_dir(&currentDir, newCurrentDir);
             break;
 
@@ -123,33 +128,46 @@ void run_ui(struct FileNode* currentDir) {
     }
 }
 
+/**
+    * Writes time as local date and minute. Nodes keep times
+    * as nanoseconds, they are turned into calendar fields
+    * only here.
+*/
+static void format_time(const uint64_t time, char* buffer, const size_t size) {
+    const time_t seconds = (time_t)(time / 1000000000u);
+    struct tm calendar;
+    if (localtime_r(&seconds, &calendar) == NULL || strftime(buffer, size, "%Y-%m-%d %H:%M", &calendar) == 0) {
+        snprintf(buffer, size, "%s", "0000-00-00 00:00");
+    }
+}
+
 void print_file_info(const struct FileNode* node) {
     if (node == NULL) return;
 
-    printf("%c%c%c%c %6lu %04u-%02u-%02u %02u:%02u %s", get_file_type_letter(node->info.properties.type),
-                                        get_permission_letter(node->info.properties.permissions & 4),
-                                        get_permission_letter(node->info.properties.permissions & 2),
-                                        get_permission_letter(node->info.properties.permissions & 1),
-                                        get_file_node_size(node),
-                                        node->info.metadata.creationTime.year,
-                                        node->info.metadata.creationTime.month,
-                                        node->info.metadata.creationTime.day,
-                                        node->info.metadata.creationTime.hour,
-                                        node->info.metadata.creationTime.minute,
-                                        node->info.metadata.name);
-
-    if (node->info.properties.type == FILE_TYPE_SYMLINK) {
-        printf(" -> %c%c%c%c %6lu %04u-%02u-%02u %02u:%02u %s", get_file_type_letter(node->info.data.symlinkTarget->info.properties.type),
-                                        get_permission_letter(node->info.data.symlinkTarget->info.properties.permissions & 4),
-                                        get_permission_letter(node->info.data.symlinkTarget->info.properties.permissions & 2),
-                                        get_permission_letter(node->info.data.symlinkTarget->info.properties.permissions & 1),
-                                        get_file_node_size(node->info.data.symlinkTarget),
-                                        node->info.data.symlinkTarget->info.metadata.creationTime.year,
-                                        node->info.data.symlinkTarget->info.metadata.creationTime.month,
-                                        node->info.data.symlinkTarget->info.metadata.creationTime.day,
-                                        node->info.data.symlinkTarget->info.metadata.creationTime.hour,
-                                        node->info.data.symlinkTarget->info.metadata.creationTime.minute,
-                                        node->info.data.symlinkTarget->info.metadata.name);
+    // Sizes of directories are kept up to date by the library, so listing doesn't walk subtrees
+    struct WsfsStat stat;
+    char time[32];
+    wsfs_stat(node, &stat);
+    format_time(stat.times.modificationTime, time, sizeof(time));
+    printf("%c%c%c%c %6lu %s %s", get_file_type_letter(stat.type),
+                                  get_permission_letter(stat.permissions & 4),
+                                  get_permission_letter(stat.permissions & 2),
+                                  get_permission_letter(stat.permissions & 1),
+                                  stat.subtreeSize,
+                                  time,
+                                  node->info.metadata.name);
+
+    if (stat.type == FILE_TYPE_SYMLINK) {
+        const struct FileNode* target = node->info.data.symlinkTarget;
+        wsfs_stat(target, &stat);
+        format_time(stat.times.modificationTime, time, sizeof(time));
+        printf(" -> %c%c%c%c %6lu %s %s", get_file_type_letter(stat.type),
+                                          get_permission_letter(stat.permissions & 4),
+                                          get_permission_letter(stat.permissions & 2),
+                                          get_permission_letter(stat.permissions & 1),
+                                          stat.subtreeSize,
+                                          time,
+                                          target->info.metadata.name);
     }
 
     puts(""); // new line
@@ -159,10 +177,13 @@ void print_dir_content(const struct FileNode* directory) {
     if (directory == NULL) return;
 
     print_file_info(directory);
-    const struct FileNode* current = directory->info.data.directoryContent;
-    while (current != NULL) {
-        print_file_info(current);
-        current = current->next;
+    struct WsfsDirCookie cookie = WSFS_DIR_COOKIE_INIT;
+    struct FileNode* children[LIST_BATCH_SIZE];
+    uint32_t count;
+    while ((count = wsfs_readdir(directory, &cookie, children, LIST_BATCH_SIZE)) > 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            print_file_info(children[i]);
+        }
     }
 }
 
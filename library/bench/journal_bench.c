@@ -0,0 +1,141 @@
+/**
+    * @file: journal_bench.c
+    * @author: without eyes
+    *
+    * This file contains journal benchmark. Every thread appends
+    * small pieces to its own file with wsfs_append_ctx() while
+    * changes are journaled with every sync policy, and without
+    * a journal for comparison. Throughput, amount of records
+    * and amount of fdatasync() calls are printed for 1, 4 and
+    * 8 threads. With JOURNAL_SYNC_ALWAYS syncs should grow
+    * slower than records as threads share them. The last rows
+    * take background checkpoints every CHECKPOINT_INTERVAL_MS
+    * meanwhile, pause of changes during the last one is printed.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/checkpoint.h"
+#include "../include/journal.h"
+#include "../include/wsfs.h"
+
+#define MAX_THREADS 8
+#define SYNCED_APPENDS_PER_THREAD 500
+#define APPENDS_PER_THREAD 50000
+#define NO_JOURNAL (-1)
+#define CHECKPOINT_INTERVAL_MS 5
+
+struct BenchThread {
+    pthread_t thread;
+    struct WsfsContext* context;
+    struct FileNode* file;
+    int appendCount;
+};
+
+static double get_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void* append_pieces(void* argument) {
+    const struct BenchThread* benchThread = argument;
+    int failed = 0;
+
+    for (int i = 0; i < benchThread->appendCount; i++) {
+        failed += wsfs_append_ctx(benchThread->context, benchThread->file, "piece", 5) != EXIT_SUCCESS;
+    }
+
+    return (void*)(uintptr_t)(failed != 0);
+}
+
+static const char* get_policy_name(const int policy) {
+    switch (policy) {
+        case JOURNAL_SYNC_ALWAYS:   return "always";
+        case JOURNAL_SYNC_INTERVAL: return "interval";
+        case JOURNAL_SYNC_NEVER:    return "never";
+        default:                    return "none";
+    }
+}
+
+static uint8_t run(const int policy, const int threadCount, const uint8_t isCheckpointed) {
+    char path[] = "/tmp/wsfs_journal_bench_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) return EXIT_FAILURE;
+    close(fd);
+    char checkpointPath[sizeof(path) + 16];
+    sprintf(checkpointPath, "%s.checkpoint", path);
+
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    if (policy != NO_JOURNAL && wsfs_open_journal_ctx(context, path, policy, 10) != EXIT_SUCCESS) {
+        free_wsfs_context(context);
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    if (isCheckpointed) wsfs_start_checkpoints_ctx(context, checkpointPath, CHECKPOINT_INTERVAL_MS, 0);
+
+    const int appendCount = policy == JOURNAL_SYNC_ALWAYS ? SYNCED_APPENDS_PER_THREAD : APPENDS_PER_THREAD;
+    struct BenchThread threads[MAX_THREADS];
+    for (int i = 0; i < threadCount; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        threads[i].context = context;
+        threads[i].file = create_file_node_ctx(context, root, name, FILE_TYPE_FILE);
+        threads[i].appendCount = appendCount;
+    }
+
+    uint8_t result = EXIT_SUCCESS;
+    const double start = get_seconds();
+    for (int i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i].thread, NULL, append_pieces, &threads[i]);
+    }
+    for (int i = 0; i < threadCount; i++) {
+        void* failed;
+        pthread_join(threads[i].thread, &failed);
+        if (failed != NULL) result = EXIT_FAILURE;
+    }
+    const double seconds = get_seconds() - start;
+
+    struct JournalStats stats;
+    get_journal_stats_ctx(context, &stats);
+    struct CheckpointStats checkpointStats;
+    get_checkpoint_stats_ctx(context, &checkpointStats);
+    printf("%10s %8d %14.0f %10llu %10llu %12llu %10.3f\n", get_policy_name(policy), threadCount,
+           (double)threadCount * appendCount / seconds, (unsigned long long)stats.records,
+           (unsigned long long)stats.syncs, (unsigned long long)checkpointStats.checkpoints,
+           (double)checkpointStats.lastPauseNs / 1e6);
+    if (checkpointStats.failures > 0) result = EXIT_FAILURE;
+
+    free_wsfs_context(context);
+    unlink(path);
+    unlink(checkpointPath);
+
+    return result;
+}
+
+int main(void) {
+    const int policies[] = {NO_JOURNAL, JOURNAL_SYNC_NEVER, JOURNAL_SYNC_INTERVAL, JOURNAL_SYNC_ALWAYS};
+    const int threadCounts[] = {1, 4, MAX_THREADS};
+    uint8_t result = EXIT_SUCCESS;
+
+    printf("%10s %8s %14s %10s %10s %12s %10s\n", "policy", "threads", "appends/s", "records", "syncs",
+           "checkpoints", "pause ms");
+    for (uint32_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        for (uint32_t j = 0; j < sizeof(threadCounts) / sizeof(threadCounts[0]); j++) {
+            if (run(policies[i], threadCounts[j], 0) != EXIT_SUCCESS) result = EXIT_FAILURE;
+        }
+    }
+    for (uint32_t j = 0; j < sizeof(threadCounts) / sizeof(threadCounts[0]); j++) {
+        if (run(JOURNAL_SYNC_NEVER, threadCounts[j], 1) != EXIT_SUCCESS) result = EXIT_FAILURE;
+    }
+
+    return result;
+}
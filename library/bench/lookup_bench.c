@@ -0,0 +1,97 @@
+/**
+    * @file: lookup_bench.c
+    * @author: without eyes
+    *
+    * This file contains multi-threaded path lookup benchmark.
+    * Tree of DIR_COUNT directories with FILES_PER_DIR files
+    * is built once, then every thread resolves random paths
+    * with wsfs_lookup_path(). Throughput is printed for 1, 2,
+    * 4 and 8 threads, it should grow with the amount of cores.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../include/wsfs.h"
+
+#define DIR_COUNT 64
+#define FILES_PER_DIR 128
+#define PATH_COUNT (DIR_COUNT * FILES_PER_DIR)
+#define LOOKUPS_PER_THREAD 1000000
+#define MAX_THREADS 8
+
+static struct FileNode* root;
+static char paths[PATH_COUNT][32];
+
+static double get_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void* lookup_random_paths(void* argument) {
+    uint32_t state = (uint32_t)(uintptr_t)argument * 2654435761u + 1;
+    uint64_t found = 0;
+
+    for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        found += wsfs_lookup_path(root, paths[state % PATH_COUNT], LOOKUP_FOLLOW_ALL) != NULL;
+    }
+
+    return (void*)(uintptr_t)(found != LOOKUPS_PER_THREAD);
+}
+
+static void build_tree(void) {
+    set_memory_limit(UINT64_MAX);
+    set_file_count_limit(UINT64_MAX);
+    set_lookup_cache_capacity(&get_default_context()->lookupCache, PATH_COUNT * 2);
+
+    root = wsfs_init();
+    change_permissions(root, PERM_DEFAULT);
+    for (int dir = 0; dir < DIR_COUNT; dir++) {
+        char name[16];
+        sprintf(name, "d%d", dir);
+        struct FileNode* dirNode = create_file_node(root, name, FILE_TYPE_DIR);
+        change_permissions(dirNode, PERM_DEFAULT);
+        for (int file = 0; file < FILES_PER_DIR; file++) {
+            sprintf(paths[dir * FILES_PER_DIR + file], "\\d%d\\file%d", dir, file);
+            sprintf(name, "file%d", file);
+            create_file_node(dirNode, name, FILE_TYPE_FILE);
+        }
+    }
+}
+
+int main(void) {
+    build_tree();
+    printf("%8s %12s %16s %8s\n", "threads", "seconds", "lookups/s", "speedup");
+
+    double baseline = 0;
+    for (int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2) {
+        pthread_t threads[MAX_THREADS];
+        uint8_t hasFailed = 0;
+
+        const double start = get_seconds();
+        for (int i = 0; i < threadCount; i++) {
+            pthread_create(&threads[i], NULL, lookup_random_paths, (void*)(uintptr_t)(i + 1));
+        }
+        for (int i = 0; i < threadCount; i++) {
+            void* result;
+            pthread_join(threads[i], &result);
+            hasFailed |= result != NULL;
+        }
+        const double seconds = get_seconds() - start;
+
+        const double throughput = (double)threadCount * LOOKUPS_PER_THREAD / seconds;
+        if (threadCount == 1) baseline = throughput;
+        printf("%8d %12.3f %16.0f %7.2fx%s\n", threadCount, seconds, throughput,
+               throughput / baseline, hasFailed ? " (lookup failed)" : "");
+    }
+
+    wsfs_deinit(root);
+
+    return EXIT_SUCCESS;
+}
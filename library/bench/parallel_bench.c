@@ -0,0 +1,123 @@
+/**
+    * @file: parallel_bench.c
+    * @author: without eyes
+    *
+    * This file contains work pool benchmark. Tree of DIR_COUNT
+    * directories with FILES_PER_DIR small files each (about a
+    * million nodes) is built once under "tree". Then, for 1,
+    * 2, 4 and 8 threads(pool threads plus the calling one, see
+    * work_pool.h), the tree is searched with a predicate in
+    * any order and in path order, copied with
+    * copy_file_node_ctx() and the copy is deleted again. Time
+    * of every step is printed per thread count.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/work_pool.h"
+#include "../include/wsfs.h"
+
+#define DIR_COUNT 1000
+#define FILES_PER_DIR 999
+#define TREE_COUNT (1 + DIR_COUNT * (FILES_PER_DIR + 1))
+#define MATCH_COUNT (DIR_COUNT * 100) // names of file0 to file998 which end with 7
+#define MAX_THREADS 8
+
+static double get_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static struct WsfsContext* build_tree(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    if (context == NULL) return NULL;
+
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* tree = create_file_node_ctx(context, root, "tree", FILE_TYPE_DIR);
+    change_permissions(tree, PERM_DEFAULT);
+    for (int dir = 0; dir < DIR_COUNT; dir++) {
+        char name[32];
+        sprintf(name, "directory%d", dir);
+        struct FileNode* dirNode = create_file_node_ctx(context, tree, name, FILE_TYPE_DIR);
+        change_permissions(dirNode, PERM_DEFAULT);
+        for (int file = 0; file < FILES_PER_DIR; file++) {
+            sprintf(name, "file%d", file);
+            struct FileNode* fileNode = create_file_node_ctx(context, dirNode, name, FILE_TYPE_FILE);
+            change_permissions(fileNode, PERM_DEFAULT);
+            write_to_file_ctx(context, fileNode, name);
+        }
+    }
+
+    return context;
+}
+
+static uint8_t is_named_seven(const struct FileNode* node, void* argument) {
+    (void)argument;
+    const char* name = node->info.metadata.name;
+    return node->info.properties.type == FILE_TYPE_FILE && name[strlen(name) - 1] == '7';
+}
+
+int main(void) {
+    struct WsfsContext* context = build_tree();
+    if (context == NULL || get_file_count_ctx(context) != TREE_COUNT + 1) {
+        printf("building tree failed\n");
+        return EXIT_FAILURE;
+    }
+
+    struct FileNode* root = get_root_node_ctx(context);
+    struct FileNode* tree = find_file_node_in_curr_dir_ctx(context, root, "tree");
+    struct FileNode* copies = create_file_node_ctx(context, root, "copies", FILE_TYPE_DIR);
+    change_permissions(copies, PERM_DEFAULT);
+    uint8_t hasFailed = copies == NULL;
+    struct FileNode* firstFound = NULL;
+
+    printf("%8s %12s %12s %12s %12s\n", "threads", "search", "sorted", "copy", "delete");
+    for (uint32_t threads = 1; threads <= MAX_THREADS && !hasFailed; threads *= 2) {
+        if (threads > 1 && wsfs_start_workers_ctx(context, threads - 1) != EXIT_SUCCESS) {
+            printf("starting %u threads failed\n", threads);
+            hasFailed = 1;
+            break;
+        }
+
+        uint32_t count;
+        double start = get_seconds();
+        struct FileNode** found = find_file_nodes_matching_ctx(context, tree, is_named_seven, NULL, 0, &count);
+        const double searchSeconds = get_seconds() - start;
+        hasFailed |= found == NULL || count != MATCH_COUNT;
+        free(found);
+
+        start = get_seconds();
+        found = find_file_nodes_matching_ctx(context, tree, is_named_seven, NULL, 1, &count);
+        const double sortSeconds = get_seconds() - start;
+        hasFailed |= found == NULL || count != MATCH_COUNT || (firstFound != NULL && found[0] != firstFound);
+        if (found != NULL) firstFound = found[0];
+        free(found);
+
+        start = get_seconds();
+        hasFailed |= copy_file_node_ctx(context, copies, tree) != EXIT_SUCCESS;
+        const double copySeconds = get_seconds() - start;
+        hasFailed |= get_file_count_ctx(context) != 2 * TREE_COUNT + 2;
+
+        start = get_seconds();
+        struct FileNode* copy = copies->info.data.directoryContent;
+        hasFailed |= copy == NULL || delete_file_node_ctx(context, copies, copy) != EXIT_SUCCESS;
+        const double deleteSeconds = get_seconds() - start;
+        hasFailed |= get_file_count_ctx(context) != TREE_COUNT + 2;
+
+        printf("%8u %12.3f %12.3f %12.3f %12.3f\n", threads, searchSeconds, sortSeconds, copySeconds, deleteSeconds);
+        wsfs_stop_workers_ctx(context);
+    }
+    if (hasFailed) printf("parallel operations failed\n");
+
+    free_wsfs_context(context);
+
+    return hasFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+/**
+    * @file: readdir_bench.c
+    * @author: without eyes
+    *
+    * This file contains directory listing benchmark. One
+    * directory with CHILD_COUNT children is built in shuffled
+    * name order. Then it is listed whole by wsfs_readdir() in
+    * batches of BATCH_SIZE, and BATCH_COUNT single batches are
+    * resumed from cookies spread over the directory while
+    * children are added and removed between them. Time of
+    * full listing and average time of resumed batch are
+    * printed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/wsfs.h"
+
+#define CHILD_COUNT 1000000
+#define BATCH_SIZE 256
+#define BATCH_COUNT 10000
+#define SHUFFLE_STEP 7919 // prime which doesn't divide CHILD_COUNT
+
+static double get_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    if (context == NULL) return EXIT_FAILURE;
+
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    char name[32];
+    for (uint64_t i = 0; i < CHILD_COUNT; i++) {
+        sprintf(name, "file%07llu", (unsigned long long)(i * SHUFFLE_STEP % CHILD_COUNT));
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+    uint8_t hasFailed = get_dir_child_count(dir) != CHILD_COUNT;
+
+    struct FileNode* children[BATCH_SIZE];
+    struct WsfsDirCookie cookie = WSFS_DIR_COOKIE_INIT;
+    uint64_t total = 0;
+    uint32_t count;
+    double start = get_seconds();
+    while ((count = wsfs_readdir(dir, &cookie, children, BATCH_SIZE)) > 0) {
+        total += count;
+    }
+    const double listSeconds = get_seconds() - start;
+    hasFailed |= total != CHILD_COUNT;
+
+    double batchSeconds = 0;
+    for (uint64_t batch = 0; batch < BATCH_COUNT && !hasFailed; batch++) {
+        sprintf(name, "file%07llu", (unsigned long long)(batch * SHUFFLE_STEP % CHILD_COUNT));
+        struct FileNode* child = find_file_node_in_curr_dir_ctx(context, dir, name);
+        hasFailed |= child == NULL || delete_file_node_ctx(context, dir, child) != EXIT_SUCCESS;
+        hasFailed |= create_file_node_ctx(context, dir, name, FILE_TYPE_FILE) == NULL;
+
+        // Cookie names a deleted child, listing resumes after its name
+        struct WsfsDirCookie resumed = {malloc(strlen(name) + 1), (uintptr_t)child};
+        if (resumed.name == NULL) {
+            hasFailed = 1;
+            break;
+        }
+        strcpy(resumed.name, name);
+        start = get_seconds();
+        count = wsfs_readdir(dir, &resumed, children, BATCH_SIZE);
+        batchSeconds += get_seconds() - start;
+        hasFailed |= count == 0 || strcmp(children[0]->info.metadata.name, name) < 0;
+        wsfs_release_dir_cookie(&resumed);
+    }
+
+    printf("%12s %12s %16s\n", "children", "list", "resumed batch");
+    printf("%12d %12.3f %13.3f us\n", CHILD_COUNT, listSeconds, batchSeconds / BATCH_COUNT * 1e6);
+    if (hasFailed) printf("listing directory failed\n");
+
+    free_wsfs_context(context);
+
+    return hasFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/**
+    * @file: snapshot_bench.c
+    * @author: without eyes
+    *
+    * This file contains snapshot benchmark. Tree of DIR_COUNT
+    * directories with FILES_PER_DIR small files each (about a
+    * million nodes) is built through create_file_node_ctx() and
+    * write_to_file_ctx(), saved with wsfs_save() and loaded back
+    * with wsfs_load(). The same tree is written as an image
+    * with wsfs_save_image(), mapped with wsfs_open_image() and
+    * one file is read from it. At last a read-only copy of the
+    * tree is taken with create_tree_snapshot_ctx(), content is
+    * shared so only nodes are copied. Time of every step is
+    * printed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/image.h"
+#include "../include/snapshot.h"
+#include "../include/wsfs.h"
+
+#define DIR_COUNT 1000
+#define FILES_PER_DIR 999
+#define NODE_COUNT (1 + DIR_COUNT * (FILES_PER_DIR + 1))
+
+static double get_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static struct WsfsContext* build_tree(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    if (context == NULL) return NULL;
+
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions(root, PERM_DEFAULT);
+    for (int dir = 0; dir < DIR_COUNT; dir++) {
+        char name[32];
+        sprintf(name, "directory%d", dir);
+        struct FileNode* dirNode = create_file_node_ctx(context, root, name, FILE_TYPE_DIR);
+        change_permissions(dirNode, PERM_DEFAULT);
+        for (int file = 0; file < FILES_PER_DIR; file++) {
+            sprintf(name, "file%d", file);
+            struct FileNode* fileNode = create_file_node_ctx(context, dirNode, name, FILE_TYPE_FILE);
+            change_permissions(fileNode, PERM_DEFAULT);
+            write_to_file_ctx(context, fileNode, name);
+        }
+    }
+
+    return context;
+}
+
+int main(void) {
+    FILE* snapshot = tmpfile();
+    if (snapshot == NULL) return EXIT_FAILURE;
+
+    double start = get_seconds();
+    struct WsfsContext* built = build_tree();
+    const double buildSeconds = get_seconds() - start;
+    if (built == NULL || get_file_count_ctx(built) != NODE_COUNT) {
+        printf("building tree failed\n");
+        return EXIT_FAILURE;
+    }
+
+    start = get_seconds();
+    const uint8_t saveResult = wsfs_save(built, fileno(snapshot));
+    const double saveSeconds = get_seconds() - start;
+    const off_t snapshotSize = lseek(fileno(snapshot), 0, SEEK_CUR);
+
+    lseek(fileno(snapshot), 0, SEEK_SET);
+    start = get_seconds();
+    struct WsfsContext* loaded = wsfs_load(fileno(snapshot));
+    const double loadSeconds = get_seconds() - start;
+
+    FILE* imageFile = tmpfile();
+    if (imageFile == NULL) return EXIT_FAILURE;
+    start = get_seconds();
+    const uint8_t imageResult = wsfs_save_image(built, fileno(imageFile));
+    const double imageSaveSeconds = get_seconds() - start;
+
+    // Warm start is mapping plus the first lookup and read
+    start = get_seconds();
+    struct WsfsImage* image = wsfs_open_image(fileno(imageFile));
+    struct ImageEntry entry;
+    char content[16];
+    const uint8_t lookupResult = image != NULL
+                                 ? wsfs_image_lookup(image, "directory999\\file998", LOOKUP_FOLLOW_ALL, &entry)
+                                 : EXIT_FAILURE;
+    const uint64_t readSize = lookupResult == EXIT_SUCCESS ? wsfs_image_read(image, &entry, content, 16, 0) : 0;
+    const double openSeconds = get_seconds() - start;
+
+    const uint8_t hasFailed = saveResult != EXIT_SUCCESS || loaded == NULL ||
+                              get_file_count_ctx(loaded) != NODE_COUNT ||
+                              get_used_memory_ctx(loaded) != get_used_memory_ctx(built) ||
+                              imageResult != EXIT_SUCCESS || readSize != 7;
+
+    // Nodes of tree snapshot are charged to the built tree, so it is taken after counters are compared
+    start = get_seconds();
+    const uint8_t cloneResult = create_tree_snapshot_ctx(built, "bench");
+    const double cloneSeconds = get_seconds() - start;
+    printf("%8s %12s %16s\n", "step", "seconds", "nodes/s");
+    printf("%8s %12.3f %16.0f\n", "build", buildSeconds, NODE_COUNT / buildSeconds);
+    printf("%8s %12.3f %16.0f\n", "save", saveSeconds, NODE_COUNT / saveSeconds);
+    printf("%8s %12.3f %16.0f\n", "load", loadSeconds, NODE_COUNT / loadSeconds);
+    printf("%8s %12.3f %16.0f\n", "save img", imageSaveSeconds, NODE_COUNT / imageSaveSeconds);
+    printf("%8s %12.6f %16.0f\n", "open img", openSeconds, NODE_COUNT / openSeconds);
+    printf("%8s %12.3f %16.0f\n", "clone", cloneSeconds, NODE_COUNT / cloneSeconds);
+    printf("snapshot of %d nodes takes %lld bytes, image takes %lld bytes%s\n", NODE_COUNT,
+           (long long)snapshotSize, (long long)lseek(fileno(imageFile), 0, SEEK_CUR),
+           hasFailed ? " (snapshot failed)" : "");
+    if (cloneResult != EXIT_SUCCESS) printf("tree snapshot failed\n");
+
+    wsfs_close_image(image);
+    fclose(imageFile);
+    free_wsfs_context(loaded);
+    free_wsfs_context(built);
+    fclose(snapshot);
+
+    return hasFailed || cloneResult != EXIT_SUCCESS ? EXIT_FAILURE : EXIT_SUCCESS;
+}
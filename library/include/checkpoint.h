@@ -0,0 +1,135 @@
+/**
+    * @file: checkpoint.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to checkpoints. A checkpoint is a snapshot(see snapshot.h)
+    * of a journaled file system, after it is saved the journal
+    * holds only changes made later, so it doesn't grow forever.
+    *
+    * Checkpoint waits until no change is in progress, rotates
+    * the journal and forks. The child process sees the tree
+    * as it was at that moment(copy-on-write pages) and writes
+    * it into a temporary file, while changes go on in the
+    * parent. Changes only wait for the rotation and fork.
+    *
+    * To restore, load the checkpoint with wsfs_load_checkpoint()
+    * (or create an empty context if there is none) and open
+    * the journal, which replays changes made after it.
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "wsfs_context.h"
+
+#define CHECKPOINT_MAGIC 0x50435357u // "WSCP" in little endian
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_TEMPORARY_SUFFIX ".tmp"
+
+/**
+ * @struct CheckpointStats
+ * @brief Counters of checkpoints.
+ */
+struct CheckpointStats {
+    uint64_t checkpoints;       /**< Amount of saved checkpoints */
+    uint64_t failures;          /**< Amount of checkpoints which weren't saved */
+    uint64_t lastDurationNs;    /**< Duration of the last saved checkpoint in nanoseconds */
+    uint64_t lastPauseNs;       /**< Time changes waited for the last checkpoint in nanoseconds */
+    uint64_t lastBytes;         /**< Size of the last saved checkpoint in bytes */
+    uint64_t totalBytes;        /**< Amount of bytes of every saved checkpoint */
+    uint64_t journalSize;       /**< Current size of journal files in bytes */
+};
+
+/**
+    * Starts checkpoints of context. Background thread checks
+    * the journal every interval and saves a checkpoint once
+    * journal files reach the size limit and hold new records.
+    *
+    * @param[in,out] context The context which will be checkpointed.
+    * @param[in] path The path of checkpoint file.
+    * @param[in] intervalMs The interval between checks in
+    * milliseconds, 0 if checkpoints are saved only by
+    * wsfs_checkpoint_ctx().
+    * @param[in] journalSizeLimit The size of journal files in bytes
+    * after which checkpoint is saved.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * allocation failed or thread couldn't be started, else
+    * returns 0.
+    *
+    * @pre context != NULL && path != NULL
+    * @pre context has a journal(see wsfs_open_journal_ctx()) and a root
+    * @pre checkpoints of context aren't started yet
+*/
+uint8_t wsfs_start_checkpoints_ctx(struct WsfsContext* context, const char* path, uint32_t intervalMs,
+                                   uint64_t journalSizeLimit);
+
+/**
+    * Same as wsfs_start_checkpoints_ctx(), in default context.
+*/
+uint8_t wsfs_start_checkpoints(const char* path, uint32_t intervalMs, uint64_t journalSizeLimit);
+
+/**
+    * Saves checkpoint now and waits until it is saved. Other
+    * threads may change file system meanwhile.
+    *
+    * @param[in,out] context The context which will be checkpointed.
+    *
+    * @return Returns 1 if checkpoints aren't started, journal
+    * couldn't be rotated or checkpoint wasn't saved, else
+    * returns 0. Journal keeps every record if checkpoint
+    * wasn't saved.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_checkpoint_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_checkpoint_ctx(), in default context.
+*/
+uint8_t wsfs_checkpoint(void);
+
+/**
+    * Stops background thread, waits for checkpoint in
+    * progress and frees checkpointer. Journal stays open.
+    *
+    * @param[in,out] context The context which checkpoints will be stopped.
+    *
+    * @pre context != NULL
+*/
+void wsfs_stop_checkpoints_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_stop_checkpoints_ctx(), in default context.
+*/
+void wsfs_stop_checkpoints(void);
+
+/**
+    * Gets counters of checkpoints. Counters are zero if
+    * checkpoints aren't started, except for journal size.
+    *
+    * @param[in,out] context The context which checkpoints are inspected.
+    * @param[out] stats The counters.
+    *
+    * @pre context != NULL && stats != NULL
+*/
+void get_checkpoint_stats_ctx(struct WsfsContext* context, struct CheckpointStats* stats);
+
+/**
+    * Reads checkpoint file into a new context, which remembers
+    * number of checkpoint, so journal opened afterwards replays
+    * only changes made after it.
+    *
+    * @param[in] path The path of checkpoint file.
+    *
+    * @return Returns NULL if file doesn't exist, is malformed
+    * or memory allocation failed, else returns new context with
+    * root node set. Free it with free_wsfs_context().
+    *
+    * @pre path != NULL
+*/
+struct WsfsContext* wsfs_load_checkpoint(const char* path);
+
+#endif //CHECKPOINT_H
@@ -0,0 +1,195 @@
+/**
+    * @file: dir_index.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to hashed directory indexes. Index is an open-addressing
+    * hash table of directory's children keyed by name hash,
+    * it is only a lookup accelerator, the linked list stays
+    * the iteration order. Slots are published atomically and
+    * a grown table replaces the old one, which is retired, so
+    * readers inside an epoch may search without the lock.
+    * Index also keeps children sorted by name in blocks, so
+    * listings (see wsfs_readdir()) resume after any name with
+    * two binary searches. Order is read under lock of
+    * directory only.
+*/
+
+#ifndef DIR_INDEX_H
+#define DIR_INDEX_H
+
+#include "file_node_structs.h"
+#include "slab_allocator.h"
+
+/**
+ * @struct DirIndexTable
+ * @brief Slots of index, the table is replaced as a whole when index grows.
+ */
+struct DirIndexTable {
+    uint32_t capacity;                  /**< Amount of slots, always a power of two */
+    struct FileNode* _Atomic slots[];   /**< Children, NULL if slot is empty */
+};
+
+#define DIR_ORDER_BLOCK_CAPACITY 128
+
+/**
+ * @struct DirOrderBlock
+ * @brief Children of directory in ascending order of name, then of address.
+ */
+struct DirOrderBlock {
+    uint32_t count;                                     /**< Amount of children in block */
+    struct FileNode* children[DIR_ORDER_BLOCK_CAPACITY]; /**< Children, the first count are used */
+};
+
+/**
+ * @struct DirIndex
+ * @brief Open-addressing (linear probing) hash table of directory
+ * children and their order by name.
+ */
+struct DirIndex {
+    struct DirIndexTable* _Atomic table; /**< Current table of children */
+    struct SlabAllocator* allocator;    /**< Allocator which owns index memory */
+    uint32_t capacity;                  /**< Amount of slots of current table */
+    uint32_t count;                     /**< Amount of indexed children */
+    uint32_t tombstones;                /**< Amount of slots freed by removal */
+    struct DirOrderBlock** orderBlocks; /**< Blocks of sorted children, in ascending order */
+    uint32_t orderBlockCount;           /**< Amount of blocks */
+    uint32_t orderBlockCapacity;        /**< Capacity of block table */
+    uint8_t isOrdered;                  /**< 1 if blocks hold every indexed child, 0 from failed allocation to next insert */
+};
+
+/**
+    * Calculates hash of file node name (32-bit FNV-1a).
+    *
+    * @param[in] name The name which hash will be calculated.
+    * @param[out] length The length of name. Can be NULL.
+    *
+    * @return Returns hash of name.
+    *
+    * @pre name != NULL
+*/
+uint32_t hash_file_node_name(const char* name, uint32_t* length);
+
+/**
+    * Builds index of all children of directory. The caller
+    * is responsible for freeing the index by calling
+    * free_dir_index().
+    *
+    * @param[in] dir The directory which children will be indexed.
+    * @param[in,out] allocator The allocator which will own index memory.
+    *
+    * @return Returns NULL if memory allocation failed, else
+    * returns created index.
+    *
+    * @pre dir != NULL && allocator != NULL
+    * @pre dir must have FILE_TYPE_DIR
+*/
+struct DirIndex* build_dir_index(const struct FileNode* dir, struct SlabAllocator* allocator);
+
+/**
+    * Adds file node to index.
+    *
+    * @param[in,out] index The index where node will be added.
+    * @param[in] node The file node which will be added.
+    *
+    * @return Returns 1 if preconditions aren't met or memory
+    * allocation failed, else returns 0.
+    *
+    * @pre index != NULL && node != NULL
+*/
+uint8_t dir_index_insert(struct DirIndex* index, struct FileNode* node);
+
+/**
+    * Removes file node from index.
+    *
+    * @param[in,out] index The index from which node will be removed.
+    * @param[in] node The file node which will be removed.
+    *
+    * @return Returns 1 if node wasn't in index, else returns 0.
+    *
+    * @pre index != NULL && node != NULL
+*/
+uint8_t dir_index_remove(struct DirIndex* index, const struct FileNode* node);
+
+/**
+    * Finds file node in index by name.
+    *
+    * @param[in] index The index where node will be searched.
+    * @param[in] name The name of file node.
+    * @param[in] hash The hash of name(see hash_file_node_name()).
+    * @param[in] length The length of name.
+    *
+    * @return Returns NULL if there is no such node, else
+    * returns found file node.
+    *
+    * @pre index != NULL && name != NULL
+    *
+    * @note If several children share a name, it is not
+    * specified which one of them will be found.
+*/
+struct FileNode* dir_index_find(const struct DirIndex* index, const char* name, uint32_t hash, uint32_t length);
+
+/**
+    * Finds child of directory by name, index is used if
+    * directory has one, else children are scanned.
+    *
+    * @param[in] dir The directory where node will be searched.
+    * @param[in] name The name of file node.
+    * @param[in] hash The hash of name(see hash_file_node_name()).
+    * @param[in] length The length of name.
+    *
+    * @return Returns NULL if there is no such node, else
+    * returns found file node.
+    *
+    * @pre dir != NULL && name != NULL
+    * @pre dir must have FILE_TYPE_DIR
+    * @pre the caller holds lock of dir or is inside an epoch(see wsfs_epoch_enter())
+    *
+    * @note Without the lock a child which is renamed or moved
+    * meanwhile may be missed.
+*/
+struct FileNode* find_dir_child(const struct FileNode* dir, const char* name, uint32_t hash, uint32_t length);
+
+/**
+    * Gets children of directory which sort after given name
+    * and address, in ascending order of name, then of address.
+    * Sorted blocks of index are used if directory has them,
+    * else children are scanned.
+    *
+    * @param[in] dir The directory which children will be listed.
+    * @param[in] name The name of the last listed child, NULL
+    * to list from the first child.
+    * @param[in] address The address of the last listed child.
+    * @param[out] children The array where children will be written.
+    * @param[in] capacity The amount of children which fit into array.
+    *
+    * @return Returns amount of written children.
+    *
+    * @pre dir != NULL && children != NULL
+    * @pre dir must have FILE_TYPE_DIR
+    * @pre the caller holds lock of dir
+*/
+uint32_t list_dir_children(const struct FileNode* dir, const char* name, uintptr_t address,
+                           struct FileNode** children, uint32_t capacity);
+
+/**
+    * Frees index once no reader inside an epoch can reach it
+    * anymore(see epoch_retire()).
+    *
+    * @param[in] index The index which will be freed.
+    *
+    * @pre index != NULL
+    * @pre index was unpublished from its directory before the call
+*/
+void retire_dir_index(struct DirIndex* index);
+
+/**
+    * Frees allocated memory of index.
+    *
+    * @param[in] index The index which will be freed.
+    *
+    * @pre no reader can reach index anymore
+*/
+void free_dir_index(struct DirIndex* index);
+
+#endif //DIR_INDEX_H
@@ -0,0 +1,108 @@
+/**
+    * @file: epoch.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to epoch-based memory reclamation. Readers announce
+    * that they are inside an epoch in their own per-thread
+    * record, so they never write a shared cache line and
+    * never wait. Writers unlink memory first and retire it,
+    * it is freed once every reader which could still see
+    * it has left its epoch.
+*/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "slab_allocator.h"
+
+/**
+    * Frees memory retired by epoch_retire().
+    *
+    * @param[in,out] allocator The allocator which owns memory.
+    * @param[in,out] pointer The retired memory.
+    * @param[in] size The size which was passed to epoch_retire().
+*/
+typedef void (*EpochReclaimFunc)(struct SlabAllocator* allocator, void* pointer, size_t size);
+
+/**
+    * Enters epoch. File nodes, names and content reached
+    * until wsfs_epoch_exit() is called stay allocated even
+    * if another thread deletes them meanwhile. Calls may be
+    * nested, only the outermost pair matters.
+    *
+    * @return Returns 1 if memory allocation of the thread
+    * record failed, epoch isn't entered then, else returns 0.
+    *
+    * @note Thread must not wait for another thread while it
+    * is inside an epoch, memory would stop being reclaimed.
+*/
+uint8_t wsfs_epoch_enter(void);
+
+/**
+    * Exits epoch entered by wsfs_epoch_enter().
+    *
+    * @pre wsfs_epoch_enter() was called by this thread.
+*/
+void wsfs_epoch_exit(void);
+
+/**
+    * Checks if no thread is inside an epoch. Memory unlinked
+    * before the call may be reused at once then, threads which
+    * enter an epoch later can't reach it.
+    *
+    * @return Returns 1 if no thread is inside an epoch, else returns 0.
+*/
+uint8_t is_epoch_idle(void);
+
+/**
+    * Retires memory which is no longer reachable from the
+    * file system. Memory is freed at once if no thread is
+    * inside an epoch, else once those threads exit it.
+    *
+    * @param[in] reclaim The function which will free memory.
+    * @param[in,out] allocator The allocator which owns memory.
+    * @param[in,out] pointer The retired memory.
+    * @param[in] size The size passed to reclaim.
+    *
+    * @pre reclaim != NULL && pointer != NULL
+    * @pre pointer was unlinked before the call
+    * @pre reclaim doesn't call epoch_retire()
+*/
+void epoch_retire(EpochReclaimFunc reclaim, struct SlabAllocator* allocator, void* pointer, size_t size);
+
+/**
+    * Frees retired memory which no thread inside an epoch
+    * can reach anymore. Called by epoch_retire() every
+    * EPOCH_COLLECT_INTERVAL retirements.
+*/
+void epoch_collect(void);
+
+/**
+    * Frees all retired memory at once.
+    *
+    * @note Must not be called while other threads are inside an epoch.
+*/
+void epoch_reclaim_all(void);
+
+/**
+    * Frees all retired memory owned by given allocator at
+    * once, memory of other allocators keeps waiting.
+    *
+    * @param[in] allocator The allocator which memory will be freed.
+    *
+    * @note Must not be called while other threads are inside
+    * an epoch and may reach memory of allocator.
+*/
+void epoch_reclaim_allocator(const struct SlabAllocator* allocator);
+
+/**
+    * Gets amount of retired objects which aren't freed yet.
+    *
+    * @return Returns amount of pending objects.
+*/
+uint64_t get_epoch_pending_count(void);
+
+#endif //EPOCH_H
@@ -0,0 +1,304 @@
+/**
+    * @file: file_content.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to chunked file content. Content is split in chunks of
+    * FILE_CHUNK_SIZE bytes, only the last one may be smaller
+    * and it grows by doubling, so writing at offset or
+    * appending costs O(bytes written) instead of copying the
+    * whole file. Functions here don't check permissions and
+    * don't charge memory counters, see wsfs_pwrite() and
+    * others for that. Memory which lock-free readers may still
+    * use is retired(see epoch_retire()) instead of freed.
+    *
+    * Copied files share chunks until one of them changes,
+    * then it copies content for itself(copy-on-write). The
+    * last file which points to shared chunks frees them.
+    *
+    * Content written as a whole may be kept in a content
+    * store instead, a hash table of shared contents keyed by
+    * their hash. A file written with content which is already
+    * stored points to the stored chunks, so files with equal
+    * content keep one copy. Stored chunks never change, a
+    * file which changes them makes its own copy as above.
+    *
+    * Private content which wasn't read or written for a while
+    * may be compressed(see compress_file_content()), every
+    * chunk becomes an LZ block(see lz_block.h). Reads decode
+    * the chunks they need, the first change decompresses the
+    * whole content back into chunks.
+*/
+
+#ifndef FILE_CONTENT_H
+#define FILE_CONTENT_H
+
+#include "file_node_structs.h"
+#include "rw_lock.h"
+#include "slab_allocator.h"
+
+#define COMPRESSION_DISABLED UINT64_MAX // window of compressor which never ends
+
+/**
+ * @struct ContentStore
+ * @brief Hash table of shared contents, see store_file_content().
+ */
+struct ContentStore {
+    struct ContentShare** buckets;  /**< Chains of stored contents, NULL until first store */
+    uint32_t capacity;              /**< Amount of buckets */
+    uint32_t count;                 /**< Amount of stored contents */
+    uint64_t hits;                  /**< Writes which found their content already stored */
+    struct RwLock lock;             /**< Guards the table, hits and owner counts of stored contents */
+    uint8_t isEnabled;              /**< 1 if whole writes go through the store */
+};
+
+/**
+ * @struct ContentCompressor
+ * @brief Settings and counters of compressed file content.
+ */
+struct ContentCompressor {
+    uint64_t windowMs;                  /**< Content untouched for this long is compressed, see COMPRESSION_DISABLED */
+    _Atomic uint64_t files;             /**< Amount of files with compressed content */
+    _Atomic uint64_t uncompressedBytes; /**< Length of compressed contents */
+    _Atomic uint64_t compressedBytes;   /**< Memory taken by compressed contents */
+    _Atomic uint64_t compressions;      /**< Amount of contents compressed so far */
+    _Atomic uint64_t decompressions;    /**< Amount of contents decompressed because they changed */
+    _Atomic uint64_t decodedBytes;      /**< Bytes decoded for reads and decompressions so far */
+};
+
+/**
+ * @struct CompressionStats
+ * @brief Counters which show the CPU and memory trade of compression.
+ *
+ * Compression ratio is uncompressedBytes / compressedBytes,
+ * decodedBytes grows with the CPU spent on reads.
+ */
+struct CompressionStats {
+    uint64_t files;             /**< Amount of files with compressed content */
+    uint64_t uncompressedBytes; /**< Length of compressed contents */
+    uint64_t compressedBytes;   /**< Memory taken by compressed contents */
+    uint64_t compressions;      /**< Amount of contents compressed so far */
+    uint64_t decompressions;    /**< Amount of contents decompressed because they changed */
+    uint64_t decodedBytes;      /**< Bytes decoded for reads and decompressions so far */
+};
+
+/**
+ * @struct ContentStoreStats
+ * @brief Counters which show how much memory content store saves.
+ *
+ * Deduplication ratio is logicalBytes / uniqueBytes, 1 means
+ * no file shares its content with another one.
+ */
+struct ContentStoreStats {
+    uint64_t contents;      /**< Amount of stored contents */
+    uint64_t uniqueBytes;   /**< Length of stored contents, each counted once */
+    uint64_t logicalBytes;  /**< Length of stored contents, counted once per file */
+    uint64_t savedBytes;    /**< Bytes which aren't copied, logicalBytes - uniqueBytes */
+    uint64_t hits;          /**< Writes which found their content already stored */
+};
+
+/**
+    * Changes length of file content. New bytes are filled
+    * with zeros, chunks past the new end are freed. Compressed
+    * content is decompressed first.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be resized.
+    * @param[in] size The new length of content.
+    *
+    * @return Returns 1 if memory allocation failed, content
+    * isn't changed then, else returns 0.
+    *
+    * @pre allocator != NULL && file != NULL
+    * @pre file must have FILE_TYPE_FILE
+    * @pre file is write locked if it may be shared
+*/
+uint8_t resize_file_content(struct SlabAllocator* allocator, struct FileNode* file, uint64_t size);
+
+/**
+    * Copies bytes into file content.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be overwritten.
+    * @param[in] buffer The bytes which will be written.
+    * @param[in] size The amount of bytes.
+    * @param[in] offset The position of first written byte.
+    *
+    * @return Returns 1 if content is shared or compressed and
+    * memory allocation for its own copy failed, content isn't
+    * changed then, else returns 0.
+    *
+    * @pre allocator != NULL && file != NULL && buffer != NULL
+    * @pre offset + size <= file->info.data.contentSize
+    * @pre file is write locked if it may be shared
+*/
+uint8_t write_file_content(struct SlabAllocator* allocator, struct FileNode* file,
+                           const void* buffer, uint64_t size, uint64_t offset);
+
+/**
+    * Copies bytes from file content.
+    *
+    * @param[in] file The file which content will be read.
+    * @param[out] buffer The buffer where bytes will be copied.
+    * @param[in] size The maximum amount of bytes.
+    * @param[in] offset The position of first read byte.
+    *
+    * @return Returns amount of copied bytes, it is less than
+    * size if end of content is reached.
+    *
+    * @pre file != NULL && buffer != NULL
+*/
+uint64_t read_file_content_range(const struct FileNode* file, void* buffer, uint64_t size, uint64_t offset);
+
+/**
+    * Gets whole file content as one NUL-terminated block and
+    * publishes it in contentFlat. Content which fits in one
+    * chunk is published as it is, otherwise a contiguous copy
+    * is made and kept until the next change of content.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be returned.
+    *
+    * @return Returns NULL if file is empty or memory allocation
+    * failed, else returns content.
+    *
+    * @pre allocator != NULL && file != NULL
+*/
+char* flatten_file_content(struct SlabAllocator* allocator, struct FileNode* file);
+
+/**
+    * Copies content of one file to another in O(1). Both
+    * files point to the same chunks afterwards, the one
+    * which changes first copies them.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] destination The empty file where content will be copied.
+    * @param[in] source The file which content will be copied.
+    *
+    * @return Returns 1 if memory allocation failed, else returns 0.
+    *
+    * @pre allocator != NULL && destination != NULL && source != NULL
+    * @pre source is read locked
+*/
+uint8_t copy_file_content(struct SlabAllocator* allocator, struct FileNode* destination, const struct FileNode* source);
+
+/**
+    * Checks if file points to chunks which may be shared
+    * with copies.
+    *
+    * @param[in] file The file which will be checked.
+    *
+    * @return Returns 1 if chunks are shared, else returns 0.
+    *
+    * @pre file != NULL
+*/
+uint8_t is_file_content_shared(const struct FileNode* file);
+
+/**
+    * Replaces whole file content with bytes kept in content
+    * store. If equal bytes are stored already, file points to
+    * them, else they are copied and stored.
+    *
+    * @param[in,out] store The store where content is kept.
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be replaced.
+    * @param[in] buffer The new content.
+    * @param[in] size The length of new content.
+    *
+    * @return Returns 1 if memory allocation failed, content
+    * isn't changed then, else returns 0.
+    *
+    * @pre store != NULL && allocator != NULL && file != NULL
+    * @pre buffer != NULL || size == 0
+    * @pre file must have FILE_TYPE_FILE and is write locked
+*/
+uint8_t store_file_content(struct ContentStore* store, struct SlabAllocator* allocator, struct FileNode* file,
+                           const void* buffer, uint64_t size);
+
+/**
+    * Marks file content as used now, so it isn't compressed
+    * until it gets cold again.
+    *
+    * @param[in,out] file The file which content is read or written.
+    *
+    * @pre file != NULL
+*/
+void touch_file_content(struct FileNode* file);
+
+/**
+    * Compresses content of file if it wasn't touched within
+    * the window of compressor. Shared content and content
+    * which doesn't get smaller stay as they are. Contiguous
+    * copy published for readers is dropped from cold content.
+    *
+    * @param[in,out] compressor The compressor which settings are used and counters updated.
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content may be compressed.
+    *
+    * @return Returns 1 if content was compressed, else returns 0.
+    *
+    * @pre compressor != NULL && allocator != NULL && file != NULL
+    * @pre file must have FILE_TYPE_FILE and is write locked
+*/
+uint8_t compress_file_content(struct ContentCompressor* compressor, struct SlabAllocator* allocator,
+                              struct FileNode* file);
+
+/**
+    * Decompresses content of file back into chunks, content
+    * which isn't compressed is left as it is.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be decompressed.
+    *
+    * @return Returns 1 if memory allocation failed, content
+    * stays compressed then, else returns 0.
+    *
+    * @pre allocator != NULL && file != NULL
+    * @pre file is write locked
+*/
+uint8_t decompress_file_content(struct SlabAllocator* allocator, struct FileNode* file);
+
+/**
+    * Gets memory taken by compressed content of file.
+    *
+    * @param[in] file The file which will be checked.
+    *
+    * @return Returns 0 if content isn't compressed, else returns
+    * size of compressed content in bytes.
+    *
+    * @pre file != NULL
+*/
+uint64_t get_compressed_content_size(const struct FileNode* file);
+
+/**
+    * Gets counters of compressor.
+    *
+    * @param[in] compressor The compressor which is inspected.
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre compressor != NULL && stats != NULL
+*/
+void get_content_compressor_stats(const struct ContentCompressor* compressor, struct CompressionStats* stats);
+
+/**
+    * Gets counters of content store.
+    *
+    * @param[in,out] store The store which is inspected.
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre store != NULL && stats != NULL
+*/
+void get_content_store_stats(struct ContentStore* store, struct ContentStoreStats* stats);
+
+/**
+    * Frees all chunks of file content at once.
+    *
+    * @param[in,out] allocator The allocator which owns content memory.
+    * @param[in,out] file The file which content will be freed.
+    *
+    * @pre allocator != NULL && file != NULL
+    * @pre no reader can reach file anymore
+*/
+void free_file_content(struct SlabAllocator* allocator, struct FileNode* file);
+
+#endif //FILE_CONTENT_H
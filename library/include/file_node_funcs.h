@@ -4,19 +4,58 @@
     *
     * This file contains declaration of functions
     * related to files and file nodes.
+    *
+    * Functions may be called from several threads at once,
+    * except the ones which say otherwise. Locks are always
+    * taken in this order:
+    *   1. rename lock, written by change_file_node_name(),
+    *      change_file_node_location() and delete_file_node(),
+    *      read by every other change of the tree, so names and
+    *      parents can't change while a node is copied, a move
+    *      is checked or subtree totals(see wsfs_stat()) are
+    *      updated,
+    *   2. directory locks, when two directories are locked
+    *      (change_file_node_location()) the one with lower
+    *      address is locked first,
+    *   3. regular file locks,
+    *   4. content store lock, taken while file content is
+    *      replaced, shared or freed,
+    *   5. lookup cache, name index, query index, allocator,
+    *      tree snapshot list and work deque locks, which never
+    *      wait for anything else.
+    * find_file_node_in_curr_dir(), get_symlink_target(),
+    * read_file_content() and get_file_node_path() take no
+    * locks at all. They run inside an epoch(see epoch.h),
+    * deleted nodes, old names and old content are retired
+    * and freed only after every such reader has finished.
+    * File node pointers returned to the caller stay valid
+    * only until node is deleted, unless the caller keeps its
+    * own epoch by wsfs_epoch_enter() around their use.
+    *
+    * Every function which touches counters, limits, the
+    * allocator or the lookup cache has a *_ctx() variant
+    * taking the file system context(see wsfs_context.h),
+    * the plain one uses the default context. File nodes
+    * must only be passed to functions of the context which
+    * created them. The rename lock is owned by the context,
+    * so renames in different contexts don't wait for each
+    * other.
 */
 
 #ifndef FILE_H
 #define FILE_H
 
+#include "epoch.h"
 #include "file_node_structs.h"
+#include "slab_allocator.h"
+#include "wsfs_context.h"
 #include <stddef.h>
 
 /**
     * Create file node in "parent" directory. The caller is
     * responsible for freeing the memory allocated for the
-    * file node and it's name by calling free(). If name of
-    * the directory is "\" , it will be it's own parent.
+    * file node and it's name by calling free_file_node_recursive().
+    * If name of the directory is "\" , it will be it's own parent.
     *
     * @param[in] parent The directory where file node will be
     * located.
@@ -30,6 +69,43 @@
 */
 struct FileNode* create_file_node(struct FileNode* parent, const char* name, enum FileType type);
 
+/**
+    * Same as create_file_node(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* create_file_node_ctx(struct WsfsContext* context, struct FileNode* parent, const char* name,
+                                      enum FileType type);
+
+/**
+    * Creates file node while a tree is rebuilt, e.g. from a
+    * snapshot or an image. Limits and permissions aren't
+    * checked, counters are still updated. Content of regular
+    * file is zero filled, the caller writes it by
+    * write_file_content() before file is used.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    * @param[in] parent The directory where node will be located,
+    * NULL if node is the root and its own parent.
+    * @param[in] name The name of new file node.
+    * @param[in] properties The type and permissions of new file node.
+    * @param[in] times The creation, modification and access
+    * times of new file node.
+    * @param[in] contentSize The length of content if node is
+    * a regular file.
+    *
+    * @return Returns NULL if preconditions aren't met or memory
+    * allocation failed, else returns created file node.
+    *
+    * @pre context != NULL && name != NULL
+    * @pre parent must have FILE_TYPE_DIR
+*/
+struct FileNode* restore_file_node_ctx(struct WsfsContext* context, struct FileNode* parent, const char* name,
+                                       struct FileProperties properties, struct FileTimes times,
+                                       uint64_t contentSize);
+
 /**
     * Changes the permissions of file node.
     *
@@ -41,9 +117,19 @@ struct FileNode* create_file_node(struct FileNode* parent, const char* name, enu
     * returns 0.
     *
     * @pre node != NULL
+    * @pre node doesn't belong to a tree snapshot
 */
 uint8_t change_permissions(struct FileNode* node, enum Permissions permissions);
 
+/**
+    * Same as change_permissions(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t change_permissions_ctx(struct WsfsContext* context, struct FileNode* node, enum Permissions permissions);
+
 /**
     * Compares permissions.
     *
@@ -54,6 +140,18 @@ uint8_t change_permissions(struct FileNode* node, enum Permissions permissions);
 */
 uint8_t is_permissions_equal(enum Permissions left, enum Permissions right);
 
+/**
+    * Checks if file node may be changed.
+    *
+    * @param[in] node The file node which will be checked.
+    *
+    * @return Returns 1 if node has WRITE permission and
+    * doesn't belong to a tree snapshot, else returns 0.
+    *
+    * @pre node != NULL
+*/
+uint8_t is_file_node_writable(const struct FileNode* node);
+
 /**
     * Sets root node.
     *
@@ -63,6 +161,15 @@ uint8_t is_permissions_equal(enum Permissions left, enum Permissions right);
 */
 void set_root_node(struct FileNode* node);
 
+/**
+    * Same as set_root_node(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_root_node_ctx(struct WsfsContext* context, struct FileNode* node);
+
 /**
     * Returns root node.
     *
@@ -71,7 +178,18 @@ void set_root_node(struct FileNode* node);
 struct FileNode* get_root_node();
 
 /**
-    * Gets size of file node recursively.
+    * Same as get_root_node(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* get_root_node_ctx(const struct WsfsContext* context);
+
+/**
+    * Gets size of file node with its subtree in O(1). Every
+    * directory keeps totals of its subtree, which changes
+    * add to all the way up to the root.
     *
     * @param[in] node The node which size user wants to
     * get.
@@ -84,6 +202,24 @@ struct FileNode* get_root_node();
 */
 size_t get_file_node_size(const struct FileNode* node);
 
+/**
+    * Gets attributes of file node in O(1), subtree totals
+    * included. Symlink is described itself, not its target.
+    * Sizes and counts of node without READ permission are 0.
+    *
+    * @param[in] node The node which will be described.
+    * @param[out] stat The structure where attributes will be written.
+    *
+    * @return Returns 1 if preconditions aren't met, else
+    * returns 0.
+    *
+    * @pre node != NULL && stat != NULL
+    *
+    * @note Totals of directory are exact once changes below it
+    * have finished, changes in progress may be partly counted.
+*/
+uint8_t wsfs_stat(const struct FileNode* node, struct WsfsStat* stat);
+
 /**
     * Changes current directory.
     *
@@ -99,7 +235,8 @@ size_t get_file_node_size(const struct FileNode* node);
 uint8_t change_current_dir(struct FileNode** currentDir, struct FileNode* newCurrentDir);
 
 /**
-    * Add "child" file node to "parent" directory's linked list.
+    * Add "child" file node to the end of "parent" directory's
+    * linked list. It takes constant time.
     *
     * @param[in] parent The directory where file node will be
     * located.
@@ -109,10 +246,71 @@ uint8_t change_current_dir(struct FileNode** currentDir, struct FileNode* newCur
     * @return Returns 1 if preconditions aren't met, else returns 0.
     *
     * @pre parent != NULL && child != NULL
+    * @pre parent must have FILE_TYPE_DIR
     * @pre parent must have WRITE permission
 */
 uint8_t add_to_dir(struct FileNode* restrict parent, struct FileNode* restrict child);
 
+/**
+    * Same as add_to_dir(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t add_to_dir_ctx(struct WsfsContext* context, struct FileNode* restrict parent, struct FileNode* restrict child);
+
+/**
+    * Gets amount of file nodes in directory without walking
+    * it's linked list.
+    *
+    * @param[in] dir The directory which children will be counted.
+    *
+    * @return Returns 0 if preconditions aren't met, else
+    * returns amount of children.
+    *
+    * @pre dir != NULL
+    * @pre dir must have FILE_TYPE_DIR
+*/
+uint32_t get_dir_child_count(const struct FileNode* dir);
+
+/**
+    * Gets the next children of directory in ascending order
+    * of name (bytewise, children which share a name follow
+    * in order of address). Every batch resumes after the
+    * child named in cookie, so directory may change between
+    * batches: child which stays in directory during the whole
+    * listing is listed exactly once, children which are
+    * added, removed or renamed meanwhile may be listed or not.
+    * A batch costs two binary searches in directories with a
+    * hash index(see dir_index.h), smaller ones are scanned.
+    *
+    * @param[in] dir The directory which children will be listed.
+    * @param[in,out] cookie The position of listing, initialized by
+    * WSFS_DIR_COOKIE_INIT and moved past the written children.
+    * @param[out] children The array where children will be written.
+    * @param[in] capacity The amount of children which fit into array.
+    *
+    * @return Returns 0 if preconditions aren't met, memory
+    * allocation failed or every child was listed, else
+    * returns amount of written children.
+    *
+    * @pre dir != NULL && cookie != NULL && children != NULL && capacity > 0
+    * @pre dir must have FILE_TYPE_DIR
+    *
+    * @note Name of cookie is freed once listing ends, call
+    * wsfs_release_dir_cookie() to stop listing earlier.
+*/
+uint32_t wsfs_readdir(const struct FileNode* dir, struct WsfsDirCookie* cookie, struct FileNode** children,
+                      uint32_t capacity);
+
+/**
+    * Frees name of cookie and resets it to the first child.
+    *
+    * @param[in,out] cookie The cookie which will be reset.
+*/
+void wsfs_release_dir_cookie(struct WsfsDirCookie* cookie);
+
 /**
     * Get file type first letter.
     *
@@ -146,6 +344,15 @@ char get_permission_letter(enum Permissions permission);
 */
 uint8_t set_symlink_target(struct FileNode* symlink, struct FileNode* target);
 
+/**
+    * Same as set_symlink_target(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t set_symlink_target_ctx(struct WsfsContext* context, struct FileNode* symlink, struct FileNode* target);
+
 /**
     * Gets the target of symbolic link.
     *
@@ -161,7 +368,9 @@ uint8_t set_symlink_target(struct FileNode* symlink, struct FileNode* target);
 struct FileNode* get_symlink_target(struct FileNode* symlink);
 
 /**
-    * Write content into file.
+    * Write content into file. If deduplication is enabled
+    * (see set_dedup_enabled()), file shares content with other
+    * files written with equal content.
     *
     * @param[in] node The file in which text will be written.
     * @param[in] content The content which will be written into file.
@@ -173,20 +382,168 @@ struct FileNode* get_symlink_target(struct FileNode* symlink);
 */
 uint8_t write_to_file(struct FileNode* node, const char* content);
 
+/**
+    * Same as write_to_file(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t write_to_file_ctx(struct WsfsContext* context, struct FileNode* node, const char* content);
+
 /**
     * Reads content from file.
     *
     * @param[in] node The file node from which content will
     * be read.
     *
-    * @return Returns NULL if preconditions aren't met, else
-    * returns the content of file.
+    * @return Returns NULL if preconditions aren't met or file
+    * is empty, else returns the content of file.
     *
     * @pre node != NULL
     * @pre node must have WRITE and READ permission
+    *
+    * @note Content longer than one chunk is copied to a
+    * contiguous block which lives until the next change of
+    * file. Only the first call after a change takes the file
+    * lock. Content stays allocated while the caller is inside
+    * an epoch, but a concurrent write may change it in place,
+    * use wsfs_pread() to read big or binary files, or files
+    * which other threads may write at the same time.
 */
 char* read_file_content(struct FileNode* node);
 
+/**
+    * Same as read_file_content(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+char* read_file_content_ctx(struct WsfsContext* context, struct FileNode* node);
+
+/**
+    * Writes bytes into file at given offset. File is extended
+    * if write goes past its end, gap is filled with zeros.
+    * Costs O(size), the rest of content isn't copied.
+    *
+    * @param[in] node The file in which bytes will be written.
+    * @param[in] buffer The bytes which will be written.
+    * @param[in] size The amount of bytes.
+    * @param[in] offset The position of first written byte.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * limit is reached or memory allocation failed, else
+    * returns 0.
+    *
+    * @pre node != NULL && buffer != NULL
+    * @pre node must have WRITE and READ permission
+*/
+uint8_t wsfs_pwrite(struct FileNode* node, const void* buffer, uint64_t size, uint64_t offset);
+
+/**
+    * Same as wsfs_pwrite(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_pwrite_ctx(struct WsfsContext* context, struct FileNode* node, const void* buffer,
+                        uint64_t size, uint64_t offset);
+
+/**
+    * Reads bytes from file at given offset.
+    *
+    * @param[in] node The file from which bytes will be read.
+    * @param[out] buffer The buffer where bytes will be copied.
+    * @param[in] size The maximum amount of bytes.
+    * @param[in] offset The position of first read byte.
+    *
+    * @return Returns 0 if preconditions aren't met or offset
+    * is past the end of file, else returns amount of read bytes.
+    *
+    * @pre node != NULL && buffer != NULL
+    * @pre node must have READ permission
+*/
+uint64_t wsfs_pread(struct FileNode* node, void* buffer, uint64_t size, uint64_t offset);
+
+/**
+    * Writes bytes at the end of file.
+    *
+    * @param[in] node The file in which bytes will be written.
+    * @param[in] buffer The bytes which will be written.
+    * @param[in] size The amount of bytes.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * limit is reached or memory allocation failed, else
+    * returns 0.
+    *
+    * @pre node != NULL && buffer != NULL
+    * @pre node must have WRITE and READ permission
+*/
+uint8_t wsfs_append(struct FileNode* node, const void* buffer, uint64_t size);
+
+/**
+    * Same as wsfs_append(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_append_ctx(struct WsfsContext* context, struct FileNode* node, const void* buffer, uint64_t size);
+
+/**
+    * Changes length of file. New bytes are filled with zeros.
+    *
+    * @param[in] node The file which will be truncated.
+    * @param[in] size The new length of file.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * limit is reached or memory allocation failed, else
+    * returns 0.
+    *
+    * @pre node != NULL
+    * @pre node must have WRITE and READ permission
+*/
+uint8_t wsfs_truncate(struct FileNode* node, uint64_t size);
+
+/**
+    * Same as wsfs_truncate(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_truncate_ctx(struct WsfsContext* context, struct FileNode* node, uint64_t size);
+
+/**
+    * Gets length of file content.
+    *
+    * @param[in] node The file which length will be returned.
+    *
+    * @return Returns 0 if preconditions aren't met, else
+    * returns length of content in bytes.
+    *
+    * @pre node != NULL
+    * @pre node must have READ permission
+*/
+uint64_t get_file_content_size(struct FileNode* node);
+
+/**
+    * Gets memory taken by compressed content of file, see
+    * compress_cold_files(). Its uncompressed length is
+    * returned by get_file_content_size().
+    *
+    * @param[in] node The file which will be checked.
+    *
+    * @return Returns 0 if preconditions aren't met or content
+    * isn't compressed, else returns compressed size in bytes.
+    *
+    * @pre node != NULL
+    * @pre node must have READ permission
+*/
+uint64_t get_file_compressed_size(struct FileNode* node);
+
 /**
     * Find file node by name in current directory.
     *
@@ -200,23 +557,144 @@ char* read_file_content(struct FileNode* node);
     *
     * @pre currentDir != NULL && name != NULL
     * @pre currentDir must have READ and EXEC permission
+    *
+    * @note Search takes no lock, it is repeated if a rename
+    * or move happened meanwhile.
 */
 struct FileNode* find_file_node_in_curr_dir(const struct FileNode* currentDir, const char* name);
 
 /**
-    * Find file node by name in entire file system.
+    * Same as find_file_node_in_curr_dir(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* find_file_node_in_curr_dir_ctx(struct WsfsContext* context, const struct FileNode* currentDir,
+                                                const char* name);
+
+/**
+    * Find file node by name in entire file system. Nodes are
+    * looked up in name index of context, names which no node
+    * has are rejected by its filter without any lock.
     *
     * @param[in,out] root The root directory.
     * @param[in] name The name of the file node which user
     * wants to find.
     *
-    * @return Returns NULL if preconditions aren't met, else
-    * returns found file node.
+    * @return Returns NULL if preconditions aren't met or there
+    * is no such node in subtree of root, else returns found
+    * file node.
     *
     * @pre root != NULL && name != NULL
+    *
+    * @note If several nodes share a name, it is not specified
+    * which one of them will be found(see find_file_nodes_in_fs()).
 */
 struct FileNode* find_file_node_in_fs(const struct FileNode* root, const char* name);
 
+/**
+    * Same as find_file_node_in_fs(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* find_file_node_in_fs_ctx(struct WsfsContext* context, const struct FileNode* root, const char* name);
+
+/**
+    * Finds all file nodes with given name in subtree of root,
+    * root itself included. The caller is responsible for
+    * freeing the array by calling free().
+    *
+    * @param[in] root The directory which subtree is searched.
+    * @param[in] name The name of file nodes.
+    * @param[out] count The amount of found nodes.
+    *
+    * @return Returns NULL if preconditions aren't met, memory
+    * allocation failed or there is no such node, else returns
+    * array of found file nodes in no particular order.
+    *
+    * @pre root != NULL && name != NULL && count != NULL
+*/
+struct FileNode** find_file_nodes_in_fs(const struct FileNode* root, const char* name, uint32_t* count);
+
+/**
+    * Same as find_file_nodes_in_fs(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode** find_file_nodes_in_fs_ctx(struct WsfsContext* context, const struct FileNode* root,
+                                            const char* name, uint32_t* count);
+
+/**
+    * Checks if file node is one of the searched ones.
+    *
+    * @param[in] node The file node which will be checked.
+    * @param[in,out] argument The argument passed to the search.
+    *
+    * @return Returns 1 if node is searched, else returns 0.
+*/
+typedef uint8_t (*FileNodePredicate)(const struct FileNode* node, void* argument);
+
+/**
+    * Finds all file nodes in subtree of root, root itself
+    * included, which meet predicate. Subtree is searched by
+    * workers of context(see work_pool.h), so predicate may be
+    * called from several threads at once. The caller is
+    * responsible for freeing the array by calling free().
+    *
+    * @param[in] root The node which subtree is searched.
+    * @param[in] predicate The condition of found nodes.
+    * @param[in,out] argument The argument passed to predicate.
+    * @param[in] isOrdered 1 if nodes are returned in pre-order
+    * with siblings ordered by name, 0 if order doesn't matter.
+    * @param[out] count The amount of found nodes.
+    *
+    * @return Returns NULL if preconditions aren't met, memory
+    * allocation failed or there is no such node, else returns
+    * array of found file nodes.
+    *
+    * @pre root != NULL && predicate != NULL && count != NULL
+    * @pre predicate doesn't change file nodes
+    *
+    * @note Moves and deletes wait until search is finished.
+*/
+struct FileNode** find_file_nodes_matching(struct FileNode* root, FileNodePredicate predicate, void* argument,
+                                           uint8_t isOrdered, uint32_t* count);
+
+/**
+    * Same as find_file_nodes_matching(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode** find_file_nodes_matching_ctx(struct WsfsContext* context, struct FileNode* root,
+                                               FileNodePredicate predicate, void* argument, uint8_t isOrdered,
+                                               uint32_t* count);
+
+/**
+    * Gets counters of name index, which shows how many
+    * lookups by name were answered by its filter.
+    *
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre stats != NULL
+*/
+void get_name_lookup_stats(struct NameIndexStats* stats);
+
+/**
+    * Same as get_name_lookup_stats(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void get_name_lookup_stats_ctx(struct WsfsContext* context, struct NameIndexStats* stats);
+
 /**
     * Get file node path. The caller is responsible for freeing
     * the memory allocated for the file node by calling free().
@@ -230,6 +708,15 @@ struct FileNode* find_file_node_in_fs(const struct FileNode* root, const char* n
 */
 char* get_file_node_path(const struct FileNode* node);
 
+/**
+    * Same as get_file_node_path(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+char* get_file_node_path_ctx(struct WsfsContext* context, const struct FileNode* node);
+
 /**
     * Copy file node to location.
     *
@@ -241,17 +728,36 @@ char* get_file_node_path(const struct FileNode* node);
     * @pre node != NULL && location != NULL
     * @pre location must have WRITE permission
     * @pre node must have WRITE permission
+    * @pre location isn't node or a directory inside node
 */
 uint8_t change_file_node_location(struct FileNode* restrict location, struct FileNode* restrict node);
 
 /**
-    * Changes file node location. The caller is responsible for freeing
-    * the memory allocated for the file node by calling free().
+    * Same as change_file_node_location(), in given context.
     *
-    * @param[in,out] node The file node whose location will be changed.
-    * @param[in] location The file node where node will be located.
+    * @param[in,out] context The context which owns file nodes.
     *
-    * @return Returns 1 if preconditions aren't met, else returns 0.
+    * @pre context != NULL
+*/
+uint8_t change_file_node_location_ctx(struct WsfsContext* context, struct FileNode* restrict location,
+                                      struct FileNode* restrict node);
+
+/**
+    * Copies file node with its whole subtree into location.
+    * Content of regular files is shared with the originals
+    * until either side changes(see copy_file_content()), so
+    * only nodes and names are allocated. Directories are
+    * copied by workers of context(see work_pool.h), the copy
+    * is linked once it is complete.
+    * Copies of tree snapshot nodes may be changed, so a
+    * snapshot is restored by copying from it.
+    *
+    * @param[in] node The file node which will be copied.
+    * @param[in,out] location The directory where copy will be located.
+    *
+    * @return Returns 1 if preconditions aren't met, memory or
+    * file count limit is reached or memory allocation failed,
+    * nothing is copied then, else returns 0.
     *
     * @pre node != NULL && location != NULL
     * @pre location must have FILE_TYPE_DIR
@@ -260,8 +766,18 @@ uint8_t change_file_node_location(struct FileNode* restrict location, struct Fil
 uint8_t copy_file_node(struct FileNode* restrict location, const struct FileNode* restrict node);
 
 /**
-    * Changes file node name. The caller is responsible for freeing
-    * the memory allocated for the file node's name by calling free().
+    * Same as copy_file_node(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t copy_file_node_ctx(struct WsfsContext* context, struct FileNode* restrict location,
+                           const struct FileNode* restrict node);
+
+/**
+    * Changes file node name. New name is published at once,
+    * memory of old name is retired.
     *
     * @param[in,out] node The file node whose name will be changed.
     * @param[in] name The new name of file node.
@@ -273,6 +789,15 @@ uint8_t copy_file_node(struct FileNode* restrict location, const struct FileNode
 */
 uint8_t change_file_node_name(struct FileNode* node, const char* name);
 
+/**
+    * Same as change_file_node_name(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t change_file_node_name_ctx(struct WsfsContext* context, struct FileNode* node, const char* name);
+
 /**
     * Delete file node (and it's children if it is a directory) in
     * current directory.
@@ -284,42 +809,458 @@ uint8_t change_file_node_name(struct FileNode* node, const char* name);
     * @return Returns 1 if preconditions aren't met, else returns 0.
     *
     * @pre currentDir != NULL && node != NULL
+    * @pre node must be located in currentDir
+    * @pre currentDir doesn't belong to a tree snapshot
 */
 uint8_t delete_file_node(struct FileNode* restrict currentDir, struct FileNode* restrict node);
 
+/**
+    * Same as delete_file_node(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t delete_file_node_ctx(struct WsfsContext* context, struct FileNode* restrict currentDir,
+                             struct FileNode* restrict node);
+
+/**
+    * Takes named read-only snapshot of the whole tree. Every
+    * node is copied as in copy_file_node(), content of regular
+    * files is shared until live files change. Nodes of snapshot
+    * can't be changed, moved or deleted, but may be read,
+    * looked up from snapshot root and copied back into tree.
+    * Snapshots stay in memory only, they aren't journaled or
+    * saved, and are charged to limits like other file nodes.
+    *
+    * @param[in] name The name of snapshot.
+    *
+    * @return Returns 1 if there is no root, snapshot with
+    * such name exists, memory or file count limit is reached
+    * or memory allocation failed, else returns 0.
+    *
+    * @pre name != NULL
+*/
+uint8_t create_tree_snapshot(const char* name);
+
+/**
+    * Same as create_tree_snapshot(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t create_tree_snapshot_ctx(struct WsfsContext* context, const char* name);
+
+/**
+    * Gets root directory of tree snapshot.
+    *
+    * @param[in] name The name of snapshot.
+    *
+    * @return Returns NULL if there is no such snapshot, else
+    * returns its root, which stays valid until the snapshot
+    * is deleted.
+    *
+    * @pre name != NULL
+*/
+struct FileNode* get_tree_snapshot(const char* name);
+
+/**
+    * Same as get_tree_snapshot(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* get_tree_snapshot_ctx(struct WsfsContext* context, const char* name);
+
+/**
+    * Deletes tree snapshot. Shared content is freed once no
+    * file points to it.
+    *
+    * @param[in] name The name of snapshot.
+    *
+    * @return Returns 1 if there is no such snapshot, else
+    * returns 0.
+    *
+    * @pre name != NULL
+*/
+uint8_t delete_tree_snapshot(const char* name);
+
+/**
+    * Same as delete_tree_snapshot(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t delete_tree_snapshot_ctx(struct WsfsContext* context, const char* name);
+
 /**
     * Frees allocated memory of file node (and it's children
-    * if it is a directory).
+    * if it is a directory). Counters are updated at once,
+    * memory is freed when no thread inside an epoch can
+    * reach it anymore. Subtree is split by directory among
+    * workers of context(see work_pool.h), so it may have any
+    * width and depth.
     *
     * @param[in] node The file node user wants to free.
     *
-    * @return Returns 1 if preconditions aren't met, else returns 0.
+    * @return Returns 1 if preconditions aren't met, else
+    * returns 0.
     *
     * @pre node != NULL
+    * @pre no other thread can reach node, use delete_file_node()
+    * for nodes which are located in shared directories
 */
 uint8_t free_file_node_recursive(struct FileNode* node);
 
 /**
-    * Retrieves the current local time (hour and minute).
+    * Same as free_file_node_recursive(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
     *
-    * @return Returns the current hour and minute.
+    * @pre context != NULL
+*/
+uint8_t free_file_node_recursive_ctx(struct WsfsContext* context, struct FileNode* node);
+
+/**
+    * Retrieves the current time from the coarse wall clock,
+    * which is read without a system call or a lock, so it is
+    * cheap enough for every create, write and read. The clock
+    * advances once per kernel tick. Every thread keeps its
+    * last reading, so times taken by one thread never go back
+    * even if the clock is stepped. Times are converted into
+    * calendar fields only when they are displayed.
+    *
+    * @return Returns nanoseconds since Unix epoch.
 */
-struct Timestamp get_current_time(void);
+uint64_t get_current_time(void);
 
 /**
-    * Check if used memory isn't bigger than MAX_MEMORY_SIZE.
+    * Check if "newMemory" more bytes fit into the memory limit.
+    * Uses the running memory counter, so it doesn't walk
+    * the tree.
+    *
+    * @param[in] newMemory The amount of bytes that are going
+    * to be allocated.
     *
     * @return Returns 1 if there is memory available, else
     * returns 0.
 */
-uint8_t is_enough_memory(unsigned long long newMemory);
+uint8_t is_enough_memory(uint64_t newMemory);
 
 /**
-    * Check if file count is smaller than MAX_FILE_COUNT.
+    * Same as is_enough_memory(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t is_enough_memory_ctx(const struct WsfsContext* context, uint64_t newMemory);
+
+/**
+    * Check if file count is smaller than the file count limit.
     *
     * @return Returns 1 if file count is within limit, else
     * returns 0.
 */
-uint8_t is_file_count_within_limit();
+uint8_t is_file_count_within_limit(void);
+
+/**
+    * Same as is_file_count_within_limit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint8_t is_file_count_within_limit_ctx(const struct WsfsContext* context);
+
+/**
+    * Sets the memory limit of file system. Defaults to
+    * MAX_MEMORY_SIZE.
+    *
+    * @param[in] limit The new memory limit in bytes.
+    *
+    * @note Lowering the limit below currently used memory
+    * doesn't free anything, it only blocks new allocations.
+    * Must not be called while other threads use file system.
+*/
+void set_memory_limit(uint64_t limit);
+
+/**
+    * Same as set_memory_limit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_memory_limit_ctx(struct WsfsContext* context, uint64_t limit);
+
+/**
+    * Gets the memory limit of file system.
+    *
+    * @return Returns the memory limit in bytes.
+*/
+uint64_t get_memory_limit(void);
+
+/**
+    * Same as get_memory_limit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint64_t get_memory_limit_ctx(const struct WsfsContext* context);
+
+/**
+    * Sets the file count limit of file system. Defaults to
+    * MAX_FILE_COUNT.
+    *
+    * @param[in] limit The new maximal amount of file nodes.
+    *
+    * @note Must not be called while other threads use file system.
+*/
+void set_file_count_limit(uint64_t limit);
+
+/**
+    * Same as set_file_count_limit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_file_count_limit_ctx(struct WsfsContext* context, uint64_t limit);
+
+/**
+    * Gets the file count limit of file system.
+    *
+    * @return Returns the maximal amount of file nodes.
+*/
+uint64_t get_file_count_limit(void);
+
+/**
+    * Same as get_file_count_limit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint64_t get_file_count_limit_ctx(const struct WsfsContext* context);
+
+/**
+    * Gets the amount of memory used by all file nodes. Counter
+    * is updated on every create, write, rename, copy and free.
+    *
+    * @return Returns used memory in bytes.
+*/
+uint64_t get_used_memory(void);
+
+/**
+    * Same as get_used_memory(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint64_t get_used_memory_ctx(const struct WsfsContext* context);
+
+/**
+    * Gets the amount of existing file nodes.
+    *
+    * @return Returns file node count.
+*/
+uint64_t get_file_count(void);
+
+/**
+    * Same as get_file_count(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint64_t get_file_count_ctx(const struct WsfsContext* context);
+
+/**
+    * Sets how file system memory is released. In arena mode
+    * wsfs_deinit() drops all file nodes at once instead of
+    * freeing them one by one.
+    *
+    * @param[in] mode The allocator mode(use ALLOCATOR_MODE_*).
+    *
+    * @note Must not be called while other threads use file system.
+*/
+void set_allocator_mode(enum AllocatorMode mode);
+
+/**
+    * Same as set_allocator_mode(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_allocator_mode_ctx(struct WsfsContext* context, enum AllocatorMode mode);
+
+/**
+    * Gets how file system memory is released.
+    *
+    * @return Returns allocator mode.
+*/
+enum AllocatorMode get_allocator_mode(void);
+
+/**
+    * Same as get_allocator_mode(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+enum AllocatorMode get_allocator_mode_ctx(const struct WsfsContext* context);
+
+/**
+    * Gets occupancy of the allocator which holds file nodes,
+    * names, file content and directory indexes.
+    *
+    * @param[out] stats The structure where occupancy will be written.
+    *
+    * @pre stats != NULL
+*/
+void get_allocator_stats(struct AllocatorStats* stats);
+
+/**
+    * Same as get_allocator_stats(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void get_allocator_stats_ctx(struct WsfsContext* context, struct AllocatorStats* stats);
+
+/**
+    * Enables or disables deduplication of file content.
+    * While it is enabled, write_to_file() keeps content in the
+    * content store(see file_content.h), so files written with
+    * equal content share one copy until one of them changes.
+    * Disabled by default. Memory counter is charged for every
+    * file as if it had its own copy.
+    *
+    * @param[in] isEnabled 1 to enable deduplication, 0 to disable it.
+    *
+    * @note Contents stored while it was enabled stay shared.
+    * Only whole writes are deduplicated, wsfs_pwrite() and
+    * others change content in place. Must not be called while
+    * other threads use file system.
+*/
+void set_dedup_enabled(uint8_t isEnabled);
+
+/**
+    * Same as set_dedup_enabled(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_dedup_enabled_ctx(struct WsfsContext* context, uint8_t isEnabled);
+
+/**
+    * Gets counters of deduplicated file content, such as
+    * bytes saved by sharing and deduplication ratio.
+    *
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre stats != NULL
+*/
+void get_dedup_stats(struct ContentStoreStats* stats);
+
+/**
+    * Same as get_dedup_stats(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void get_dedup_stats_ctx(struct WsfsContext* context, struct ContentStoreStats* stats);
+
+/**
+    * Sets how long file content has to stay untouched(not
+    * read or written) before compress_cold_files() compresses
+    * it. Reads of compressed content decode it transparently,
+    * the first change decompresses it. Memory counter is
+    * charged for compressed size, so compression leaves room
+    * for more content within memory limit.
+    *
+    * @param[in] windowMs The window in milliseconds, COMPRESSION_DISABLED
+    * (default) if content is never compressed.
+    *
+    * @note Must not be called while other threads use file system.
+*/
+void set_compression_window(uint64_t windowMs);
+
+/**
+    * Same as set_compression_window(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void set_compression_window_ctx(struct WsfsContext* context, uint64_t windowMs);
+
+/**
+    * Compresses content of every file in the tree which wasn't
+    * touched within the compression window. Shared content and
+    * content which doesn't get smaller aren't compressed. Call
+    * it periodically, e.g. from a timer thread.
+    *
+    * @return Returns amount of files which content was compressed.
+    *
+    * @note Directories on the path of visited file are read
+    * locked and renames wait until the sweep is finished.
+*/
+uint64_t compress_cold_files(void);
+
+/**
+    * Same as compress_cold_files(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+uint64_t compress_cold_files_ctx(struct WsfsContext* context);
+
+/**
+    * Gets counters of compressed file content.
+    *
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre stats != NULL
+*/
+void get_compression_stats(struct CompressionStats* stats);
+
+/**
+    * Same as get_compression_stats(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void get_compression_stats_ctx(struct WsfsContext* context, struct CompressionStats* stats);
+
+/**
+    * Frees every file node at once by releasing all allocator
+    * memory. Every file node pointer becomes invalid, counters
+    * and root node are reset.
+    *
+    * @note Must not be called while other threads use file system.
+*/
+void release_all_file_nodes(void);
+
+/**
+    * Same as release_all_file_nodes(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes.
+    *
+    * @pre context != NULL
+*/
+void release_all_file_nodes_ctx(struct WsfsContext* context);
 
 #endif //FILE_H
\ No newline at end of file
@@ -10,6 +10,10 @@
 #define FILE_NODE_STRUCTS_H
 
 #include <stdint.h>
+#include "rw_lock.h"
+
+#define INLINE_NAME_SIZE 24 // names shorter than this are stored inside file node
+#define FILE_CHUNK_SIZE 4096 // file content is stored in chunks of this size
 
 /**
  * @enum FileType
@@ -34,18 +38,51 @@ enum Permissions {
     PERM_DEFAULT = 7    /**< All permissions */
 };
 
+/**
+ * @enum LookupFlags
+ * @brief Defines which symbolic links are followed during path lookup.
+ */
+enum LookupFlags {
+    LOOKUP_FOLLOW_NONE = 0,         /**< Symbolic links aren't followed */
+    LOOKUP_FOLLOW_INTERMEDIATE = 1, /**< Symbolic links in the middle of path are followed */
+    LOOKUP_FOLLOW_LAST = 2,         /**< Symbolic link at the end of path is followed */
+    LOOKUP_FOLLOW_ALL = 3           /**< All symbolic links are followed */
+};
+
+/**
+ * @enum OpenFlags
+ * @brief Defines how file handle may be used.
+ */
+enum OpenFlags {
+    OPEN_READ = 1,      /**< File may be read */
+    OPEN_WRITE = 2,     /**< File may be written */
+    OPEN_APPEND = 4,    /**< Every write goes to the end of file */
+    OPEN_TRUNCATE = 8   /**< File is emptied on open */
+};
+
+/**
+ * @enum SeekOrigin
+ * @brief Defines from where seek offset is counted.
+ */
+enum SeekOrigin {
+    SEEK_ORIGIN_SET = 0,     /**< From the beginning of file */
+    SEEK_ORIGIN_CURRENT = 1, /**< From the current position */
+    SEEK_ORIGIN_END = 2      /**< From the end of file */
+};
+
 struct FileNode; /**< Forward declaration of FileNode struct */
+struct DirIndex; /**< Forward declaration of DirIndex struct */
+struct ContentShare; /**< Forward declaration of ContentShare struct */
+struct CompressedContent; /**< Forward declaration of CompressedContent struct */
 
 /**
- * @struct Timestamp
- * @brief Represents a time value with hour and minute.
+ * @struct FileTimes
+ * @brief Times of a file node in nanoseconds since Unix epoch, see get_current_time().
  */
-struct Timestamp {
-    uint16_t year;  /**< Year value (0-65535) */
-    uint8_t month;  /**< Year value (0-11) */
-    uint8_t day;  /**< Year value (1-31) */
-    uint8_t hour;   /**< Hour value (0-23) */
-    uint8_t minute; /**< Minute value (0-59) */
+struct FileTimes {
+    uint64_t creationTime;      /**< Time of file creation */
+    uint64_t modificationTime;  /**< Time of the last change of content (or of child list, if directory) */
+    uint64_t accessTime;        /**< Time of the last read or write of content */
 };
 
 /**
@@ -53,8 +90,13 @@ struct Timestamp {
  * @brief Contains metadata related to a file.
  */
 struct FileMetadata {
-    char* name;                     /**< Name of the file */
-    struct Timestamp creationTime;  /**< Timestamp of file creation */
+    char* _Atomic name;                     /**< Name of the file, points to inlineName for short names */
+    _Atomic uint32_t nameHash;              /**< Cached hash of the name */
+    _Atomic uint32_t nameLength;            /**< Cached length of the name */
+    char inlineName[INLINE_NAME_SIZE];      /**< Storage for names shorter than INLINE_NAME_SIZE */
+    uint64_t creationTime;                  /**< Time of file creation, see FileTimes */
+    _Atomic uint64_t modificationTime;      /**< Time of the last change of content or child list */
+    _Atomic uint64_t accessTime;            /**< Time of the last read or write of content */
 };
 
 /**
@@ -64,6 +106,7 @@ struct FileMetadata {
 struct FileProperties {
     enum FileType type;             /**< Type of the file */
     enum Permissions permissions;   /**< File permissions */
+    uint8_t isReadOnly;             /**< 1 if node belongs to a tree snapshot and can't be changed */
 };
 
 /**
@@ -72,9 +115,29 @@ struct FileProperties {
  */
 struct FileData {
     union {
-        struct FileNode* directoryContent; /**< Pointer to directory content (if directory) */
-        struct FileNode* symlinkTarget;    /**< Pointer to symbolic link target (if symlink) */
-        char* fileContent;                 /**< Pointer to file content (if regular file) */
+        struct {
+            struct FileNode* _Atomic directoryContent; /**< Pointer to directory content (if directory) */
+            struct FileNode* directoryTail;            /**< Pointer to the last node of directory content */
+            struct DirIndex* _Atomic directoryIndex;   /**< Hash index of directory content, NULL until directory grows */
+            uint32_t childCount;               /**< Amount of nodes in directory content */
+            uint8_t isForgotten;               /**< 1 once deleted directory's children left lookup cache */
+            _Atomic uint64_t subtreeSize;      /**< Size of directory and its subtree, see get_file_node_size() */
+            _Atomic uint64_t subtreeCount;     /**< Amount of nodes in subtree, directory included */
+        };
+        struct FileNode* _Atomic symlinkTarget; /**< Pointer to symbolic link target (if symlink) */
+        struct {
+            union {
+                char* fileContent;         /**< The only content chunk, NUL-terminated (if regular file) */
+                char** contentChunks;      /**< Table of content chunks (if content takes several chunks) */
+            };
+            char* _Atomic contentFlat;     /**< Content published by read_file_content(), NULL until it is needed */
+            uint64_t contentSize;          /**< Length of content in bytes */
+            uint32_t contentChunkCount;    /**< Amount of content chunks */
+            uint32_t contentTableCapacity; /**< Capacity of chunk table, 1 or less means fileContent is used */
+            uint32_t contentTailCapacity;  /**< Capacity of the last chunk, others hold FILE_CHUNK_SIZE bytes */
+            struct ContentShare* _Atomic contentShare; /**< Owners of shared chunks, NULL if chunks are private */
+            struct CompressedContent* contentCompressed; /**< Compressed chunks, NULL if content isn't compressed */
+        };
     };
 };
 
@@ -91,11 +154,55 @@ struct FileInfo {
 /**
  * @struct FileNode
  * @brief Represents a file node in the file system.
+ *
+ * Links are placed before info, so directory scans and path
+ * building (next, parent, name hash and inline name) only
+ * touch the first cache line of node.
+ *
+ * Lock of directory guards its child list and the links,
+ * names and index entries of its children. Lock of regular
+ * file guards its content. Name index links are guarded by
+ * lock of name index. See file_node_funcs.h for lock order.
+ * Fields which lock-free readers follow are atomic, writers
+ * publish them with release stores. Subtree totals of
+ * directory are changed under the rename lock, see wsfs_stat().
  */
 struct FileNode {
-    struct FileInfo info;      /**< Information about the file */
-    struct FileNode* parent;   /**< Pointer to the parent node */
-    struct FileNode* next;     /**< Pointer to the next node */
+    struct FileNode* _Atomic parent; /**< Pointer to the parent node */
+    struct FileNode* _Atomic next;   /**< Pointer to the next node */
+    struct FileInfo info;            /**< Information about the file */
+    struct FileNode* prev;           /**< Pointer to the previous node */
+    struct RwLock lock;              /**< Guards children (if directory) or content (if regular file) */
+    struct FileNode* nameNext;       /**< Next node in chain of name index, guarded by its lock */
+    struct FileNode* namePrev;       /**< Previous node in chain of name index, NULL if node heads the chain */
+};
+
+/**
+ * @struct WsfsStat
+ * @brief Attributes of a file node, see wsfs_stat().
+ */
+struct WsfsStat {
+    enum FileType type;             /**< Type of the file */
+    enum Permissions permissions;   /**< File permissions */
+    struct FileTimes times;         /**< Creation, modification and access times */
+    uint64_t contentSize;           /**< Length of content, 0 if node isn't a regular file */
+    uint32_t childCount;            /**< Amount of nodes in directory content, 0 if node isn't a directory */
+    uint64_t subtreeSize;           /**< Memory charged for node and its subtree, see get_file_node_size() */
+    uint64_t subtreeCount;          /**< Amount of nodes in subtree, node included */
+};
+
+/**
+ * @struct WsfsDirCookie
+ * @brief Position of a paginated directory listing, see wsfs_readdir().
+ *
+ * Cookie holds the last listed child by name, not by place,
+ * so it stays valid while directory changes.
+ */
+struct WsfsDirCookie {
+    char* name;         /**< Copy of name of the last listed child, NULL before the first batch */
+    uintptr_t address;  /**< Address of the last listed child, orders children which share a name */
 };
 
+#define WSFS_DIR_COOKIE_INIT {NULL, 0} // cookie which lists directory from its first child
+
 #endif //FILE_NODE_STRUCTS_H
@@ -0,0 +1,197 @@
+/**
+    * @file: image.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions which serve
+    * file system straight from a memory mapped image.
+    *
+    * Image holds no pointers. Nodes refer to each other by
+    * 32-bit indexes into the node table, names and content by
+    * offsets into their sections. Nodes are stored breadth
+    * first, so children of every directory take a contiguous
+    * range of the node table, and the lookup table holds the
+    * same range sorted by name hash. Image is mapped read-only
+    * and shared, so opening it costs a few system calls and
+    * processes which map the same image share its pages.
+    *
+    * Image itself never changes. The first write to a node
+    * takes over its subtree: the subtree is copied into an
+    * overlay context(see wsfs_context.h) and is served from
+    * there afterwards, the rest of image stays mapped.
+    * Images are written by wsfs_save_image()(see snapshot.h).
+*/
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdint.h>
+#include "wsfs_context.h"
+
+#define IMAGE_MAGIC 0x4d495357u // "WSIM" in little endian
+#define IMAGE_VERSION 2
+#define IMAGE_NO_NODE UINT32_MAX
+
+/**
+ * @struct ImageHeader
+ * @brief First bytes of image. Offsets are counted from its start.
+ */
+struct ImageHeader {
+    uint32_t magic;             /**< IMAGE_MAGIC */
+    uint32_t version;           /**< IMAGE_VERSION */
+    uint32_t nodeCount;         /**< Amount of entries in node table, the root is the first one */
+    uint32_t reserved;          /**< Zero */
+    uint64_t lookupOffset;      /**< Offset of lookup table, nodeCount - 1 node indexes */
+    uint64_t stringOffset;      /**< Offset of string table with NUL-terminated names */
+    uint64_t stringSize;        /**< Size of string table in bytes */
+    uint64_t contentOffset;     /**< Offset of content section */
+    uint64_t contentSize;       /**< Size of content section in bytes */
+    uint64_t memoryLimit;       /**< Memory limit of saved file system */
+    uint64_t fileCountLimit;    /**< File count limit of saved file system */
+    uint64_t reservedTail;      /**< Zero, keeps header 80 bytes long */
+};
+
+/**
+ * @struct ImageNode
+ * @brief Entry of node table, it follows header. Entries are
+ * 64 bytes long, so every entry takes one cache line.
+ */
+struct ImageNode {
+    uint64_t contentOffset;     /**< Offset of content in content section (if regular file) */
+    uint64_t contentSize;       /**< Length of content (if regular file) */
+    uint64_t creationTime;      /**< Time of creation, see FileTimes */
+    uint64_t modificationTime;  /**< Time of the last change, it stands for access time too */
+    uint32_t parent;            /**< Index of parent, the root is its own parent */
+    uint32_t firstChild;        /**< Index of the first child (if directory) */
+    uint32_t childCount;        /**< Amount of children (if directory) */
+    uint32_t symlinkTarget;     /**< Index of target (if symlink), IMAGE_NO_NODE if target isn't saved */
+    uint32_t nameOffset;        /**< Offset of name in string table */
+    uint32_t nameLength;        /**< Length of name */
+    uint32_t nameHash;          /**< Hash of name(see hash_file_node_name()) */
+    uint8_t type;               /**< Type of file node(FILE_TYPE_*) */
+    uint8_t permissions;        /**< Permissions of file node(PERM_*) */
+    uint8_t reserved[2];        /**< Zero */
+};
+
+/**
+ * @struct ImageEntry
+ * @brief Node found in image or in its overlay.
+ */
+struct ImageEntry {
+    uint32_t node;              /**< Index of node in image, IMAGE_NO_NODE if node was found in overlay */
+    struct FileNode* overlay;   /**< Copy which serves node after take over, NULL if node is served by image */
+};
+
+struct WsfsImage; /**< Forward declaration of WsfsImage struct */
+
+/**
+    * Maps image read-only. Only header is checked, every node
+    * is checked when it is reached, so opening takes constant
+    * time.
+    *
+    * @param[in] fd The file descriptor of image opened for
+    * reading. It may be closed after the call.
+    *
+    * @return Returns NULL if header is malformed, mapping or
+    * memory allocation failed, else returns opened image.
+*/
+struct WsfsImage* wsfs_open_image(int fd);
+
+/**
+    * Unmaps image and frees its overlay. Overlay nodes become
+    * invalid.
+    *
+    * @param[in] image The image which will be closed.
+    *
+    * @note Must not be called while other threads use image.
+*/
+void wsfs_close_image(struct WsfsImage* image);
+
+/**
+    * Resolves path like "dir\subdir\file" from the root of
+    * image, the same way as wsfs_lookup_path(). Once path
+    * reaches a taken over directory, the rest of it is
+    * resolved in overlay.
+    *
+    * @param[in,out] image The image where path is resolved.
+    * @param[in] path The path to file node.
+    * @param[in] flags Which symbolic links are followed(use LOOKUP_*).
+    * @param[out] entry The found node.
+    *
+    * @return Returns 1 if preconditions aren't met or there is
+    * no such node, else returns 0.
+    *
+    * @pre image != NULL && path != NULL && entry != NULL
+*/
+uint8_t wsfs_image_lookup(struct WsfsImage* image, const char* path, enum LookupFlags flags, struct ImageEntry* entry);
+
+/**
+    * Reads bytes of regular file at given offset, symbolic
+    * links are followed.
+    *
+    * @param[in,out] image The image where file is located.
+    * @param[in] entry The file.
+    * @param[out] buffer The buffer where bytes will be copied.
+    * @param[in] size The maximum amount of bytes.
+    * @param[in] offset The position of first read byte.
+    *
+    * @return Returns 0 if preconditions aren't met or offset
+    * is past the end of file, else returns amount of read bytes.
+    *
+    * @pre image != NULL && entry != NULL && buffer != NULL
+    * @pre file must have READ permission
+    *
+    * @note Entry found before its node was taken over still
+    * reads content from image.
+*/
+uint64_t wsfs_image_read(struct WsfsImage* image, const struct ImageEntry* entry, void* buffer,
+                         uint64_t size, uint64_t offset);
+
+/**
+    * Gets length of regular file.
+    *
+    * @param[in,out] image The image where file is located.
+    * @param[in] entry The file.
+    *
+    * @return Returns 0 if preconditions aren't met, else
+    * returns length of content in bytes.
+    *
+    * @pre image != NULL && entry != NULL
+*/
+uint64_t wsfs_image_get_content_size(struct WsfsImage* image, const struct ImageEntry* entry);
+
+/**
+    * Takes over subtree of node before it is changed. Subtree
+    * is copied into overlay together with empty copies of its
+    * ancestors, later lookups reaching it are served by overlay.
+    * Targets of symbolic links in subtree are taken over too.
+    * Change the returned node with *_ctx() functions and
+    * context returned by wsfs_image_get_overlay().
+    *
+    * @param[in,out] image The image where node is located.
+    * @param[in,out] entry The node, its overlay copy is
+    * written into it.
+    *
+    * @return Returns NULL if preconditions aren't met or memory
+    * allocation failed, else returns overlay copy of node.
+    *
+    * @pre image != NULL && entry != NULL
+    *
+    * @note ".." from a taken over directory leads to a copy
+    * of its parent, which holds taken over children only.
+    * To rename, move or delete node, take over its parent.
+*/
+struct FileNode* wsfs_image_take_over(struct WsfsImage* image, struct ImageEntry* entry);
+
+/**
+    * Gets context which holds taken over nodes.
+    *
+    * @param[in] image The image which overlay will be returned.
+    *
+    * @return Returns NULL if nothing was taken over yet, else
+    * returns overlay context.
+    *
+    * @pre image != NULL
+*/
+struct WsfsContext* wsfs_image_get_overlay(struct WsfsImage* image);
+
+#endif //IMAGE_H
@@ -0,0 +1,273 @@
+/**
+    * @file: journal.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the journal of changes. Every successful change of
+    * a node reachable from the root is appended to a local
+    * file as a record which refers to nodes by their paths.
+    * Records are appended while the changed node is locked
+    * and while names and parents can't change, so the journal
+    * holds changes in the order they took effect and replays
+    * them onto an empty root(see wsfs_init_ctx()).
+    *
+    * Records are collected in memory and written in batches.
+    * With JOURNAL_SYNC_ALWAYS the changing thread waits until
+    * its record is synced, but one fdatasync() covers every
+    * record appended meanwhile(group commit).
+    *
+    * Every journal file follows a checkpoint(see checkpoint.h).
+    * While a checkpoint is saved, records go to a next file
+    * which replaces the journal file once the checkpoint is
+    * saved, so the journal holds changes after the last
+    * checkpoint only.
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include "file_node_structs.h"
+#include "wsfs_context.h"
+
+#define JOURNAL_MAGIC 0x4c4a5357u // "WSJL" in little endian
+#define JOURNAL_VERSION 1
+#define JOURNAL_NEXT_SUFFIX ".next"
+#define JOURNAL_TEMPORARY_SUFFIX ".tmp"
+
+/**
+ * @enum JournalSyncPolicy
+ * @brief Defines when journal records become durable.
+ */
+enum JournalSyncPolicy {
+    JOURNAL_SYNC_ALWAYS = 0,    /**< Change returns once its record is synced */
+    JOURNAL_SYNC_INTERVAL = 1,  /**< Records are synced by background thread every interval */
+    JOURNAL_SYNC_NEVER = 2      /**< Records are written when buffer fills up, never synced */
+};
+
+/**
+ * @enum JournalRecordType
+ * @brief Defines which change is described by record.
+ */
+enum JournalRecordType {
+    JOURNAL_CREATE = 1,         /**< Node was created, value holds its type */
+    JOURNAL_PERMISSIONS = 2,    /**< Permissions changed, value holds new ones */
+    JOURNAL_WRITE = 3,          /**< Bytes were written at offset held by value */
+    JOURNAL_WRITE_ALL = 4,      /**< Content was replaced by bytes */
+    JOURNAL_APPEND = 5,         /**< Bytes were appended */
+    JOURNAL_TRUNCATE = 6,       /**< Length changed to value */
+    JOURNAL_RENAME = 7,         /**< Node got its current name, bytes hold the old one */
+    JOURNAL_MOVE = 8,           /**< Node was moved out of other node */
+    JOURNAL_DELETE = 9,         /**< Node was deleted */
+    JOURNAL_SYMLINK = 10,       /**< Symbolic link got other node as target */
+    JOURNAL_ATTACH = 11         /**< Node was added to directory together with its subtree, never stored */
+};
+
+/**
+ * @struct JournalChange
+ * @brief Change passed to journal_record().
+ */
+struct JournalChange {
+    enum JournalRecordType type;    /**< Type of change */
+    const struct FileNode* node;    /**< Changed node */
+    const struct FileNode* other;   /**< Old parent or symlink target, else NULL */
+    const void* data;               /**< Written bytes or old name, else NULL */
+    uint64_t size;                  /**< Amount of bytes in data */
+    uint64_t value;                 /**< Offset, length, type or permissions */
+};
+
+/**
+ * @struct JournalStats
+ * @brief Counters of journal.
+ */
+struct JournalStats {
+    uint64_t records;   /**< Amount of appended records */
+    uint64_t bytes;     /**< Amount of appended bytes */
+    uint64_t writes;    /**< Amount of batches written into file */
+    uint64_t syncs;     /**< Amount of fdatasync() calls */
+    uint64_t fileSize;  /**< Size of journal files in bytes */
+};
+
+/**
+    * Opens journal file of context and creates it if it
+    * doesn't exist. Changes are journaled from now on, records
+    * already in file are replayed right away if context has
+    * a root(e.g. loaded by wsfs_load_checkpoint()), else by
+    * wsfs_init_ctx(). Records which checkpoint of context
+    * already holds are dropped.
+    *
+    * @param[in,out] context The context which changes will be journaled.
+    * @param[in] path The path of journal file.
+    * @param[in] policy When records become durable.
+    * @param[in] intervalMs The interval between syncs in
+    * milliseconds if policy is JOURNAL_SYNC_INTERVAL.
+    *
+    * @return Returns 1 if preconditions aren't met, file isn't
+    * a journal, journal follows a newer checkpoint than context,
+    * opening failed or memory allocation failed, else returns 0.
+    *
+    * @pre context != NULL && path != NULL
+    * @pre context has no journal yet
+    * @pre no other thread uses context
+*/
+uint8_t wsfs_open_journal_ctx(struct WsfsContext* context, const char* path, enum JournalSyncPolicy policy,
+                              uint32_t intervalMs);
+
+/**
+    * Same as wsfs_open_journal_ctx(), in default context.
+*/
+uint8_t wsfs_open_journal(const char* path, enum JournalSyncPolicy policy, uint32_t intervalMs);
+
+/**
+    * Writes and syncs every appended record regardless of
+    * sync policy.
+    *
+    * @param[in,out] context The context which journal will be synced.
+    *
+    * @return Returns 1 if context has no journal or writing
+    * failed, else returns 0.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_sync_journal_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_sync_journal_ctx(), in default context.
+*/
+uint8_t wsfs_sync_journal(void);
+
+/**
+    * Writes every appended record, syncs them unless policy is
+    * JOURNAL_SYNC_NEVER and closes journal. Changes aren't
+    * journaled afterwards.
+    *
+    * @param[in,out] context The context which journal will be closed.
+    *
+    * @pre context != NULL
+    * @pre no other thread uses context
+    * @pre checkpoints of context are stopped
+*/
+void wsfs_close_journal_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_close_journal_ctx(), in default context.
+*/
+void wsfs_close_journal(void);
+
+/**
+    * Gets counters of journal. Counters are zero if context
+    * has no journal.
+    *
+    * @param[in,out] context The context which journal is inspected.
+    * @param[out] stats The counters.
+    *
+    * @pre context != NULL && stats != NULL
+*/
+void get_journal_stats_ctx(struct WsfsContext* context, struct JournalStats* stats);
+
+/**
+    * Appends record of change. Nodes which aren't reachable
+    * from the root aren't journaled. The caller holds lock of
+    * changed node(directory lock for structural changes) and
+    * keeps names and parents stable(rename lock).
+    *
+    * @param[in,out] context The context where node was changed.
+    * @param[in] change The change.
+    *
+    * @return Returns 0 if context has no journal or change
+    * isn't journaled, else returns sequence number of record
+    * which is passed to journal_commit().
+    *
+    * @pre context != NULL && change != NULL
+*/
+uint64_t journal_record(struct WsfsContext* context, const struct JournalChange* change);
+
+/**
+    * Waits until record is durable if sync policy requires
+    * it, else writes buffered records once JOURNAL_BUFFER_SIZE
+    * is reached. Called after locks of changed nodes are
+    * released, so threads changing other nodes meanwhile share
+    * the sync.
+    *
+    * @param[in,out] context The context where node was changed.
+    * @param[in] sequence The number returned by journal_record().
+    *
+    * @pre context != NULL
+*/
+void journal_commit(struct WsfsContext* context, uint64_t sequence);
+
+/**
+    * Starts journal file for records after checkpoint. Records
+    * appended so far are written into current file, which is
+    * kept as previous file until finish_journal_rotation().
+    * Records aren't written into the new file until
+    * sync_rotated_journal() is called.
+    *
+    * @param[in,out] context The context which journal is rotated.
+    * @param[in] checkpoint The number of checkpoint being saved.
+    *
+    * @return Returns 1 if context has no journal, journal is
+    * rotated already, failed or writing failed, else returns 0.
+    *
+    * @pre context != NULL
+    * @pre rename lock of context is write locked, so no change is in progress
+*/
+uint8_t rotate_journal(struct WsfsContext* context, uint64_t checkpoint);
+
+/**
+    * Syncs previous file of rotated journal and lets records
+    * be written into the new one.
+    *
+    * @param[in,out] context The context which journal was rotated.
+    *
+    * @return Returns 1 if sync failed, else returns 0.
+    *
+    * @pre context != NULL
+    * @pre rotate_journal() succeeded
+*/
+uint8_t sync_rotated_journal(struct WsfsContext* context);
+
+/**
+    * Ends rotation. If checkpoint was saved, the new file
+    * replaces previous one, else records of both files are
+    * merged into journal file again.
+    *
+    * @param[in,out] context The context which journal was rotated.
+    * @param[in] isCheckpointSaved 1 if checkpoint file is in place.
+    *
+    * @return Returns 1 if renaming or merging failed, journal
+    * is failed then, else returns 0.
+    *
+    * @pre context != NULL
+    * @pre sync_rotated_journal() was called
+*/
+uint8_t finish_journal_rotation(struct WsfsContext* context, uint8_t isCheckpointSaved);
+
+/**
+    * Syncs directory which contains path, so a rename or
+    * a new file in it is durable.
+    *
+    * @param[in] path The path of file in directory.
+    *
+    * @return Returns 1 if opening or sync failed, else returns 0.
+    *
+    * @pre path != NULL
+*/
+uint8_t sync_parent_directory(const char* path);
+
+/**
+    * Applies records of journal file to tree of context.
+    * Journal is detached meanwhile, so applied changes aren't
+    * journaled again. Torn record at the end of file, left by
+    * a crash during write, is cut off.
+    *
+    * @param[in,out] context The context which root was just created.
+    *
+    * @return Returns amount of applied records.
+    *
+    * @pre context != NULL
+    * @pre no other thread uses context
+*/
+uint64_t replay_journal(struct WsfsContext* context);
+
+#endif //JOURNAL_H
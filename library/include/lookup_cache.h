@@ -0,0 +1,132 @@
+/**
+    * @file: lookup_cache.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the lookup cache. Cache maps (parent directory,
+    * name) pairs to file nodes, so repeated path lookups
+    * don't scan directories level by level. It is bounded
+    * and set-associative, entries are dropped when file
+    * node is renamed, moved or deleted. Every set has its own
+    * lock, so threads hitting different sets don't wait on
+    * each other. Every file system context has its own cache.
+*/
+
+#ifndef LOOKUP_CACHE_H
+#define LOOKUP_CACHE_H
+
+#include "file_node_structs.h"
+
+/**
+ * @struct LookupCacheStats
+ * @brief Counters which show how well lookup cache is sized.
+ */
+struct LookupCacheStats {
+    uint64_t hits;          /**< Lookups answered by cache */
+    uint64_t misses;        /**< Lookups that had to scan directory */
+    uint64_t evictions;     /**< Entries replaced because their set was full */
+    uint64_t invalidations; /**< Entries dropped by rename, move or delete */
+    uint32_t capacity;      /**< Maximal amount of entries */
+    uint32_t used;          /**< Amount of valid entries */
+};
+
+struct LookupCacheSet; /**< Forward declaration of LookupCacheSet struct */
+
+/**
+ * @struct LookupCache
+ * @brief Set-associative cache, sets are allocated on first insert.
+ */
+struct LookupCache {
+    struct LookupCacheSet* _Atomic sets;    /**< Sets of entries, NULL until first insert */
+    uint32_t capacity;                      /**< Maximal amount of entries, 0 if cache is disabled */
+    _Atomic uint64_t uncachedMisses;        /**< Misses counted while there were no sets */
+    struct LookupCacheStats retiredStats;   /**< Counters of freed sets */
+};
+
+/**
+    * Initializes cache with LOOKUP_CACHE_SIZE entries without
+    * allocating any memory.
+    *
+    * @param[out] cache The cache which will be initialized.
+    *
+    * @pre cache != NULL
+*/
+void init_lookup_cache(struct LookupCache* cache);
+
+/**
+    * Finds file node in cache.
+    *
+    * @param[in,out] cache The cache where node will be searched.
+    * @param[in] parent The directory where node is located.
+    * @param[in] name The name of file node.
+    * @param[in] hash The hash of name(see hash_file_node_name()).
+    * @param[in] length The length of name.
+    *
+    * @return Returns NULL if there is no such entry, else
+    * returns cached file node.
+    *
+    * @pre cache != NULL && parent != NULL && name != NULL
+*/
+struct FileNode* lookup_cache_find(struct LookupCache* cache, const struct FileNode* parent,
+                                   const char* name, uint32_t hash, uint32_t length);
+
+/**
+    * Adds file node to cache. If set of entries is full, the
+    * oldest one is replaced.
+    *
+    * @param[in,out] cache The cache where node will be added.
+    * @param[in] node The file node which will be cached under
+    * it's parent and name.
+    *
+    * @pre cache != NULL && node != NULL
+*/
+void lookup_cache_insert(struct LookupCache* cache, struct FileNode* node);
+
+/**
+    * Removes file node from cache. Must be called before node's
+    * name or parent changes, or before node is freed.
+    *
+    * @param[in,out] cache The cache from which entry will be removed.
+    * @param[in] node The file node which entry will be removed.
+    *
+    * @pre cache != NULL && node != NULL
+*/
+void lookup_cache_invalidate(struct LookupCache* cache, const struct FileNode* node);
+
+/**
+    * Changes the amount of cache entries. All entries and
+    * counters are dropped.
+    *
+    * @param[in,out] cache The cache which will be resized.
+    * @param[in] capacity The new amount of entries, rounded up to
+    * power of two. 0 disables cache.
+    *
+    * @return Returns 1 if memory allocation failed, else returns 0.
+    *
+    * @note Must not be called while other threads use cache.
+*/
+uint8_t set_lookup_cache_capacity(struct LookupCache* cache, uint32_t capacity);
+
+/**
+    * Gets cache counters.
+    *
+    * @param[in,out] cache The cache which counters will be read.
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre cache != NULL && stats != NULL
+*/
+void get_lookup_cache_stats(struct LookupCache* cache, struct LookupCacheStats* stats);
+
+/**
+    * Drops all entries and frees cache memory. Cache will be
+    * allocated again on next insert.
+    *
+    * @param[in,out] cache The cache which memory will be freed.
+    *
+    * @pre cache != NULL
+    *
+    * @note Must not be called while other threads use cache.
+*/
+void free_lookup_cache(struct LookupCache* cache);
+
+#endif //LOOKUP_CACHE_H
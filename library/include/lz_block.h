@@ -0,0 +1,56 @@
+/**
+    * @file: lz_block.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the LZ block compressor. A block is compressed on its
+    * own, without a dictionary, as a sequence of literal runs
+    * followed by back references of at least LZ_MIN_MATCH
+    * bytes into already written output(LZ77). Blocks are
+    * expected to be at most LZ_MAX_BLOCK_SIZE bytes, so
+    * offsets fit in two bytes. Compression is a single greedy
+    * pass with a hash table of recent positions, it trades
+    * ratio for speed.
+*/
+
+#ifndef LZ_BLOCK_H
+#define LZ_BLOCK_H
+
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_BLOCK_SIZE 65535
+#define LZ_BLOCK_BOUND(size) ((size) + (size) / 255 + 16) // largest compressed size of incompressible block
+
+/**
+    * Compresses block.
+    *
+    * @param[in] source The bytes which will be compressed.
+    * @param[in] size The amount of bytes.
+    * @param[out] destination The buffer where compressed block
+    * will be written, it holds LZ_BLOCK_BOUND(size) bytes.
+    *
+    * @return Returns length of compressed block.
+    *
+    * @pre source != NULL && destination != NULL
+    * @pre size <= LZ_MAX_BLOCK_SIZE
+*/
+uint32_t lz_block_compress(const void* source, uint32_t size, void* destination);
+
+/**
+    * Decompresses block written by lz_block_compress().
+    *
+    * @param[in] source The compressed block.
+    * @param[in] size The length of compressed block.
+    * @param[out] destination The buffer where bytes will be written.
+    * @param[in] originalSize The amount of bytes block was
+    * compressed from.
+    *
+    * @return Returns 1 if block is malformed or doesn't hold
+    * exactly originalSize bytes, else returns 0.
+    *
+    * @pre source != NULL && destination != NULL
+*/
+uint8_t lz_block_decompress(const void* source, uint32_t size, void* destination, uint32_t originalSize);
+
+#endif //LZ_BLOCK_H
@@ -0,0 +1,148 @@
+/**
+    * @file: name_index.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the name index. Index is a hash table of all file
+    * nodes of a context keyed by name hash, nodes are chained
+    * through their own links, so indexing never allocates
+    * per node. A counting Bloom filter of name hashes sits
+    * in front of the table, it is read without the lock
+    * inside an epoch, so looking up a name which no node has
+    * doesn't touch the table at all. Like the lookup cache,
+    * index memory doesn't come from allocator of context.
+*/
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include "file_node_structs.h"
+#include "rw_lock.h"
+
+/**
+ * @struct NameFilter
+ * @brief Counting Bloom filter, replaced as a whole when index grows.
+ */
+struct NameFilter {
+    uint32_t capacity;          /**< Amount of counters, always a power of two */
+    _Atomic uint8_t counters[]; /**< Amount of nodes hashed to counter, saturated counters stay */
+};
+
+/**
+ * @struct NameIndexStats
+ * @brief Counters which show how names are found.
+ */
+struct NameIndexStats {
+    uint64_t nodes;         /**< Amount of indexed file nodes */
+    uint32_t capacity;      /**< Amount of buckets */
+    uint64_t lookups;       /**< Lookups which checked the filter */
+    uint64_t filterRejects; /**< Lookups answered by filter without searching table */
+};
+
+/**
+ * @struct NameIndex
+ * @brief Chained hash table of file nodes, zero-initialized index is empty.
+ */
+struct NameIndex {
+    struct FileNode** buckets;          /**< Chains of nodes, NULL until first insert */
+    struct NameFilter* _Atomic filter;  /**< Filter of indexed name hashes, NULL until first insert */
+    uint32_t capacity;                  /**< Amount of buckets, always a power of two */
+    uint64_t count;                     /**< Amount of indexed nodes */
+    struct RwLock lock;                 /**< Guards buckets and chain links of nodes */
+    _Atomic uint64_t lookups;           /**< Lookups which checked the filter */
+    _Atomic uint64_t filterRejects;     /**< Lookups answered by filter */
+};
+
+/**
+    * Initializes empty index without allocating any memory.
+    *
+    * @param[out] index The index which will be initialized.
+    *
+    * @pre index != NULL
+*/
+void init_name_index(struct NameIndex* index);
+
+/**
+    * Adds file node to index under its current name. Buckets
+    * are doubled once there are as many nodes as buckets, if
+    * that fails chains just grow longer.
+    *
+    * @param[in,out] index The index where node will be added.
+    * @param[in,out] node The file node which will be added.
+    *
+    * @return Returns 1 if the first buckets couldn't be
+    * allocated, else returns 0.
+    *
+    * @pre index != NULL && node != NULL
+    * @pre node isn't in index
+*/
+uint8_t name_index_insert(struct NameIndex* index, struct FileNode* node);
+
+/**
+    * Removes file node from index. Must be called before
+    * node's name changes or node is freed.
+    *
+    * @param[in,out] index The index from which node will be removed.
+    * @param[in,out] node The file node which will be removed.
+    *
+    * @pre index != NULL && node != NULL
+    * @pre node is in index
+*/
+void name_index_remove(struct NameIndex* index, struct FileNode* node);
+
+/**
+    * Checks filter for name hash without taking the lock.
+    *
+    * @param[in,out] index The index which filter will be checked.
+    * @param[in] hash The hash of name(see hash_file_node_name()).
+    *
+    * @return Returns 0 if no indexed node has such name, else
+    * returns 1(node may have it).
+    *
+    * @pre index != NULL
+    * @pre the caller is inside an epoch(see wsfs_epoch_enter()) or holds lock of index
+*/
+uint8_t name_index_may_contain(struct NameIndex* index, uint32_t hash);
+
+/**
+    * Finds the next file node with given name. Nodes with
+    * equal names are returned in no particular order.
+    *
+    * @param[in] index The index where node will be searched.
+    * @param[in] name The name of file node.
+    * @param[in] hash The hash of name(see hash_file_node_name()).
+    * @param[in] length The length of name.
+    * @param[in] previous The node returned by previous call, NULL
+    * to find the first one.
+    *
+    * @return Returns NULL if there are no more such nodes, else
+    * returns found file node.
+    *
+    * @pre index != NULL && name != NULL
+    * @pre the caller holds lock of index
+*/
+struct FileNode* name_index_find(const struct NameIndex* index, const char* name, uint32_t hash, uint32_t length,
+                                 const struct FileNode* previous);
+
+/**
+    * Gets index counters.
+    *
+    * @param[in,out] index The index which counters will be read.
+    * @param[out] stats The structure where counters will be written.
+    *
+    * @pre index != NULL && stats != NULL
+*/
+void get_name_index_stats(struct NameIndex* index, struct NameIndexStats* stats);
+
+/**
+    * Drops all nodes and frees index memory.
+    *
+    * @param[in,out] index The index which memory will be freed.
+    *
+    * @pre index != NULL
+    *
+    * @note Must not be called while other threads use index.
+*/
+void free_name_index(struct NameIndex* index);
+
+#endif //NAME_INDEX_H
@@ -0,0 +1,238 @@
+/**
+    * @file: query_index.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the query index. Index keeps every file node of a
+    * context ordered by type, by creation time and by
+    * modification time, and every regular file ordered by
+    * content size. Functions which create, free or change
+    * file nodes keep it up to date, so a query reads only
+    * the range of one index and checks the rest of its
+    * predicates on nodes found there, instead of walking the
+    * whole tree. Access time changes on every lock-free read,
+    * so it isn't indexed, it is only checked on found nodes.
+    * Index is optional, it is built by wsfs_enable_queries().
+    * Like the name index, its memory doesn't come from
+    * allocator of context.
+*/
+
+#ifndef QUERY_INDEX_H
+#define QUERY_INDEX_H
+
+#include <stdint.h>
+#include "file_node_structs.h"
+#include "wsfs_context.h"
+
+#define QUERY_INDEXED_FIELDS 4 // fields before QUERY_ACCESS_TIME have an index
+
+struct QueryIndex; /**< Forward declaration of QueryIndex struct */
+struct WsfsQuery; /**< Forward declaration of WsfsQuery struct */
+
+/**
+ * @enum QueryField
+ * @brief Defines which attribute of file node predicate checks.
+ */
+enum QueryField {
+    QUERY_TYPE = 0,                 /**< Type of file node(FILE_TYPE_*) */
+    QUERY_SIZE = 1,                 /**< Length of content, only regular files match */
+    QUERY_CREATION_TIME = 2,        /**< Creation time, see FileTimes */
+    QUERY_MODIFICATION_TIME = 3,    /**< Modification time, see FileTimes */
+    QUERY_ACCESS_TIME = 4,          /**< Access time, see FileTimes (not indexed) */
+    QUERY_FIELD_COUNT = 5           /**< Amount of fields */
+};
+
+/**
+ * @struct QueryPredicate
+ * @brief Holds if field of file node lies within [min, max].
+ */
+struct QueryPredicate {
+    enum QueryField field;  /**< Checked attribute */
+    uint64_t min;           /**< The smallest matching value */
+    uint64_t max;           /**< The largest matching value */
+};
+
+/**
+ * @struct QueryIndexStats
+ * @brief Counters of query index.
+ */
+struct QueryIndexStats {
+    uint64_t nodes;             /**< Amount of indexed file nodes */
+    uint64_t files;             /**< Amount of regular files in size index */
+    uint64_t queries;           /**< Amount of queries started */
+    uint64_t candidates;        /**< Nodes read from indexes by queries, matching or not */
+    uint64_t droppedUpdates;    /**< Changes which couldn't be indexed for lack of memory */
+};
+
+/**
+    * Builds query index of context from its tree and keeps
+    * it up to date from then on. Nodes of tree snapshots(see
+    * create_tree_snapshot()) aren't indexed.
+    *
+    * @param[in,out] context The context which will be indexed.
+    *
+    * @return Returns 1 if preconditions aren't met, index is
+    * already built or memory allocation failed, else returns 0.
+    *
+    * @pre context != NULL
+    *
+    * @note Must not be called while other threads change file
+    * system, nodes created meanwhile may be missed.
+*/
+uint8_t wsfs_enable_queries_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_enable_queries_ctx(), in default context.
+*/
+uint8_t wsfs_enable_queries(void);
+
+/**
+    * Frees query index of context, changes don't update it
+    * anymore. Does nothing if queries aren't enabled.
+    *
+    * @param[in,out] context The context which index will be freed.
+    *
+    * @pre context != NULL
+    *
+    * @note Must not be called while other threads use file
+    * system or a query of context is open.
+*/
+void wsfs_disable_queries_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_disable_queries_ctx(), in default context.
+*/
+void wsfs_disable_queries(void);
+
+/**
+    * Starts query for file nodes which match every predicate.
+    * Nodes are read in batches by wsfs_query_next(), none of
+    * them is found before. Query reads the index of the
+    * predicate which matches the fewest nodes, with no
+    * indexed predicate it reads every node.
+    *
+    * @param[in,out] context The context which nodes are queried.
+    * @param[in] predicates The predicates, they are copied.
+    * @param[in] count The amount of predicates, 0 matches every node.
+    *
+    * @return Returns NULL if preconditions aren't met, queries
+    * of context aren't enabled or memory allocation failed,
+    * else returns query. Close it by wsfs_query_close().
+    *
+    * @pre context != NULL
+    * @pre predicates != NULL if count > 0
+    * @pre every predicate has min <= max, else nothing matches
+*/
+struct WsfsQuery* wsfs_query_ctx(struct WsfsContext* context, const struct QueryPredicate* predicates,
+                                 uint32_t count);
+
+/**
+    * Same as wsfs_query_ctx(), in default context.
+*/
+struct WsfsQuery* wsfs_query(const struct QueryPredicate* predicates, uint32_t count);
+
+/**
+    * Gets the next matching file nodes of query. Every batch
+    * resumes after the last node read by the previous one,
+    * so tree may change between batches. Node which changes
+    * an indexed attribute of the query meanwhile may be found
+    * twice or not at all.
+    *
+    * @param[in,out] query The query which nodes will be read.
+    * @param[out] nodes The array where found nodes will be written.
+    * @param[in] capacity The amount of nodes which fit into array.
+    *
+    * @return Returns 0 if preconditions aren't met or there are
+    * no more matching nodes, else returns amount of written nodes.
+    *
+    * @pre query != NULL && nodes != NULL && capacity > 0
+    *
+    * @note Found nodes stay valid only until they are deleted,
+    * see file_node_funcs.h.
+*/
+uint32_t wsfs_query_next(struct WsfsQuery* query, struct FileNode** nodes, uint32_t capacity);
+
+/**
+    * Frees query.
+    *
+    * @param[in,out] query The query which will be freed.
+*/
+void wsfs_query_close(struct WsfsQuery* query);
+
+/**
+    * Gets counters of query index, all of them are 0 if
+    * queries aren't enabled.
+    *
+    * @param[in,out] context The context which index is inspected.
+    * @param[out] stats The counters.
+    *
+    * @pre context != NULL && stats != NULL
+*/
+void get_query_index_stats_ctx(struct WsfsContext* context, struct QueryIndexStats* stats);
+
+/**
+    * Same as get_query_index_stats_ctx(), in default context.
+*/
+void get_query_index_stats(struct QueryIndexStats* stats);
+
+/**
+    * Adds new file node to index under its current type,
+    * times and content size. Does nothing if index is NULL or
+    * node belongs to a tree snapshot.
+    *
+    * @param[in,out] index The index where node will be added,
+    * may be NULL.
+    * @param[in] node The file node which will be added.
+    *
+    * @return Returns 1 if memory allocation failed, node isn't
+    * in index then, else returns 0.
+    *
+    * @pre node != NULL
+    * @pre node isn't in index
+*/
+uint8_t query_index_insert(struct QueryIndex* index, const struct FileNode* node);
+
+/**
+    * Removes file node from index. Must be called before node
+    * is freed.
+    *
+    * @param[in,out] index The index from which node will be
+    * removed, may be NULL.
+    * @param[in] node The file node which will be removed.
+    *
+    * @pre node != NULL
+    * @pre indexed attributes of node didn't change since it
+    * was indexed, except through query_index_rekey()
+*/
+void query_index_remove(struct QueryIndex* index, const struct FileNode* node);
+
+/**
+    * Moves file node to its new value of field. If it can't
+    * be added back, node is left out of that index and
+    * counted in droppedUpdates.
+    *
+    * @param[in,out] index The index where node will be moved,
+    * may be NULL.
+    * @param[in] node The file node which field has changed.
+    * @param[in] field QUERY_SIZE or QUERY_MODIFICATION_TIME.
+    * @param[in] oldValue The value of field node was indexed under.
+    *
+    * @pre node != NULL
+    * @pre the caller holds lock of node, so field of node
+    * isn't changed by another thread meanwhile
+*/
+void query_index_rekey(struct QueryIndex* index, const struct FileNode* node, enum QueryField field,
+                       uint64_t oldValue);
+
+/**
+    * Drops all nodes of index, its memory except the index
+    * itself is freed. Used when all file nodes of context
+    * are released.
+    *
+    * @param[in,out] index The index which will be cleared, may be NULL.
+    *
+    * @note Must not be called while other threads use index.
+*/
+void clear_query_index(struct QueryIndex* index);
+
+#endif //QUERY_INDEX_H
@@ -0,0 +1,64 @@
+/**
+    * @file: rw_lock.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to reader/writer locks. Lock is a single atomic word,
+    * so every file node can have its own one without growing
+    * out of its slab class. Waiting writers block new readers,
+    * so writers aren't starved. Locks aren't recursive.
+*/
+
+#ifndef RW_LOCK_H
+#define RW_LOCK_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/**
+ * @struct RwLock
+ * @brief Reader/writer spin lock, zero-initialized lock is unlocked.
+ */
+struct RwLock {
+    _Atomic uint32_t state; /**< Writer bit, writer-waiting bit and reader count */
+};
+
+/**
+    * Acquires lock for reading. Several readers may hold
+    * lock at once.
+    *
+    * @param[in,out] lock The lock which will be acquired.
+    *
+    * @pre lock != NULL
+*/
+void acquire_read_lock(struct RwLock* lock);
+
+/**
+    * Releases lock acquired by acquire_read_lock().
+    *
+    * @param[in,out] lock The lock which will be released.
+    *
+    * @pre lock != NULL
+*/
+void release_read_lock(struct RwLock* lock);
+
+/**
+    * Acquires lock for writing. Only one writer and no
+    * readers may hold lock at once.
+    *
+    * @param[in,out] lock The lock which will be acquired.
+    *
+    * @pre lock != NULL
+*/
+void acquire_write_lock(struct RwLock* lock);
+
+/**
+    * Releases lock acquired by acquire_write_lock().
+    *
+    * @param[in,out] lock The lock which will be released.
+    *
+    * @pre lock != NULL
+*/
+void release_write_lock(struct RwLock* lock);
+
+#endif //RW_LOCK_H
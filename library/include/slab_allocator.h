@@ -0,0 +1,172 @@
+/**
+    * @file: slab_allocator.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the slab allocator. File nodes and small strings are
+    * carved out of big aligned slabs grouped by size class,
+    * bigger blocks are allocated separately but still tracked,
+    * so the whole allocator can be released at once.
+*/
+
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <stddef.h>
+#include "file_node_structs.h"
+#include "rw_lock.h"
+
+#define SLAB_SIZE 16384 // must be power of two, slabs are aligned to it
+#define SLAB_CLASS_COUNT 6
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @enum AllocatorMode
+ * @brief Defines how file system memory is released.
+ */
+enum AllocatorMode {
+    ALLOCATOR_MODE_SLAB = 0,    /**< wsfs_deinit() frees file nodes one by one */
+    ALLOCATOR_MODE_ARENA = 1    /**< wsfs_deinit() drops all slabs at once */
+};
+
+struct Slab;        /**< Forward declaration of Slab struct */
+struct LargeBlock;  /**< Forward declaration of LargeBlock struct */
+
+/**
+ * @struct SlabClass
+ * @brief Slabs which hold objects of one size.
+ */
+struct SlabClass {
+    uint32_t objectSize;        /**< Size of every object in class */
+    uint32_t objectsPerSlab;    /**< Amount of objects one slab can hold */
+    struct Slab* partial;       /**< Slabs that have free objects */
+    struct Slab* full;          /**< Slabs without free objects */
+    uint64_t slabCount;         /**< Amount of allocated slabs */
+    uint64_t objectsUsed;       /**< Amount of allocated objects */
+};
+
+/**
+ * @struct SlabAllocator
+ * @brief Size-class allocator for file nodes and their data.
+ */
+struct SlabAllocator {
+    struct SlabClass classes[SLAB_CLASS_COUNT]; /**< Size classes, first one fits struct FileNode */
+    struct LargeBlock* largeBlocks;             /**< Blocks too big for any class */
+    uint64_t largeCount;                        /**< Amount of large blocks */
+    uint64_t largeBytes;                        /**< Size of all large blocks */
+    enum AllocatorMode mode;                    /**< How memory is released */
+#ifdef WSFS_FAULT_INJECTION
+    uint32_t failingAllocations;                /**< Amount of the next allocations which fail, test builds only */
+#endif
+    struct RwLock lock;                         /**< Guards all of the above, allocator may be shared by threads */
+};
+
+/**
+ * @struct AllocatorClassStats
+ * @brief Occupancy of one size class.
+ */
+struct AllocatorClassStats {
+    uint32_t objectSize;    /**< Size of every object in class */
+    uint64_t slabs;         /**< Amount of allocated slabs */
+    uint64_t objectsTotal;  /**< Amount of objects slabs can hold */
+    uint64_t objectsUsed;   /**< Amount of allocated objects */
+};
+
+/**
+ * @struct AllocatorStats
+ * @brief Occupancy of allocator. Fragmentation is 1 - usedBytes / reservedBytes.
+ */
+struct AllocatorStats {
+    struct AllocatorClassStats classes[SLAB_CLASS_COUNT]; /**< Occupancy of every size class */
+    uint64_t largeBlocks;   /**< Amount of blocks too big for any class */
+    uint64_t largeBytes;    /**< Size of all large blocks */
+    uint64_t reservedBytes; /**< Memory taken from system */
+    uint64_t usedBytes;     /**< Memory handed out to file system */
+};
+
+/**
+    * Initializes allocator without allocating any memory.
+    *
+    * @param[out] allocator The allocator which will be initialized.
+    * @param[in] mode How memory is released(use ALLOCATOR_MODE_*).
+    *
+    * @pre allocator != NULL
+*/
+void init_slab_allocator(struct SlabAllocator* allocator, enum AllocatorMode mode);
+
+/**
+    * Allocates memory block. The caller is responsible for
+    * freeing it by calling slab_free() with the same size.
+    *
+    * @param[in,out] allocator The allocator which owns the block.
+    * @param[in] size The size of block.
+    *
+    * @return Returns NULL if memory allocation failed, else
+    * returns allocated block.
+    *
+    * @pre allocator != NULL
+*/
+void* slab_alloc(struct SlabAllocator* allocator, size_t size);
+
+/**
+    * Allocates memory block filled with zeros. The caller is
+    * responsible for freeing it by calling slab_free() with
+    * the same size.
+    *
+    * @param[in,out] allocator The allocator which owns the block.
+    * @param[in] size The size of block.
+    *
+    * @return Returns NULL if memory allocation failed, else
+    * returns allocated block.
+    *
+    * @pre allocator != NULL
+*/
+void* slab_calloc(struct SlabAllocator* allocator, size_t size);
+
+/**
+    * Duplicates string. The caller is responsible for freeing
+    * it by calling slab_free() with strlen() + 1 as size.
+    *
+    * @param[in,out] allocator The allocator which owns the copy.
+    * @param[in] string The string which will be duplicated.
+    *
+    * @return Returns NULL if memory allocation failed, else
+    * returns copy of string.
+    *
+    * @pre allocator != NULL && string != NULL
+*/
+char* slab_strdup(struct SlabAllocator* allocator, const char* string);
+
+/**
+    * Frees memory block. Slab is given back to system when
+    * it becomes empty and its class has other free objects.
+    *
+    * @param[in,out] allocator The allocator which owns the block.
+    * @param[in] pointer The block which will be freed.
+    * @param[in] size The size that was passed on allocation.
+    *
+    * @pre allocator != NULL
+*/
+void slab_free(struct SlabAllocator* allocator, void* pointer, size_t size);
+
+/**
+    * Frees every block of allocator at once. All pointers
+    * given out by allocator become invalid.
+    *
+    * @param[in,out] allocator The allocator which will be released.
+    *
+    * @pre allocator != NULL
+*/
+void release_slab_allocator(struct SlabAllocator* allocator);
+
+/**
+    * Gets occupancy of allocator.
+    *
+    * @param[in] allocator The allocator which occupancy user wants to get.
+    * @param[out] stats The structure where occupancy will be written.
+    *
+    * @pre allocator != NULL && stats != NULL
+*/
+void get_slab_allocator_stats(struct SlabAllocator* allocator, struct AllocatorStats* stats);
+
+#endif //SLAB_ALLOCATOR_H
@@ -0,0 +1,95 @@
+/**
+    * @file: snapshot.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions which save
+    * file system into a binary snapshot and load it back.
+    *
+    * Snapshot consists of a header, a string table with
+    * NUL-terminated names, a node table and a content section.
+    * Nodes are stored breadth first, so every parent precedes
+    * its children and children keep their order. Every section
+    * is written and read through one SNAPSHOT_BUFFER_SIZE
+    * buffer, so the file descriptor sees large sequential
+    * writes and reads only. Numbers are stored in native byte
+    * order, a snapshot of another byte order is rejected.
+    *
+    * Images(see image.h) are written here as well, they share
+    * the buffered writer and the breadth first node order.
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "wsfs_context.h"
+
+#define SNAPSHOT_MAGIC 0x53465357u // "WSFS" in little endian
+#define SNAPSHOT_VERSION 2
+
+/**
+    * Writes file system of context into file descriptor,
+    * starting at its current position. File times(see FileTimes),
+    * permissions, symbolic links and limits are saved too.
+    *
+    * @param[in] context The context which file system will be saved.
+    * @param[in] fd The file descriptor opened for writing.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * allocation failed or write failed, else returns 0.
+    *
+    * @pre context != NULL
+    * @pre context must have root node(see wsfs_init_ctx())
+    *
+    * @note Other threads may read file system meanwhile, but
+    * must not change it.
+*/
+uint8_t wsfs_save(struct WsfsContext* context, int fd);
+
+/**
+    * Same as wsfs_save(), but takes no locks. Used in child
+    * process of a checkpoint(see checkpoint.h), where the
+    * forking thread is the only one left and lock words
+    * copied from parent may be held by threads which don't
+    * exist there.
+    *
+    * @pre no other thread uses context
+    * @pre no change of the tree was in progress when process was forked
+*/
+uint8_t save_frozen_snapshot(struct WsfsContext* context, int fd);
+
+/**
+    * Reads snapshot written by wsfs_save() into a new context.
+    * Tree is rebuilt in one pass, nodes aren't checked against
+    * limits one by one, limits of saved file system are restored.
+    *
+    * @param[in] fd The file descriptor opened for reading.
+    *
+    * @return Returns NULL if snapshot is malformed, read failed
+    * or memory allocation failed, else returns new context with
+    * root node set. Free it with free_wsfs_context().
+*/
+struct WsfsContext* wsfs_load(int fd);
+
+/**
+    * Writes file system of context as an image into file
+    * descriptor. Image is mapped from the start of file, so
+    * it must be written there. Access times aren't saved,
+    * nodes of image report their modification time instead.
+    *
+    * @param[in] context The context which file system will be saved.
+    * @param[in] fd The file descriptor opened for writing.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * allocation failed or write failed, else returns 0.
+    *
+    * @pre context != NULL
+    * @pre context must have root node(see wsfs_init_ctx())
+    * @pre fd must be positioned at the start of file
+    *
+    * @note Other threads may read file system meanwhile, but
+    * must not change it.
+*/
+uint8_t wsfs_save_image(struct WsfsContext* context, int fd);
+
+#endif //SNAPSHOT_H
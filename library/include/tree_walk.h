@@ -0,0 +1,75 @@
+/**
+    * @file: tree_walk.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to tree walks. Walk visits a file node and its whole
+    * subtree in pre-order, post-order or breadth first. Nodes
+    * waiting for their visit are kept in an explicit list,
+    * which starts inside the walk and grows on the heap, so
+    * neither width nor depth of tree is limited. Visitor
+    * decides after every node if walk goes on, skips the
+    * children of node or stops.
+*/
+
+#ifndef TREE_WALK_H
+#define TREE_WALK_H
+
+#include <stdint.h>
+#include "file_node_structs.h"
+
+/**
+ * @enum WalkOrder
+ * @brief Defines when node is visited relative to its children.
+ */
+enum WalkOrder {
+    WALK_PRE_ORDER = 0,     /**< Node is visited before its children, siblings in directory order */
+    WALK_POST_ORDER = 1,    /**< Node is visited after its children, so visitor may free it */
+    WALK_BREADTH_FIRST = 2  /**< Nodes are visited level by level */
+};
+
+/**
+ * @enum WalkAction
+ * @brief Defines how walk goes on after node was visited.
+ */
+enum WalkAction {
+    WALK_CONTINUE = 0,  /**< Walk goes on */
+    WALK_PRUNE = 1,     /**< Children of node aren't visited, means WALK_CONTINUE in post-order */
+    WALK_STOP = 2       /**< Walk ends at once */
+};
+
+/**
+    * Visits file node during walk.
+    *
+    * @param[in,out] node The visited file node.
+    * @param[in,out] argument The argument passed to walk_file_node_tree().
+    *
+    * @return Returns how walk goes on(use WALK_*).
+*/
+typedef enum WalkAction (*WalkVisitor)(struct FileNode* node, void* argument);
+
+/**
+    * Walks file node and its subtree. Children of directory
+    * are read once, before any of them is visited.
+    *
+    * @param[in] root The node where walk starts, it is visited too.
+    * @param[in] order The order of visits(use WALK_*).
+    * @param[in] isLocked 1 if directories are read locked while
+    * their children are read, 0 if tree can't change meanwhile.
+    * @param[in] visitor The function which visits every node.
+    * @param[in,out] argument The argument passed to visitor.
+    *
+    * @return Returns 1 if preconditions aren't met or memory
+    * allocation failed before all nodes were visited, else
+    * returns 0(also when visitor stopped walk).
+    *
+    * @pre root != NULL && visitor != NULL
+    * @pre the caller holds no lock of directory in subtree if isLocked is 1
+    *
+    * @note In post-order visitor may free the node it gets,
+    * the node isn't read anymore.
+*/
+uint8_t walk_file_node_tree(struct FileNode* root, enum WalkOrder order, uint8_t isLocked, WalkVisitor visitor,
+                            void* argument);
+
+#endif //TREE_WALK_H
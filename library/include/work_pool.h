@@ -0,0 +1,161 @@
+/**
+    * @file: work_pool.h
+    * @author: without eyes
+    *
+    * This file contains declaration of functions related
+    * to the work pool. Pool is a set of threads which share
+    * work on a subtree. Work is split by directory, every
+    * task handles children of one directory and hands out
+    * tasks for its subdirectories. Every worker keeps tasks
+    * in its own deque, takes the newest one from its end and,
+    * once it runs out, steals the oldest one from another
+    * worker, so big subtrees spread over all threads while
+    * small ones stay on one. The thread which runs a job works
+    * on it too, without a pool it is the only worker.
+    *
+    * free_file_node_recursive(), copy_file_node(),
+    * create_tree_snapshot() and find_file_nodes_matching()
+    * run their subtree work as jobs.
+*/
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdint.h>
+#include "file_node_structs.h"
+#include "wsfs_context.h"
+
+struct WorkJob; /**< Forward declaration of WorkJob struct */
+
+/**
+ * @struct WorkTask
+ * @brief Directory which children are still to be handled.
+ */
+struct WorkTask {
+    struct FileNode* node;  /**< Directory of task */
+    struct FileNode* copy;  /**< Node which job made for directory, NULL if job makes none */
+};
+
+/**
+ * @struct WorkPoolStats
+ * @brief Counters of work pool.
+ */
+struct WorkPoolStats {
+    uint32_t threads;   /**< Amount of pool threads, the thread which runs job isn't counted */
+    uint64_t jobs;      /**< Amount of jobs run on pool */
+    uint64_t tasks;     /**< Amount of tasks handled by those jobs */
+    uint64_t steals;    /**< Amount of tasks taken from deque of another worker */
+};
+
+/**
+    * Handles task of job.
+    *
+    * @param[in,out] job The job which task belongs to.
+    * @param[in] worker The number of worker which handles task,
+    * 0 is the thread which runs job.
+    * @param[in] task The task which will be handled.
+    * @param[in,out] argument The argument passed to run_work_job().
+*/
+typedef void (*WorkFunction)(struct WorkJob* job, uint32_t worker, struct WorkTask task, void* argument);
+
+/**
+    * Starts threads which share subtree work of context.
+    *
+    * @param[in,out] context The context which jobs will be shared.
+    * @param[in] threadCount The amount of pool threads, the
+    * thread which runs job works besides them.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * allocation failed or thread couldn't be started, else
+    * returns 0.
+    *
+    * @pre context != NULL && threadCount > 0
+    * @pre workers of context aren't started yet
+*/
+uint8_t wsfs_start_workers_ctx(struct WsfsContext* context, uint32_t threadCount);
+
+/**
+    * Same as wsfs_start_workers_ctx(), in default context.
+*/
+uint8_t wsfs_start_workers(uint32_t threadCount);
+
+/**
+    * Stops threads of context and frees pool. Jobs run on the
+    * calling thread only afterwards. Does nothing if workers
+    * aren't started.
+    *
+    * @param[in,out] context The context which workers will be stopped.
+    *
+    * @pre context != NULL
+    *
+    * @note Must not be called while a job of context runs.
+*/
+void wsfs_stop_workers_ctx(struct WsfsContext* context);
+
+/**
+    * Same as wsfs_stop_workers_ctx(), in default context.
+*/
+void wsfs_stop_workers(void);
+
+/**
+    * Gets counters of work pool, all of them are 0 if workers
+    * aren't started.
+    *
+    * @param[in,out] context The context which pool is inspected.
+    * @param[out] stats The counters.
+    *
+    * @pre context != NULL && stats != NULL
+*/
+void get_work_pool_stats_ctx(struct WsfsContext* context, struct WorkPoolStats* stats);
+
+/**
+    * Same as get_work_pool_stats_ctx(), in default context.
+*/
+void get_work_pool_stats(struct WorkPoolStats* stats);
+
+/**
+    * Gets the amount of workers which a job of context may
+    * have, the thread which runs it included.
+    *
+    * @param[in] context The context which pool is inspected.
+    *
+    * @return Returns 1 if workers aren't started, else returns
+    * amount of pool threads plus one.
+    *
+    * @pre context != NULL
+*/
+uint32_t get_work_pool_worker_count(const struct WsfsContext* context);
+
+/**
+    * Runs job from the first task until it and every task
+    * handed out by it are handled. Job runs on pool of
+    * context, if pool is busy with another job or workers
+    * aren't started it runs on the calling thread alone.
+    *
+    * @param[in,out] context The context which pool runs job.
+    * @param[in] task The first task.
+    * @param[in] function The function which handles every task.
+    * @param[in,out] argument The argument passed to function.
+    *
+    * @return Returns 1 if preconditions aren't met, else
+    * returns 0 once job is finished.
+    *
+    * @pre context != NULL && function != NULL
+    * @pre function may be called from several threads at once
+*/
+uint8_t run_work_job(struct WsfsContext* context, struct WorkTask task, WorkFunction function, void* argument);
+
+/**
+    * Hands out task, any worker of job may handle it. If
+    * deque of worker can't grow, task is handled at once.
+    *
+    * @param[in,out] job The job which task belongs to.
+    * @param[in] worker The number of worker which hands it out.
+    * @param[in] task The task which will be handled.
+    *
+    * @pre job != NULL
+    * @pre called from task of job handled by worker
+*/
+void push_work_task(struct WorkJob* job, uint32_t worker, struct WorkTask task);
+
+#endif //WORK_POOL_H
@@ -4,12 +4,35 @@
     *
     * This file contains declaration of functions related
     * to Without eyeS's File System(WSFS).
+    *
+    * Handles are numbered per context, a handle opened by
+    * wsfs_open_ctx() must be used with the same context.
 */
 
 #ifndef WSFS_H
 #define WSFS_H
 
 #include "file_node_funcs.h"
+#include "lookup_cache.h"
+
+/**
+    * Creates file system context with its own root, counters,
+    * limits, allocator, lookup cache and handle table. Use
+    * wsfs_init_ctx() to create its root directory.
+    *
+    * @return Returns NULL if memory allocation failed, else
+    * returns created context.
+*/
+struct WsfsContext* create_wsfs_context(void);
+
+/**
+    * Frees context with all its file nodes and handles at once.
+    *
+    * @param[in] context The context which will be freed.
+    *
+    * @note Must not be called while other threads use context.
+*/
+void free_wsfs_context(struct WsfsContext* context);
 
 /**
     * Starts file system.
@@ -19,10 +42,216 @@
 struct FileNode* wsfs_init(void);
 
 /**
-    * Free memory after program ends.
+    * Same as wsfs_init(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* wsfs_init_ctx(struct WsfsContext* context);
+
+/**
+    * Free memory after program ends. In ALLOCATOR_MODE_ARENA
+    * all file nodes are dropped at once, including the ones
+    * which aren't located in "root".
     *
     * @param[in] root The root directory.
 */
 void wsfs_deinit(struct FileNode* root);
 
+/**
+    * Same as wsfs_deinit(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+void wsfs_deinit_ctx(struct WsfsContext* context, struct FileNode* root);
+
+/**
+    * Resolves path like "dir\subdir\file" starting from "root"
+    * directory. Every resolved (directory, name) pair is kept
+    * in lookup cache, so repeated lookups don't scan directories.
+    *
+    * @param[in] root The directory from which path is resolved.
+    * @param[in] path The path to file node. Leading separators
+    * are ignored, "." and ".." mean current and parent directory.
+    * @param[in] flags Which symbolic links are followed(use LOOKUP_*).
+    *
+    * @return Returns NULL if preconditions aren't met or
+    * there is no such file node, else returns found file node.
+    *
+    * @pre root != NULL && path != NULL
+    * @pre every directory in path must have READ and EXEC permission
+    *
+    * @note Symbolic link chains longer than MAX_SYMLINK_DEPTH
+    * are treated as broken.
+*/
+struct FileNode* wsfs_lookup_path(struct FileNode* root, const char* path, enum LookupFlags flags);
+
+/**
+    * Same as wsfs_lookup_path(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+struct FileNode* wsfs_lookup_path_ctx(struct WsfsContext* context, struct FileNode* root, const char* path,
+                                      enum LookupFlags flags);
+
+/**
+    * Opens file. Symbolic links are resolved and permissions
+    * are checked once here, so later calls on handle don't
+    * walk links again.
+    *
+    * @param[in] node The file or symbolic link to file.
+    * @param[in] flags How file will be used(use OPEN_*).
+    * @param[out] handle The handle of opened file.
+    *
+    * @return Returns 1 if preconditions aren't met or memory
+    * allocation failed, else returns 0.
+    *
+    * @pre node != NULL && handle != NULL
+    * @pre flags must contain OPEN_READ or OPEN_WRITE
+    * @pre node must have READ permission, and WRITE
+    * permission if opened with OPEN_WRITE
+    *
+    * @note File must not be deleted while it is open. One
+    * handle must not be used by several threads at once.
+*/
+uint8_t wsfs_open(struct FileNode* node, enum OpenFlags flags, uint32_t* handle);
+
+/**
+    * Same as wsfs_open(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_open_ctx(struct WsfsContext* context, struct FileNode* node, enum OpenFlags flags, uint32_t* handle);
+
+/**
+    * Reads bytes at handle position and moves position
+    * past them. Buffered writes are flushed first.
+    *
+    * @param[in] handle The handle of file.
+    * @param[out] buffer The buffer where bytes will be copied.
+    * @param[in] size The maximum amount of bytes.
+    *
+    * @return Returns 0 if preconditions aren't met or end
+    * of file is reached, else returns amount of read bytes.
+    *
+    * @pre handle must be opened with OPEN_READ
+    * @pre buffer != NULL
+*/
+uint64_t wsfs_read(uint32_t handle, void* buffer, uint64_t size);
+
+/**
+    * Same as wsfs_read(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint64_t wsfs_read_ctx(struct WsfsContext* context, uint32_t handle, void* buffer, uint64_t size);
+
+/**
+    * Writes bytes at handle position and moves position past
+    * them. Small consecutive writes are gathered in handle's
+    * buffer and reach the file on flush, so memory limit
+    * errors may be reported later by wsfs_flush() or
+    * wsfs_close().
+    *
+    * @param[in] handle The handle of file.
+    * @param[in] buffer The bytes which will be written.
+    * @param[in] size The amount of bytes.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * limit is reached or memory allocation failed, else
+    * returns 0.
+    *
+    * @pre handle must be opened with OPEN_WRITE
+    * @pre buffer != NULL
+*/
+uint8_t wsfs_write(uint32_t handle, const void* buffer, uint64_t size);
+
+/**
+    * Same as wsfs_write(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_write_ctx(struct WsfsContext* context, uint32_t handle, const void* buffer, uint64_t size);
+
+/**
+    * Moves handle position. Position may be past the end of
+    * file, the gap is filled with zeros by the next write.
+    *
+    * @param[in] handle The handle of file.
+    * @param[in] offset The offset relative to origin.
+    * @param[in] origin From where offset is counted(use SEEK_ORIGIN_*).
+    * @param[out] position The new position. Can be NULL.
+    *
+    * @return Returns 1 if preconditions aren't met or new
+    * position would be negative, else returns 0.
+    *
+    * @pre handle must be open
+*/
+uint8_t wsfs_seek(uint32_t handle, int64_t offset, enum SeekOrigin origin, uint64_t* position);
+
+/**
+    * Same as wsfs_seek(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_seek_ctx(struct WsfsContext* context, uint32_t handle, int64_t offset, enum SeekOrigin origin,
+                      uint64_t* position);
+
+/**
+    * Writes buffered bytes of handle into file.
+    *
+    * @param[in] handle The handle of file.
+    *
+    * @return Returns 1 if preconditions aren't met, memory
+    * limit is reached or memory allocation failed, else
+    * returns 0.
+    *
+    * @pre handle must be open
+*/
+uint8_t wsfs_flush(uint32_t handle);
+
+/**
+    * Same as wsfs_flush(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_flush_ctx(struct WsfsContext* context, uint32_t handle);
+
+/**
+    * Flushes and closes handle. Handle is closed even if
+    * flush failed.
+    *
+    * @param[in] handle The handle of file.
+    *
+    * @return Returns 1 if preconditions aren't met or flush
+    * failed, else returns 0.
+    *
+    * @pre handle must be open
+*/
+uint8_t wsfs_close(uint32_t handle);
+
+/**
+    * Same as wsfs_close(), in given context.
+    *
+    * @param[in,out] context The context which owns file nodes and handles.
+    *
+    * @pre context != NULL
+*/
+uint8_t wsfs_close_ctx(struct WsfsContext* context, uint32_t handle);
+
 #endif //WSFS_H
\ No newline at end of file
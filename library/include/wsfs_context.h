@@ -0,0 +1,85 @@
+/**
+    * @file: wsfs_context.h
+    * @author: without eyes
+    *
+    * This file contains the struct which holds state of one
+    * file system instance. Every instance has its own root,
+    * counters, limits, allocator, lookup cache, name index,
+    * content store and handle table, so instances in one
+    * process share nothing and may be used by different
+    * threads without contention.
+    * Functions without a context argument use the default
+    * instance(see get_default_context()).
+*/
+
+#ifndef WSFS_CONTEXT_H
+#define WSFS_CONTEXT_H
+
+#include <stdint.h>
+#include "file_content.h"
+#include "lookup_cache.h"
+#include "name_index.h"
+#include "rw_lock.h"
+#include "slab_allocator.h"
+
+struct FileHandle; /**< Forward declaration of FileHandle struct */
+struct Journal; /**< Forward declaration of Journal struct */
+struct Checkpointer; /**< Forward declaration of Checkpointer struct */
+struct TreeSnapshot; /**< Forward declaration of TreeSnapshot struct */
+struct WorkPool; /**< Forward declaration of WorkPool struct */
+struct QueryIndex; /**< Forward declaration of QueryIndex struct */
+
+/**
+ * @struct WsfsContext
+ * @brief State of one file system instance. Fields are managed
+ * by the library, use functions which take context to change them.
+ */
+struct WsfsContext {
+    struct FileNode* root;              /**< Root directory, NULL until set_root_node_ctx() */
+    _Atomic uint64_t fileCount;         /**< Amount of file nodes */
+    _Atomic uint64_t usedMemory;        /**< Memory charged for file nodes, names and content */
+    uint64_t fileCountLimit;            /**< Maximal amount of file nodes */
+    uint64_t memoryLimit;               /**< Maximal amount of charged memory */
+    struct SlabAllocator allocator;     /**< Allocator which owns all memory of file nodes */
+    struct LookupCache lookupCache;     /**< Cache of resolved (directory, name) pairs */
+    struct RwLock renameLock;           /**< Keeps names and parents stable, see file_node_funcs.h */
+    _Atomic uint64_t renameSequence;    /**< Odd while a rename or move is in progress */
+    struct FileHandle* handles;         /**< Table of open file handles */
+    uint32_t handleCapacity;            /**< Amount of slots in handle table */
+    uint32_t firstFreeHandle;           /**< First free slot, NO_FREE_HANDLE if table is full */
+    struct RwLock handleLock;           /**< Write locked while handle table changes */
+    struct Journal* journal;            /**< Journal of changes, NULL if changes aren't journaled */
+    uint64_t checkpoint;                /**< Number of the last checkpoint of tree, 0 if there is none */
+    struct Checkpointer* checkpointer;  /**< Background checkpoints, NULL if they aren't taken */
+    struct TreeSnapshot* snapshots;     /**< Named read-only copies of tree, see create_tree_snapshot_ctx() */
+    struct RwLock snapshotLock;         /**< Guards list of tree snapshots */
+    struct ContentStore contentStore;   /**< Deduplicated file contents, see set_dedup_enabled_ctx() */
+    struct ContentCompressor compressor; /**< Compression of cold file contents, see compress_cold_files_ctx() */
+    struct NameIndex nameIndex;         /**< All file nodes by name, see find_file_node_in_fs_ctx() */
+    struct WorkPool* workPool;          /**< Threads which share subtree work, NULL if jobs run on caller alone */
+    struct QueryIndex* queryIndex;      /**< Nodes by type, size and times, NULL if queries aren't enabled */
+};
+
+#define NO_FREE_HANDLE UINT32_MAX
+
+/**
+    * Initializes context with default limits(MAX_MEMORY_SIZE,
+    * MAX_FILE_COUNT), an empty allocator in slab mode, an
+    * empty lookup cache, an empty name index and compression
+    * disabled. No memory is allocated.
+    *
+    * @param[out] context The context which will be initialized.
+    *
+    * @pre context != NULL
+*/
+void init_wsfs_context(struct WsfsContext* context);
+
+/**
+    * Gets context used by functions without a context argument.
+    * It is initialized on first call.
+    *
+    * @return Returns default context.
+*/
+struct WsfsContext* get_default_context(void);
+
+#endif //WSFS_CONTEXT_H
@@ -1,8 +1,44 @@
 #ifndef WSFS_MACROS_H
 #define WSFS_MACROS_H
 
-#define MAX_MEMORY_SIZE 1024 // in bytes
-#define MAX_FILE_COUNT 50
+#ifndef MAX_MEMORY_SIZE
+#define MAX_MEMORY_SIZE 1024ULL // default memory limit in bytes, see set_memory_limit()
+#endif
+
+#ifndef MAX_FILE_COUNT
+#define MAX_FILE_COUNT 50ULL // default file count limit, see set_file_count_limit()
+#endif
+
+#ifndef DIR_INDEX_THRESHOLD
+#define DIR_INDEX_THRESHOLD 16 // amount of children after which directory gets hash index
+#endif
+
+#ifndef LOOKUP_CACHE_SIZE
+#define LOOKUP_CACHE_SIZE 1024 // default amount of lookup cache entries, see set_lookup_cache_capacity()
+#endif
+
+#ifndef HANDLE_BUFFER_SIZE
+#define HANDLE_BUFFER_SIZE 4096 // size of per-handle write buffer, bigger writes bypass it
+#endif
+
+#ifndef SNAPSHOT_BUFFER_SIZE
+#define SNAPSHOT_BUFFER_SIZE (1024 * 1024) // size of buffer through which snapshots are written and read
+#endif
+
+#ifndef JOURNAL_BUFFER_SIZE
+#define JOURNAL_BUFFER_SIZE (1024 * 1024) // amount of buffered journal records after which they are written
+#endif
+
+#ifndef JOURNAL_RECORD_DATA_SIZE
+#define JOURNAL_RECORD_DATA_SIZE (1024u * 1024 * 1024) // largest data of one journal record, bigger writes take several
+#endif
+
+#ifndef EPOCH_COLLECT_INTERVAL
+#define EPOCH_COLLECT_INTERVAL 64 // amount of deferred retirements after which retired memory is collected
+#endif
+
+#define LOOKUP_CACHE_WAYS 4
+#define MAX_SYMLINK_DEPTH 40
 #define PERMISSION_MASK 1
 #define MAX_NAME_SIZE 32
 #define BUFFER_SIZE 1024
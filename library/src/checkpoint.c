@@ -0,0 +1,286 @@
+/**
+    * @file: checkpoint.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to checkpoints.
+*/
+
+#include "../include/checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/journal.h"
+#include "../include/snapshot.h"
+#include "../include/wsfs.h"
+
+/**
+ * @struct CheckpointHeader
+ * @brief First bytes of checkpoint file, snapshot follows.
+ */
+struct CheckpointHeader {
+    uint32_t magic;         /**< CHECKPOINT_MAGIC */
+    uint32_t version;       /**< CHECKPOINT_VERSION */
+    uint64_t checkpoint;    /**< Number of checkpoint, journal files refer to it */
+};
+
+struct Checkpointer {
+    char* path;                     /**< Path of checkpoint file */
+    char* temporaryPath;            /**< Path where checkpoint is written before it replaces the file */
+    uint32_t intervalMs;            /**< Interval between checks of background thread */
+    uint64_t journalSizeLimit;      /**< Size of journal files after which checkpoint is saved */
+    pthread_mutex_t runMutex;       /**< Held while checkpoint is saved */
+    pthread_mutex_t mutex;          /**< Protects every field below */
+    pthread_cond_t wake;            /**< Wakes background thread */
+    uint64_t savedRecords;          /**< Amount of journal records when the last checkpoint started */
+    uint8_t isStopping;             /**< 1 once background thread has to stop */
+    uint8_t hasThread;              /**< 1 if background thread was started */
+    pthread_t thread;               /**< Background thread */
+    struct CheckpointStats stats;   /**< Counters */
+};
+
+static uint64_t get_nanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+    * Writes checkpoint file in child process. Only the forking
+    * thread exists there, locks copied from parent may stay
+    * held or awaited forever, so tree is saved without them.
+*/
+static uint8_t write_checkpoint_file(struct WsfsContext* context, const char* path, const uint64_t checkpoint) {
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return EXIT_FAILURE;
+
+    struct CheckpointHeader header = {0};
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.checkpoint = checkpoint;
+    const uint8_t result = write(fd, &header, sizeof(header)) == sizeof(header) &&
+                           save_frozen_snapshot(context, fd) == EXIT_SUCCESS && fsync(fd) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    close(fd);
+
+    return result;
+}
+
+/**
+    * Waits for child process. Returns 1 if it wasn't started
+    * or didn't write checkpoint file.
+*/
+static uint8_t wait_for_child(const pid_t child) {
+    if (child < 0) return EXIT_FAILURE;
+
+    int status;
+    pid_t waited;
+    do {
+        waited = waitpid(child, &status, 0);
+    } while (waited < 0 && errno == EINTR);
+
+    return waited == child && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static uint8_t save_checkpoint(struct WsfsContext* context, struct Checkpointer* checkpointer) {
+    const uint64_t checkpoint = context->checkpoint + 1;
+    struct JournalStats journalStats;
+    get_journal_stats_ctx(context, &journalStats);
+    const uint64_t start = get_nanoseconds();
+
+    // No change is in progress while rename lock is write locked, so child gets the tree between two changes
+    acquire_write_lock(&context->renameLock);
+    if (rotate_journal(context, checkpoint) != EXIT_SUCCESS) {
+        release_write_lock(&context->renameLock);
+        pthread_mutex_lock(&checkpointer->mutex);
+        checkpointer->stats.failures++;
+        pthread_mutex_unlock(&checkpointer->mutex);
+        return EXIT_FAILURE;
+    }
+    const pid_t child = fork();
+    if (child == 0) _exit(write_checkpoint_file(context, checkpointer->temporaryPath, checkpoint));
+    release_write_lock(&context->renameLock);
+    const uint64_t pause = get_nanoseconds() - start;
+
+    uint8_t isSaved = sync_rotated_journal(context) == EXIT_SUCCESS;
+    if (wait_for_child(child) != EXIT_SUCCESS) isSaved = 0;
+
+    struct stat status;
+    if (isSaved && (stat(checkpointer->temporaryPath, &status) != 0 ||
+                    rename(checkpointer->temporaryPath, checkpointer->path) != 0 ||
+                    sync_parent_directory(checkpointer->path) != EXIT_SUCCESS)) isSaved = 0;
+    if (!isSaved) unlink(checkpointer->temporaryPath);
+
+    if (finish_journal_rotation(context, isSaved) != EXIT_SUCCESS) isSaved = 0;
+    if (isSaved) context->checkpoint = checkpoint;
+
+    pthread_mutex_lock(&checkpointer->mutex);
+    if (isSaved) {
+        checkpointer->savedRecords = journalStats.records;
+        checkpointer->stats.checkpoints++;
+        checkpointer->stats.lastDurationNs = get_nanoseconds() - start;
+        checkpointer->stats.lastPauseNs = pause;
+        checkpointer->stats.lastBytes = (uint64_t)status.st_size;
+        checkpointer->stats.totalBytes += (uint64_t)status.st_size;
+    } else {
+        checkpointer->stats.failures++;
+    }
+    pthread_mutex_unlock(&checkpointer->mutex);
+
+    return isSaved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void* run_checkpointer(void* argument) {
+    struct WsfsContext* context = argument;
+    struct Checkpointer* checkpointer = context->checkpointer;
+
+    pthread_mutex_lock(&checkpointer->mutex);
+    while (!checkpointer->isStopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += checkpointer->intervalMs / 1000;
+        deadline.tv_nsec += (long)(checkpointer->intervalMs % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&checkpointer->wake, &checkpointer->mutex, &deadline);
+        if (checkpointer->isStopping) break;
+
+        const uint64_t savedRecords = checkpointer->savedRecords;
+        pthread_mutex_unlock(&checkpointer->mutex);
+
+        struct JournalStats journalStats;
+        get_journal_stats_ctx(context, &journalStats);
+        if (journalStats.fileSize >= checkpointer->journalSizeLimit && journalStats.records != savedRecords) {
+            wsfs_checkpoint_ctx(context);
+        }
+        pthread_mutex_lock(&checkpointer->mutex);
+    }
+    pthread_mutex_unlock(&checkpointer->mutex);
+
+    return NULL;
+}
+
+static void free_checkpointer(struct Checkpointer* checkpointer) {
+    pthread_mutex_destroy(&checkpointer->runMutex);
+    pthread_mutex_destroy(&checkpointer->mutex);
+    pthread_cond_destroy(&checkpointer->wake);
+    free(checkpointer->path);
+    free(checkpointer->temporaryPath);
+    free(checkpointer);
+}
+
+uint8_t wsfs_start_checkpoints_ctx(struct WsfsContext* context, const char* path, const uint32_t intervalMs,
+                                   const uint64_t journalSizeLimit) {
+    if (context == NULL || path == NULL || context->journal == NULL || context->root == NULL ||
+        context->checkpointer != NULL) return EXIT_FAILURE;
+
+    struct Checkpointer* checkpointer = calloc(1, sizeof(struct Checkpointer));
+    if (checkpointer == NULL) return EXIT_FAILURE;
+
+    const size_t pathLength = strlen(path);
+    checkpointer->path = strdup(path);
+    checkpointer->temporaryPath = malloc(pathLength + sizeof(CHECKPOINT_TEMPORARY_SUFFIX));
+    checkpointer->intervalMs = intervalMs;
+    checkpointer->journalSizeLimit = journalSizeLimit;
+    pthread_mutex_init(&checkpointer->runMutex, NULL);
+    pthread_mutex_init(&checkpointer->mutex, NULL);
+    pthread_cond_init(&checkpointer->wake, NULL);
+    if (checkpointer->path == NULL || checkpointer->temporaryPath == NULL) {
+        free_checkpointer(checkpointer);
+        return EXIT_FAILURE;
+    }
+    memcpy(checkpointer->temporaryPath, path, pathLength);
+    memcpy(checkpointer->temporaryPath + pathLength, CHECKPOINT_TEMPORARY_SUFFIX, sizeof(CHECKPOINT_TEMPORARY_SUFFIX));
+
+    context->checkpointer = checkpointer;
+    if (intervalMs > 0) {
+        if (pthread_create(&checkpointer->thread, NULL, run_checkpointer, context) != 0) {
+            context->checkpointer = NULL;
+            free_checkpointer(checkpointer);
+            return EXIT_FAILURE;
+        }
+        checkpointer->hasThread = 1;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_start_checkpoints(const char* path, const uint32_t intervalMs, const uint64_t journalSizeLimit) {
+    return wsfs_start_checkpoints_ctx(get_default_context(), path, intervalMs, journalSizeLimit);
+}
+
+uint8_t wsfs_checkpoint_ctx(struct WsfsContext* context) {
+    struct Checkpointer* checkpointer = context != NULL ? context->checkpointer : NULL;
+    if (checkpointer == NULL) return EXIT_FAILURE;
+
+    pthread_mutex_lock(&checkpointer->runMutex);
+    const uint8_t result = save_checkpoint(context, checkpointer);
+    pthread_mutex_unlock(&checkpointer->runMutex);
+
+    return result;
+}
+
+uint8_t wsfs_checkpoint(void) {
+    return wsfs_checkpoint_ctx(get_default_context());
+}
+
+void wsfs_stop_checkpoints_ctx(struct WsfsContext* context) {
+    struct Checkpointer* checkpointer = context != NULL ? context->checkpointer : NULL;
+    if (checkpointer == NULL) return;
+
+    pthread_mutex_lock(&checkpointer->mutex);
+    checkpointer->isStopping = 1;
+    pthread_cond_signal(&checkpointer->wake);
+    pthread_mutex_unlock(&checkpointer->mutex);
+    if (checkpointer->hasThread) pthread_join(checkpointer->thread, NULL);
+
+    // Checkpoint started by another thread is finished first
+    pthread_mutex_lock(&checkpointer->runMutex);
+    pthread_mutex_unlock(&checkpointer->runMutex);
+
+    context->checkpointer = NULL;
+    free_checkpointer(checkpointer);
+}
+
+void wsfs_stop_checkpoints(void) {
+    wsfs_stop_checkpoints_ctx(get_default_context());
+}
+
+void get_checkpoint_stats_ctx(struct WsfsContext* context, struct CheckpointStats* stats) {
+    struct Checkpointer* checkpointer = context->checkpointer;
+    if (checkpointer != NULL) {
+        pthread_mutex_lock(&checkpointer->mutex);
+        *stats = checkpointer->stats;
+        pthread_mutex_unlock(&checkpointer->mutex);
+    } else {
+        memset(stats, 0, sizeof(struct CheckpointStats));
+    }
+
+    struct JournalStats journalStats;
+    get_journal_stats_ctx(context, &journalStats);
+    stats->journalSize = journalStats.fileSize;
+}
+
+struct WsfsContext* wsfs_load_checkpoint(const char* path) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct CheckpointHeader header;
+    struct WsfsContext* context = read(fd, &header, sizeof(header)) == sizeof(header) &&
+                                  header.magic == CHECKPOINT_MAGIC && header.version == CHECKPOINT_VERSION
+                                  ? wsfs_load(fd) : NULL;
+    if (context != NULL) context->checkpoint = header.checkpoint;
+    close(fd);
+
+    return context;
+}
@@ -0,0 +1,512 @@
+/**
+    * @file: dir_index.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to hashed directory indexes.
+*/
+
+#include "../include/dir_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "../include/epoch.h"
+
+#define DIR_INDEX_MIN_CAPACITY 16
+#define DIR_ORDER_MIN_BLOCKS 4
+
+static char tombstoneMarker;
+#define TOMBSTONE ((struct FileNode*)&tombstoneMarker)
+
+static uint32_t get_capacity_for(const uint32_t count) {
+    uint32_t capacity = DIR_INDEX_MIN_CAPACITY;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+static size_t get_table_size(const uint32_t capacity) {
+    return sizeof(struct DirIndexTable) + capacity * sizeof(struct FileNode*);
+}
+
+static struct DirIndexTable* create_table(struct SlabAllocator* allocator, const uint32_t capacity) {
+    struct DirIndexTable* table = slab_calloc(allocator, get_table_size(capacity));
+    if (table != NULL) table->capacity = capacity;
+
+    return table;
+}
+
+static void insert_into_slots(struct DirIndexTable* table, struct FileNode* node) {
+    const uint32_t mask = table->capacity - 1;
+    uint32_t slot = node->info.metadata.nameHash & mask;
+    while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed) != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    atomic_store_explicit(&table->slots[slot], node, memory_order_release);
+}
+
+/**
+    * Moves children to a new table. Readers may still probe
+    * the old one, so it is retired instead of freed.
+*/
+static uint8_t rehash_dir_index(struct DirIndex* index, const uint32_t capacity) {
+    struct DirIndexTable* table = create_table(index->allocator, capacity);
+    if (table == NULL) return EXIT_FAILURE;
+
+    struct DirIndexTable* oldTable = atomic_load_explicit(&index->table, memory_order_relaxed);
+    for (uint32_t i = 0; i < oldTable->capacity; i++) {
+        struct FileNode* node = atomic_load_explicit(&oldTable->slots[i], memory_order_relaxed);
+        if (node != NULL && node != TOMBSTONE) {
+            insert_into_slots(table, node);
+        }
+    }
+
+    atomic_store_explicit(&index->table, table, memory_order_release);
+    epoch_retire(slab_free, index->allocator, oldTable, get_table_size(oldTable->capacity));
+    index->capacity = capacity;
+    index->tombstones = 0;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Compares name of node with given one. Name may be
+    * replaced by rename meanwhile, published names are never
+    * changed in place, so the comparison stops at their end.
+*/
+static uint8_t is_node_named(const struct FileNode* node, const char* name, const uint32_t hash, const uint32_t length) {
+    if (atomic_load_explicit(&node->info.metadata.nameHash, memory_order_relaxed) != hash ||
+        atomic_load_explicit(&node->info.metadata.nameLength, memory_order_relaxed) != length) return 0;
+
+    const char* nodeName = atomic_load_explicit(&node->info.metadata.name, memory_order_acquire);
+    return strncmp(nodeName, name, length) == 0 && nodeName[length] == '\0';
+}
+
+/**
+    * Compares name and address with child, children are
+    * ordered by name, then by address.
+*/
+static int compare_with_child(const char* name, const uintptr_t address, const struct FileNode* child) {
+    const int result = strcmp(name, child->info.metadata.name);
+    if (result != 0) return result;
+    if (address != (uintptr_t)child) return address < (uintptr_t)child ? -1 : 1;
+
+    return 0;
+}
+
+static int compare_children(const void* left, const void* right) {
+    const struct FileNode* leftChild = *(struct FileNode* const*)left;
+
+    return compare_with_child(leftChild->info.metadata.name, (uintptr_t)leftChild, *(struct FileNode* const*)right);
+}
+
+/**
+ * @struct DirOrderPosition
+ * @brief Place of child in sorted blocks.
+ */
+struct DirOrderPosition {
+    uint32_t block; /**< Index of block, orderBlockCount if child is past the end */
+    uint32_t child; /**< Index of child in block */
+};
+
+/**
+    * Finds the first child which doesn't sort before given
+    * name and address. Blocks are searched by their last
+    * children.
+*/
+static struct DirOrderPosition find_order_position(const struct DirIndex* index, const char* name,
+                                                   const uintptr_t address) {
+    uint32_t low = 0;
+    uint32_t high = index->orderBlockCount;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        const struct DirOrderBlock* block = index->orderBlocks[middle];
+        if (compare_with_child(name, address, block->children[block->count - 1]) > 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    struct DirOrderPosition position = {low, 0};
+    if (low == index->orderBlockCount) return position;
+
+    const struct DirOrderBlock* block = index->orderBlocks[low];
+    high = block->count;
+    while (position.child < high) {
+        const uint32_t middle = position.child + (high - position.child) / 2;
+        if (compare_with_child(name, address, block->children[middle]) > 0) {
+            position.child = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return position;
+}
+
+/**
+    * Adds empty block to block table at given place.
+*/
+static struct DirOrderBlock* add_order_block(struct DirIndex* index, const uint32_t place) {
+    if (index->orderBlockCount == index->orderBlockCapacity) {
+        if (index->orderBlockCapacity > UINT32_MAX / 2) return NULL;
+        const uint32_t capacity = index->orderBlockCapacity == 0 ? DIR_ORDER_MIN_BLOCKS
+                                                                 : index->orderBlockCapacity * 2;
+        struct DirOrderBlock** blocks = slab_alloc(index->allocator, capacity * sizeof(struct DirOrderBlock*));
+        if (blocks == NULL) return NULL;
+
+        if (index->orderBlocks != NULL) {
+            memcpy(blocks, index->orderBlocks, index->orderBlockCount * sizeof(struct DirOrderBlock*));
+            slab_free(index->allocator, index->orderBlocks, index->orderBlockCapacity * sizeof(struct DirOrderBlock*));
+        }
+        index->orderBlocks = blocks;
+        index->orderBlockCapacity = capacity;
+    }
+
+    struct DirOrderBlock* block = slab_alloc(index->allocator, sizeof(struct DirOrderBlock));
+    if (block == NULL) return NULL;
+
+    block->count = 0;
+    memmove(&index->orderBlocks[place + 1], &index->orderBlocks[place],
+            (index->orderBlockCount - place) * sizeof(struct DirOrderBlock*));
+    index->orderBlocks[place] = block;
+    index->orderBlockCount++;
+
+    return block;
+}
+
+static void drop_order_block(struct DirIndex* index, const uint32_t place) {
+    slab_free(index->allocator, index->orderBlocks[place], sizeof(struct DirOrderBlock));
+    index->orderBlockCount--;
+    memmove(&index->orderBlocks[place], &index->orderBlocks[place + 1],
+            (index->orderBlockCount - place) * sizeof(struct DirOrderBlock*));
+}
+
+/**
+    * Frees sorted blocks, index is left unordered.
+*/
+static void drop_dir_order(struct DirIndex* index) {
+    for (uint32_t i = 0; i < index->orderBlockCount; i++) {
+        slab_free(index->allocator, index->orderBlocks[i], sizeof(struct DirOrderBlock));
+    }
+    if (index->orderBlocks != NULL) {
+        slab_free(index->allocator, index->orderBlocks, index->orderBlockCapacity * sizeof(struct DirOrderBlock*));
+    }
+    index->orderBlocks = NULL;
+    index->orderBlockCount = 0;
+    index->orderBlockCapacity = 0;
+    index->isOrdered = 0;
+}
+
+/**
+    * Sorts children of hash table into blocks, which are
+    * filled up to 3/4, so the next inserts don't split them
+    * at once. Index stays unordered if allocation fails.
+*/
+static void build_dir_order(struct DirIndex* index) {
+    drop_dir_order(index);
+    struct FileNode** children = malloc((index->count > 0 ? index->count : 1) * sizeof(struct FileNode*));
+    if (children == NULL) return;
+
+    const struct DirIndexTable* table = atomic_load_explicit(&index->table, memory_order_relaxed);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        struct FileNode* node = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (node != NULL && node != TOMBSTONE) children[count++] = node;
+    }
+    qsort(children, count, sizeof(struct FileNode*), compare_children);
+
+    const uint32_t fill = DIR_ORDER_BLOCK_CAPACITY * 3 / 4;
+    uint8_t isBuilt = 1;
+    for (uint32_t first = 0; first < count && isBuilt; first += fill) {
+        struct DirOrderBlock* block = add_order_block(index, index->orderBlockCount);
+        isBuilt = block != NULL;
+        if (isBuilt) {
+            block->count = count - first < fill ? count - first : fill;
+            memcpy(block->children, &children[first], block->count * sizeof(struct FileNode*));
+        }
+    }
+    free(children);
+
+    if (isBuilt) {
+        index->isOrdered = 1;
+    } else {
+        drop_dir_order(index);
+    }
+}
+
+/**
+    * Adds child to sorted blocks, full block is split in
+    * halves first.
+*/
+static uint8_t insert_ordered(struct DirIndex* index, struct FileNode* node) {
+    const char* name = node->info.metadata.name;
+    if (index->orderBlockCount == 0) {
+        struct DirOrderBlock* first = add_order_block(index, 0);
+        if (first == NULL) return EXIT_FAILURE;
+
+        first->children[0] = node;
+        first->count = 1;
+        return EXIT_SUCCESS;
+    }
+
+    struct DirOrderPosition position = find_order_position(index, name, (uintptr_t)node);
+    if (position.block == index->orderBlockCount) {
+        position.block--;
+        position.child = index->orderBlocks[position.block]->count;
+    }
+    struct DirOrderBlock* block = index->orderBlocks[position.block];
+    if (block->count == DIR_ORDER_BLOCK_CAPACITY) {
+        struct DirOrderBlock* upper = add_order_block(index, position.block + 1);
+        if (upper == NULL) return EXIT_FAILURE;
+
+        const uint32_t half = DIR_ORDER_BLOCK_CAPACITY / 2;
+        memcpy(upper->children, &block->children[half], (DIR_ORDER_BLOCK_CAPACITY - half) * sizeof(struct FileNode*));
+        upper->count = DIR_ORDER_BLOCK_CAPACITY - half;
+        block->count = half;
+        if (position.child > half) {
+            block = upper;
+            position.child -= half;
+        }
+    }
+
+    memmove(&block->children[position.child + 1], &block->children[position.child],
+            (block->count - position.child) * sizeof(struct FileNode*));
+    block->children[position.child] = node;
+    block->count++;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Removes child from sorted blocks if it is there. Block
+    * which gets empty is dropped, neighbours which fit into
+    * half a block together are merged.
+*/
+static void remove_ordered(struct DirIndex* index, const struct FileNode* node) {
+    const struct DirOrderPosition position = find_order_position(index, node->info.metadata.name, (uintptr_t)node);
+    if (position.block == index->orderBlockCount) return;
+
+    struct DirOrderBlock* block = index->orderBlocks[position.block];
+    if (block->children[position.child] != node) return;
+
+    block->count--;
+    memmove(&block->children[position.child], &block->children[position.child + 1],
+            (block->count - position.child) * sizeof(struct FileNode*));
+
+    if (block->count == 0) {
+        drop_order_block(index, position.block);
+        return;
+    }
+    for (uint32_t first = position.block > 0 ? position.block - 1 : 0; first <= position.block; first++) {
+        if (first + 1 >= index->orderBlockCount) break;
+
+        struct DirOrderBlock* lower = index->orderBlocks[first];
+        const struct DirOrderBlock* upper = index->orderBlocks[first + 1];
+        if (lower->count + upper->count <= DIR_ORDER_BLOCK_CAPACITY / 2) {
+            memcpy(&lower->children[lower->count], upper->children, upper->count * sizeof(struct FileNode*));
+            lower->count += upper->count;
+            drop_order_block(index, first + 1);
+            break;
+        }
+    }
+}
+
+uint32_t hash_file_node_name(const char* name, uint32_t* length) {
+    uint32_t hash = 2166136261u;
+    const unsigned char* current = (const unsigned char*)name;
+    while (*current != '\0') {
+        hash ^= *current++;
+        hash *= 16777619u;
+    }
+
+    if (length != NULL) *length = (uint32_t)(current - (const unsigned char*)name);
+
+    return hash;
+}
+
+struct DirIndex* build_dir_index(const struct FileNode* dir, struct SlabAllocator* allocator) {
+    uint32_t count = 0;
+    for (const struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        count++;
+    }
+
+    struct DirIndex* index = slab_alloc(allocator, sizeof(struct DirIndex));
+    if (index == NULL) return NULL;
+
+    index->allocator = allocator;
+    index->capacity = get_capacity_for(count);
+    index->count = count;
+    index->tombstones = 0;
+    index->orderBlocks = NULL;
+    index->orderBlockCount = 0;
+    index->orderBlockCapacity = 0;
+    index->isOrdered = 0;
+    struct DirIndexTable* table = create_table(allocator, index->capacity);
+    if (table == NULL) {
+        slab_free(allocator, index, sizeof(struct DirIndex));
+        return NULL;
+    }
+
+    for (struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        insert_into_slots(table, child);
+    }
+    atomic_init(&index->table, table);
+    build_dir_order(index);
+
+    return index;
+}
+
+uint8_t dir_index_insert(struct DirIndex* index, struct FileNode* node) {
+    if (index == NULL || node == NULL) return EXIT_FAILURE;
+
+    // keep load factor (with tombstones) under 3/4 so probe chains stay short
+    if ((index->count + index->tombstones + 1) * 4 > index->capacity * 3 &&
+        rehash_dir_index(index, get_capacity_for(index->count + 1)) != EXIT_SUCCESS) {
+        // Order would miss node, listings scan the list from now on
+        drop_dir_order(index);
+        return EXIT_FAILURE;
+    }
+
+    insert_into_slots(atomic_load_explicit(&index->table, memory_order_relaxed), node);
+    index->count++;
+    // Order dropped by failed allocation is built again, so listings don't scan the list for good
+    if (!index->isOrdered) {
+        build_dir_order(index);
+    } else if (insert_ordered(index, node) != EXIT_SUCCESS) {
+        drop_dir_order(index);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t dir_index_remove(struct DirIndex* index, const struct FileNode* node) {
+    if (index == NULL || node == NULL) return EXIT_FAILURE;
+
+    struct DirIndexTable* table = atomic_load_explicit(&index->table, memory_order_relaxed);
+    const uint32_t mask = table->capacity - 1;
+    uint32_t slot = node->info.metadata.nameHash & mask;
+    struct FileNode* current;
+    while ((current = atomic_load_explicit(&table->slots[slot], memory_order_relaxed)) != NULL) {
+        if (current == node) {
+            atomic_store_explicit(&table->slots[slot], TOMBSTONE, memory_order_release);
+            index->count--;
+            index->tombstones++;
+            if (index->isOrdered) remove_ordered(index, node);
+            return EXIT_SUCCESS;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return EXIT_FAILURE;
+}
+
+struct FileNode* dir_index_find(const struct DirIndex* index, const char* name, const uint32_t hash, const uint32_t length) {
+    if (index == NULL || name == NULL) return NULL;
+
+    const struct DirIndexTable* table = atomic_load_explicit(&index->table, memory_order_acquire);
+    const uint32_t mask = table->capacity - 1;
+    uint32_t slot = hash & mask;
+    struct FileNode* node;
+    while ((node = atomic_load_explicit(&table->slots[slot], memory_order_acquire)) != NULL) {
+        if (node != TOMBSTONE && is_node_named(node, name, hash, length)) {
+            return node;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return NULL;
+}
+
+struct FileNode* find_dir_child(const struct FileNode* dir, const char* name, const uint32_t hash, const uint32_t length) {
+    const struct DirIndex* index = atomic_load_explicit(&dir->info.data.directoryIndex, memory_order_acquire);
+    if (index != NULL) {
+        return dir_index_find(index, name, hash, length);
+    }
+
+    struct FileNode* current = atomic_load_explicit(&dir->info.data.directoryContent, memory_order_acquire);
+    while (current != NULL && !is_node_named(current, name, hash, length)) {
+        current = atomic_load_explicit(&current->next, memory_order_acquire);
+    }
+
+    return current;
+}
+
+/**
+    * Copies children from sorted blocks, starting at the
+    * first one after given name and address.
+*/
+static uint32_t list_ordered_children(const struct DirIndex* index, const char* name, const uintptr_t address,
+                                      struct FileNode** children, const uint32_t capacity) {
+    struct DirOrderPosition position = {0, 0};
+    if (name != NULL) {
+        position = find_order_position(index, name, address);
+        if (position.block < index->orderBlockCount &&
+            compare_with_child(name, address, index->orderBlocks[position.block]->children[position.child]) == 0) {
+            position.child++;
+        }
+    }
+
+    uint32_t count = 0;
+    for (; position.block < index->orderBlockCount && count < capacity; position.block++, position.child = 0) {
+        const struct DirOrderBlock* block = index->orderBlocks[position.block];
+        uint32_t taken = block->count - position.child;
+        if (taken > capacity - count) taken = capacity - count;
+        memcpy(&children[count], &block->children[position.child], taken * sizeof(struct FileNode*));
+        count += taken;
+    }
+
+    return count;
+}
+
+uint32_t list_dir_children(const struct FileNode* dir, const char* name, const uintptr_t address,
+                           struct FileNode** children, const uint32_t capacity) {
+    const struct DirIndex* index = atomic_load_explicit(&dir->info.data.directoryIndex, memory_order_acquire);
+    if (index != NULL && index->isOrdered) {
+        return list_ordered_children(index, name, address, children, capacity);
+    }
+
+    // Small or unordered directory, the smallest children after name are kept sorted in array
+    uint32_t count = 0;
+    for (struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        if (name != NULL && compare_with_child(name, address, child) >= 0) continue;
+
+        uint32_t low = 0;
+        uint32_t high = count;
+        while (low < high) {
+            const uint32_t middle = low + (high - low) / 2;
+            if (compare_children(&children[middle], &child) < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low == capacity) continue;
+
+        if (count < capacity) count++;
+        memmove(&children[low + 1], &children[low], (count - 1 - low) * sizeof(struct FileNode*));
+        children[low] = child;
+    }
+
+    return count;
+}
+
+static void reclaim_dir_index(struct SlabAllocator* allocator, void* pointer, const size_t size) {
+    (void)allocator;
+    (void)size;
+    free_dir_index(pointer);
+}
+
+void retire_dir_index(struct DirIndex* index) {
+    epoch_retire(reclaim_dir_index, index->allocator, index, sizeof(struct DirIndex));
+}
+
+void free_dir_index(struct DirIndex* index) {
+    if (index == NULL) return;
+
+    drop_dir_order(index);
+    struct DirIndexTable* table = atomic_load_explicit(&index->table, memory_order_relaxed);
+    slab_free(index->allocator, table, get_table_size(table->capacity));
+    slab_free(index->allocator, index, sizeof(struct DirIndex));
+}
@@ -0,0 +1,245 @@
+/**
+    * @file: epoch.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to epoch-based memory reclamation.
+*/
+
+#include "../include/epoch.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "../include/rw_lock.h"
+#include "../include/wsfs_macros.h"
+
+#define EPOCH_QUIESCENT 0
+#define RECORD_ALIGNMENT 64
+
+/**
+ * @struct EpochRecord
+ * @brief Announcement of one thread. Records are aligned to
+ * a cache line, so entering an epoch doesn't disturb other threads.
+ */
+struct EpochRecord {
+    _Atomic uint64_t epoch;         /**< Epoch thread is inside, EPOCH_QUIESCENT if none */
+    _Atomic uint8_t isUsed;         /**< 1 while record belongs to a live thread */
+    uint32_t depth;                 /**< Nesting depth of wsfs_epoch_enter() calls */
+    struct EpochRecord* next;       /**< Next record, records are never freed */
+};
+
+/**
+ * @struct RetiredObject
+ * @brief Memory waiting until no reader can reach it.
+ */
+struct RetiredObject {
+    EpochReclaimFunc reclaim;           /**< Function which frees memory */
+    struct SlabAllocator* allocator;    /**< Allocator passed to reclaim */
+    void* pointer;                      /**< Retired memory */
+    size_t size;                        /**< Size passed to reclaim */
+    uint64_t epoch;                     /**< Global epoch at retirement */
+    struct RetiredObject* next;         /**< Object retired earlier */
+};
+
+static _Atomic uint64_t globalEpoch = 1;
+static struct EpochRecord* _Atomic records = NULL;
+static _Thread_local struct EpochRecord* localRecord = NULL;
+static pthread_key_t recordKey;
+static pthread_once_t recordKeyOnce = PTHREAD_ONCE_INIT;
+
+static struct RwLock retiredLock;
+static struct RetiredObject* retired = NULL;
+static uint64_t pendingCount = 0;
+static uint32_t retiredSinceCollect = 0;
+
+/**
+    * Gives record back when its thread exits, so threads
+    * created later reuse it.
+*/
+static void release_record(void* pointer) {
+    struct EpochRecord* record = pointer;
+    atomic_store_explicit(&record->epoch, EPOCH_QUIESCENT, memory_order_release);
+    atomic_store_explicit(&record->isUsed, 0, memory_order_release);
+}
+
+static void create_record_key(void) {
+    pthread_key_create(&recordKey, release_record);
+}
+
+static struct EpochRecord* get_local_record(void) {
+    if (localRecord != NULL) return localRecord;
+
+    struct EpochRecord* record = atomic_load_explicit(&records, memory_order_acquire);
+    for (; record != NULL; record = record->next) {
+        uint8_t expected = 0;
+        if (atomic_load_explicit(&record->isUsed, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong(&record->isUsed, &expected, 1)) break;
+    }
+
+    if (record == NULL) {
+        record = aligned_alloc(RECORD_ALIGNMENT, RECORD_ALIGNMENT);
+        if (record == NULL) return NULL;
+
+        atomic_init(&record->epoch, EPOCH_QUIESCENT);
+        atomic_init(&record->isUsed, 1);
+        record->next = atomic_load_explicit(&records, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&records, &record->next, record,
+                                                      memory_order_release, memory_order_relaxed)) {}
+    }
+
+    record->depth = 0;
+    pthread_once(&recordKeyOnce, create_record_key);
+    pthread_setspecific(recordKey, record);
+    localRecord = record;
+
+    return record;
+}
+
+uint8_t wsfs_epoch_enter(void) {
+    struct EpochRecord* record = get_local_record();
+    if (record == NULL) return EXIT_FAILURE;
+    if (record->depth++ > 0) return EXIT_SUCCESS;
+
+    atomic_store_explicit(&record->epoch, atomic_load_explicit(&globalEpoch, memory_order_relaxed),
+                          memory_order_relaxed);
+    // Announcement must be visible before any node is read, pairs with fence in epoch_retire()
+    atomic_thread_fence(memory_order_seq_cst);
+
+    return EXIT_SUCCESS;
+}
+
+void wsfs_epoch_exit(void) {
+    struct EpochRecord* record = localRecord;
+    if (record == NULL || record->depth == 0 || --record->depth > 0) return;
+
+    atomic_store_explicit(&record->epoch, EPOCH_QUIESCENT, memory_order_release);
+}
+
+/**
+    * Checks if any thread is inside an epoch older than
+    * given one, EPOCH_QUIESCENT as epoch checks for any thread.
+*/
+static uint8_t is_epoch_lagging(const uint64_t epoch) {
+    for (struct EpochRecord* record = atomic_load_explicit(&records, memory_order_acquire);
+         record != NULL; record = record->next) {
+        const uint64_t recordEpoch = atomic_load_explicit(&record->epoch, memory_order_acquire);
+        if (recordEpoch != EPOCH_QUIESCENT && (epoch == EPOCH_QUIESCENT || recordEpoch != epoch)) return 1;
+    }
+
+    return 0;
+}
+
+static void reclaim_list(struct RetiredObject* object) {
+    while (object != NULL) {
+        struct RetiredObject* next = object->next;
+        object->reclaim(object->allocator, object->pointer, object->size);
+        free(object);
+        object = next;
+    }
+}
+
+uint8_t is_epoch_idle(void) {
+    // Unlink must be visible before threads are checked, pairs with fence in wsfs_epoch_enter()
+    atomic_thread_fence(memory_order_seq_cst);
+    return !is_epoch_lagging(EPOCH_QUIESCENT);
+}
+
+void epoch_retire(const EpochReclaimFunc reclaim, struct SlabAllocator* allocator, void* pointer, const size_t size) {
+    if (is_epoch_idle()) {
+        reclaim(allocator, pointer, size);
+        return;
+    }
+
+    struct RetiredObject* object = malloc(sizeof(struct RetiredObject));
+    if (object == NULL) {
+        // Nowhere to remember memory, so wait until readers are gone
+        while (!is_epoch_idle()) {
+            sched_yield();
+        }
+        reclaim(allocator, pointer, size);
+        return;
+    }
+
+    object->reclaim = reclaim;
+    object->allocator = allocator;
+    object->pointer = pointer;
+    object->size = size;
+
+    acquire_write_lock(&retiredLock);
+    object->epoch = atomic_load(&globalEpoch);
+    object->next = retired;
+    retired = object;
+    pendingCount++;
+    const uint8_t isCollected = ++retiredSinceCollect >= EPOCH_COLLECT_INTERVAL;
+    release_write_lock(&retiredLock);
+
+    if (isCollected) epoch_collect();
+}
+
+void epoch_collect(void) {
+    acquire_write_lock(&retiredLock);
+    retiredSinceCollect = 0;
+
+    // Epoch advances only when every reader has seen the current one
+    uint64_t epoch = atomic_load(&globalEpoch);
+    if (!is_epoch_lagging(epoch) && atomic_compare_exchange_strong(&globalEpoch, &epoch, epoch + 1)) {
+        epoch++;
+    }
+
+    // Newer objects are first, cut the list at the first one readers may still see
+    struct RetiredObject** link = &retired;
+    while (*link != NULL && (*link)->epoch + 2 > epoch) {
+        link = &(*link)->next;
+    }
+    struct RetiredObject* expired = *link;
+    *link = NULL;
+    for (const struct RetiredObject* object = expired; object != NULL; object = object->next) {
+        pendingCount--;
+    }
+    release_write_lock(&retiredLock);
+
+    reclaim_list(expired);
+}
+
+void epoch_reclaim_all(void) {
+    acquire_write_lock(&retiredLock);
+    struct RetiredObject* all = retired;
+    retired = NULL;
+    pendingCount = 0;
+    retiredSinceCollect = 0;
+    release_write_lock(&retiredLock);
+
+    reclaim_list(all);
+}
+
+void epoch_reclaim_allocator(const struct SlabAllocator* allocator) {
+    struct RetiredObject* owned = NULL;
+
+    acquire_write_lock(&retiredLock);
+    struct RetiredObject** link = &retired;
+    while (*link != NULL) {
+        struct RetiredObject* object = *link;
+        if (object->allocator != allocator) {
+            link = &object->next;
+            continue;
+        }
+
+        *link = object->next;
+        object->next = owned;
+        owned = object;
+        pendingCount--;
+    }
+    release_write_lock(&retiredLock);
+
+    reclaim_list(owned);
+}
+
+uint64_t get_epoch_pending_count(void) {
+    acquire_read_lock(&retiredLock);
+    const uint64_t count = pendingCount;
+    release_read_lock(&retiredLock);
+
+    return count;
+}
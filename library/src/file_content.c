@@ -0,0 +1,831 @@
+/**
+    * @file: file_content.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to chunked file content.
+*/
+
+#include "../include/file_content.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "../include/epoch.h"
+#include "../include/file_node_funcs.h"
+#include "../include/lz_block.h"
+
+#define CHUNK_MIN_CAPACITY 16
+#define CHUNK_TABLE_MIN_CAPACITY 4
+#define CONTENT_STORE_MIN_CAPACITY 64
+
+/**
+ * @struct ContentShare
+ * @brief Counts files which point to the same chunks after a
+ * copy or a write of stored content.
+ */
+struct ContentShare {
+    _Atomic uint32_t ownerCount;    /**< Amount of files which point to the chunks */
+    struct ContentStore* store;     /**< Store which holds the chunks, NULL if they aren't stored */
+    struct ContentShare* next;      /**< Next stored content in the same bucket */
+    uint64_t hash;                  /**< Hash of stored content */
+    struct FileData content;        /**< Stored chunks, owners point to them as well */
+};
+
+/**
+ * @struct CompressedContent
+ * @brief Content compressed chunk by chunk, blocks follow the table of their ends.
+ */
+struct CompressedContent {
+    struct ContentCompressor* compressor;   /**< Compressor which counts the content */
+    uint64_t allocatedSize;                 /**< Size of the whole allocation */
+    uint64_t blockEnds[];                   /**< End of every compressed chunk, counted from the first block */
+};
+
+static uint32_t get_chunk_count_for(const uint64_t size) {
+    return size == 0 ? 0 : (uint32_t)((size - 1) / FILE_CHUNK_SIZE + 1);
+}
+
+/**
+    * Gets capacity of the last chunk for content of given
+    * length. One byte is left for NUL terminator unless the
+    * chunk is full size.
+*/
+static uint32_t get_tail_capacity_for(const uint64_t size) {
+    const uint64_t tailLength = size - (uint64_t)(get_chunk_count_for(size) - 1) * FILE_CHUNK_SIZE;
+    uint32_t capacity = CHUNK_MIN_CAPACITY;
+    while (capacity <= tailLength && capacity < FILE_CHUNK_SIZE) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+    * Gets table of chunks. While content takes at most one
+    * chunk the table is the fileContent field itself.
+*/
+static char** get_chunk_table(struct FileNode* file) {
+    return file->info.data.contentTableCapacity > 1 ? file->info.data.contentChunks : &file->info.data.fileContent;
+}
+
+static char* const* get_data_chunks(const struct FileData* data) {
+    return data->contentTableCapacity > 1 ? data->contentChunks : &data->fileContent;
+}
+
+static char* const* get_chunks(const struct FileNode* file) {
+    return get_data_chunks(&file->info.data);
+}
+
+static uint32_t get_chunk_capacity(const struct FileNode* file, const uint32_t index) {
+    return index + 1 == file->info.data.contentChunkCount ? file->info.data.contentTailCapacity : FILE_CHUNK_SIZE;
+}
+
+/**
+    * Frees memory of content. Readers of a reachable file may
+    * still use its published content, so memory is retired then.
+*/
+static void release_content_memory(struct SlabAllocator* allocator, void* pointer, const size_t size, const uint8_t isShared) {
+    if (isShared) {
+        epoch_retire(slab_free, allocator, pointer, size);
+    } else {
+        slab_free(allocator, pointer, size);
+    }
+}
+
+/**
+    * Unpublishes content given to readers. Must be called before
+    * content changes, contiguous copy is sized by its length.
+*/
+static void drop_flat_content(struct SlabAllocator* allocator, struct FileNode* file, const uint8_t isShared) {
+    char* flat = atomic_load_explicit(&file->info.data.contentFlat, memory_order_relaxed);
+    if (flat == NULL) return;
+
+    atomic_store_explicit(&file->info.data.contentFlat, NULL, memory_order_relaxed);
+    // The only chunk may be published as it is, it is released with the other chunks
+    if (file->info.data.contentChunkCount == 0 || flat != get_chunk_table(file)[0]) {
+        release_content_memory(allocator, flat, file->info.data.contentSize + 1, isShared);
+    }
+}
+
+static uint8_t reserve_chunk_table(struct SlabAllocator* allocator, struct FileNode* file, const uint32_t count) {
+    const uint32_t capacity = file->info.data.contentTableCapacity;
+    if (count <= 1 || count <= capacity) return EXIT_SUCCESS;
+
+    uint32_t newCapacity = CHUNK_TABLE_MIN_CAPACITY;
+    while (newCapacity < count) {
+        newCapacity *= 2;
+    }
+
+    char** table = slab_alloc(allocator, newCapacity * sizeof(char*));
+    if (table == NULL) return EXIT_FAILURE;
+
+    memcpy(table, get_chunk_table(file), file->info.data.contentChunkCount * sizeof(char*));
+    if (capacity > 1) {
+        slab_free(allocator, file->info.data.contentChunks, capacity * sizeof(char*));
+    }
+    file->info.data.contentChunks = table;
+    file->info.data.contentTableCapacity = newCapacity;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Frees table of chunks once content fits in one chunk,
+    * so fileContent points to content again.
+*/
+static void release_chunk_table(struct SlabAllocator* allocator, struct FileNode* file) {
+    const uint32_t capacity = file->info.data.contentTableCapacity;
+    if (capacity <= 1) return;
+
+    char** table = file->info.data.contentChunks;
+    char* first = file->info.data.contentChunkCount > 0 ? table[0] : NULL;
+    slab_free(allocator, table, capacity * sizeof(char*));
+    file->info.data.fileContent = first;
+    file->info.data.contentTableCapacity = 0;
+}
+
+/**
+    * Copies bytes to chunks, zeros are written if source is NULL.
+*/
+static void copy_to_chunks(struct FileNode* file, const char* source, uint64_t size, uint64_t offset) {
+    char** chunks = get_chunk_table(file);
+
+    while (size > 0) {
+        const uint32_t index = (uint32_t)(offset / FILE_CHUNK_SIZE);
+        const uint32_t position = (uint32_t)(offset % FILE_CHUNK_SIZE);
+        const uint64_t length = size < FILE_CHUNK_SIZE - position ? size : FILE_CHUNK_SIZE - position;
+
+        if (source != NULL) {
+            memcpy(chunks[index] + position, source, length);
+            source += length;
+        } else {
+            memset(chunks[index] + position, 0, length);
+        }
+        offset += length;
+        size -= length;
+    }
+}
+
+static void terminate_file_content(struct FileNode* file) {
+    const uint32_t count = file->info.data.contentChunkCount;
+    if (count == 0) return;
+
+    const uint64_t tailLength = file->info.data.contentSize - (uint64_t)(count - 1) * FILE_CHUNK_SIZE;
+    if (tailLength < file->info.data.contentTailCapacity) {
+        get_chunk_table(file)[count - 1][tailLength] = '\0';
+    }
+}
+
+static uint8_t grow_file_content(struct SlabAllocator* allocator, struct FileNode* file, const uint64_t size) {
+    const uint64_t oldSize = file->info.data.contentSize;
+    const uint32_t oldCount = file->info.data.contentChunkCount;
+    const uint32_t newCount = get_chunk_count_for(size);
+    const uint32_t newTailCapacity = get_tail_capacity_for(size);
+
+    if (reserve_chunk_table(allocator, file, newCount) != EXIT_SUCCESS) return EXIT_FAILURE;
+    char** chunks = get_chunk_table(file);
+
+    if (oldCount > 0) {
+        const uint32_t last = oldCount - 1;
+        const uint32_t capacity = oldCount == newCount ? newTailCapacity : FILE_CHUNK_SIZE;
+        if (file->info.data.contentTailCapacity < capacity) {
+            char* chunk = slab_alloc(allocator, capacity);
+            if (chunk == NULL) return EXIT_FAILURE;
+
+            memcpy(chunk, chunks[last], oldSize - (uint64_t)last * FILE_CHUNK_SIZE);
+            release_content_memory(allocator, chunks[last], file->info.data.contentTailCapacity, 1);
+            chunks[last] = chunk;
+            file->info.data.contentTailCapacity = capacity;
+        }
+    }
+
+    for (uint32_t i = oldCount; i < newCount; i++) {
+        chunks[i] = slab_alloc(allocator, i + 1 == newCount ? newTailCapacity : FILE_CHUNK_SIZE);
+        if (chunks[i] == NULL) {
+            while (i-- > oldCount) {
+                slab_free(allocator, chunks[i], FILE_CHUNK_SIZE);
+            }
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (newCount > oldCount) file->info.data.contentTailCapacity = newTailCapacity;
+    file->info.data.contentChunkCount = newCount;
+    file->info.data.contentSize = size;
+    copy_to_chunks(file, NULL, size - oldSize, oldSize);
+    terminate_file_content(file);
+
+    return EXIT_SUCCESS;
+}
+
+static void shrink_file_content(struct SlabAllocator* allocator, struct FileNode* file,
+                                const uint64_t size, const uint8_t isShared) {
+    const uint32_t oldCount = file->info.data.contentChunkCount;
+    const uint32_t newCount = get_chunk_count_for(size);
+    char** chunks = get_chunk_table(file);
+
+    for (uint32_t i = newCount; i < oldCount; i++) {
+        release_content_memory(allocator, chunks[i], get_chunk_capacity(file, i), isShared);
+    }
+    if (newCount < oldCount) {
+        file->info.data.contentTailCapacity = newCount > 0 ? FILE_CHUNK_SIZE : 0;
+    }
+
+    file->info.data.contentChunkCount = newCount;
+    if (newCount <= 1) release_chunk_table(allocator, file);
+    if (newCount == 0) file->info.data.fileContent = NULL;
+    file->info.data.contentSize = size;
+    terminate_file_content(file);
+}
+
+/**
+    * Copies the first size bytes of source into chunks of
+    * the empty destination.
+*/
+static uint8_t copy_content_chunks(struct SlabAllocator* allocator, struct FileNode* destination,
+                                   const struct FileNode* source, const uint64_t size) {
+    if (resize_file_content(allocator, destination, size) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    char* const* sourceChunks = get_chunks(source);
+    char** destinationChunks = get_chunk_table(destination);
+    const uint32_t count = destination->info.data.contentChunkCount;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t length = i + 1 == count ? size - (uint64_t)i * FILE_CHUNK_SIZE : FILE_CHUNK_SIZE;
+        memcpy(destinationChunks[i], sourceChunks[i], length);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Points destination to chunks of source. Published content
+    * isn't touched, lock-free readers may load it meanwhile.
+*/
+static void set_content_chunks(struct FileData* destination, const struct FileData* source) {
+    destination->contentChunks = source->contentChunks;
+    destination->contentSize = source->contentSize;
+    destination->contentChunkCount = source->contentChunkCount;
+    destination->contentTableCapacity = source->contentTableCapacity;
+    destination->contentTailCapacity = source->contentTailCapacity;
+}
+
+static struct ContentShare** find_stored_link(struct ContentStore* store, const struct ContentShare* share) {
+    struct ContentShare** link = &store->buckets[share->hash & (store->capacity - 1)];
+    while (*link != share) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/**
+    * Removes content from store, so no write can find it
+    * anymore. Store must be write locked.
+*/
+static void remove_stored_content(struct ContentShare* share) {
+    struct ContentStore* store = share->store;
+    struct ContentShare** link = find_stored_link(store, share);
+    *link = share->next;
+    store->count--;
+    share->store = NULL;
+}
+
+/**
+    * Gives up ownership of shared chunks. Returns 1 if file
+    * was the last owner, so chunks are freed by the caller.
+*/
+static uint8_t leave_content_share(struct SlabAllocator* allocator, struct FileNode* file) {
+    struct ContentShare* share = atomic_load_explicit(&file->info.data.contentShare, memory_order_acquire);
+    if (share == NULL) return 1;
+
+    atomic_store_explicit(&file->info.data.contentShare, NULL, memory_order_relaxed);
+    // Writes join stored content under store lock, so it is removed under the same lock
+    struct ContentStore* store = share->store;
+    if (store != NULL) acquire_write_lock(&store->lock);
+    const uint8_t isLast = atomic_fetch_sub_explicit(&share->ownerCount, 1, memory_order_acq_rel) == 1;
+    if (isLast && store != NULL) remove_stored_content(share);
+    if (store != NULL) release_write_lock(&store->lock);
+    if (!isLast) return 0;
+    slab_free(allocator, share, sizeof(struct ContentShare));
+
+    return 1;
+}
+
+/**
+    * Checks if file is the only owner of its chunks. Stored
+    * content is removed from store then, so no write can join
+    * it while the chunks change.
+*/
+static uint8_t is_only_content_owner(struct ContentShare* share) {
+    struct ContentStore* store = share->store;
+    if (store == NULL) return atomic_load_explicit(&share->ownerCount, memory_order_acquire) == 1;
+
+    acquire_write_lock(&store->lock);
+    const uint8_t isOnly = atomic_load_explicit(&share->ownerCount, memory_order_acquire) == 1;
+    if (isOnly) remove_stored_content(share);
+    release_write_lock(&store->lock);
+
+    return isOnly;
+}
+
+/**
+    * Gives file its own chunks before they change, only the
+    * first size bytes are copied. Other owners keep the old
+    * chunks, the last one frees them. Copies are made under
+    * read lock of file, so the owner count can't grow here.
+*/
+static uint8_t make_content_private(struct SlabAllocator* allocator, struct FileNode* file, const uint64_t size) {
+    struct ContentShare* share = atomic_load_explicit(&file->info.data.contentShare, memory_order_acquire);
+    if (share == NULL) return EXIT_SUCCESS;
+
+    if (is_only_content_owner(share)) {
+        leave_content_share(allocator, file);
+        return EXIT_SUCCESS;
+    }
+
+    struct FileNode copy;
+    memset(&copy.info.data, 0, sizeof(struct FileData));
+    if (copy_content_chunks(allocator, &copy, file, size) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    drop_flat_content(allocator, file, 1);
+    if (leave_content_share(allocator, file)) shrink_file_content(allocator, file, 0, 1);
+    set_content_chunks(&file->info.data, &copy.info.data);
+
+    return EXIT_SUCCESS;
+}
+
+static uint64_t get_chunk_length(const uint64_t size, const uint32_t index) {
+    const uint64_t offset = (uint64_t)index * FILE_CHUNK_SIZE;
+    return size - offset < FILE_CHUNK_SIZE ? size - offset : FILE_CHUNK_SIZE;
+}
+
+static const uint8_t* get_compressed_blocks(const struct CompressedContent* compressed, const uint64_t size) {
+    return (const uint8_t*)&compressed->blockEnds[get_chunk_count_for(size)];
+}
+
+static uint8_t decode_compressed_chunk(const struct FileData* data, const uint32_t index, char* destination) {
+    const struct CompressedContent* compressed = data->contentCompressed;
+    const uint64_t start = index > 0 ? compressed->blockEnds[index - 1] : 0;
+    const uint64_t length = get_chunk_length(data->contentSize, index);
+
+    atomic_fetch_add_explicit(&compressed->compressor->decodedBytes, length, memory_order_relaxed);
+    return lz_block_decompress(get_compressed_blocks(compressed, data->contentSize) + start,
+                               (uint32_t)(compressed->blockEnds[index] - start), destination, (uint32_t)length);
+}
+
+/**
+    * Frees compressed content, length of content is kept.
+*/
+static void drop_compressed_content(struct SlabAllocator* allocator, struct FileNode* file, const uint8_t isShared) {
+    struct CompressedContent* compressed = file->info.data.contentCompressed;
+    if (compressed == NULL) return;
+
+    struct ContentCompressor* compressor = compressed->compressor;
+    const uint64_t allocatedSize = compressed->allocatedSize;
+    atomic_fetch_sub_explicit(&compressor->files, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&compressor->uncompressedBytes, file->info.data.contentSize, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&compressor->compressedBytes, allocatedSize, memory_order_relaxed);
+    file->info.data.contentCompressed = NULL;
+    release_content_memory(allocator, compressed, allocatedSize, isShared);
+}
+
+static void count_compressed_content(struct ContentCompressor* compressor, const uint64_t size,
+                                     const uint64_t allocatedSize) {
+    atomic_fetch_add_explicit(&compressor->files, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&compressor->uncompressedBytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&compressor->compressedBytes, allocatedSize, memory_order_relaxed);
+}
+
+uint8_t decompress_file_content(struct SlabAllocator* allocator, struct FileNode* file) {
+    const struct CompressedContent* compressed = file->info.data.contentCompressed;
+    if (compressed == NULL) return EXIT_SUCCESS;
+
+    struct FileNode copy;
+    memset(&copy.info.data, 0, sizeof(struct FileData));
+    uint8_t result = resize_file_content(allocator, &copy, file->info.data.contentSize);
+    char** chunks = get_chunk_table(&copy);
+    for (uint32_t i = 0; result == EXIT_SUCCESS && i < copy.info.data.contentChunkCount; i++) {
+        result = decode_compressed_chunk(&file->info.data, i, chunks[i]);
+    }
+    if (result != EXIT_SUCCESS) {
+        shrink_file_content(allocator, &copy, 0, 0);
+        return EXIT_FAILURE;
+    }
+
+    atomic_fetch_add_explicit(&compressed->compressor->decompressions, 1, memory_order_relaxed);
+    drop_flat_content(allocator, file, 1);
+    drop_compressed_content(allocator, file, 1);
+    set_content_chunks(&file->info.data, &copy.info.data);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t resize_file_content(struct SlabAllocator* allocator, struct FileNode* file, const uint64_t size) {
+    const uint64_t oldSize = file->info.data.contentSize;
+    if (size == oldSize) return EXIT_SUCCESS;
+    if (size > 0 && (size - 1) / FILE_CHUNK_SIZE >= UINT32_MAX) return EXIT_FAILURE;
+    if (size == 0 && file->info.data.contentCompressed != NULL) {
+        drop_flat_content(allocator, file, 1);
+        drop_compressed_content(allocator, file, 1);
+        file->info.data.contentSize = 0;
+        return EXIT_SUCCESS;
+    }
+    if (decompress_file_content(allocator, file) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (make_content_private(allocator, file, size < oldSize ? size : oldSize) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    drop_flat_content(allocator, file, 1);
+
+    if (size < file->info.data.contentSize) {
+        shrink_file_content(allocator, file, size, 1);
+        return EXIT_SUCCESS;
+    }
+
+    return size > file->info.data.contentSize ? grow_file_content(allocator, file, size) : EXIT_SUCCESS;
+}
+
+uint8_t write_file_content(struct SlabAllocator* allocator, struct FileNode* file,
+                           const void* buffer, const uint64_t size, const uint64_t offset) {
+    if (decompress_file_content(allocator, file) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (make_content_private(allocator, file, file->info.data.contentSize) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    drop_flat_content(allocator, file, 1);
+    copy_to_chunks(file, buffer, size, offset);
+
+    return EXIT_SUCCESS;
+}
+
+uint64_t read_file_content_range(const struct FileNode* file, void* buffer, uint64_t size, uint64_t offset) {
+    const uint64_t contentSize = file->info.data.contentSize;
+    if (offset >= contentSize) return 0;
+    if (size > contentSize - offset) size = contentSize - offset;
+
+    const uint8_t isCompressed = file->info.data.contentCompressed != NULL;
+    char* const* chunks = get_chunks(file);
+    char* destination = buffer;
+    const uint64_t total = size;
+    char decoded[FILE_CHUNK_SIZE];
+
+    while (size > 0) {
+        const uint32_t index = (uint32_t)(offset / FILE_CHUNK_SIZE);
+        const uint32_t position = (uint32_t)(offset % FILE_CHUNK_SIZE);
+        const uint64_t length = size < FILE_CHUNK_SIZE - position ? size : FILE_CHUNK_SIZE - position;
+
+        if (isCompressed && decode_compressed_chunk(&file->info.data, index, decoded) != EXIT_SUCCESS) {
+            return total - size;
+        }
+        memcpy(destination, (isCompressed ? decoded : chunks[index]) + position, length);
+        destination += length;
+        offset += length;
+        size -= length;
+    }
+
+    return total;
+}
+
+char* flatten_file_content(struct SlabAllocator* allocator, struct FileNode* file) {
+    const uint64_t size = file->info.data.contentSize;
+    if (size == 0) return NULL;
+
+    char* flat = atomic_load_explicit(&file->info.data.contentFlat, memory_order_relaxed);
+    if (flat != NULL) return flat;
+
+    if (file->info.data.contentChunkCount == 1 && size < file->info.data.contentTailCapacity) {
+        flat = file->info.data.fileContent;
+    } else {
+        flat = slab_alloc(allocator, size + 1);
+        if (flat == NULL) return NULL;
+
+        read_file_content_range(file, flat, size, 0);
+        flat[size] = '\0';
+    }
+    atomic_store_explicit(&file->info.data.contentFlat, flat, memory_order_release);
+
+    return flat;
+}
+
+/**
+    * Gets share of source chunks with one more owner, it is
+    * created on the first copy. Several copiers may hold read
+    * lock of source at once, so share is installed atomically.
+*/
+static struct ContentShare* join_content_share(struct SlabAllocator* allocator, const struct FileNode* source) {
+    // The share isn't part of content, so source is const for callers
+    struct ContentShare* _Atomic* slot = (struct ContentShare* _Atomic*)&source->info.data.contentShare;
+    struct ContentShare* share = atomic_load_explicit(slot, memory_order_acquire);
+    if (share != NULL) {
+        atomic_fetch_add_explicit(&share->ownerCount, 1, memory_order_relaxed);
+        return share;
+    }
+
+    share = slab_calloc(allocator, sizeof(struct ContentShare));
+    if (share == NULL) return NULL;
+    atomic_init(&share->ownerCount, 2);
+
+    struct ContentShare* installed = NULL;
+    if (!atomic_compare_exchange_strong_explicit(slot, &installed, share, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        slab_free(allocator, share, sizeof(struct ContentShare));
+        atomic_fetch_add_explicit(&installed->ownerCount, 1, memory_order_relaxed);
+        share = installed;
+    }
+
+    return share;
+}
+
+/**
+    * Copies compressed content as it is, source can't be
+    * decompressed under read lock.
+*/
+static uint8_t copy_compressed_content(struct SlabAllocator* allocator, struct FileNode* destination,
+                                       const struct FileNode* source) {
+    const struct CompressedContent* compressed = source->info.data.contentCompressed;
+    struct CompressedContent* copy = slab_alloc(allocator, compressed->allocatedSize);
+    if (copy == NULL) return EXIT_FAILURE;
+
+    memcpy(copy, compressed, compressed->allocatedSize);
+    destination->info.data.contentCompressed = copy;
+    destination->info.data.contentSize = source->info.data.contentSize;
+    count_compressed_content(copy->compressor, source->info.data.contentSize, copy->allocatedSize);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t copy_file_content(struct SlabAllocator* allocator, struct FileNode* destination, const struct FileNode* source) {
+    if (source->info.data.contentSize == 0) return EXIT_SUCCESS;
+    if (source->info.data.contentCompressed != NULL) return copy_compressed_content(allocator, destination, source);
+
+    struct ContentShare* share = join_content_share(allocator, source);
+    if (share == NULL) return EXIT_FAILURE;
+
+    // Contiguous copy of several chunks belongs to source, destination makes its own
+    set_content_chunks(&destination->info.data, &source->info.data);
+    atomic_store_explicit(&destination->info.data.contentShare, share, memory_order_relaxed);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t is_file_content_shared(const struct FileNode* file) {
+    return atomic_load_explicit(&file->info.data.contentShare, memory_order_acquire) != NULL;
+}
+
+/**
+    * Hashes content a word at a time, it only has to spread
+    * contents over buckets, equal hashes are compared bytewise.
+*/
+static uint64_t hash_content(const char* buffer, const uint64_t size) {
+    uint64_t hash = size * 0x9E3779B97F4A7C15u;
+    uint64_t offset = 0;
+
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, buffer + offset, sizeof(uint64_t));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDu;
+        hash ^= hash >> 32;
+    }
+    if (offset < size) {
+        uint64_t word = 0;
+        memcpy(&word, buffer + offset, size - offset);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDu;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53u;
+
+    return hash ^ (hash >> 33);
+}
+
+static uint8_t is_content_equal(const struct FileData* content, const char* buffer, const uint64_t size) {
+    if (content->contentSize != size) return 0;
+
+    char* const* chunks = get_data_chunks(content);
+    for (uint32_t i = 0; i < content->contentChunkCount; i++) {
+        const uint64_t offset = (uint64_t)i * FILE_CHUNK_SIZE;
+        const uint64_t length = size - offset < FILE_CHUNK_SIZE ? size - offset : FILE_CHUNK_SIZE;
+        if (memcmp(chunks[i], buffer + offset, length) != 0) return 0;
+    }
+
+    return 1;
+}
+
+/**
+    * Finds stored content equal to buffer and adds an owner
+    * to it. Store must be write locked.
+*/
+static struct ContentShare* join_stored_content(struct ContentStore* store, const char* buffer,
+                                                const uint64_t size, const uint64_t hash) {
+    if (store->buckets == NULL) return NULL;
+
+    struct ContentShare* share = store->buckets[hash & (store->capacity - 1)];
+    while (share != NULL && (share->hash != hash || !is_content_equal(&share->content, buffer, size))) {
+        share = share->next;
+    }
+    if (share != NULL) {
+        atomic_fetch_add_explicit(&share->ownerCount, 1, memory_order_relaxed);
+        store->hits++;
+    }
+
+    return share;
+}
+
+/**
+    * Adds content to store, buckets are doubled once they are
+    * 3/4 full. Store must be write locked.
+*/
+static uint8_t insert_stored_content(struct ContentStore* store, struct SlabAllocator* allocator,
+                                     struct ContentShare* share) {
+    if ((store->count + 1) * 4 > store->capacity * 3) {
+        const uint32_t capacity = store->capacity > 0 ? store->capacity * 2 : CONTENT_STORE_MIN_CAPACITY;
+        struct ContentShare** buckets = slab_calloc(allocator, capacity * sizeof(struct ContentShare*));
+        if (buckets == NULL && store->capacity == 0) return EXIT_FAILURE;
+
+        // A crowded table still works, so failed growth keeps the old one
+        if (buckets != NULL) {
+            for (uint32_t i = 0; i < store->capacity; i++) {
+                struct ContentShare* current = store->buckets[i];
+                while (current != NULL) {
+                    struct ContentShare* next = current->next;
+                    current->next = buckets[current->hash & (capacity - 1)];
+                    buckets[current->hash & (capacity - 1)] = current;
+                    current = next;
+                }
+            }
+            if (store->buckets != NULL) {
+                slab_free(allocator, store->buckets, store->capacity * sizeof(struct ContentShare*));
+            }
+            store->buckets = buckets;
+            store->capacity = capacity;
+        }
+    }
+
+    struct ContentShare** bucket = &store->buckets[share->hash & (store->capacity - 1)];
+    share->store = store;
+    share->next = *bucket;
+    *bucket = share;
+    store->count++;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Copies buffer into new chunks and stores them, unless
+    * another thread stored equal content meanwhile. Content
+    * which couldn't be stored is returned as private one.
+*/
+static struct ContentShare* create_stored_content(struct ContentStore* store, struct SlabAllocator* allocator,
+                                                  const char* buffer, const uint64_t size, const uint64_t hash) {
+    struct FileNode copy;
+    memset(&copy.info.data, 0, sizeof(struct FileData));
+    struct ContentShare* share = slab_calloc(allocator, sizeof(struct ContentShare));
+    if (share == NULL) return NULL;
+    if (resize_file_content(allocator, &copy, size) != EXIT_SUCCESS) {
+        shrink_file_content(allocator, &copy, 0, 0);
+        slab_free(allocator, share, sizeof(struct ContentShare));
+        return NULL;
+    }
+    copy_to_chunks(&copy, buffer, size, 0);
+    atomic_init(&share->ownerCount, 1);
+    share->hash = hash;
+    set_content_chunks(&share->content, &copy.info.data);
+
+    acquire_write_lock(&store->lock);
+    struct ContentShare* stored = join_stored_content(store, buffer, size, hash);
+    if (stored == NULL) insert_stored_content(store, allocator, share);
+    release_write_lock(&store->lock);
+    if (stored == NULL) return share;
+
+    shrink_file_content(allocator, &copy, 0, 0);
+    slab_free(allocator, share, sizeof(struct ContentShare));
+
+    return stored;
+}
+
+uint8_t store_file_content(struct ContentStore* store, struct SlabAllocator* allocator, struct FileNode* file,
+                           const void* buffer, const uint64_t size) {
+    if (size == 0) return resize_file_content(allocator, file, 0);
+    if ((size - 1) / FILE_CHUNK_SIZE >= UINT32_MAX) return EXIT_FAILURE;
+
+    const uint64_t hash = hash_content(buffer, size);
+    struct ContentShare* oldShare = atomic_load_explicit(&file->info.data.contentShare, memory_order_relaxed);
+    acquire_write_lock(&store->lock);
+    // File which already points to equal stored content keeps it
+    if (oldShare != NULL && oldShare->store == store && oldShare->hash == hash &&
+        is_content_equal(&oldShare->content, buffer, size)) {
+        store->hits++;
+        release_write_lock(&store->lock);
+        return EXIT_SUCCESS;
+    }
+    struct ContentShare* share = join_stored_content(store, buffer, size, hash);
+    release_write_lock(&store->lock);
+
+    if (share == NULL) {
+        share = create_stored_content(store, allocator, buffer, size, hash);
+        if (share == NULL) return EXIT_FAILURE;
+    }
+
+    drop_flat_content(allocator, file, 1);
+    drop_compressed_content(allocator, file, 1);
+    if (leave_content_share(allocator, file)) shrink_file_content(allocator, file, 0, 1);
+    set_content_chunks(&file->info.data, &share->content);
+    atomic_store_explicit(&file->info.data.contentShare, share, memory_order_release);
+
+    return EXIT_SUCCESS;
+}
+
+void get_content_store_stats(struct ContentStore* store, struct ContentStoreStats* stats) {
+    memset(stats, 0, sizeof(struct ContentStoreStats));
+
+    acquire_read_lock(&store->lock);
+    for (uint32_t i = 0; i < store->capacity; i++) {
+        for (const struct ContentShare* share = store->buckets[i]; share != NULL; share = share->next) {
+            const uint64_t size = share->content.contentSize;
+            stats->contents++;
+            stats->uniqueBytes += size;
+            stats->logicalBytes += size * atomic_load_explicit(&share->ownerCount, memory_order_relaxed);
+        }
+    }
+    stats->hits = store->hits;
+    release_read_lock(&store->lock);
+    stats->savedBytes = stats->logicalBytes - stats->uniqueBytes;
+}
+
+void touch_file_content(struct FileNode* file) {
+    const uint64_t now = get_current_time();
+    // Readers of hot content would fight for the cache line, so time is only stored once clock ticks
+    if (atomic_load_explicit(&file->info.metadata.accessTime, memory_order_relaxed) < now) {
+        atomic_store_explicit(&file->info.metadata.accessTime, now, memory_order_relaxed);
+    }
+}
+
+static uint8_t is_file_content_cold(const struct FileNode* file, const uint64_t windowMs) {
+    const uint64_t accessTime = atomic_load_explicit(&file->info.metadata.accessTime, memory_order_relaxed);
+    const uint64_t now = get_current_time();
+    return windowMs != COMPRESSION_DISABLED && now >= accessTime && (now - accessTime) / 1000000u >= windowMs;
+}
+
+uint8_t compress_file_content(struct ContentCompressor* compressor, struct SlabAllocator* allocator,
+                              struct FileNode* file) {
+    struct FileData* data = &file->info.data;
+    const uint64_t size = data->contentSize;
+    if (size == 0 || atomic_load_explicit(&data->contentShare, memory_order_relaxed) != NULL ||
+        !is_file_content_cold(file, compressor->windowMs)) return 0;
+
+    // Decoded copy of cold compressed content isn't worth keeping
+    if (data->contentCompressed != NULL) {
+        drop_flat_content(allocator, file, 1);
+        return 0;
+    }
+
+    const uint32_t count = data->contentChunkCount;
+    const size_t tableSize = sizeof(struct CompressedContent) + count * sizeof(uint64_t);
+    struct CompressedContent* staged = malloc(tableSize + (size_t)count * LZ_BLOCK_BOUND(FILE_CHUNK_SIZE));
+    if (staged == NULL) return 0;
+
+    uint8_t* blocks = (uint8_t*)staged + tableSize;
+    char* const* chunks = get_chunks(file);
+    uint64_t end = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        end += lz_block_compress(chunks[i], (uint32_t)get_chunk_length(size, i), blocks + end);
+        staged->blockEnds[i] = end;
+    }
+
+    const uint64_t allocatedSize = tableSize + end;
+    struct CompressedContent* compressed = allocatedSize < size ? slab_alloc(allocator, allocatedSize) : NULL;
+    if (compressed != NULL) {
+        memcpy(compressed, staged, allocatedSize);
+        compressed->compressor = compressor;
+        compressed->allocatedSize = allocatedSize;
+    }
+    free(staged);
+    if (compressed == NULL) return 0;
+
+    drop_flat_content(allocator, file, 1);
+    shrink_file_content(allocator, file, 0, 1);
+    data->contentSize = size;
+    data->contentCompressed = compressed;
+    count_compressed_content(compressor, size, allocatedSize);
+    atomic_fetch_add_explicit(&compressor->compressions, 1, memory_order_relaxed);
+
+    return 1;
+}
+
+uint64_t get_compressed_content_size(const struct FileNode* file) {
+    const struct CompressedContent* compressed = file->info.data.contentCompressed;
+    return compressed != NULL ? compressed->allocatedSize : 0;
+}
+
+void get_content_compressor_stats(const struct ContentCompressor* compressor, struct CompressionStats* stats) {
+    stats->files = atomic_load_explicit(&compressor->files, memory_order_relaxed);
+    stats->uncompressedBytes = atomic_load_explicit(&compressor->uncompressedBytes, memory_order_relaxed);
+    stats->compressedBytes = atomic_load_explicit(&compressor->compressedBytes, memory_order_relaxed);
+    stats->compressions = atomic_load_explicit(&compressor->compressions, memory_order_relaxed);
+    stats->decompressions = atomic_load_explicit(&compressor->decompressions, memory_order_relaxed);
+    stats->decodedBytes = atomic_load_explicit(&compressor->decodedBytes, memory_order_relaxed);
+}
+
+void free_file_content(struct SlabAllocator* allocator, struct FileNode* file) {
+    drop_flat_content(allocator, file, 0);
+    drop_compressed_content(allocator, file, 0);
+    if (leave_content_share(allocator, file)) {
+        shrink_file_content(allocator, file, 0, 0);
+    } else {
+        // Other owners keep the chunks, file is left empty
+        memset(&file->info.data, 0, sizeof(struct FileData));
+    }
+}
@@ -8,440 +8,2094 @@
 
 #include "../include/file_node_funcs.h"
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <malloc.h>
+#include "../include/dir_index.h"
+#include "../include/file_content.h"
+#include "../include/journal.h"
+#include "../include/lookup_cache.h"
+#include "../include/name_index.h"
+#include "../include/query_index.h"
+#include "../include/tree_walk.h"
+#include "../include/work_pool.h"
 #include "../include/wsfs_macros.h"
 
-static struct FileNode* root = NULL;
-static unsigned long long int fileCount = 0;
+#define SWEEP_LIST_MIN_CAPACITY 16
+#define FOUND_LIST_MIN_CAPACITY 4
+
+/**
+ * @struct CloneJob
+ * @brief State shared by workers which copy a subtree.
+ */
+struct CloneJob {
+    struct WsfsContext* context;    /**< Context which is charged for copies */
+    uint8_t isReadOnly;             /**< 1 if copies belong to a tree snapshot */
+    _Atomic uint8_t isFailed;       /**< 1 once a node couldn't be copied, remaining tasks are skipped */
+};
+
+/**
+ * @struct FoundList
+ * @brief Nodes found by one worker of a search.
+ */
+struct FoundList {
+    struct FileNode** nodes;    /**< Found nodes, NULL until the first one */
+    uint32_t count;             /**< Amount of found nodes */
+    uint32_t capacity;          /**< Amount of slots */
+    uint8_t isFailed;           /**< 1 if list couldn't grow */
+};
+
+/**
+ * @struct MatchJob
+ * @brief State shared by workers of a predicate search.
+ */
+struct MatchJob {
+    FileNodePredicate predicate;    /**< Condition which found nodes meet */
+    void* argument;                 /**< Argument of predicate */
+    struct FoundList* lists;        /**< List of every worker */
+};
+
+/**
+ * @struct SweepLevel
+ * @brief Read locked directory on the path of compression sweep.
+ */
+struct SweepLevel {
+    struct FileNode* dir;   /**< Directory which children are visited */
+    struct FileNode* next;  /**< Next child to visit, NULL once all were visited */
+};
+
+/**
+ * @struct TreeSnapshot
+ * @brief Named read-only copy of tree, see create_tree_snapshot().
+ */
+struct TreeSnapshot {
+    struct FileNode* root;          /**< Copy of root directory */
+    struct TreeSnapshot* next;      /**< Next snapshot of context */
+    char name[];                    /**< Name of snapshot */
+};
+
+/**
+    * Adds size to the memory counter unless memory limit would
+    * be reached. Check and add are one atomic step, so threads
+    * can't overshoot the limit together.
+*/
+static uint8_t charge_memory(struct WsfsContext* context, const uint64_t size) {
+    const uint64_t limit = context->memoryLimit;
+    uint64_t used = atomic_load_explicit(&context->usedMemory, memory_order_relaxed);
+    do {
+        if (size >= limit || used >= limit - size) return EXIT_FAILURE;
+    } while (!atomic_compare_exchange_weak_explicit(&context->usedMemory, &used, used + size,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    return EXIT_SUCCESS;
+}
+
+static void refund_memory(struct WsfsContext* context, const uint64_t size) {
+    atomic_fetch_sub_explicit(&context->usedMemory, size, memory_order_relaxed);
+}
+
+/**
+    * Charges counters for a new file node. Returns 1 if file
+    * count or memory limit would be reached.
+*/
+static uint8_t charge_file_node(struct WsfsContext* context, const uint64_t size) {
+    uint64_t count = atomic_load_explicit(&context->fileCount, memory_order_relaxed);
+    do {
+        if (count >= context->fileCountLimit) return EXIT_FAILURE;
+    } while (!atomic_compare_exchange_weak_explicit(&context->fileCount, &count, count + 1,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    if (charge_memory(context, size) != EXIT_SUCCESS) {
+        atomic_fetch_sub_explicit(&context->fileCount, 1, memory_order_relaxed);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void refund_file_node(struct WsfsContext* context, const uint64_t size) {
+    refund_memory(context, size);
+    atomic_fetch_sub_explicit(&context->fileCount, 1, memory_order_relaxed);
+}
+
+/**
+    * Gets lock of node for functions which get node as const,
+    * taking a lock doesn't change the node itself.
+*/
+static struct RwLock* get_node_lock(const struct FileNode* node) {
+    return (struct RwLock*)&node->lock;
+}
+
+/**
+    * Locks two directories for writing in order of their
+    * addresses, so threads locking the same pair can't
+    * deadlock. First directory may be NULL.
+*/
+static void acquire_dir_pair(struct FileNode* first, struct FileNode* second) {
+    if (first == NULL || first == second) {
+        acquire_write_lock(&second->lock);
+    } else if (first < second) {
+        acquire_write_lock(&first->lock);
+        acquire_write_lock(&second->lock);
+    } else {
+        acquire_write_lock(&second->lock);
+        acquire_write_lock(&first->lock);
+    }
+}
+
+static void release_dir_pair(struct FileNode* first, struct FileNode* second) {
+    release_write_lock(&second->lock);
+    if (first != NULL && first != second) release_write_lock(&first->lock);
+}
+
+/**
+    * Starts change of names or parents. Sequence stays odd until
+    * end_rename() is called, so lock-free readers which overlap
+    * with the change notice it and retry.
+*/
+static void begin_rename(struct WsfsContext* context) {
+    acquire_write_lock(&context->renameLock);
+    atomic_fetch_add_explicit(&context->renameSequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void end_rename(struct WsfsContext* context) {
+    atomic_fetch_add_explicit(&context->renameSequence, 1, memory_order_release);
+    release_write_lock(&context->renameLock);
+}
+
+static uint64_t read_rename_sequence(struct WsfsContext* context) {
+    return atomic_load_explicit(&context->renameSequence, memory_order_acquire);
+}
+
+/**
+    * Checks that no name or parent changed since sequence was read.
+*/
+static uint8_t is_rename_sequence_valid(struct WsfsContext* context, const uint64_t sequence) {
+    atomic_thread_fence(memory_order_acquire);
+    return sequence % 2 == 0 && atomic_load_explicit(&context->renameSequence, memory_order_relaxed) == sequence;
+}
+
+/**
+    * Starts change inside the tree. Names and parents stay
+    * stable until end_tree_change(), so paths in journal
+    * records follow the order of changes and subtree totals
+    * are never changed by a move or delete meanwhile.
+*/
+static void begin_tree_change(struct WsfsContext* context) {
+    acquire_read_lock(&context->renameLock);
+}
+
+/**
+    * Ends change started by begin_tree_change() and waits
+    * until its record is durable if sync policy requires it.
+*/
+static void end_tree_change(struct WsfsContext* context, const uint64_t sequence) {
+    release_read_lock(&context->renameLock);
+    journal_commit(context, sequence);
+}
+
+/**
+    * Journals change, see journal_record(). Returns 0 if
+    * context has no journal.
+*/
+static uint64_t record_change(struct WsfsContext* context, const enum JournalRecordType type,
+                              const struct FileNode* node, const struct FileNode* other, const void* data,
+                              const uint64_t size, const uint64_t value) {
+    if (context->journal == NULL) return 0;
+
+    const struct JournalChange change = {type, node, other, data, size, value};
+
+    return journal_record(context, &change);
+}
+
+/**
+    * Gets amount charged to the memory counter for file content
+    * of given length, the terminator is counted as well.
+*/
+static uint64_t get_content_charge(const uint64_t size) {
+    return size > 0 ? size + 1 : 0;
+}
+
+/**
+    * Gets amount charged for content of file, compressed
+    * content is charged for its compressed size.
+*/
+static uint64_t get_file_content_charge(const struct FileNode* file) {
+    const uint64_t compressedSize = get_compressed_content_size(file);
+    return compressedSize > 0 ? compressedSize : get_content_charge(file->info.data.contentSize);
+}
+
+/**
+    * Gets size of a single file node without its children.
+    * This is the amount charged to the memory counter.
+*/
+static uint64_t get_file_node_own_size(const struct FileNode* node) {
+    uint64_t size = sizeof(struct FileNode);
+
+    if (node->info.metadata.name != NULL) {
+        size += node->info.metadata.nameLength + 1;
+    }
+
+    if (node->info.properties.type == FILE_TYPE_FILE) {
+        size += get_file_content_charge(node);
+    }
+
+    return size;
+}
+
+/**
+    * Stores name in file node. Names shorter than INLINE_NAME_SIZE
+    * are kept inside the node, so comparing them doesn't touch
+    * another cache line, longer ones are allocated. Returns 1
+    * if memory allocation failed, node isn't changed then.
+*/
+static uint8_t store_file_node_name(struct SlabAllocator* allocator, struct FileNode* node, const char* name,
+                                    const uint32_t length, const uint32_t hash) {
+    char* storage = node->info.metadata.inlineName;
+    if (length >= INLINE_NAME_SIZE) {
+        storage = slab_alloc(allocator, length + 1);
+        if (storage == NULL) return EXIT_FAILURE;
+    }
+
+    memmove(storage, name, length + 1);
+    node->info.metadata.name = storage;
+    node->info.metadata.nameLength = length;
+    node->info.metadata.nameHash = hash;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Frees name of file node if it isn't stored inline.
+*/
+static void free_file_node_name(struct SlabAllocator* allocator, struct FileNode* node) {
+    if (node->info.metadata.name != node->info.metadata.inlineName) {
+        slab_free(allocator, node->info.metadata.name, node->info.metadata.nameLength + 1);
+    }
+}
+
+/**
+    * Gets directory where node is located. Returns NULL if
+    * node has no parent or is the root.
+*/
+static struct FileNode* get_parent_dir(const struct FileNode* node) {
+    if (node->parent == NULL || node->parent == node ||
+        node->parent->info.properties.type != FILE_TYPE_DIR) return NULL;
+
+    return node->parent;
+}
+
+/**
+    * Gets hash index of directory where node is located.
+    * Returns NULL if node has no parent or parent isn't indexed.
+*/
+static struct DirIndex* get_parent_index(const struct FileNode* node) {
+    const struct FileNode* parent = get_parent_dir(node);
+
+    return parent != NULL ? parent->info.data.directoryIndex : NULL;
+}
+
+/**
+    * Checks if child is in directory's list. Unlinked child
+    * keeps its parent, so parent alone doesn't tell.
+*/
+static uint8_t is_linked_to_dir(const struct FileNode* parent, const struct FileNode* child) {
+    return child->prev != NULL || parent->info.data.directoryContent == child;
+}
+
+/**
+    * Gets directory whose list holds node. Returns NULL if
+    * node is the root or isn't linked anywhere.
+*/
+static struct FileNode* get_linked_parent_dir(const struct FileNode* node) {
+    struct FileNode* parent = get_parent_dir(node);
+
+    return parent != NULL && is_linked_to_dir(parent, node) ? parent : NULL;
+}
+
+/**
+    * Gets size of node with its subtree. Directories keep it,
+    * files and symlinks are measured.
+*/
+static uint64_t get_subtree_size(const struct FileNode* node) {
+    if (node->info.properties.type != FILE_TYPE_DIR) return get_file_node_own_size(node);
+
+    return atomic_load_explicit(&node->info.data.subtreeSize, memory_order_relaxed);
+}
+
+static uint64_t get_subtree_count(const struct FileNode* node) {
+    if (node->info.properties.type != FILE_TYPE_DIR) return 1;
+
+    return atomic_load_explicit(&node->info.data.subtreeCount, memory_order_relaxed);
+}
+
+/**
+    * Starts subtree totals of a new directory with the
+    * directory alone. Name must be stored already.
+*/
+static void init_subtree_totals(struct FileNode* node) {
+    if (node->info.properties.type != FILE_TYPE_DIR) return;
+
+    atomic_store_explicit(&node->info.data.subtreeSize, get_file_node_own_size(node), memory_order_relaxed);
+    atomic_store_explicit(&node->info.data.subtreeCount, 1, memory_order_relaxed);
+}
+
+/**
+    * Adds to subtree totals of directory and of every
+    * directory above it, decrements are passed wrapped.
+    * Totals are only added to, so changes in different
+    * subtrees may overlap. The caller holds rename lock.
+*/
+static void add_to_subtree_totals(struct FileNode* dir, const uint64_t size, const uint64_t count) {
+    for (; dir != NULL; dir = get_linked_parent_dir(dir)) {
+        atomic_fetch_add_explicit(&dir->info.data.subtreeSize, size, memory_order_relaxed);
+        if (count != 0) atomic_fetch_add_explicit(&dir->info.data.subtreeCount, count, memory_order_relaxed);
+    }
+}
+
+/**
+    * Adds change of node's own size to subtree totals which
+    * include it. The caller holds rename lock and lock of
+    * node if it is a file.
+*/
+static void update_subtree_totals(struct FileNode* node, const uint64_t oldSize) {
+    const uint64_t size = get_file_node_own_size(node);
+    if (size == oldSize) return;
+
+    add_to_subtree_totals(node->info.properties.type == FILE_TYPE_DIR ? node : get_linked_parent_dir(node),
+                          size - oldSize, 0);
+}
+
+/**
+    * Sets modification time of node to now, once content of
+    * file or child list of directory has changed. The caller
+    * holds lock of node.
+*/
+static void mark_file_node_modified(struct WsfsContext* context, struct FileNode* node) {
+    const uint64_t oldTime = atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed);
+    const uint64_t now = get_current_time();
+    if (now == oldTime) return;
+
+    atomic_store_explicit(&node->info.metadata.modificationTime, now, memory_order_relaxed);
+    query_index_rekey(context->queryIndex, node, QUERY_MODIFICATION_TIME, oldTime);
+}
+
+/**
+    * Moves file to its new content length in query index.
+    * The caller holds lock of file.
+*/
+static void reindex_file_size(struct WsfsContext* context, struct FileNode* file, const uint64_t oldContentSize) {
+    if (file->info.data.contentSize != oldContentSize) {
+        query_index_rekey(context->queryIndex, file, QUERY_SIZE, oldContentSize);
+    }
+}
+
+/**
+    * Adds new node to name index and query index. If either
+    * fails, node is in neither of them.
+*/
+static uint8_t index_file_node(struct WsfsContext* context, struct FileNode* node) {
+    if (name_index_insert(&context->nameIndex, node) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (query_index_insert(context->queryIndex, node) != EXIT_SUCCESS) {
+        name_index_remove(&context->nameIndex, node);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Adds child to hash index of directory. Index which can't
+    * grow is unpublished, so lookups scan the list until
+    * directory is indexed again by link_to_dir().
+*/
+static void index_dir_child(struct FileNode* dir, struct DirIndex* index, struct FileNode* child) {
+    if (dir_index_insert(index, child) == EXIT_SUCCESS) return;
+
+    atomic_store_explicit(&dir->info.data.directoryIndex, NULL, memory_order_release);
+    retire_dir_index(index);
+}
+
+/**
+    * Appends child to the end of directory's list in O(1) and
+    * keeps child count, hash index and subtree totals up to
+    * date. Doesn't check permissions. Child is filled in
+    * before it is published, so lock-free readers see it whole.
+*/
+static void link_to_dir(struct WsfsContext* context, struct FileNode* parent, struct FileNode* child) {
+    atomic_store_explicit(&child->next, NULL, memory_order_relaxed);
+    child->prev = parent->info.data.directoryTail;
+    atomic_store_explicit(&child->parent, parent, memory_order_release);
+
+    if (parent->info.data.directoryTail == NULL) {
+        atomic_store_explicit(&parent->info.data.directoryContent, child, memory_order_release);
+    } else {
+        atomic_store_explicit(&parent->info.data.directoryTail->next, child, memory_order_release);
+    }
+    parent->info.data.directoryTail = child;
+    parent->info.data.childCount++;
+
+    struct DirIndex* index = atomic_load_explicit(&parent->info.data.directoryIndex, memory_order_relaxed);
+    if (index != NULL) {
+        index_dir_child(parent, index, child);
+    } else if (parent->info.data.childCount >= DIR_INDEX_THRESHOLD) {
+        atomic_store_explicit(&parent->info.data.directoryIndex, build_dir_index(parent, &context->allocator),
+                              memory_order_release);
+    }
+
+    add_to_subtree_totals(parent, get_subtree_size(child), get_subtree_count(child));
+}
+
+/**
+    * Removes child from directory's list in O(1) and keeps
+    * child count, hash index and subtree totals up to date.
+    * Returns 1 if child isn't in directory's list.
+*/
+static uint8_t unlink_from_dir(struct WsfsContext* context, struct FileNode* parent, struct FileNode* child) {
+    if (!is_linked_to_dir(parent, child)) return EXIT_FAILURE;
+
+    lookup_cache_invalidate(&context->lookupCache, child);
+
+    struct FileNode* next = atomic_load_explicit(&child->next, memory_order_relaxed);
+    if (child->prev != NULL) {
+        atomic_store_explicit(&child->prev->next, next, memory_order_release);
+    } else {
+        atomic_store_explicit(&parent->info.data.directoryContent, next, memory_order_release);
+    }
+
+    if (next != NULL) {
+        next->prev = child->prev;
+    } else {
+        parent->info.data.directoryTail = child->prev;
+    }
+
+    parent->info.data.childCount--;
+    struct DirIndex* index = atomic_load_explicit(&parent->info.data.directoryIndex, memory_order_relaxed);
+    if (index != NULL) {
+        dir_index_remove(index, child);
+    }
+
+    // Readers standing on child may still follow its next link
+    child->prev = NULL;
+    add_to_subtree_totals(parent, 0 - get_subtree_size(child), 0 - get_subtree_count(child));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Copies file node without its children and links. Name is
+    * duplicated, file content is shared(see copy_file_content()).
+    * Returns NULL if memory or file count limit is reached or
+    * memory allocation failed. The caller holds rename lock,
+    * so name of node can't change.
+*/
+static struct FileNode* duplicate_file_node(struct WsfsContext* context, const struct FileNode* node,
+                                            const uint8_t isReadOnly) {
+    const uint8_t isFile = node->info.properties.type == FILE_TYPE_FILE;
+    if (isFile) acquire_read_lock(get_node_lock(node));
+
+    struct SlabAllocator* allocator = &context->allocator;
+    struct FileNode* nodeCopy = NULL;
+    const uint64_t nodeSize = get_file_node_own_size(node);
+    if (charge_file_node(context, nodeSize) == EXIT_SUCCESS) {
+        nodeCopy = slab_alloc(allocator, sizeof(struct FileNode));
+    }
+
+    if (nodeCopy != NULL) {
+        memset(nodeCopy, 0, sizeof(struct FileNode));
+        nodeCopy->info.metadata.creationTime = node->info.metadata.creationTime;
+        atomic_init(&nodeCopy->info.metadata.modificationTime,
+                    atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed));
+        atomic_init(&nodeCopy->info.metadata.accessTime,
+                    atomic_load_explicit(&node->info.metadata.accessTime, memory_order_relaxed));
+        nodeCopy->info.properties = node->info.properties;
+        nodeCopy->info.properties.isReadOnly = isReadOnly;
+
+        if (store_file_node_name(allocator, nodeCopy, node->info.metadata.name, node->info.metadata.nameLength,
+                                 node->info.metadata.nameHash) != EXIT_SUCCESS) {
+            slab_free(allocator, nodeCopy, sizeof(struct FileNode));
+            nodeCopy = NULL;
+        } else if (isFile && copy_file_content(allocator, nodeCopy, node) != EXIT_SUCCESS) {
+            free_file_node_name(allocator, nodeCopy);
+            slab_free(allocator, nodeCopy, sizeof(struct FileNode));
+            nodeCopy = NULL;
+        } else if (index_file_node(context, nodeCopy) != EXIT_SUCCESS) {
+            if (isFile) free_file_content(allocator, nodeCopy);
+            free_file_node_name(allocator, nodeCopy);
+            slab_free(allocator, nodeCopy, sizeof(struct FileNode));
+            nodeCopy = NULL;
+        }
+        if (nodeCopy == NULL) refund_file_node(context, nodeSize);
+    }
+
+    if (isFile) release_read_lock(get_node_lock(node));
+    if (nodeCopy == NULL) return NULL;
+
+    init_subtree_totals(nodeCopy);
+
+    if (node->info.properties.type == FILE_TYPE_SYMLINK) {
+        nodeCopy->info.data.symlinkTarget = node->info.data.symlinkTarget;
+    }
+
+    return nodeCopy;
+}
+
+/**
+    * Copies children of directory into its copy and hands out
+    * tasks for subdirectories. Copy of directory is reached
+    * only through its task, so it isn't locked. The caller of
+    * job holds rename lock and stays inside an epoch.
+*/
+static void clone_dir_children(struct WorkJob* job, const uint32_t worker, const struct WorkTask task,
+                               void* argument) {
+    struct CloneJob* clone = argument;
+    if (atomic_load_explicit(&clone->isFailed, memory_order_relaxed)) return;
+
+    acquire_read_lock(&task.node->lock);
+    for (struct FileNode* child = task.node->info.data.directoryContent; child != NULL; child = child->next) {
+        struct FileNode* childCopy = duplicate_file_node(clone->context, child, clone->isReadOnly);
+        if (childCopy == NULL) {
+            atomic_store_explicit(&clone->isFailed, 1, memory_order_relaxed);
+            break;
+        }
+        link_to_dir(clone->context, task.copy, childCopy);
+        if (child->info.properties.type == FILE_TYPE_DIR) {
+            push_work_task(job, worker, (struct WorkTask){child, childCopy});
+        }
+    }
+    release_read_lock(&task.node->lock);
+}
+
+/**
+    * Copies node with its whole subtree. Directories are
+    * shared by workers of context(see work_pool.h), every
+    * one is read locked while its children are copied.
+    * Returns NULL if memory or file count limit is reached
+    * or memory allocation failed. The caller holds rename
+    * lock and stays inside an epoch, so directories waiting
+    * for their task aren't freed meanwhile.
+*/
+static struct FileNode* clone_file_node_tree(struct WsfsContext* context, const struct FileNode* node,
+                                             const uint8_t isReadOnly) {
+    struct FileNode* nodeCopy = duplicate_file_node(context, node, isReadOnly);
+    if (nodeCopy == NULL || node->info.properties.type != FILE_TYPE_DIR) return nodeCopy;
+
+    struct CloneJob clone;
+    clone.context = context;
+    clone.isReadOnly = isReadOnly;
+    atomic_init(&clone.isFailed, 0);
+    run_work_job(context, (struct WorkTask){(struct FileNode*)node, nodeCopy}, clone_dir_children, &clone);
+
+    if (atomic_load_explicit(&clone.isFailed, memory_order_relaxed)) {
+        free_file_node_recursive_ctx(context, nodeCopy);
+        return NULL;
+    }
+
+    return nodeCopy;
+}
+
+struct FileNode* create_file_node_ctx(struct WsfsContext* context, struct FileNode* parent, const char* name,
+                                      const enum FileType type) {
+    if (context == NULL) return NULL;
+    if (name == NULL) name = "?";
+
+    uint32_t nameLength;
+    const uint32_t nameHash = hash_file_node_name(name, &nameLength);
+    const uint64_t nodeSize = sizeof(struct FileNode) + nameLength + 1;
+    if (charge_file_node(context, nodeSize) != EXIT_SUCCESS) return NULL;
+
+    struct FileNode* node = slab_alloc(&context->allocator, sizeof(struct FileNode));
+    if (node == NULL) {
+        refund_file_node(context, nodeSize);
+        return NULL;
+    }
+
+    if (store_file_node_name(&context->allocator, node, name, nameLength, nameHash) != EXIT_SUCCESS) {
+        slab_free(&context->allocator, node, sizeof(struct FileNode));
+        refund_file_node(context, nodeSize);
+        return NULL;
+    }
+    const uint64_t now = get_current_time();
+    node->info.metadata.creationTime = now;
+    atomic_init(&node->info.metadata.modificationTime, now);
+    atomic_init(&node->info.metadata.accessTime, now);
+    node->info.properties.type = type;
+    node->info.properties.permissions = PERM_DEFAULT - PERMISSION_MASK;
+    node->info.properties.isReadOnly = 0;
+    memset(&node->info.data, 0, sizeof(struct FileData));
+    init_subtree_totals(node);
+    atomic_init(&node->lock.state, 0);
+    node->next = NULL;
+    node->prev = NULL;
+    node->parent = strcmp(name, "\\") == 0 ? node : parent;
+    if (index_file_node(context, node) != EXIT_SUCCESS) {
+        free_file_node_name(&context->allocator, node);
+        slab_free(&context->allocator, node, sizeof(struct FileNode));
+        refund_file_node(context, nodeSize);
+        return NULL;
+    }
+    if (parent != node) add_to_dir_ctx(context, parent, node);
+
+    return node;
+}
 
 struct FileNode* create_file_node(struct FileNode* parent, const char* name, const enum FileType type) {
-    if (!is_enough_memory(sizeof(struct FileNode) + strlen(name)) ||
-        !is_file_count_within_limit()) return NULL;
+    return create_file_node_ctx(get_default_context(), parent, name, type);
+}
+
+struct FileNode* restore_file_node_ctx(struct WsfsContext* context, struct FileNode* parent, const char* name,
+                                       const struct FileProperties properties, const struct FileTimes times,
+                                       const uint64_t contentSize) {
+    if (context == NULL || name == NULL ||
+        (parent != NULL && parent->info.properties.type != FILE_TYPE_DIR)) return NULL;
+
+    uint32_t nameLength;
+    const uint32_t nameHash = hash_file_node_name(name, &nameLength);
+    struct FileNode* node = slab_alloc(&context->allocator, sizeof(struct FileNode));
+    if (node == NULL) return NULL;
+
+    memset(node, 0, sizeof(struct FileNode));
+    if (store_file_node_name(&context->allocator, node, name, nameLength, nameHash) != EXIT_SUCCESS) {
+        slab_free(&context->allocator, node, sizeof(struct FileNode));
+        return NULL;
+    }
+    node->info.properties = properties;
+    node->info.metadata.creationTime = times.creationTime;
+    atomic_init(&node->info.metadata.modificationTime, times.modificationTime);
+    atomic_init(&node->info.metadata.accessTime, times.accessTime);
+    if (properties.type == FILE_TYPE_FILE && resize_file_content(&context->allocator, node, contentSize) != EXIT_SUCCESS) {
+        free_file_node_name(&context->allocator, node);
+        slab_free(&context->allocator, node, sizeof(struct FileNode));
+        return NULL;
+    }
+    if (index_file_node(context, node) != EXIT_SUCCESS) {
+        if (properties.type == FILE_TYPE_FILE) free_file_content(&context->allocator, node);
+        free_file_node_name(&context->allocator, node);
+        slab_free(&context->allocator, node, sizeof(struct FileNode));
+        return NULL;
+    }
+
+    init_subtree_totals(node);
+
+    // Tree isn't shared yet, so node is counted without checking limits
+    atomic_fetch_add_explicit(&context->fileCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&context->usedMemory, get_file_node_own_size(node), memory_order_relaxed);
+
+    if (parent == NULL) {
+        node->parent = node;
+    } else {
+        acquire_write_lock(&parent->lock);
+        link_to_dir(context, parent, node);
+        release_write_lock(&parent->lock);
+    }
+
+    return node;
+}
+
+uint8_t change_permissions_ctx(struct WsfsContext* context, struct FileNode* node, const enum Permissions permissions) {
+    if (context == NULL || node == NULL || node->info.properties.isReadOnly) return EXIT_FAILURE;
+
+    if (context->journal == NULL) {
+        node->info.properties.permissions = permissions;
+        return EXIT_SUCCESS;
+    }
+
+    begin_tree_change(context);
+    acquire_write_lock(&node->lock);
+    node->info.properties.permissions = permissions;
+    const uint64_t sequence = record_change(context, JOURNAL_PERMISSIONS, node, NULL, NULL, 0, permissions);
+    release_write_lock(&node->lock);
+    end_tree_change(context, sequence);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t change_permissions(struct FileNode* node, const enum Permissions permissions) {
+    return change_permissions_ctx(get_default_context(), node, permissions);
+}
+
+uint8_t is_permissions_equal(const enum Permissions left, const enum Permissions right) {
+    return (left & right) == right;
+}
+
+uint8_t is_file_node_writable(const struct FileNode* node) {
+    return !node->info.properties.isReadOnly && is_permissions_equal(node->info.properties.permissions, PERM_WRITE);
+}
+
+void set_root_node_ctx(struct WsfsContext* context, struct FileNode* node) {
+    if (context == NULL || node == NULL) return;
+    context->root = node;
+}
+
+void set_root_node(struct FileNode* node) {
+    set_root_node_ctx(get_default_context(), node);
+}
+
+struct FileNode* get_root_node_ctx(const struct WsfsContext* context) {
+    return context != NULL ? context->root : NULL;
+}
+
+struct FileNode* get_root_node() {
+    return get_root_node_ctx(get_default_context());
+}
+
+size_t get_file_node_size(const struct FileNode* node) {
+    if (node == NULL ||
+        !is_permissions_equal(node->info.properties.permissions, PERM_READ)) {
+        return 0;
+    }
+
+    return get_subtree_size(node);
+}
+
+uint8_t wsfs_stat(const struct FileNode* node, struct WsfsStat* stat) {
+    if (node == NULL || stat == NULL) return EXIT_FAILURE;
+
+    // Totals of directory are loaded without locks, the node lock keeps content length and child count stable
+    acquire_read_lock(get_node_lock(node));
+    stat->type = node->info.properties.type;
+    stat->permissions = node->info.properties.permissions;
+    stat->times.creationTime = node->info.metadata.creationTime;
+    stat->times.modificationTime = atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed);
+    stat->times.accessTime = atomic_load_explicit(&node->info.metadata.accessTime, memory_order_relaxed);
+    stat->contentSize = stat->type == FILE_TYPE_FILE ? node->info.data.contentSize : 0;
+    stat->childCount = stat->type == FILE_TYPE_DIR ? node->info.data.childCount : 0;
+    stat->subtreeSize = get_subtree_size(node);
+    stat->subtreeCount = get_subtree_count(node);
+    release_read_lock(get_node_lock(node));
+
+    // Like get_file_node_size(), nothing below unreadable node is shown
+    if (!is_permissions_equal(stat->permissions, PERM_READ)) {
+        stat->contentSize = 0;
+        stat->childCount = 0;
+        stat->subtreeSize = 0;
+        stat->subtreeCount = 0;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t change_current_dir(struct FileNode** currentDir, struct FileNode* newCurrentDir) {
+    if (*currentDir == NULL || newCurrentDir == NULL ||
+        !is_permissions_equal(newCurrentDir->info.properties.permissions, PERM_READ) ||
+        !is_permissions_equal(newCurrentDir->info.properties.permissions, PERM_EXEC)) return EXIT_FAILURE;
+
+    newCurrentDir = get_symlink_target(newCurrentDir);
+
+    *currentDir = newCurrentDir;
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t add_to_dir_ctx(struct WsfsContext* context, struct FileNode* restrict parent, struct FileNode* restrict child) {
+    if (context == NULL || parent == NULL || child == NULL ||
+        parent->info.properties.type != FILE_TYPE_DIR ||
+        !is_file_node_writable(parent)) return EXIT_FAILURE;
+
+    begin_tree_change(context);
+    acquire_write_lock(&parent->lock);
+    link_to_dir(context, parent, child);
+    mark_file_node_modified(context, parent);
+    const uint64_t sequence = record_change(context, JOURNAL_ATTACH, child, NULL, NULL, 0, 0);
+    release_write_lock(&parent->lock);
+    end_tree_change(context, sequence);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t add_to_dir(struct FileNode* restrict parent, struct FileNode* restrict child) {
+    return add_to_dir_ctx(get_default_context(), parent, child);
+}
+
+uint32_t get_dir_child_count(const struct FileNode* dir) {
+    if (dir == NULL || dir->info.properties.type != FILE_TYPE_DIR) return 0;
+
+    acquire_read_lock(get_node_lock(dir));
+    const uint32_t count = dir->info.data.childCount;
+    release_read_lock(get_node_lock(dir));
+
+    return count;
+}
+
+uint32_t wsfs_readdir(const struct FileNode* dir, struct WsfsDirCookie* cookie, struct FileNode** children,
+                      const uint32_t capacity) {
+    if (dir == NULL || cookie == NULL || children == NULL || capacity == 0 ||
+        dir->info.properties.type != FILE_TYPE_DIR) return 0;
+
+    acquire_read_lock(get_node_lock(dir));
+    const uint32_t count = list_dir_children(dir, cookie->name, cookie->address, children, capacity);
+    char* name = NULL;
+    if (count > 0) {
+        // Name may be replaced once lock is released, so cookie keeps its own copy
+        const struct FileNode* last = children[count - 1];
+        name = malloc(last->info.metadata.nameLength + 1);
+        if (name != NULL) memcpy(name, last->info.metadata.name, last->info.metadata.nameLength + 1);
+    }
+    release_read_lock(get_node_lock(dir));
+
+    // Cookie stays where it was, so the batch can be read again
+    if (count > 0 && name == NULL) return 0;
+
+    free(cookie->name);
+    cookie->name = name;
+    cookie->address = count > 0 ? (uintptr_t)children[count - 1] : 0;
+
+    return count;
+}
+
+void wsfs_release_dir_cookie(struct WsfsDirCookie* cookie) {
+    if (cookie == NULL) return;
+
+    free(cookie->name);
+    cookie->name = NULL;
+    cookie->address = 0;
+}
+
+char get_file_type_letter(const enum FileType type) {
+    switch (type) {
+        case FILE_TYPE_DIR:         return 'd';
+        case FILE_TYPE_FILE:        return 'f';
+        case FILE_TYPE_SYMLINK:     return 's';
+        case FILE_TYPE_UNKNOWN:     return '-';
+        default:                    return '?';
+    }
+}
+
+char get_permission_letter(const enum Permissions permission) {
+    switch (permission) {
+        case PERM_READ:     return 'r';
+        case PERM_WRITE:    return 'w';
+        case PERM_EXEC:     return 'x';
+        case PERM_NONE:     return '-';
+        default:            return '?';
+    }
+}
+
+uint8_t set_symlink_target_ctx(struct WsfsContext* context, struct FileNode* symlink, struct FileNode* target) {
+    if (context == NULL || symlink == NULL || target == NULL ||
+        !is_file_node_writable(symlink)) return EXIT_FAILURE;
+
+    if (context->journal == NULL) {
+        atomic_store_explicit(&symlink->info.data.symlinkTarget, target, memory_order_release);
+        return EXIT_SUCCESS;
+    }
+
+    begin_tree_change(context);
+    acquire_write_lock(&symlink->lock);
+    atomic_store_explicit(&symlink->info.data.symlinkTarget, target, memory_order_release);
+    const uint64_t sequence = record_change(context, JOURNAL_SYMLINK, symlink, target, NULL, 0, 0);
+    release_write_lock(&symlink->lock);
+    end_tree_change(context, sequence);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t set_symlink_target(struct FileNode* symlink, struct FileNode* target) {
+    return set_symlink_target_ctx(get_default_context(), symlink, target);
+}
+
+struct FileNode* get_symlink_target(struct FileNode* symlink) {
+    if (symlink == NULL ||
+        !is_permissions_equal(symlink->info.properties.permissions, PERM_READ) ||
+        wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
+
+    struct FileNode* current = symlink;
+    while (current != NULL && current->info.properties.type == FILE_TYPE_SYMLINK) {
+        current = atomic_load_explicit(&current->info.data.symlinkTarget, memory_order_acquire);
+    }
+    wsfs_epoch_exit();
+
+    return current;
+}
+
+/**
+    * Resolves node to a regular file which may be written.
+    * Returns NULL if there is no such file.
+*/
+static struct FileNode* get_writable_file(struct FileNode* node) {
+    if (node == NULL ||
+        !is_file_node_writable(node)) return NULL;
+
+    struct FileNode* file = get_symlink_target(node);
+    if (file == NULL || file->info.properties.type != FILE_TYPE_FILE) return NULL;
+
+    return file;
+}
+
+static struct FileNode* get_readable_file(struct FileNode* node) {
+    if (node == NULL ||
+        !is_permissions_equal(node->info.properties.permissions, PERM_READ)) return NULL;
+
+    struct FileNode* file = get_symlink_target(node);
+    if (file == NULL || file->info.properties.type != FILE_TYPE_FILE) return NULL;
+
+    return file;
+}
+
+/**
+    * Changes length of file content and charges the memory
+    * counter for it. Returns 1 if memory limit is reached or
+    * memory allocation failed.
+*/
+static uint8_t resize_charged_file_content(struct WsfsContext* context, struct FileNode* file, const uint64_t size) {
+    if (size == file->info.data.contentSize) return EXIT_SUCCESS;
+
+    // Resized content is never compressed
+    const uint64_t oldCharge = get_file_content_charge(file);
+    const uint64_t newCharge = get_content_charge(size);
+    if (newCharge > oldCharge && charge_memory(context, newCharge - oldCharge) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    if (resize_file_content(&context->allocator, file, size) != EXIT_SUCCESS) {
+        if (newCharge > oldCharge) refund_memory(context, newCharge - oldCharge);
+        return EXIT_FAILURE;
+    }
+    if (newCharge < oldCharge) refund_memory(context, oldCharge - newCharge);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Replaces file content with content kept in content store
+    * and charges the memory counter for it as resize does.
+*/
+static uint8_t store_charged_file_content(struct WsfsContext* context, struct FileNode* file,
+                                          const char* content, const uint64_t size) {
+    const uint64_t oldCharge = get_file_content_charge(file);
+    const uint64_t newCharge = get_content_charge(size);
+    if (newCharge > oldCharge && charge_memory(context, newCharge - oldCharge) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    if (store_file_content(&context->contentStore, &context->allocator, file, content, size) != EXIT_SUCCESS) {
+        if (newCharge > oldCharge) refund_memory(context, newCharge - oldCharge);
+        return EXIT_FAILURE;
+    }
+    if (newCharge < oldCharge) refund_memory(context, oldCharge - newCharge);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Decompresses content before it changes and charges the
+    * memory counter for it. Content is only compressed if it
+    * gets smaller, so decompressed one is never cheaper.
+*/
+static uint8_t decompress_charged_file_content(struct WsfsContext* context, struct FileNode* file) {
+    const uint64_t compressedSize = get_compressed_content_size(file);
+    if (compressedSize == 0) return EXIT_SUCCESS;
+
+    const uint64_t charge = get_content_charge(file->info.data.contentSize) - compressedSize;
+    if (charge_memory(context, charge) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (decompress_file_content(&context->allocator, file) != EXIT_SUCCESS) {
+        refund_memory(context, charge);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint8_t write_to_file_at(struct WsfsContext* context, struct FileNode* file, const void* buffer,
+                                const uint64_t size, const uint64_t offset) {
+    if (offset + size < offset) return EXIT_FAILURE;
+    if (size == 0) return EXIT_SUCCESS;
+
+    touch_file_content(file);
+    if (decompress_charged_file_content(context, file) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    if (offset + size > file->info.data.contentSize &&
+        resize_charged_file_content(context, file, offset + size) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    return write_file_content(&context->allocator, file, buffer, size, offset);
+}
+
+uint8_t write_to_file_ctx(struct WsfsContext* context, struct FileNode* node, const char* content) {
+    if (context == NULL || content == NULL) return EXIT_FAILURE;
+
+    struct FileNode* file = get_writable_file(node);
+    if (file == NULL) return EXIT_FAILURE;
+
+    const uint64_t length = strlen(content);
+    uint8_t result;
+
+    begin_tree_change(context);
+    acquire_write_lock(&file->lock);
+    const uint64_t oldSize = get_file_node_own_size(file);
+    const uint64_t oldContentSize = file->info.data.contentSize;
+    touch_file_content(file);
+    if (context->contentStore.isEnabled) {
+        result = store_charged_file_content(context, file, content, length);
+    } else if (length > file->info.data.contentSize) {
+        result = write_to_file_at(context, file, content, length, 0);
+    } else {
+        result = decompress_charged_file_content(context, file);
+        if (result == EXIT_SUCCESS) result = write_file_content(&context->allocator, file, content, length, 0);
+        if (result == EXIT_SUCCESS) result = resize_charged_file_content(context, file, length);
+    }
+    const uint64_t sequence = result == EXIT_SUCCESS
+                              ? record_change(context, JOURNAL_WRITE_ALL, file, NULL, content, length, 0) : 0;
+    if (result == EXIT_SUCCESS) mark_file_node_modified(context, file);
+    reindex_file_size(context, file, oldContentSize);
+    update_subtree_totals(file, oldSize);
+    release_write_lock(&file->lock);
+    end_tree_change(context, sequence);
+
+    return result;
+}
+
+uint8_t write_to_file(struct FileNode* node, const char* content) {
+    return write_to_file_ctx(get_default_context(), node, content);
+}
+
+char* read_file_content_ctx(struct WsfsContext* context, struct FileNode* node) {
+    if (context == NULL || wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
+
+    struct FileNode* file = get_readable_file(node);
+    char* content = file != NULL ? atomic_load_explicit(&file->info.data.contentFlat, memory_order_acquire) : NULL;
+    if (file != NULL) touch_file_content(file);
+
+    // Content is published once after every change, only that takes the locks
+    if (file != NULL && content == NULL) {
+        // Flatten may decompress content, checkpoint mustn't fork meanwhile
+        acquire_read_lock(&context->renameLock);
+        acquire_write_lock(&file->lock);
+        content = flatten_file_content(&context->allocator, file);
+        release_write_lock(&file->lock);
+        release_read_lock(&context->renameLock);
+    }
+    wsfs_epoch_exit();
+
+    return content;
+}
+
+char* read_file_content(struct FileNode* node) {
+    return read_file_content_ctx(get_default_context(), node);
+}
+
+uint8_t wsfs_pwrite_ctx(struct WsfsContext* context, struct FileNode* node, const void* buffer,
+                        const uint64_t size, const uint64_t offset) {
+    struct FileNode* file = get_writable_file(node);
+    if (context == NULL || file == NULL || buffer == NULL) return EXIT_FAILURE;
+
+    begin_tree_change(context);
+    acquire_write_lock(&file->lock);
+    const uint64_t oldSize = get_file_node_own_size(file);
+    const uint64_t oldContentSize = file->info.data.contentSize;
+    const uint8_t result = write_to_file_at(context, file, buffer, size, offset);
+    const uint64_t sequence = result == EXIT_SUCCESS
+                              ? record_change(context, JOURNAL_WRITE, file, NULL, buffer, size, offset) : 0;
+    if (result == EXIT_SUCCESS) mark_file_node_modified(context, file);
+    reindex_file_size(context, file, oldContentSize);
+    update_subtree_totals(file, oldSize);
+    release_write_lock(&file->lock);
+    end_tree_change(context, sequence);
+
+    return result;
+}
+
+uint8_t wsfs_pwrite(struct FileNode* node, const void* buffer, const uint64_t size, const uint64_t offset) {
+    return wsfs_pwrite_ctx(get_default_context(), node, buffer, size, offset);
+}
+
+uint64_t wsfs_pread(struct FileNode* node, void* buffer, const uint64_t size, const uint64_t offset) {
+    struct FileNode* file = get_readable_file(node);
+    if (file == NULL || buffer == NULL) return 0;
+
+    acquire_read_lock(&file->lock);
+    touch_file_content(file);
+    const uint64_t readSize = read_file_content_range(file, buffer, size, offset);
+    release_read_lock(&file->lock);
+
+    return readSize;
+}
+
+uint8_t wsfs_append_ctx(struct WsfsContext* context, struct FileNode* node, const void* buffer, const uint64_t size) {
+    struct FileNode* file = get_writable_file(node);
+    if (context == NULL || file == NULL || buffer == NULL) return EXIT_FAILURE;
+
+    begin_tree_change(context);
+    acquire_write_lock(&file->lock);
+    const uint64_t oldSize = get_file_node_own_size(file);
+    const uint64_t oldContentSize = file->info.data.contentSize;
+    const uint8_t result = write_to_file_at(context, file, buffer, size, file->info.data.contentSize);
+    const uint64_t sequence = result == EXIT_SUCCESS
+                              ? record_change(context, JOURNAL_APPEND, file, NULL, buffer, size, 0) : 0;
+    if (result == EXIT_SUCCESS) mark_file_node_modified(context, file);
+    reindex_file_size(context, file, oldContentSize);
+    update_subtree_totals(file, oldSize);
+    release_write_lock(&file->lock);
+    end_tree_change(context, sequence);
+
+    return result;
+}
+
+uint8_t wsfs_append(struct FileNode* node, const void* buffer, const uint64_t size) {
+    return wsfs_append_ctx(get_default_context(), node, buffer, size);
+}
+
+uint8_t wsfs_truncate_ctx(struct WsfsContext* context, struct FileNode* node, const uint64_t size) {
+    struct FileNode* file = get_writable_file(node);
+    if (context == NULL || file == NULL) return EXIT_FAILURE;
+
+    begin_tree_change(context);
+    acquire_write_lock(&file->lock);
+    const uint64_t oldSize = get_file_node_own_size(file);
+    const uint64_t oldContentSize = file->info.data.contentSize;
+    touch_file_content(file);
+    const uint8_t result = resize_charged_file_content(context, file, size);
+    const uint64_t sequence = result == EXIT_SUCCESS
+                              ? record_change(context, JOURNAL_TRUNCATE, file, NULL, NULL, 0, size) : 0;
+    if (result == EXIT_SUCCESS) mark_file_node_modified(context, file);
+    reindex_file_size(context, file, oldContentSize);
+    update_subtree_totals(file, oldSize);
+    release_write_lock(&file->lock);
+    end_tree_change(context, sequence);
+
+    return result;
+}
+
+uint8_t wsfs_truncate(struct FileNode* node, const uint64_t size) {
+    return wsfs_truncate_ctx(get_default_context(), node, size);
+}
+
+uint64_t get_file_compressed_size(struct FileNode* node) {
+    struct FileNode* file = get_readable_file(node);
+    if (file == NULL) return 0;
+
+    acquire_read_lock(&file->lock);
+    const uint64_t size = get_compressed_content_size(file);
+    release_read_lock(&file->lock);
+
+    return size;
+}
+
+uint64_t get_file_content_size(struct FileNode* node) {
+    struct FileNode* file = get_readable_file(node);
+    if (file == NULL) return 0;
+
+    acquire_read_lock(&file->lock);
+    const uint64_t size = file->info.data.contentSize;
+    release_read_lock(&file->lock);
+
+    return size;
+}
+
+struct FileNode* find_file_node_in_curr_dir_ctx(struct WsfsContext* context, const struct FileNode* currentDir,
+                                                const char* name) {
+    if (context == NULL || currentDir == NULL || name == NULL ||
+        currentDir->info.properties.type != FILE_TYPE_DIR ||
+        !is_permissions_equal(currentDir->info.properties.permissions, PERM_READ) ||
+        !is_permissions_equal(currentDir->info.properties.permissions, PERM_EXEC)) return NULL;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    if (wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
+
+    // Child moved meanwhile may lead the scan to another directory or cut it short
+    struct FileNode* child;
+    uint64_t sequence;
+    do {
+        sequence = read_rename_sequence(context);
+        child = find_dir_child(currentDir, name, hash, length);
+    } while (child != NULL ? atomic_load_explicit(&child->parent, memory_order_acquire) != currentDir
+                           : !is_rename_sequence_valid(context, sequence));
+    wsfs_epoch_exit();
+
+    return child;
+}
+
+struct FileNode* find_file_node_in_curr_dir(const struct FileNode* currentDir, const char* name) {
+    return find_file_node_in_curr_dir_ctx(get_default_context(), currentDir, name);
+}
+
+/**
+    * Checks if node is root or lies in its subtree. The caller
+    * is inside an epoch, so parents seen on the way aren't freed.
+*/
+static uint8_t is_in_subtree(const struct FileNode* root, const struct FileNode* node) {
+    while (node != root) {
+        const struct FileNode* parent = atomic_load_explicit(&node->parent, memory_order_acquire);
+        if (parent == NULL || parent == node) return 0;
+        node = parent;
+    }
+
+    return 1;
+}
+
+/**
+    * Finds the next node with given name in subtree of root,
+    * see name_index_find(). The caller holds lock of name index.
+*/
+static struct FileNode* find_named_node_in_subtree(struct WsfsContext* context, const struct FileNode* root,
+                                                   const char* name, const uint32_t hash, const uint32_t length,
+                                                   const struct FileNode* previous) {
+    struct FileNode* node = name_index_find(&context->nameIndex, name, hash, length, previous);
+    while (node != NULL && !is_in_subtree(root, node)) {
+        node = name_index_find(&context->nameIndex, name, hash, length, node);
+    }
+
+    return node;
+}
+
+struct FileNode* find_file_node_in_fs_ctx(struct WsfsContext* context, const struct FileNode* root, const char* name) {
+    if (context == NULL || root == NULL || name == NULL) return NULL;
+
+    if (strcmp(root->info.metadata.name, name) == 0) return (struct FileNode*)root;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    if (wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
+
+    // Filter answers most misses, a node moved meanwhile may be missed, so misses are repeated
+    struct FileNode* found = NULL;
+    if (name_index_may_contain(&context->nameIndex, hash)) {
+        uint64_t sequence;
+        do {
+            sequence = read_rename_sequence(context);
+            acquire_read_lock(&context->nameIndex.lock);
+            found = find_named_node_in_subtree(context, root, name, hash, length, NULL);
+            release_read_lock(&context->nameIndex.lock);
+        } while (found == NULL && !is_rename_sequence_valid(context, sequence));
+    }
+    wsfs_epoch_exit();
+
+    return found;
+}
+
+struct FileNode* find_file_node_in_fs(const struct FileNode* root, const char* name) {
+    return find_file_node_in_fs_ctx(get_default_context(), root, name);
+}
 
-    struct FileNode* node = malloc(sizeof(struct FileNode));
-    if (node == NULL) return NULL;
+struct FileNode** find_file_nodes_in_fs_ctx(struct WsfsContext* context, const struct FileNode* root,
+                                            const char* name, uint32_t* count) {
+    if (count != NULL) *count = 0;
+    if (context == NULL || root == NULL || name == NULL || count == NULL) return NULL;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    if (wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
+
+    struct FileNode** nodes = NULL;
+    uint32_t capacity = 0;
+    uint8_t result = EXIT_SUCCESS;
+    if (name_index_may_contain(&context->nameIndex, hash)) {
+        uint64_t sequence;
+        do {
+            sequence = read_rename_sequence(context);
+            *count = 0;
+            acquire_read_lock(&context->nameIndex.lock);
+            for (struct FileNode* node = find_named_node_in_subtree(context, root, name, hash, length, NULL);
+                 node != NULL; node = find_named_node_in_subtree(context, root, name, hash, length, node)) {
+                if (*count == capacity) {
+                    const uint32_t grownCapacity = capacity > 0 ? 2 * capacity : FOUND_LIST_MIN_CAPACITY;
+                    struct FileNode** grown = realloc(nodes, grownCapacity * sizeof(struct FileNode*));
+                    if (grown == NULL) {
+                        result = EXIT_FAILURE;
+                        break;
+                    }
+                    nodes = grown;
+                    capacity = grownCapacity;
+                }
+                nodes[(*count)++] = node;
+            }
+            release_read_lock(&context->nameIndex.lock);
+        } while (result == EXIT_SUCCESS && !is_rename_sequence_valid(context, sequence));
+    }
+    wsfs_epoch_exit();
 
-    node->info.metadata.name = name != NULL ? strdup(name) : strdup("?");
-    node->info.metadata.creationTime = get_current_time();
-    node->info.properties.type = type;
-    node->info.properties.permissions = PERM_DEFAULT - PERMISSION_MASK;
-    node->info.data.directoryContent = NULL;
-    node->info.data.fileContent = NULL;
-    node->info.data.symlinkTarget = NULL;
-    node->next = NULL;
-    node->parent = strcmp(name, "\\") == 0 ? node : parent;
-    if (parent != node) add_to_dir(parent, node);
+    if (result != EXIT_SUCCESS || *count == 0) {
+        free(nodes);
+        *count = 0;
+        return NULL;
+    }
 
-    fileCount++;
+    return nodes;
+}
 
-    return node;
+struct FileNode** find_file_nodes_in_fs(const struct FileNode* root, const char* name, uint32_t* count) {
+    return find_file_nodes_in_fs_ctx(get_default_context(), root, name, count);
 }
 
-uint8_t change_permissions(struct FileNode* node, const enum Permissions permissions) {
-    if (node == NULL) return EXIT_FAILURE;
+void get_name_lookup_stats_ctx(struct WsfsContext* context, struct NameIndexStats* stats) {
+    if (stats == NULL) return;
 
-    node->info.properties.permissions = permissions;
+    get_name_index_stats(&context->nameIndex, stats);
+}
+
+void get_name_lookup_stats(struct NameIndexStats* stats) {
+    get_name_lookup_stats_ctx(get_default_context(), stats);
+}
+
+/**
+    * Adds node to list of worker. Returns 1 if list couldn't
+    * grow, the whole search fails then.
+*/
+static uint8_t add_found_node(struct FoundList* list, struct FileNode* node) {
+    if (list->count == list->capacity) {
+        const uint32_t capacity = list->capacity > 0 ? 2 * list->capacity : FOUND_LIST_MIN_CAPACITY;
+        struct FileNode** nodes = capacity > list->capacity ? realloc(list->nodes, capacity * sizeof(struct FileNode*))
+                                                            : NULL;
+        if (nodes == NULL) {
+            list->isFailed = 1;
+            return EXIT_FAILURE;
+        }
+        list->nodes = nodes;
+        list->capacity = capacity;
+    }
+    list->nodes[list->count++] = node;
 
     return EXIT_SUCCESS;
 }
 
-uint8_t is_permissions_equal(const enum Permissions left, const enum Permissions right) {
-    return (left & right) == right;
+/**
+    * Checks children of directory and hands out tasks for
+    * subdirectories. The caller of job holds rename lock.
+*/
+static void match_dir_children(struct WorkJob* job, const uint32_t worker, const struct WorkTask task,
+                               void* argument) {
+    struct MatchJob* match = argument;
+    struct FoundList* list = &match->lists[worker];
+
+    acquire_read_lock(&task.node->lock);
+    for (struct FileNode* child = task.node->info.data.directoryContent; child != NULL; child = child->next) {
+        if (match->predicate(child, match->argument)) add_found_node(list, child);
+        if (child->info.properties.type == FILE_TYPE_DIR) push_work_task(job, worker, (struct WorkTask){child, NULL});
+    }
+    release_read_lock(&task.node->lock);
 }
 
-void set_root_node(struct FileNode* node) {
-    if (node == NULL) return;
-    root = node;
+static uint32_t get_file_node_depth(const struct FileNode* node) {
+    uint32_t depth = 0;
+    for (const struct FileNode* parent = get_parent_dir(node); parent != NULL; parent = get_parent_dir(parent)) {
+        depth++;
+    }
+
+    return depth;
 }
 
-struct FileNode* get_root_node() {
-    return root;
+/**
+    * Orders nodes as a pre-order walk which visits siblings
+    * by name would. The caller holds rename lock.
+*/
+static int compare_by_path(const void* left, const void* right) {
+    const struct FileNode* leftNode = *(struct FileNode* const*)left;
+    const struct FileNode* rightNode = *(struct FileNode* const*)right;
+    uint32_t leftDepth = get_file_node_depth(leftNode);
+    uint32_t rightDepth = get_file_node_depth(rightNode);
+
+    // Deeper node is replaced by its ancestor, equal ones mean that the other node is that ancestor
+    const struct FileNode* leftAncestor = leftNode;
+    const struct FileNode* rightAncestor = rightNode;
+    for (; leftDepth > rightDepth; leftDepth--) leftAncestor = leftAncestor->parent;
+    for (; rightDepth > leftDepth; rightDepth--) rightAncestor = rightAncestor->parent;
+    if (leftAncestor == rightAncestor) return leftNode == rightNode ? 0 : leftNode == leftAncestor ? -1 : 1;
+
+    while (leftAncestor->parent != rightAncestor->parent) {
+        leftAncestor = leftAncestor->parent;
+        rightAncestor = rightAncestor->parent;
+    }
+    const int result = strcmp(leftAncestor->info.metadata.name, rightAncestor->info.metadata.name);
+    if (result != 0) return result;
+
+    return leftAncestor < rightAncestor ? -1 : 1;
 }
 
-size_t get_file_node_size(const struct FileNode* node) {
-    if (node == NULL ||
-        !is_permissions_equal(node->info.properties.permissions, PERM_READ)) {
-        return 0;
+struct FileNode** find_file_nodes_matching_ctx(struct WsfsContext* context, struct FileNode* root,
+                                               const FileNodePredicate predicate, void* argument,
+                                               const uint8_t isOrdered, uint32_t* count) {
+    if (count != NULL) *count = 0;
+    if (context == NULL || root == NULL || predicate == NULL || count == NULL) return NULL;
+
+    const uint32_t workerCount = get_work_pool_worker_count(context);
+    struct MatchJob match = {predicate, argument, calloc(workerCount, sizeof(struct FoundList))};
+    if (match.lists == NULL) return NULL;
+
+    // Tree keeps its shape until found nodes are ordered
+    acquire_read_lock(&context->renameLock);
+    if (predicate(root, argument)) add_found_node(&match.lists[0], root);
+    if (root->info.properties.type == FILE_TYPE_DIR) {
+        run_work_job(context, (struct WorkTask){root, NULL}, match_dir_children, &match);
     }
 
-    size_t totalSize = 0;
-    const struct FileNode* stack[512];
-    int top = -1;
+    uint64_t total = 0;
+    uint8_t isFailed = 0;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        total += match.lists[i].count;
+        isFailed |= match.lists[i].isFailed;
+    }
+    struct FileNode** nodes = !isFailed && total > 0 && total <= UINT32_MAX
+                              ? malloc(total * sizeof(struct FileNode*)) : NULL;
+    if (nodes != NULL) {
+        for (uint32_t i = 0; i < workerCount; i++) {
+            if (match.lists[i].count == 0) continue;
+            memcpy(nodes + *count, match.lists[i].nodes, match.lists[i].count * sizeof(struct FileNode*));
+            *count += match.lists[i].count;
+        }
+        if (isOrdered) qsort(nodes, *count, sizeof(struct FileNode*), compare_by_path);
+    }
+    release_read_lock(&context->renameLock);
 
-    stack[++top] = node;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        free(match.lists[i].nodes);
+    }
+    free(match.lists);
 
-    while (top >= 0) {
-        const struct FileNode* topNode = stack[top--];
+    return nodes;
+}
 
-        if (topNode == NULL) continue;
+struct FileNode** find_file_nodes_matching(struct FileNode* root, const FileNodePredicate predicate, void* argument,
+                                           const uint8_t isOrdered, uint32_t* count) {
+    return find_file_nodes_matching_ctx(get_default_context(), root, predicate, argument, isOrdered, count);
+}
 
-        totalSize += sizeof(struct FileNode);
+static const char* load_file_node_name(const struct FileNode* node) {
+    return atomic_load_explicit(&node->info.metadata.name, memory_order_acquire);
+}
 
-        if (topNode->info.metadata.name) {
-            totalSize += strlen(topNode->info.metadata.name) + 1;
-        }
+static const struct FileNode* load_parent(const struct FileNode* node) {
+    return atomic_load_explicit(&node->parent, memory_order_acquire);
+}
 
-        if (topNode->info.properties.type == FILE_TYPE_FILE && topNode->info.data.fileContent) {
-            totalSize += strlen(topNode->info.data.fileContent) + 1;
-        }
+static uint8_t is_root_name(const struct FileNode* node) {
+    const char* name = load_file_node_name(node);
+    return name[0] == '\\' && name[1] == '\0';
+}
 
-        if (topNode->info.properties.type == FILE_TYPE_DIR) {
-            const struct FileNode* child = topNode->info.data.directoryContent;
-            while (child != NULL) {
-                stack[++top] = child;
-                child = child->next;
-            }
+/**
+    * Builds path of file node. Names and parents may change
+    * meanwhile, the caller checks rename sequence and retries,
+    * so here only bounds of path are kept.
+*/
+static char* build_file_node_path(struct WsfsContext* context, const struct FileNode* node) {
+    const struct FileNode* temp = node;
+    size_t pathLength = 1;
+    while (temp != NULL && !is_root_name(temp)) {
+        pathLength += strlen(load_file_node_name(temp)) + 1;
+        temp = load_parent(temp);
+    }
+
+    if (!is_enough_memory_ctx(context, pathLength)) return NULL;
+
+    char* path = malloc(pathLength);
+    if (path == NULL) return NULL;
+    path[pathLength - 1] = '\0';
+    size_t pos = pathLength - 1;
+    const struct FileNode* current = node;
+    while (current != NULL && !is_root_name(current)) {
+        const char* name = load_file_node_name(current);
+        const size_t nameLen = strlen(name);
+        if (nameLen > pos) break;
+
+        pos -= nameLen;
+        memcpy(&path[pos], name, nameLen);
+        if (pos > 0) {
+            path[--pos] = '\\';
         }
+        current = load_parent(current);
     }
 
-    return totalSize;
+    return path;
 }
 
-uint8_t change_current_dir(struct FileNode** currentDir, struct FileNode* newCurrentDir) {
-    if (*currentDir == NULL || newCurrentDir == NULL ||
-        !is_permissions_equal(newCurrentDir->info.properties.permissions, PERM_READ) ||
-        !is_permissions_equal(newCurrentDir->info.properties.permissions, PERM_EXEC)) return EXIT_FAILURE;
-
-    newCurrentDir = get_symlink_target(newCurrentDir);
+char* get_file_node_path_ctx(struct WsfsContext* context, const struct FileNode* node) {
+    if (context == NULL || node == NULL || wsfs_epoch_enter() != EXIT_SUCCESS) return NULL;
 
-    *currentDir = newCurrentDir;
+    char* path = NULL;
+    uint64_t sequence;
+    do {
+        free(path);
+        sequence = read_rename_sequence(context);
+        path = build_file_node_path(context, node);
+    } while (!is_rename_sequence_valid(context, sequence));
+    wsfs_epoch_exit();
 
-    return EXIT_SUCCESS;
+    return path;
 }
 
-uint8_t add_to_dir(struct FileNode* restrict parent, struct FileNode* restrict child) {
-    if (parent == NULL || child == NULL ||
-        !is_permissions_equal(parent->info.properties.permissions, PERM_WRITE)) return EXIT_FAILURE;
+char* get_file_node_path(const struct FileNode* node) {
+    return get_file_node_path_ctx(get_default_context(), node);
+}
 
-    if (parent->info.data.directoryContent == NULL) {
-        parent->info.data.directoryContent = child;
-        return EXIT_FAILURE;
+/**
+    * Checks if node is dir or one of directories above it.
+    * The caller holds rename lock, so parents don't change.
+*/
+static uint8_t is_dir_or_above(const struct FileNode* dir, const struct FileNode* node) {
+    for (const struct FileNode* current = dir; current != NULL; current = get_parent_dir(current)) {
+        if (current == node) return 1;
     }
 
-    struct FileNode* current = parent->info.data.directoryContent;
-    while (current->next != NULL) {
-        current = current->next;
+    return 0;
+}
+
+uint8_t change_file_node_location_ctx(struct WsfsContext* context, struct FileNode* restrict location,
+                                      struct FileNode* restrict node) {
+    if (context == NULL || node == NULL || location == NULL ||
+        location->info.properties.type != FILE_TYPE_DIR ||
+        !is_file_node_writable(location) ||
+        !is_file_node_writable(node)) return EXIT_FAILURE;
+
+    // Rename lock keeps parent of node stable until both directories are locked
+    begin_rename(context);
+    struct FileNode* parent = get_parent_dir(node);
+    // Directory moved under itself would leave the tree as a cycle
+    const uint8_t result = node->parent == location || is_dir_or_above(location, node) ? EXIT_FAILURE
+                                                                                       : EXIT_SUCCESS;
+    uint64_t sequence = 0;
+
+    if (result == EXIT_SUCCESS) {
+        acquire_dir_pair(parent, location);
+        if (parent != NULL) {
+            unlink_from_dir(context, parent, node);
+            mark_file_node_modified(context, parent);
+        }
+        link_to_dir(context, location, node);
+        mark_file_node_modified(context, location);
+        sequence = record_change(context, JOURNAL_MOVE, node, parent, NULL, 0, 0);
+        release_dir_pair(parent, location);
     }
-    current->next = child;
+    end_rename(context);
+    journal_commit(context, sequence);
 
-    return EXIT_SUCCESS;
+    return result;
 }
 
-char get_file_type_letter(const enum FileType type) {
-    switch (type) {
-        case FILE_TYPE_DIR:         return 'd';
-        case FILE_TYPE_FILE:        return 'f';
-        case FILE_TYPE_SYMLINK:     return 's';
-        case FILE_TYPE_UNKNOWN:     return '-';
-        default:                    return '?';
+uint8_t change_file_node_location(struct FileNode* restrict location, struct FileNode* restrict node) {
+    return change_file_node_location_ctx(get_default_context(), location, node);
+}
+
+uint8_t copy_file_node_ctx(struct WsfsContext* context, struct FileNode* restrict location,
+                           const struct FileNode* restrict node) {
+    if (context == NULL || location == NULL || node == NULL ||
+        location->info.properties.type != FILE_TYPE_DIR ||
+        !is_file_node_writable(location) || wsfs_epoch_enter() != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    // Copy isn't visible until it is linked, so location is locked only then
+    acquire_read_lock(&context->renameLock);
+    struct FileNode* nodeCopy = clone_file_node_tree(context, node, 0);
+    uint64_t sequence = 0;
+    if (nodeCopy != NULL) {
+        acquire_write_lock(&location->lock);
+        link_to_dir(context, location, nodeCopy);
+        mark_file_node_modified(context, location);
+        sequence = record_change(context, JOURNAL_ATTACH, nodeCopy, NULL, NULL, 0, 0);
+        release_write_lock(&location->lock);
     }
+    release_read_lock(&context->renameLock);
+    wsfs_epoch_exit();
+    journal_commit(context, sequence);
+
+    return nodeCopy != NULL ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-char get_permission_letter(const enum Permissions permission) {
-    switch (permission) {
-        case PERM_READ:     return 'r';
-        case PERM_WRITE:    return 'w';
-        case PERM_EXEC:     return 'x';
-        case PERM_NONE:     return '-';
-        default:            return '?';
+uint8_t copy_file_node(struct FileNode* restrict location, const struct FileNode* restrict node) {
+    return copy_file_node_ctx(get_default_context(), location, node);
+}
+
+uint8_t change_file_node_name_ctx(struct WsfsContext* context, struct FileNode* node, const char* name) {
+    if (context == NULL || node == NULL || name == NULL ||
+        !is_file_node_writable(node)) return EXIT_FAILURE;
+
+    uint32_t nameLength;
+    const uint32_t nameHash = hash_file_node_name(name, &nameLength);
+    const uint64_t newSize = nameLength + 1;
+
+    begin_rename(context);
+    struct FileNode* parent = get_parent_dir(node);
+    if (parent != NULL) acquire_write_lock(&parent->lock);
+
+    const uint64_t oldSize = node->info.metadata.nameLength + 1;
+    const uint64_t oldNodeSize = get_file_node_own_size(node);
+    // Readers may still compare the old name, so it is never overwritten
+    char* oldName = node->info.metadata.name;
+    const uint8_t isInlineFree = oldName != node->info.metadata.inlineName && is_epoch_idle();
+    uint8_t result = newSize > oldSize ? charge_memory(context, newSize - oldSize) : EXIT_SUCCESS;
+    uint64_t sequence = 0;
+    char* storage = NULL;
+    if (result == EXIT_SUCCESS) {
+        storage = isInlineFree && nameLength < INLINE_NAME_SIZE ? node->info.metadata.inlineName
+                                                                : slab_alloc(&context->allocator, newSize);
+    }
+
+    if (storage != NULL) {
+        lookup_cache_invalidate(&context->lookupCache, node);
+        struct DirIndex* parentIndex = get_parent_index(node);
+        const uint8_t isIndexed = parentIndex != NULL && dir_index_remove(parentIndex, node) == EXIT_SUCCESS;
+        name_index_remove(&context->nameIndex, node);
+
+        memcpy(storage, name, newSize);
+        atomic_store_explicit(&node->info.metadata.name, storage, memory_order_release);
+        node->info.metadata.nameLength = nameLength;
+        node->info.metadata.nameHash = nameHash;
+        sequence = record_change(context, JOURNAL_RENAME, node, NULL, oldName, oldSize, 0);
+        if (oldName != node->info.metadata.inlineName) epoch_retire(slab_free, &context->allocator, oldName, oldSize);
+        if (newSize < oldSize) refund_memory(context, oldSize - newSize);
+
+        if (isIndexed) index_dir_child(parent, parentIndex, node);
+        name_index_insert(&context->nameIndex, node);
+        update_subtree_totals(node, oldNodeSize);
+        if (parent != NULL) mark_file_node_modified(context, parent);
+    } else if (result == EXIT_SUCCESS) {
+        result = EXIT_FAILURE;
+        if (newSize > oldSize) refund_memory(context, newSize - oldSize);
     }
+
+    if (parent != NULL) release_write_lock(&parent->lock);
+    end_rename(context);
+    journal_commit(context, sequence);
+
+    return result;
 }
 
-uint8_t set_symlink_target(struct FileNode* symlink, struct FileNode* target) {
-    if (symlink == NULL || target == NULL ||
-        !is_permissions_equal(symlink->info.properties.permissions, PERM_WRITE)) return EXIT_FAILURE;
+uint8_t change_file_node_name(struct FileNode* node, const char* name) {
+    return change_file_node_name_ctx(get_default_context(), node, name);
+}
+
+uint8_t delete_file_node_ctx(struct WsfsContext* context, struct FileNode* restrict currentDir,
+                             struct FileNode* restrict node) {
+    if (context == NULL || currentDir == NULL || node == NULL ||
+        currentDir->info.properties.type != FILE_TYPE_DIR || currentDir->info.properties.isReadOnly) return EXIT_FAILURE;
+
+    // Subtree leaves totals of directories above it, so no other change may overlap
+    begin_rename(context);
+    acquire_write_lock(&currentDir->lock);
+    const uint8_t result = node->parent == currentDir && is_linked_to_dir(currentDir, node)
+                           ? EXIT_SUCCESS : EXIT_FAILURE;
+    uint64_t sequence = 0;
+    if (result == EXIT_SUCCESS) {
+        // Path is journaled while node is still linked
+        sequence = record_change(context, JOURNAL_DELETE, node, NULL, NULL, 0, 0);
+        unlink_from_dir(context, currentDir, node);
+        mark_file_node_modified(context, currentDir);
+    }
+    release_write_lock(&currentDir->lock);
+    end_rename(context);
+    journal_commit(context, sequence);
+
+    if (result != EXIT_SUCCESS) return EXIT_FAILURE;
 
-    symlink->info.data.symlinkTarget = target;
+    free_file_node_recursive_ctx(context, node);
 
     return EXIT_SUCCESS;
 }
 
-struct FileNode* get_symlink_target(struct FileNode* symlink) {
-    if (symlink == NULL ||
-        !is_permissions_equal(symlink->info.properties.permissions, PERM_READ)) return NULL;
+uint8_t delete_file_node(struct FileNode* restrict currentDir, struct FileNode* restrict node) {
+    return delete_file_node_ctx(get_default_context(), currentDir, node);
+}
 
-    struct FileNode* current = symlink;
-    while (current != NULL && current->info.properties.type == FILE_TYPE_SYMLINK) {
-        current = current->info.data.symlinkTarget;
+/**
+    * Finds link which points to snapshot with given name, the
+    * link points to NULL if there is no such snapshot. The
+    * caller holds snapshot lock.
+*/
+static struct TreeSnapshot** find_tree_snapshot(struct WsfsContext* context, const char* name) {
+    struct TreeSnapshot** link = &context->snapshots;
+    while (*link != NULL && strcmp((*link)->name, name) != 0) {
+        link = &(*link)->next;
     }
 
-    return current;
+    return link;
 }
 
-uint8_t write_to_file(struct FileNode* node, const char* content) {
-    if (node == NULL || content == NULL ||
-        !is_permissions_equal(node->info.properties.permissions, PERM_WRITE) ||
-        !is_enough_memory(strlen(content))) return EXIT_FAILURE;
+uint8_t create_tree_snapshot_ctx(struct WsfsContext* context, const char* name) {
+    if (context == NULL || name == NULL || context->root == NULL ||
+        get_tree_snapshot_ctx(context, name) != NULL) return EXIT_FAILURE;
 
-    struct FileNode* current = get_symlink_target(node);
+    const size_t snapshotSize = sizeof(struct TreeSnapshot) + strlen(name) + 1;
+    struct TreeSnapshot* snapshot = slab_alloc(&context->allocator, snapshotSize);
+    if (snapshot == NULL) return EXIT_FAILURE;
+    memcpy(snapshot->name, name, snapshotSize - sizeof(struct TreeSnapshot));
+
+    if (wsfs_epoch_enter() != EXIT_SUCCESS) {
+        slab_free(&context->allocator, snapshot, snapshotSize);
+        return EXIT_FAILURE;
+    }
+    acquire_read_lock(&context->renameLock);
+    snapshot->root = clone_file_node_tree(context, context->root, 1);
+    release_read_lock(&context->renameLock);
+    wsfs_epoch_exit();
+    if (snapshot->root == NULL) {
+        slab_free(&context->allocator, snapshot, snapshotSize);
+        return EXIT_FAILURE;
+    }
+    // Root of snapshot is its own parent, like root of tree
+    atomic_store_explicit(&snapshot->root->parent, snapshot->root, memory_order_relaxed);
+
+    // Another thread may have taken the name meanwhile
+    acquire_write_lock(&context->snapshotLock);
+    struct TreeSnapshot** link = find_tree_snapshot(context, name);
+    const uint8_t isNameFree = *link == NULL;
+    if (isNameFree) {
+        snapshot->next = NULL;
+        *link = snapshot;
+    }
+    release_write_lock(&context->snapshotLock);
 
-    free(current->info.data.fileContent);
-    current->info.data.fileContent = strdup(content);
-    if (current->info.data.fileContent == NULL) return EXIT_FAILURE;
+    if (!isNameFree) {
+        free_file_node_recursive_ctx(context, snapshot->root);
+        slab_free(&context->allocator, snapshot, snapshotSize);
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
 
-char* read_file_content(struct FileNode* node) {
-    if (node == NULL ||
-        !is_permissions_equal(node->info.properties.permissions, PERM_READ)) return NULL;
-
-    const struct FileNode* current = get_symlink_target(node);
-
-    return current->info.data.fileContent;
+uint8_t create_tree_snapshot(const char* name) {
+    return create_tree_snapshot_ctx(get_default_context(), name);
 }
 
-struct FileNode* find_file_node_in_curr_dir(const struct FileNode* currentDir, const char* name) {
-    if (currentDir == NULL || name == NULL ||
-        !is_permissions_equal(currentDir->info.properties.permissions, PERM_READ) ||
-        !is_permissions_equal(currentDir->info.properties.permissions, PERM_EXEC)) return NULL;
+struct FileNode* get_tree_snapshot_ctx(struct WsfsContext* context, const char* name) {
+    if (context == NULL || name == NULL) return NULL;
 
-    struct FileNode* current = currentDir->info.data.directoryContent;
-    while (current != NULL && strcmp(current->info.metadata.name, name) != 0) {
-        current = current->next;
-    }
+    acquire_read_lock(&context->snapshotLock);
+    const struct TreeSnapshot* snapshot = *find_tree_snapshot(context, name);
+    struct FileNode* root = snapshot != NULL ? snapshot->root : NULL;
+    release_read_lock(&context->snapshotLock);
 
-    return current;
+    return root;
 }
 
-struct FileNode* find_file_node_in_fs(const struct FileNode* root, const char* name) {
-    if (root == NULL || name == NULL) return NULL;
+struct FileNode* get_tree_snapshot(const char* name) {
+    return get_tree_snapshot_ctx(get_default_context(), name);
+}
 
-    const struct FileNode* stack[512];
-    int top = -1;
+uint8_t delete_tree_snapshot_ctx(struct WsfsContext* context, const char* name) {
+    if (context == NULL || name == NULL) return EXIT_FAILURE;
 
-    stack[++top] = root;
+    acquire_write_lock(&context->snapshotLock);
+    struct TreeSnapshot** link = find_tree_snapshot(context, name);
+    struct TreeSnapshot* snapshot = *link;
+    if (snapshot != NULL) *link = snapshot->next;
+    release_write_lock(&context->snapshotLock);
+    if (snapshot == NULL) return EXIT_FAILURE;
 
-    while (top >= 0) {
-        const struct FileNode* node = stack[top--];
+    free_file_node_recursive_ctx(context, snapshot->root);
+    slab_free(&context->allocator, snapshot, sizeof(struct TreeSnapshot) + strlen(snapshot->name) + 1);
 
-        if (node == NULL) continue;
+    return EXIT_SUCCESS;
+}
 
-        if (strcmp(node->info.metadata.name, name) == 0) {
-            return (struct FileNode*)node;
-        }
+uint8_t delete_tree_snapshot(const char* name) {
+    return delete_tree_snapshot_ctx(get_default_context(), name);
+}
 
-        if (node->info.properties.type == FILE_TYPE_DIR) {
-            const struct FileNode* child = node->info.data.directoryContent;
-            while (child != NULL) {
-                stack[++top] = child;
-                child = child->next;
-            }
-        }
+/**
+    * Frees memory of visited node, its children are already freed.
+*/
+static enum WalkAction reclaim_file_node(struct FileNode* node, void* argument) {
+    struct SlabAllocator* nodeAllocator = argument;
+    if (node->info.properties.type == FILE_TYPE_DIR) {
+        free_dir_index(node->info.data.directoryIndex);
+    } else if (node->info.properties.type == FILE_TYPE_FILE) {
+        free_file_content(nodeAllocator, node);
     }
+    free_file_node_name(nodeAllocator, node);
+    slab_free(nodeAllocator, node, sizeof(struct FileNode));
 
-    return NULL;
+    return WALK_CONTINUE;
 }
 
-char* get_file_node_path(const struct FileNode* node) {
-    if (node == NULL) return NULL;
+/**
+    * Frees memory of node and its children once no reader
+    * can reach them, see free_file_node_recursive().
+*/
+static void reclaim_file_node_tree(struct SlabAllocator* nodeAllocator, void* pointer, size_t size) {
+    (void)size;
+    walk_file_node_tree(pointer, WALK_POST_ORDER, 0, reclaim_file_node, nodeAllocator);
+}
 
-    const struct FileNode* temp = node;
-    size_t pathLength = 1;
-    while (strcmp(temp->info.metadata.name, "\\") != 0) {
-        pathLength += strlen(temp->info.metadata.name) + 1;
-        temp = temp->parent;
-    }
+/**
+    * Drops node from counters, cache, name index and query index.
+*/
+static void forget_file_node(struct WsfsContext* context, struct FileNode* node) {
+    lookup_cache_invalidate(&context->lookupCache, node);
+    name_index_remove(&context->nameIndex, node);
+    query_index_remove(context->queryIndex, node);
+    refund_file_node(context, get_file_node_own_size(node));
+}
 
-    if (!is_enough_memory(pathLength)) return NULL;
+/**
+    * Forgets children of directory and hands out tasks for
+    * subdirectories. Subtree can't be reached by other
+    * changes, but path lookups may still stand inside it,
+    * so directory is write locked and marked forgotten to
+    * keep them from caching its children again.
+*/
+static void forget_dir_children(struct WorkJob* job, const uint32_t worker, const struct WorkTask task,
+                                void* argument) {
+    acquire_write_lock(&task.node->lock);
+    task.node->info.data.isForgotten = 1;
+    for (struct FileNode* child = task.node->info.data.directoryContent; child != NULL; child = child->next) {
+        forget_file_node(argument, child);
+        if (child->info.properties.type == FILE_TYPE_DIR) push_work_task(job, worker, (struct WorkTask){child, NULL});
+    }
+    release_write_lock(&task.node->lock);
+}
 
-    char* path = malloc(pathLength);
-    path[pathLength - 1] = '\0';
-    size_t pos = pathLength - 1;
-    const struct FileNode* current = node;
-    while (strcmp(current->info.metadata.name, "\\") != 0) {
-        const size_t nameLen = strlen(current->info.metadata.name);
-        pos -= nameLen;
-        memcpy(&path[pos], current->info.metadata.name, nameLen);
-        if (pos > 0) {
-            path[--pos] = '\\';
+/**
+    * Frees children of directory and directory itself.
+    * Subdirectories are handed out, next child is read
+    * before, as another worker may free them at once.
+*/
+static void reclaim_dir_children(struct WorkJob* job, const uint32_t worker, const struct WorkTask task,
+                                 void* argument) {
+    struct FileNode* child = task.node->info.data.directoryContent;
+    while (child != NULL) {
+        struct FileNode* next = child->next;
+        if (child->info.properties.type == FILE_TYPE_DIR) {
+            push_work_task(job, worker, (struct WorkTask){child, NULL});
+        } else {
+            reclaim_file_node(child, argument);
         }
-        current = current->parent;
+        child = next;
+    }
+    reclaim_file_node(task.node, argument);
+}
+
+uint8_t free_file_node_recursive_ctx(struct WsfsContext* context, struct FileNode* node) {
+    if (context == NULL || node == NULL) return EXIT_FAILURE;
+
+    // Counters, cache and name index are updated at once, memory waits until readers are gone
+    const uint8_t isDir = node->info.properties.type == FILE_TYPE_DIR;
+    forget_file_node(context, node);
+    if (isDir) run_work_job(context, (struct WorkTask){node, NULL}, forget_dir_children, context);
+
+    // Subtree can't be found anymore, so without readers workers free it at once
+    if (isDir && is_epoch_idle()) {
+        run_work_job(context, (struct WorkTask){node, NULL}, reclaim_dir_children, &context->allocator);
+    } else {
+        epoch_retire(reclaim_file_node_tree, &context->allocator, node, sizeof(struct FileNode));
     }
 
-    return path;
+    return EXIT_SUCCESS;
 }
 
-uint8_t change_file_node_location(struct FileNode* restrict location, struct FileNode* restrict node) {
-    if (node == NULL || location == NULL ||
-        node->parent == location ||
-        !is_permissions_equal(location->info.properties.permissions, PERM_WRITE) ||
-        !is_permissions_equal(node->info.properties.permissions, PERM_WRITE)) return EXIT_FAILURE;
+uint8_t free_file_node_recursive(struct FileNode* node) {
+    return free_file_node_recursive_ctx(get_default_context(), node);
+}
 
-    if (node->parent != NULL) {
-        struct FileNode** prev_ptr = &node->parent->info.data.directoryContent;
+uint64_t get_current_time(void) {
+    static _Thread_local uint64_t lastTime = 0;
 
-        while (*prev_ptr && *prev_ptr != node) {
-            prev_ptr = &(*prev_ptr)->next;
-        }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    const uint64_t time = (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+    if (time > lastTime) lastTime = time;
 
-        if (*prev_ptr == node) {
-            *prev_ptr = node->next;
-        }
-    }
+    return lastTime;
+}
 
-    node->next = NULL;
-    node->parent = location;
-    add_to_dir(location, node);
+uint8_t is_enough_memory_ctx(const struct WsfsContext* context, const uint64_t newMemory) {
+    return newMemory < context->memoryLimit &&
+           atomic_load_explicit(&context->usedMemory, memory_order_relaxed) < context->memoryLimit - newMemory;
+}
 
-    return EXIT_SUCCESS;
+uint8_t is_enough_memory(const uint64_t newMemory) {
+    return is_enough_memory_ctx(get_default_context(), newMemory);
 }
 
-uint8_t copy_file_node(struct FileNode* restrict location, const struct FileNode* restrict node) {
-    if (location == NULL || node == NULL ||
-        location->info.properties.type != FILE_TYPE_DIR ||
-        !is_permissions_equal(location->info.properties.permissions, PERM_WRITE) ||
-        !is_enough_memory(sizeof(struct FileNode) + strlen(node->info.metadata.name) + strlen(node->info.data.fileContent)) ||
-        !is_file_count_within_limit()) return EXIT_FAILURE;
+uint8_t is_file_count_within_limit_ctx(const struct WsfsContext* context) {
+    return atomic_load_explicit(&context->fileCount, memory_order_relaxed) < context->fileCountLimit;
+}
 
-    struct FileNode* nodeCopy = malloc(sizeof(struct FileNode));
-    if (nodeCopy == NULL) return EXIT_FAILURE;
-    memcpy(nodeCopy, node, sizeof(struct FileNode));
+uint8_t is_file_count_within_limit(void) {
+    return is_file_count_within_limit_ctx(get_default_context());
+}
 
-    nodeCopy->info.metadata.name = NULL;
-    nodeCopy->info.data.fileContent = NULL;
-    nodeCopy->info.data.directoryContent = NULL;
-    nodeCopy->next = NULL;
+void set_memory_limit_ctx(struct WsfsContext* context, const uint64_t limit) {
+    context->memoryLimit = limit;
+}
 
-    if (node->info.metadata.name != NULL) {
-        nodeCopy->info.metadata.name = strdup(node->info.metadata.name);
-    }
+void set_memory_limit(const uint64_t limit) {
+    set_memory_limit_ctx(get_default_context(), limit);
+}
 
-    if (node->info.properties.type == FILE_TYPE_FILE && node->info.data.fileContent != NULL) {
-        nodeCopy->info.data.fileContent = strdup(node->info.data.fileContent);
-    }
+uint64_t get_memory_limit_ctx(const struct WsfsContext* context) {
+    return context->memoryLimit;
+}
 
-    nodeCopy->parent = location;
-    add_to_dir(location, nodeCopy);
-    fileCount++;
+uint64_t get_memory_limit(void) {
+    return get_memory_limit_ctx(get_default_context());
+}
 
-    if (node->info.properties.type == FILE_TYPE_DIR && node->info.data.directoryContent != NULL) {
-        const struct FileNode* child = node->info.data.directoryContent;
-        struct FileNode* prevCopy = NULL;
+void set_file_count_limit_ctx(struct WsfsContext* context, const uint64_t limit) {
+    context->fileCountLimit = limit;
+}
 
-        while (child != NULL) {
-            if (!is_enough_memory(sizeof(struct FileNode) + strlen(child->info.metadata.name) + strlen(child->info.data.fileContent)) ||
-                !is_file_count_within_limit()) return EXIT_FAILURE;
+void set_file_count_limit(const uint64_t limit) {
+    set_file_count_limit_ctx(get_default_context(), limit);
+}
 
-            struct FileNode* childCopy = malloc(sizeof(struct FileNode));
-            if (childCopy == NULL) return EXIT_FAILURE;
-            memcpy(childCopy, child, sizeof(struct FileNode));
+uint64_t get_file_count_limit_ctx(const struct WsfsContext* context) {
+    return context->fileCountLimit;
+}
 
-            childCopy->info.metadata.name = NULL;
-            childCopy->info.data.fileContent = NULL;
-            childCopy->info.data.directoryContent = NULL;
-            childCopy->next = NULL;
+uint64_t get_file_count_limit(void) {
+    return get_file_count_limit_ctx(get_default_context());
+}
 
-            if (child->info.metadata.name != NULL) {
-                childCopy->info.metadata.name = strdup(child->info.metadata.name);
-            }
+uint64_t get_used_memory_ctx(const struct WsfsContext* context) {
+    return atomic_load_explicit(&context->usedMemory, memory_order_relaxed);
+}
 
-            if (child->info.properties.type == FILE_TYPE_FILE && child->info.data.fileContent != NULL) {
-                childCopy->info.data.fileContent = strdup(child->info.data.fileContent);
-            }
+uint64_t get_used_memory(void) {
+    return get_used_memory_ctx(get_default_context());
+}
 
-            childCopy->parent = nodeCopy;
+uint64_t get_file_count_ctx(const struct WsfsContext* context) {
+    return atomic_load_explicit(&context->fileCount, memory_order_relaxed);
+}
 
-            if (prevCopy == NULL) {
-                nodeCopy->info.data.directoryContent = childCopy;
-            } else {
-                prevCopy->next = childCopy;
-            }
+uint64_t get_file_count(void) {
+    return get_file_count_ctx(get_default_context());
+}
 
-            prevCopy = childCopy;
-            child = child->next;
-            fileCount++;
-        }
-    }
+void set_allocator_mode_ctx(struct WsfsContext* context, const enum AllocatorMode mode) {
+    context->allocator.mode = mode;
+}
 
-    return EXIT_SUCCESS;
+void set_allocator_mode(const enum AllocatorMode mode) {
+    set_allocator_mode_ctx(get_default_context(), mode);
 }
 
-uint8_t change_file_node_name(struct FileNode* node, const char* name) {
-    if (!is_permissions_equal(node->info.properties.permissions, PERM_WRITE) ||
-        !is_enough_memory(strlen(name))) return EXIT_FAILURE;
+enum AllocatorMode get_allocator_mode_ctx(const struct WsfsContext* context) {
+    return context->allocator.mode;
+}
 
-    free(node->info.metadata.name);
-    node->info.metadata.name = strdup(name);
-    if (node->info.metadata.name == NULL) return EXIT_FAILURE;
+enum AllocatorMode get_allocator_mode(void) {
+    return get_allocator_mode_ctx(get_default_context());
+}
 
-    return EXIT_SUCCESS;
+void get_allocator_stats_ctx(struct WsfsContext* context, struct AllocatorStats* stats) {
+    if (stats == NULL) return;
+
+    get_slab_allocator_stats(&context->allocator, stats);
 }
 
-uint8_t delete_file_node(struct FileNode* restrict currentDir, struct FileNode* restrict node) {
-    if (currentDir == NULL || node == NULL) return EXIT_FAILURE;
+void get_allocator_stats(struct AllocatorStats* stats) {
+    get_allocator_stats_ctx(get_default_context(), stats);
+}
 
-    struct FileNode* currentFileNode = currentDir->info.data.directoryContent;
-    if (currentFileNode == node) {
-        currentDir->info.data.directoryContent = currentDir->info.data.directoryContent->next;
-        free_file_node_recursive(node);
-        return EXIT_FAILURE;
-    }
+void set_dedup_enabled_ctx(struct WsfsContext* context, const uint8_t isEnabled) {
+    context->contentStore.isEnabled = isEnabled != 0;
+}
 
-    while (currentFileNode->next != node) {
-        currentFileNode = currentFileNode->next;
-    }
+void set_dedup_enabled(const uint8_t isEnabled) {
+    set_dedup_enabled_ctx(get_default_context(), isEnabled);
+}
 
-    currentFileNode->next = currentFileNode->next->next;
-    free_file_node_recursive(node);
+void get_dedup_stats_ctx(struct WsfsContext* context, struct ContentStoreStats* stats) {
+    if (stats == NULL) return;
 
-    return EXIT_SUCCESS;
+    get_content_store_stats(&context->contentStore, stats);
 }
 
-uint8_t free_file_node_recursive(struct FileNode* node) {
-    if (node == NULL) return EXIT_FAILURE;
+void get_dedup_stats(struct ContentStoreStats* stats) {
+    get_dedup_stats_ctx(get_default_context(), stats);
+}
 
-    struct FileNode* stack[512];
-    int top = -1;
+void set_compression_window_ctx(struct WsfsContext* context, const uint64_t windowMs) {
+    context->compressor.windowMs = windowMs;
+}
 
-    stack[++top] = node;
+void set_compression_window(const uint64_t windowMs) {
+    set_compression_window_ctx(get_default_context(), windowMs);
+}
 
-    while (top >= 0) {
-        struct FileNode* topNode = stack[top--];
+/**
+    * Compresses content of cold file and refunds memory which
+    * it doesn't take anymore. Returns 1 if it was compressed.
+*/
+static uint8_t compress_charged_file_content(struct WsfsContext* context, struct FileNode* file) {
+    acquire_write_lock(&file->lock);
+    const uint64_t oldSize = get_file_node_own_size(file);
+    const uint64_t oldCharge = get_file_content_charge(file);
+    const uint8_t isCompressed = compress_file_content(&context->compressor, &context->allocator, file);
+    if (isCompressed) {
+        refund_memory(context, oldCharge - get_file_content_charge(file));
+        update_subtree_totals(file, oldSize);
+    }
+    release_write_lock(&file->lock);
 
-        if (topNode->info.properties.type == FILE_TYPE_DIR) {
-            struct FileNode* child = topNode->info.data.directoryContent;
-            while (child != NULL) {
-                struct FileNode* next = child->next;
-                stack[++top] = child;
-                child = next;
-            }
-        }
+    return isCompressed;
+}
 
-        if (topNode->info.properties.type == FILE_TYPE_FILE) {
-            free(topNode->info.data.fileContent);
+uint64_t compress_cold_files_ctx(struct WsfsContext* context) {
+    if (context == NULL || context->root == NULL || context->compressor.windowMs == COMPRESSION_DISABLED) return 0;
+
+    uint32_t capacity = SWEEP_LIST_MIN_CAPACITY;
+    uint32_t depth = 0;
+    struct SweepLevel* levels = malloc(capacity * sizeof(struct SweepLevel));
+    if (levels == NULL) return 0;
+    uint64_t compressed = 0;
+
+    // Directories on the path stay read locked, so no file is freed while its charge changes
+    acquire_read_lock(&context->renameLock);
+    acquire_read_lock(&context->root->lock);
+    levels[depth++] = (struct SweepLevel){context->root, context->root->info.data.directoryContent};
+    while (depth > 0) {
+        struct SweepLevel* level = &levels[depth - 1];
+        struct FileNode* child = level->next;
+        if (child == NULL) {
+            release_read_lock(&level->dir->lock);
+            depth--;
+            continue;
+        }
+        level->next = child->next;
+
+        if (child->info.properties.type == FILE_TYPE_FILE) {
+            compressed += compress_charged_file_content(context, child);
+        } else if (child->info.properties.type == FILE_TYPE_DIR) {
+            if (depth == capacity) {
+                struct SweepLevel* grown = realloc(levels, 2 * capacity * sizeof(struct SweepLevel));
+                // Subtree is skipped until the next sweep
+                if (grown == NULL) continue;
+                levels = grown;
+                capacity *= 2;
+            }
+            acquire_read_lock(&child->lock);
+            levels[depth++] = (struct SweepLevel){child, child->info.data.directoryContent};
         }
-        free(topNode->info.metadata.name);
-        free(topNode);
-        fileCount--;
     }
+    release_read_lock(&context->renameLock);
+    free(levels);
 
-    return EXIT_SUCCESS;
+    return compressed;
 }
 
-struct Timestamp get_current_time(void) {
-    time_t rawTime;
-    time(&rawTime);
-    const struct tm* timeInfo = localtime(&rawTime);
+uint64_t compress_cold_files(void) {
+    return compress_cold_files_ctx(get_default_context());
+}
+
+void get_compression_stats_ctx(struct WsfsContext* context, struct CompressionStats* stats) {
+    if (stats == NULL) return;
 
-    struct Timestamp currentTime;
-    currentTime.year = timeInfo->tm_year + 1900;
-    currentTime.month = timeInfo->tm_mon + 1;
-    currentTime.day = timeInfo->tm_mday;
-    currentTime.hour = timeInfo->tm_hour;
-    currentTime.minute = timeInfo->tm_min;
+    get_content_compressor_stats(&context->compressor, stats);
+}
 
-    return currentTime;
+void get_compression_stats(struct CompressionStats* stats) {
+    get_compression_stats_ctx(get_default_context(), stats);
 }
 
-uint8_t is_enough_memory(const unsigned long long newMemory) {
-    return get_file_node_size(root) + newMemory < MAX_MEMORY_SIZE;
+void release_all_file_nodes_ctx(struct WsfsContext* context) {
+    // Retired memory of other contexts may still be read, only this allocator's is reclaimed
+    epoch_reclaim_allocator(&context->allocator);
+    free_lookup_cache(&context->lookupCache);
+    free_name_index(&context->nameIndex);
+    clear_query_index(context->queryIndex);
+    release_slab_allocator(&context->allocator);
+    context->root = NULL;
+    context->snapshots = NULL;
+    context->contentStore.buckets = NULL;
+    context->contentStore.capacity = 0;
+    context->contentStore.count = 0;
+    atomic_store(&context->compressor.files, 0);
+    atomic_store(&context->compressor.uncompressedBytes, 0);
+    atomic_store(&context->compressor.compressedBytes, 0);
+    atomic_store(&context->fileCount, 0);
+    atomic_store(&context->usedMemory, 0);
 }
 
-uint8_t is_file_count_within_limit() {
-    return fileCount < MAX_FILE_COUNT;
-}
\ No newline at end of file
+void release_all_file_nodes(void) {
+    release_all_file_nodes_ctx(get_default_context());
+}
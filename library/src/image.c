@@ -0,0 +1,475 @@
+/**
+    * @file: image.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions which serve
+    * file system straight from a memory mapped image.
+*/
+
+#include "../include/image.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/dir_index.h"
+#include "../include/file_content.h"
+#include "../include/rw_lock.h"
+#include "../include/wsfs.h"
+#include "../include/wsfs_macros.h"
+
+#define PATH_BUFFER_SIZE 256
+#define TAKE_OVER_MIN_CAPACITY 64
+
+struct WsfsImage {
+    const uint8_t* base;                /**< Start of mapping */
+    uint64_t size;                      /**< Length of mapping */
+    const struct ImageHeader* header;   /**< Header at the start of mapping */
+    const struct ImageNode* nodes;      /**< Node table */
+    const uint32_t* lookup;             /**< Children of every directory sorted by name hash */
+    const char* names;                  /**< String table */
+    const uint8_t* content;             /**< Content section */
+    struct WsfsContext* overlay;        /**< Context with taken over nodes, NULL until the first take over */
+    struct FileNode** copies;           /**< Overlay copy of every node, NULL if node isn't copied */
+    uint8_t* isTakenOver;               /**< 1 if subtree of node is served by overlay */
+    struct RwLock lock;                 /**< Read locked by lookups, write locked by take overs */
+};
+
+/**
+ * @struct IndexQueue
+ * @brief Growing array of node indexes.
+ */
+struct IndexQueue {
+    uint32_t* items;    /**< Indexes */
+    uint32_t count;     /**< Amount of pushed indexes */
+    uint32_t capacity;  /**< Amount of indexes which fit into items */
+};
+
+/**
+    * Checks whether section lies within mapping without
+    * overflowing.
+*/
+static uint8_t is_section_valid(const uint64_t mappingSize, const uint64_t offset, const uint64_t size) {
+    return offset <= mappingSize && size <= mappingSize - offset;
+}
+
+static uint8_t is_header_valid(const struct ImageHeader* header, const uint64_t size) {
+    if (size < sizeof(struct ImageHeader) || header->magic != IMAGE_MAGIC ||
+        header->version != IMAGE_VERSION || header->nodeCount == 0 ||
+        header->nodeCount == IMAGE_NO_NODE) return 0;
+
+    const uint64_t nodeTableSize = (uint64_t)header->nodeCount * sizeof(struct ImageNode);
+    const uint64_t lookupSize = (uint64_t)(header->nodeCount - 1) * sizeof(uint32_t);
+
+    return is_section_valid(size, sizeof(struct ImageHeader), nodeTableSize) &&
+           header->lookupOffset >= sizeof(struct ImageHeader) + nodeTableSize &&
+           header->lookupOffset % sizeof(uint32_t) == 0 &&
+           is_section_valid(size, header->lookupOffset, lookupSize) &&
+           is_section_valid(size, header->stringOffset, header->stringSize) &&
+           is_section_valid(size, header->contentOffset, header->contentSize);
+}
+
+/**
+    * Gets entry of node table. Returns NULL if index or
+    * any offset of entry points out of image.
+*/
+static const struct ImageNode* get_image_node(const struct WsfsImage* image, const uint32_t index) {
+    if (index >= image->header->nodeCount) return NULL;
+
+    const struct ImageNode* node = &image->nodes[index];
+    const uint64_t nameEnd = (uint64_t)node->nameOffset + node->nameLength;
+    if (nameEnd >= image->header->stringSize || image->names[nameEnd] != '\0' ||
+        (index == 0 ? node->parent != 0 : node->parent >= index) ||
+        !is_section_valid(image->header->contentSize, node->contentOffset, node->contentSize)) return NULL;
+
+    if (node->childCount > 0 &&
+        (node->firstChild == 0 || node->firstChild >= image->header->nodeCount ||
+         node->childCount > image->header->nodeCount - node->firstChild)) return NULL;
+
+    return node;
+}
+
+static uint8_t has_permission(const struct ImageNode* node, const enum Permissions permission) {
+    return is_permissions_equal((enum Permissions)node->permissions, permission);
+}
+
+static uint32_t follow_image_symlink(const struct WsfsImage* image, uint32_t index) {
+    for (uint32_t depth = 0; index != IMAGE_NO_NODE; depth++) {
+        const struct ImageNode* node = get_image_node(image, index);
+        if (node == NULL) return IMAGE_NO_NODE;
+        if (node->type != FILE_TYPE_SYMLINK) break;
+        if (depth == MAX_SYMLINK_DEPTH || !has_permission(node, PERM_READ)) return IMAGE_NO_NODE;
+
+        index = node->symlinkTarget;
+    }
+
+    return index;
+}
+
+/**
+    * Finds child by binary search on name hash over lookup
+    * range of directory.
+*/
+static uint32_t find_image_child(const struct WsfsImage* image, const struct ImageNode* dir, const char* name,
+                                 const uint32_t hash, const uint32_t length) {
+    const uint32_t* children = image->lookup + dir->firstChild - 1;
+    uint32_t low = 0;
+    uint32_t high = dir->childCount;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        const struct ImageNode* child = get_image_node(image, children[middle]);
+        if (child == NULL) return IMAGE_NO_NODE;
+
+        if (child->nameHash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (; low < dir->childCount; low++) {
+        const struct ImageNode* child = get_image_node(image, children[low]);
+        if (child == NULL || child->nameHash != hash) break;
+
+        if (child->nameLength == length && memcmp(image->names + child->nameOffset, name, length) == 0) {
+            return children[low];
+        }
+    }
+
+    return IMAGE_NO_NODE;
+}
+
+static uint32_t lookup_image_child(const struct WsfsImage* image, const uint32_t dirIndex, const char* name) {
+    const struct ImageNode* dir = get_image_node(image, dirIndex);
+    if (dir == NULL || dir->type != FILE_TYPE_DIR ||
+        !has_permission(dir, PERM_READ) || !has_permission(dir, PERM_EXEC)) return IMAGE_NO_NODE;
+
+    if (strcmp(name, ".") == 0) return dirIndex;
+    if (strcmp(name, "..") == 0) return dir->parent;
+    if (dir->childCount == 0) return IMAGE_NO_NODE;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+
+    return find_image_child(image, dir, name, hash, length);
+}
+
+static uint8_t is_taken_over(const struct WsfsImage* image, const uint32_t index) {
+    return image->isTakenOver != NULL && image->isTakenOver[index];
+}
+
+struct WsfsImage* wsfs_open_image(const int fd) {
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(struct ImageHeader)) return NULL;
+
+    struct WsfsImage* image = calloc(1, sizeof(struct WsfsImage));
+    if (image == NULL) return NULL;
+
+    image->size = (uint64_t)status.st_size;
+    void* base = mmap(NULL, image->size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        free(image);
+        return NULL;
+    }
+
+    image->base = base;
+    image->header = base;
+    if (!is_header_valid(image->header, image->size)) {
+        munmap(base, image->size);
+        free(image);
+        return NULL;
+    }
+
+    image->nodes = (const struct ImageNode*)(image->base + sizeof(struct ImageHeader));
+    image->lookup = (const uint32_t*)(image->base + image->header->lookupOffset);
+    image->names = (const char*)image->base + image->header->stringOffset;
+    image->content = image->base + image->header->contentOffset;
+
+    return image;
+}
+
+void wsfs_close_image(struct WsfsImage* image) {
+    if (image == NULL) return;
+
+    free_wsfs_context(image->overlay);
+    free(image->copies);
+    free(image->isTakenOver);
+    munmap((void*)image->base, image->size);
+    free(image);
+}
+
+static uint8_t resolve_in_overlay(struct WsfsImage* image, const uint32_t index, const char* path,
+                                  const enum LookupFlags flags, struct ImageEntry* entry) {
+    entry->node = IMAGE_NO_NODE;
+    entry->overlay = wsfs_lookup_path_ctx(image->overlay, image->copies[index], path, flags);
+
+    return entry->overlay != NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+    * Resolves path components one by one until path ends
+    * or reaches taken over node. Image read lock is held by
+    * the caller.
+*/
+static uint8_t resolve_image_path(struct WsfsImage* image, char* position, const enum LookupFlags flags,
+                                  struct ImageEntry* entry) {
+    uint32_t current = 0;
+    while (current != IMAGE_NO_NODE) {
+        while (*position == '\\') position++;
+        if (*position == '\0') break;
+
+        const struct ImageNode* node = get_image_node(image, current);
+        if (node != NULL && node->type == FILE_TYPE_SYMLINK) {
+            current = flags & LOOKUP_FOLLOW_INTERMEDIATE ? follow_image_symlink(image, current) : IMAGE_NO_NODE;
+            if (current == IMAGE_NO_NODE) break;
+        }
+        if (is_taken_over(image, current)) return resolve_in_overlay(image, current, position, flags, entry);
+
+        const char* name = position;
+        while (*position != '\0' && *position != '\\') position++;
+        if (*position != '\0') *position++ = '\0';
+
+        current = lookup_image_child(image, current, name);
+    }
+
+    if (current != IMAGE_NO_NODE && is_taken_over(image, current)) {
+        return resolve_in_overlay(image, current, "", flags, entry);
+    }
+    if (current != IMAGE_NO_NODE && flags & LOOKUP_FOLLOW_LAST) {
+        current = follow_image_symlink(image, current);
+    }
+    if (current == IMAGE_NO_NODE || get_image_node(image, current) == NULL) return EXIT_FAILURE;
+
+    entry->node = current;
+    entry->overlay = is_taken_over(image, current) ? image->copies[current] : NULL;
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_image_lookup(struct WsfsImage* image, const char* path, const enum LookupFlags flags,
+                          struct ImageEntry* entry) {
+    if (image == NULL || path == NULL || entry == NULL) return EXIT_FAILURE;
+
+    // Components are cut in place, so path is copied into writable buffer
+    char buffer[PATH_BUFFER_SIZE];
+    const size_t pathLength = strlen(path);
+    char* components = pathLength < PATH_BUFFER_SIZE ? buffer : malloc(pathLength + 1);
+    if (components == NULL) return EXIT_FAILURE;
+    memcpy(components, path, pathLength + 1);
+
+    acquire_read_lock(&image->lock);
+    const uint8_t result = resolve_image_path(image, components, flags, entry);
+    release_read_lock(&image->lock);
+
+    if (components != buffer) free(components);
+
+    return result;
+}
+
+uint64_t wsfs_image_read(struct WsfsImage* image, const struct ImageEntry* entry, void* buffer,
+                         const uint64_t size, const uint64_t offset) {
+    if (image == NULL || entry == NULL || buffer == NULL) return 0;
+    if (entry->overlay != NULL) return wsfs_pread(get_symlink_target(entry->overlay), buffer, size, offset);
+
+    const uint32_t index = follow_image_symlink(image, entry->node);
+    const struct ImageNode* node = index != IMAGE_NO_NODE ? get_image_node(image, index) : NULL;
+    if (node == NULL || node->type != FILE_TYPE_FILE || !has_permission(node, PERM_READ) ||
+        offset >= node->contentSize) return 0;
+
+    const uint64_t readSize = size < node->contentSize - offset ? size : node->contentSize - offset;
+    memcpy(buffer, image->content + node->contentOffset + offset, readSize);
+
+    return readSize;
+}
+
+uint64_t wsfs_image_get_content_size(struct WsfsImage* image, const struct ImageEntry* entry) {
+    if (image == NULL || entry == NULL) return 0;
+    if (entry->overlay != NULL) return get_file_content_size(entry->overlay);
+
+    const struct ImageNode* node = get_image_node(image, entry->node);
+
+    return node != NULL && node->type == FILE_TYPE_FILE ? node->contentSize : 0;
+}
+
+static uint8_t push_index(struct IndexQueue* queue, const uint32_t index) {
+    if (queue->count == queue->capacity) {
+        const uint32_t capacity = queue->capacity == 0 ? TAKE_OVER_MIN_CAPACITY : queue->capacity * 2;
+        uint32_t* items = realloc(queue->items, capacity * sizeof(uint32_t));
+        if (items == NULL) return EXIT_FAILURE;
+
+        queue->items = items;
+        queue->capacity = capacity;
+    }
+    queue->items[queue->count++] = index;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Creates overlay context and tables of copies on the
+    * first take over.
+*/
+static uint8_t init_overlay(struct WsfsImage* image) {
+    if (image->overlay != NULL) return EXIT_SUCCESS;
+
+    image->copies = calloc(image->header->nodeCount, sizeof(struct FileNode*));
+    image->isTakenOver = calloc(image->header->nodeCount, sizeof(uint8_t));
+    struct WsfsContext* overlay = create_wsfs_context();
+    if (image->copies == NULL || image->isTakenOver == NULL || overlay == NULL) {
+        free_wsfs_context(overlay);
+        free(image->copies);
+        free(image->isTakenOver);
+        image->copies = NULL;
+        image->isTakenOver = NULL;
+        return EXIT_FAILURE;
+    }
+
+    set_memory_limit_ctx(overlay, image->header->memoryLimit);
+    set_file_count_limit_ctx(overlay, image->header->fileCountLimit);
+    image->overlay = overlay;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Copies node into overlay, content of regular file is
+    * copied from mapping. Parent must be copied already.
+*/
+static struct FileNode* copy_image_node(struct WsfsImage* image, const uint32_t index) {
+    const struct ImageNode* node = get_image_node(image, index);
+    if (node == NULL) return NULL;
+
+    const struct FileProperties properties = {(enum FileType)node->type, (enum Permissions)node->permissions, 0};
+    // Access time isn't kept in image, copy was last accessed when it was last changed
+    const struct FileTimes times = {node->creationTime, node->modificationTime, node->modificationTime};
+    const uint64_t contentSize = node->type == FILE_TYPE_FILE ? node->contentSize : 0;
+    struct FileNode* copy = restore_file_node_ctx(image->overlay, index == 0 ? NULL : image->copies[node->parent],
+                                                  image->names + node->nameOffset, properties, times,
+                                                  contentSize);
+    if (copy == NULL) return NULL;
+
+    if (contentSize > 0) {
+        acquire_write_lock(&copy->lock);
+        write_file_content(&image->overlay->allocator, copy, image->content + node->contentOffset, contentSize, 0);
+        release_write_lock(&copy->lock);
+    }
+    if (index == 0) set_root_node_ctx(image->overlay, copy);
+    image->copies[index] = copy;
+
+    return copy;
+}
+
+/**
+    * Copies ancestors of node which aren't copied yet, from
+    * the topmost one down. Their copies hold taken over
+    * children only.
+*/
+static uint8_t copy_image_ancestors(struct WsfsImage* image, const uint32_t index, struct IndexQueue* path) {
+    path->count = 0;
+    for (uint32_t ancestor = index; image->copies[ancestor] == NULL;) {
+        const struct ImageNode* node = get_image_node(image, ancestor);
+        if (node == NULL || push_index(path, ancestor) != EXIT_SUCCESS) return EXIT_FAILURE;
+        if (ancestor == 0) break;
+
+        // Parent index is smaller than index of child, so walk ends at the root
+        ancestor = node->parent;
+    }
+
+    for (uint32_t i = path->count; i-- > 1;) {
+        if (copy_image_node(image, path->items[i]) == NULL) return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Copies subtree of node breadth first and marks it taken
+    * over. Symbolic links whose targets aren't taken over yet
+    * are added to pending list.
+*/
+static uint8_t copy_image_subtree(struct WsfsImage* image, const uint32_t index, struct IndexQueue* queue,
+                                  struct IndexQueue* symlinks) {
+    queue->count = 0;
+    if (push_index(queue, index) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    for (uint32_t position = 0; position < queue->count; position++) {
+        const uint32_t current = queue->items[position];
+        const struct ImageNode* node = get_image_node(image, current);
+        if (node == NULL || (image->copies[current] == NULL && copy_image_node(image, current) == NULL)) {
+            return EXIT_FAILURE;
+        }
+        image->isTakenOver[current] = 1;
+
+        if (node->type == FILE_TYPE_SYMLINK && push_index(symlinks, current) != EXIT_SUCCESS) return EXIT_FAILURE;
+        if (node->type != FILE_TYPE_DIR) continue;
+
+        const uint32_t* children = image->lookup + node->firstChild - 1;
+        for (uint32_t i = 0; i < node->childCount; i++) {
+            // Child which is taken over already holds its whole subtree
+            if (children[i] >= image->header->nodeCount || image->isTakenOver[children[i]]) continue;
+            if (push_index(queue, children[i]) != EXIT_SUCCESS) return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Takes over node and targets of symbolic links in taken
+    * over subtrees. Image write lock is held by the caller.
+*/
+static uint8_t take_over_image_node(struct WsfsImage* image, const uint32_t index) {
+    struct IndexQueue queue = {0};
+    struct IndexQueue symlinks = {0};
+    uint8_t result = push_index(&symlinks, index);
+
+    // The node itself is the first pending entry, then targets of copied symbolic links
+    for (uint32_t position = 0; position < symlinks.count && result == EXIT_SUCCESS; position++) {
+        const uint32_t current = symlinks.items[position];
+        const uint32_t target = position == 0 ? current : image->nodes[current].symlinkTarget;
+        if (target >= image->header->nodeCount || image->isTakenOver[target]) continue;
+
+        result = copy_image_ancestors(image, target, &queue) == EXIT_SUCCESS &&
+                 copy_image_subtree(image, target, &queue, &symlinks) == EXIT_SUCCESS
+                 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Targets are copied now, so copies of symbolic links can point to them
+    for (uint32_t position = 1; position < symlinks.count && result == EXIT_SUCCESS; position++) {
+        const uint32_t target = image->nodes[symlinks.items[position]].symlinkTarget;
+        if (target < image->header->nodeCount) {
+            atomic_store_explicit(&image->copies[symlinks.items[position]]->info.data.symlinkTarget,
+                                  image->copies[target], memory_order_release);
+        }
+    }
+
+    free(queue.items);
+    free(symlinks.items);
+
+    return result;
+}
+
+struct FileNode* wsfs_image_take_over(struct WsfsImage* image, struct ImageEntry* entry) {
+    if (image == NULL || entry == NULL) return NULL;
+    if (entry->overlay != NULL) return entry->overlay;
+
+    acquire_write_lock(&image->lock);
+    if (get_image_node(image, entry->node) != NULL && init_overlay(image) == EXIT_SUCCESS &&
+        take_over_image_node(image, entry->node) == EXIT_SUCCESS) {
+        entry->overlay = image->copies[entry->node];
+    }
+    release_write_lock(&image->lock);
+
+    return entry->overlay;
+}
+
+struct WsfsContext* wsfs_image_get_overlay(struct WsfsImage* image) {
+    if (image == NULL) return NULL;
+
+    acquire_read_lock(&image->lock);
+    struct WsfsContext* overlay = image->overlay;
+    release_read_lock(&image->lock);
+
+    return overlay;
+}
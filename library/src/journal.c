@@ -0,0 +1,1009 @@
+/**
+    * @file: journal.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the journal of changes.
+*/
+
+#include "../include/journal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/dir_index.h"
+#include "../include/epoch.h"
+#include "../include/file_content.h"
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs_macros.h"
+
+#define PATH_BUFFER_SIZE 256
+#define JOURNAL_COPY_BUFFER_SIZE 65536
+#define TREE_MIN_CAPACITY 16
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+/**
+ * @struct JournalFileHeader
+ * @brief First bytes of journal file.
+ */
+struct JournalFileHeader {
+    uint32_t magic;         /**< JOURNAL_MAGIC */
+    uint32_t version;       /**< JOURNAL_VERSION */
+    uint64_t checkpoint;    /**< Number of checkpoint which records follow, 0 if they start from an empty root */
+};
+
+/**
+ * @struct JournalRecordHeader
+ * @brief Header of record. It is followed by path of node,
+ * path of other node(both NUL-terminated) and data.
+ */
+struct JournalRecordHeader {
+    uint32_t size;          /**< Amount of bytes after header */
+    uint32_t checksum;      /**< FNV-1a of the whole record with this field set to zero */
+    uint64_t value;         /**< Offset, length, type or permissions */
+    uint32_t pathLength;    /**< Length of path of node with terminator */
+    uint32_t otherLength;   /**< Length of path of other node with terminator, 0 if there is none */
+    uint32_t type;          /**< JOURNAL_* */
+    uint32_t reserved;      /**< Zero */
+};
+
+/**
+ * @struct JournalBuffer
+ * @brief Growing buffer of records.
+ */
+struct JournalBuffer {
+    char* data;         /**< Records */
+    uint64_t size;      /**< Amount of used bytes */
+    uint64_t capacity;  /**< Amount of allocated bytes */
+};
+
+struct Journal {
+    int fd;                             /**< Journal file opened for appending */
+    int previousFd;                     /**< Journal file before rotation, -1 if journal isn't rotated */
+    char* path;                         /**< Path of journal file */
+    char* nextPath;                     /**< Path of file which records go to during checkpoint */
+    char* temporaryPath;                /**< Path of file where journal files are merged */
+    uint64_t checkpoint;                /**< Number of checkpoint which records in fd follow */
+    uint64_t rotatedSequence;           /**< Number of the last record written into previous file */
+    uint64_t previousSize;              /**< Size of previous file */
+    enum JournalSyncPolicy policy;      /**< When records become durable */
+    uint32_t intervalMs;                /**< Interval between syncs of JOURNAL_SYNC_INTERVAL */
+    pthread_mutex_t mutex;              /**< Protects every field below */
+    pthread_cond_t written;             /**< Signalled when a batch is written */
+    pthread_cond_t wake;                /**< Wakes background thread */
+    struct JournalBuffer active;        /**< Buffer where records are appended */
+    struct JournalBuffer spare;         /**< Buffer being written, swapped with active one */
+    uint64_t appendedSequence;          /**< Number of the last appended record */
+    uint64_t syncedSequence;            /**< Number of the last durable record */
+    uint8_t isWriting;                  /**< 1 while a thread writes a batch without mutex */
+    uint8_t isFailed;                   /**< 1 after a write or sync failed */
+    uint8_t isStopping;                 /**< 1 once background thread has to stop */
+    uint8_t hasFlusher;                 /**< 1 if background thread was started */
+    pthread_t flusher;                  /**< Background thread of JOURNAL_SYNC_INTERVAL */
+    struct JournalStats stats;          /**< Counters */
+};
+
+/**
+ * @struct JournalPath
+ * @brief Path of node built for a record.
+ */
+struct JournalPath {
+    char* data;                         /**< NUL-terminated path */
+    uint32_t length;                    /**< Length with terminator */
+    char buffer[PATH_BUFFER_SIZE];      /**< Storage of short paths */
+};
+
+/**
+ * @struct NodeList
+ * @brief Growing array of nodes of attached subtree.
+ */
+struct NodeList {
+    const struct FileNode** items;  /**< Nodes in breadth first order */
+    uint32_t count;                 /**< Amount of nodes */
+    uint32_t capacity;              /**< Amount of nodes which fit into items */
+};
+
+static uint32_t update_checksum(uint32_t hash, const void* bytes, const uint64_t size) {
+    const uint8_t* data = bytes;
+    for (uint64_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static uint32_t get_record_checksum(struct JournalRecordHeader header, const char* payload) {
+    header.checksum = 0;
+    const uint32_t hash = update_checksum(FNV_OFFSET_BASIS, &header, sizeof(header));
+
+    return update_checksum(hash, payload, header.size);
+}
+
+static uint8_t write_all(const int fd, const char* data, uint64_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return EXIT_FAILURE;
+
+        data += written;
+        size -= (uint64_t)written;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Writes active buffer and syncs file if asked. Mutex is
+    * held on entry and exit, but released during the write,
+    * so other threads keep appending into the other buffer.
+*/
+static void write_batch(struct Journal* journal, const uint8_t isSync) {
+    while (journal->isWriting) {
+        pthread_cond_wait(&journal->written, &journal->mutex);
+    }
+
+    const uint64_t target = journal->appendedSequence;
+    if (journal->isFailed || (journal->active.size == 0 && (!isSync || journal->syncedSequence == target))) return;
+
+    const struct JournalBuffer batch = journal->active;
+    const int fd = journal->fd;
+    journal->active = journal->spare;
+    journal->active.size = 0;
+    journal->isWriting = 1;
+    pthread_mutex_unlock(&journal->mutex);
+
+    uint8_t result = write_all(fd, batch.data, batch.size);
+    if (result == EXIT_SUCCESS && isSync && fdatasync(fd) != 0) result = EXIT_FAILURE;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->spare = batch;
+    journal->isWriting = 0;
+    if (result != EXIT_SUCCESS) journal->isFailed = 1;
+    if (result == EXIT_SUCCESS && isSync) journal->syncedSequence = target;
+    if (result == EXIT_SUCCESS) journal->stats.fileSize += batch.size;
+    if (batch.size > 0) journal->stats.writes++;
+    if (isSync) journal->stats.syncs++;
+    pthread_cond_broadcast(&journal->written);
+}
+
+static void* run_flusher(void* argument) {
+    struct Journal* journal = argument;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (!journal->isStopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += journal->intervalMs / 1000;
+        deadline.tv_nsec += (long)(journal->intervalMs % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&journal->wake, &journal->mutex, &deadline);
+
+        if (journal->syncedSequence < journal->appendedSequence) write_batch(journal, 1);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    return NULL;
+}
+
+static uint8_t reserve_buffer(struct JournalBuffer* buffer, const uint64_t size) {
+    if (buffer->size + size <= buffer->capacity) return EXIT_SUCCESS;
+
+    uint64_t capacity = buffer->capacity == 0 ? JOURNAL_BUFFER_SIZE : buffer->capacity;
+    while (capacity < buffer->size + size) capacity *= 2;
+    char* data = realloc(buffer->data, capacity);
+    if (data == NULL) return EXIT_FAILURE;
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Appends record to active buffer. Returns 0 if memory
+    * allocation failed or record doesn't fit its size field,
+    * journal is failed then.
+*/
+static uint64_t append_record(struct Journal* journal, struct JournalRecordHeader* header, const char* path,
+                              const char* other, const void* data, const uint64_t dataSize) {
+    const uint64_t size = (uint64_t)header->pathLength + header->otherLength + dataSize;
+    if (size > UINT32_MAX) {
+        pthread_mutex_lock(&journal->mutex);
+        journal->isFailed = 1;
+        pthread_mutex_unlock(&journal->mutex);
+        return 0;
+    }
+    header->size = (uint32_t)size;
+    header->checksum = 0;
+    uint32_t hash = update_checksum(FNV_OFFSET_BASIS, header, sizeof(*header));
+    hash = update_checksum(hash, path, header->pathLength);
+    hash = update_checksum(hash, other, header->otherLength);
+    header->checksum = update_checksum(hash, data, dataSize);
+
+    const uint64_t recordSize = sizeof(*header) + header->size;
+    uint64_t sequence = 0;
+    pthread_mutex_lock(&journal->mutex);
+    if (reserve_buffer(&journal->active, recordSize) != EXIT_SUCCESS) {
+        journal->isFailed = 1;
+    } else {
+        char* destination = journal->active.data + journal->active.size;
+        memcpy(destination, header, sizeof(*header));
+        memcpy(destination + sizeof(*header), path, header->pathLength);
+        if (header->otherLength > 0) memcpy(destination + sizeof(*header) + header->pathLength, other, header->otherLength);
+        if (dataSize > 0) memcpy(destination + sizeof(*header) + header->pathLength + header->otherLength, data, dataSize);
+
+        journal->active.size += recordSize;
+        journal->stats.records++;
+        journal->stats.bytes += recordSize;
+        sequence = ++journal->appendedSequence;
+    }
+    pthread_mutex_unlock(&journal->mutex);
+
+    return sequence;
+}
+
+static const struct FileNode* load_parent(const struct FileNode* node) {
+    return atomic_load_explicit(&node->parent, memory_order_acquire);
+}
+
+/**
+    * Checks if node can be reached from the root. Nodes which
+    * were never added to a directory end in NULL or themselves.
+*/
+static uint8_t is_reachable(const struct WsfsContext* context, const struct FileNode* node) {
+    while (node != context->root) {
+        const struct FileNode* parent = load_parent(node);
+        if (parent == NULL || parent == node) return 0;
+        node = parent;
+    }
+
+    return 1;
+}
+
+static void free_journal_path(const struct JournalPath* path) {
+    if (path->data != path->buffer) free(path->data);
+}
+
+/**
+    * Builds path of node relative to the root, the root
+    * itself has an empty path. Name is appended if given, so
+    * path of a former child of node can be built as well.
+*/
+static uint8_t build_journal_path(const struct WsfsContext* context, const struct FileNode* node, const char* name,
+                                  struct JournalPath* path) {
+    // Every component is followed by a separator or by the terminator
+    uint64_t length = name != NULL ? strlen(name) + 1 : 0;
+    for (const struct FileNode* current = node; current != context->root; current = load_parent(current)) {
+        length += current->info.metadata.nameLength + 1;
+    }
+    if (length == 0) length = 1;
+    if (length > UINT32_MAX) return EXIT_FAILURE;
+
+    path->data = length <= PATH_BUFFER_SIZE ? path->buffer : malloc(length);
+    if (path->data == NULL) return EXIT_FAILURE;
+    path->length = (uint32_t)length;
+
+    uint64_t position = length - 1;
+    path->data[position] = '\0';
+    if (name != NULL) {
+        const uint64_t nameLength = strlen(name);
+        position -= nameLength;
+        memcpy(path->data + position, name, nameLength);
+        if (position > 0) path->data[--position] = '\\';
+    }
+    for (const struct FileNode* current = node; current != context->root; current = load_parent(current)) {
+        const uint32_t nameLength = current->info.metadata.nameLength;
+        position -= nameLength;
+        memcpy(path->data + position, atomic_load_explicit(&current->info.metadata.name, memory_order_acquire),
+               nameLength);
+        if (position > 0) path->data[--position] = '\\';
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint64_t append_change(struct Journal* journal, const struct WsfsContext* context,
+                              const enum JournalRecordType type, const struct FileNode* node, const char* name,
+                              const struct FileNode* other, const void* data, const uint64_t size,
+                              const uint64_t value) {
+    struct JournalPath path;
+    struct JournalPath otherPath = {0};
+    if (build_journal_path(context, node, name, &path) != EXIT_SUCCESS) return 0;
+    if (other != NULL && build_journal_path(context, other, NULL, &otherPath) != EXIT_SUCCESS) {
+        free_journal_path(&path);
+        return 0;
+    }
+
+    // Size of record has 32 bits, bigger content is split into records which replay to the same change
+    const uint8_t isSplit = type == JOURNAL_WRITE || type == JOURNAL_WRITE_ALL || type == JOURNAL_APPEND;
+    uint64_t sequence;
+    uint64_t written = 0;
+    do {
+        const uint64_t chunkSize = isSplit && size - written > JOURNAL_RECORD_DATA_SIZE ? JOURNAL_RECORD_DATA_SIZE
+                                                                                        : size - written;
+        const enum JournalRecordType chunkType = type == JOURNAL_WRITE_ALL && written > 0 ? JOURNAL_WRITE : type;
+        struct JournalRecordHeader header = {0};
+        header.value = chunkType == JOURNAL_WRITE ? value + written : value;
+        header.pathLength = path.length;
+        header.otherLength = other != NULL ? otherPath.length : 0;
+        header.type = chunkType;
+        sequence = append_record(journal, &header, path.data, otherPath.data,
+                                 data != NULL ? (const char*)data + written : NULL, chunkSize);
+        written += chunkSize;
+    } while (sequence != 0 && written < size);
+
+    free_journal_path(&path);
+    if (other != NULL) free_journal_path(&otherPath);
+
+    return sequence;
+}
+
+static uint8_t push_node(struct NodeList* list, const struct FileNode* node) {
+    if (list->count == list->capacity) {
+        const uint32_t capacity = list->capacity == 0 ? TREE_MIN_CAPACITY : list->capacity * 2;
+        const struct FileNode** items = realloc(list->items, capacity * sizeof(struct FileNode*));
+        if (items == NULL) return EXIT_FAILURE;
+
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = node;
+
+    return EXIT_SUCCESS;
+}
+
+static uint64_t append_file_content(struct Journal* journal, const struct WsfsContext* context,
+                                    const struct FileNode* file) {
+    struct RwLock* lock = (struct RwLock*)&file->lock;
+    acquire_read_lock(lock);
+    const uint64_t size = file->info.data.contentSize;
+    char* content = size > 0 ? malloc(size) : NULL;
+    if (content != NULL) read_file_content_range(file, content, size, 0);
+    release_read_lock(lock);
+
+    const uint64_t sequence = content != NULL
+                              ? append_change(journal, context, JOURNAL_WRITE_ALL, file, NULL, NULL, content, size, 0)
+                              : 0;
+    free(content);
+
+    return sequence;
+}
+
+/**
+    * Journals node added to directory as if its subtree was
+    * built there from scratch. Nodes are created first, while
+    * directories still accept children, then content and
+    * targets are filled in and permissions come last.
+*/
+static uint64_t append_tree(struct Journal* journal, const struct WsfsContext* context, const struct FileNode* node) {
+    struct NodeList list = {0};
+    uint64_t sequence = push_node(&list, node) == EXIT_SUCCESS ? 1 : 0;
+    for (uint32_t i = 0; i < list.count && sequence != 0; i++) {
+        const struct FileNode* current = list.items[i];
+        sequence = append_change(journal, context, JOURNAL_CREATE, current, NULL, NULL, NULL, 0,
+                                 current->info.properties.type);
+        if (current->info.properties.type != FILE_TYPE_DIR || sequence == 0) continue;
+
+        struct RwLock* lock = (struct RwLock*)&current->lock;
+        acquire_read_lock(lock);
+        for (const struct FileNode* child = current->info.data.directoryContent; child != NULL && sequence != 0;
+             child = child->next) {
+            if (push_node(&list, child) != EXIT_SUCCESS) sequence = 0;
+        }
+        release_read_lock(lock);
+    }
+
+    for (uint32_t i = 0; i < list.count && sequence != 0; i++) {
+        const struct FileNode* current = list.items[i];
+        const struct FileNode* target = current->info.properties.type == FILE_TYPE_SYMLINK
+                                        ? atomic_load_explicit(&current->info.data.symlinkTarget, memory_order_acquire)
+                                        : NULL;
+        if (current->info.properties.type == FILE_TYPE_FILE && current->info.data.contentSize > 0) {
+            sequence = append_file_content(journal, context, current);
+        } else if (target != NULL && is_reachable(context, target)) {
+            sequence = append_change(journal, context, JOURNAL_SYMLINK, current, NULL, target, NULL, 0, 0);
+        }
+    }
+
+    for (uint32_t i = 0; i < list.count && sequence != 0; i++) {
+        const enum Permissions permissions = list.items[i]->info.properties.permissions;
+        if (permissions != PERM_DEFAULT - PERMISSION_MASK) {
+            sequence = append_change(journal, context, JOURNAL_PERMISSIONS, list.items[i], NULL, NULL, NULL, 0,
+                                     permissions);
+        }
+    }
+    free(list.items);
+
+    return sequence;
+}
+
+/**
+    * Journals move. Node moved into the tree is journaled as
+    * added subtree, node moved out of it as deleted one.
+*/
+static uint64_t append_move(struct Journal* journal, const struct WsfsContext* context,
+                            const struct JournalChange* change) {
+    const uint8_t isNodeReachable = is_reachable(context, change->node);
+    const uint8_t isOldParentReachable = change->other != NULL && is_reachable(context, change->other);
+
+    if (isNodeReachable && isOldParentReachable) {
+        return append_change(journal, context, JOURNAL_MOVE, change->node, NULL, change->other, NULL, 0, 0);
+    }
+    if (isNodeReachable) return append_tree(journal, context, change->node);
+    if (isOldParentReachable) {
+        const char* name = atomic_load_explicit(&change->node->info.metadata.name, memory_order_acquire);
+        return append_change(journal, context, JOURNAL_DELETE, change->other, name, NULL, NULL, 0, 0);
+    }
+
+    return 0;
+}
+
+uint64_t journal_record(struct WsfsContext* context, const struct JournalChange* change) {
+    struct Journal* journal = context->journal;
+    if (journal == NULL || change->node == NULL || wsfs_epoch_enter() != EXIT_SUCCESS) return 0;
+
+    // Nodes of the tree stay allocated even if a directory above them is deleted meanwhile
+    uint64_t sequence = 0;
+    if (change->type == JOURNAL_MOVE) {
+        sequence = append_move(journal, context, change);
+    } else if (is_reachable(context, change->node)) {
+        if (change->type == JOURNAL_ATTACH) {
+            sequence = append_tree(journal, context, change->node);
+        } else if (change->other == NULL || is_reachable(context, change->other)) {
+            sequence = append_change(journal, context, change->type, change->node, NULL, change->other,
+                                     change->data, change->size, change->value);
+        }
+    }
+    wsfs_epoch_exit();
+
+    return sequence;
+}
+
+void journal_commit(struct WsfsContext* context, const uint64_t sequence) {
+    struct Journal* journal = context->journal;
+    if (journal == NULL || sequence == 0) return;
+
+    pthread_mutex_lock(&journal->mutex);
+    if (journal->policy == JOURNAL_SYNC_ALWAYS) {
+        // The first waiting thread syncs records of everyone who appended meanwhile
+        while (journal->syncedSequence < sequence && !journal->isFailed) {
+            if (journal->isWriting) {
+                pthread_cond_wait(&journal->written, &journal->mutex);
+            } else {
+                write_batch(journal, 1);
+            }
+        }
+    } else if (journal->active.size >= JOURNAL_BUFFER_SIZE && !journal->isWriting) {
+        write_batch(journal, 0);
+    }
+    pthread_mutex_unlock(&journal->mutex);
+}
+
+static uint8_t write_journal_header(const int fd, const uint64_t checkpoint) {
+    struct JournalFileHeader header = {0};
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.checkpoint = checkpoint;
+
+    return write_all(fd, (const char*)&header, sizeof(header));
+}
+
+static uint8_t read_journal_header(const int fd, struct JournalFileHeader* header) {
+    return pread(fd, header, sizeof(*header), 0) == sizeof(*header) && header->magic == JOURNAL_MAGIC &&
+           header->version == JOURNAL_VERSION ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static char* join_path(const char* path, const char* suffix) {
+    const size_t pathLength = strlen(path);
+    const size_t suffixLength = strlen(suffix);
+    char* joined = malloc(pathLength + suffixLength + 1);
+    if (joined == NULL) return NULL;
+
+    memcpy(joined, path, pathLength);
+    memcpy(joined + pathLength, suffix, suffixLength + 1);
+
+    return joined;
+}
+
+uint8_t sync_parent_directory(const char* path) {
+    const char* separator = strrchr(path, '/');
+    char* directory = separator != NULL ? strndup(path, separator == path ? 1 : (size_t)(separator - path))
+                                        : strdup(".");
+    if (directory == NULL) return EXIT_FAILURE;
+
+    const int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    free(directory);
+    if (fd < 0) return EXIT_FAILURE;
+    const uint8_t result = fsync(fd) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    close(fd);
+
+    return result;
+}
+
+/**
+    * Appends records of file, everything after its header, to
+    * file descriptor.
+*/
+static uint8_t copy_records(const char* path, const int destination) {
+    const int source = open(path, O_RDONLY);
+    if (source < 0) return EXIT_FAILURE;
+
+    char buffer[JOURNAL_COPY_BUFFER_SIZE];
+    off_t offset = sizeof(struct JournalFileHeader);
+    ssize_t size;
+    uint8_t result = EXIT_SUCCESS;
+    while (result == EXIT_SUCCESS && (size = pread(source, buffer, sizeof(buffer), offset)) != 0) {
+        if (size < 0 && errno == EINTR) continue;
+
+        result = size > 0 ? write_all(destination, buffer, (uint64_t)size) : EXIT_FAILURE;
+        offset += size;
+    }
+    close(source);
+
+    return result;
+}
+
+/**
+    * Merges records of next file into journal file, used when
+    * checkpoint wasn't saved. Merged file replaces next file
+    * first and journal file afterwards, so a crash in between
+    * leaves next file with the same checkpoint as journal
+    * file, which holds every record then(see settle_journal_files()).
+*/
+static uint8_t merge_journal_files(const struct Journal* journal, const uint64_t checkpoint) {
+    const int fd = open(journal->temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return EXIT_FAILURE;
+
+    uint8_t result = write_journal_header(fd, checkpoint) == EXIT_SUCCESS &&
+                     copy_records(journal->path, fd) == EXIT_SUCCESS &&
+                     copy_records(journal->nextPath, fd) == EXIT_SUCCESS && fdatasync(fd) == 0
+                     ? EXIT_SUCCESS : EXIT_FAILURE;
+    close(fd);
+    if (result == EXIT_SUCCESS) {
+        result = rename(journal->temporaryPath, journal->nextPath) == 0 &&
+                 rename(journal->nextPath, journal->path) == 0 ? sync_parent_directory(journal->path) : EXIT_FAILURE;
+    } else {
+        unlink(journal->temporaryPath);
+    }
+
+    return result;
+}
+
+/**
+    * Opens journal file, writes header if file is new and
+    * reads checkpoint which its records follow.
+*/
+static uint8_t open_journal_file(struct Journal* journal, const uint64_t checkpoint) {
+    if (journal->fd >= 0) close(journal->fd);
+    journal->fd = open(journal->path, O_RDWR | O_CREAT | O_APPEND, 0644);
+
+    struct stat status;
+    struct JournalFileHeader header;
+    if (journal->fd < 0 || fstat(journal->fd, &status) != 0) return EXIT_FAILURE;
+    if (status.st_size == 0 && write_journal_header(journal->fd, checkpoint) != EXIT_SUCCESS) return EXIT_FAILURE;
+    if (read_journal_header(journal->fd, &header) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    journal->checkpoint = header.checkpoint;
+    journal->stats.fileSize = status.st_size == 0 ? sizeof(header) : (uint64_t)status.st_size;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Leaves one journal file which follows checkpoint of
+    * tree. Next file is left by a crash during checkpoint, it
+    * replaces journal file if checkpoint was saved or if it
+    * was merged already, else it is merged now. Records of a
+    * journal file older than checkpoint of tree are dropped.
+*/
+static uint8_t settle_journal_files(struct Journal* journal, const uint64_t checkpoint) {
+    const int nextFd = open(journal->nextPath, O_RDONLY);
+    if (nextFd >= 0) {
+        struct JournalFileHeader header;
+        const uint8_t isValid = read_journal_header(nextFd, &header) == EXIT_SUCCESS;
+        close(nextFd);
+
+        uint8_t result;
+        if (!isValid) {
+            // Crash before header was written, records were never written there
+            result = unlink(journal->nextPath) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        } else if (header.checkpoint == journal->checkpoint ||
+                   (header.checkpoint == journal->checkpoint + 1 && header.checkpoint == checkpoint)) {
+            result = rename(journal->nextPath, journal->path) == 0 ? sync_parent_directory(journal->path)
+                                                                     : EXIT_FAILURE;
+        } else if (header.checkpoint == journal->checkpoint + 1 && journal->checkpoint == checkpoint) {
+            result = merge_journal_files(journal, checkpoint);
+        } else {
+            result = EXIT_FAILURE;
+        }
+        if (result != EXIT_SUCCESS || open_journal_file(journal, checkpoint) != EXIT_SUCCESS) return EXIT_FAILURE;
+    }
+
+    // Tree lacks changes which records build on
+    if (journal->checkpoint > checkpoint) return EXIT_FAILURE;
+    if (journal->checkpoint < checkpoint) {
+        if (ftruncate(journal->fd, 0) != 0 || write_journal_header(journal->fd, checkpoint) != EXIT_SUCCESS ||
+            fdatasync(journal->fd) != 0) return EXIT_FAILURE;
+        journal->checkpoint = checkpoint;
+        journal->stats.fileSize = sizeof(struct JournalFileHeader);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void free_journal(struct Journal* journal) {
+    pthread_mutex_destroy(&journal->mutex);
+    pthread_cond_destroy(&journal->written);
+    pthread_cond_destroy(&journal->wake);
+    free(journal->active.data);
+    free(journal->spare.data);
+    if (journal->fd >= 0) close(journal->fd);
+    if (journal->previousFd >= 0) close(journal->previousFd);
+    free(journal->path);
+    free(journal->nextPath);
+    free(journal->temporaryPath);
+    free(journal);
+}
+
+uint8_t wsfs_open_journal_ctx(struct WsfsContext* context, const char* path, const enum JournalSyncPolicy policy,
+                              const uint32_t intervalMs) {
+    if (context == NULL || path == NULL || context->journal != NULL ||
+        (policy == JOURNAL_SYNC_INTERVAL && intervalMs == 0)) return EXIT_FAILURE;
+
+    struct Journal* journal = calloc(1, sizeof(struct Journal));
+    if (journal == NULL) return EXIT_FAILURE;
+
+    journal->fd = -1;
+    journal->previousFd = -1;
+    journal->policy = policy;
+    journal->intervalMs = intervalMs;
+    pthread_mutex_init(&journal->mutex, NULL);
+    pthread_cond_init(&journal->written, NULL);
+    pthread_cond_init(&journal->wake, NULL);
+    journal->path = strdup(path);
+    journal->nextPath = join_path(path, JOURNAL_NEXT_SUFFIX);
+    journal->temporaryPath = join_path(path, JOURNAL_TEMPORARY_SUFFIX);
+
+    if (journal->path == NULL || journal->nextPath == NULL || journal->temporaryPath == NULL ||
+        open_journal_file(journal, context->checkpoint) != EXIT_SUCCESS ||
+        settle_journal_files(journal, context->checkpoint) != EXIT_SUCCESS ||
+        (policy == JOURNAL_SYNC_INTERVAL && pthread_create(&journal->flusher, NULL, run_flusher, journal) != 0)) {
+        free_journal(journal);
+        return EXIT_FAILURE;
+    }
+    journal->hasFlusher = policy == JOURNAL_SYNC_INTERVAL;
+    context->journal = journal;
+
+    // Tree loaded from checkpoint is brought up to date now, an empty one by wsfs_init_ctx()
+    if (context->root != NULL) replay_journal(context);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_open_journal(const char* path, const enum JournalSyncPolicy policy, const uint32_t intervalMs) {
+    return wsfs_open_journal_ctx(get_default_context(), path, policy, intervalMs);
+}
+
+uint8_t wsfs_sync_journal_ctx(struct WsfsContext* context) {
+    struct Journal* journal = context != NULL ? context->journal : NULL;
+    if (journal == NULL) return EXIT_FAILURE;
+
+    pthread_mutex_lock(&journal->mutex);
+    write_batch(journal, 1);
+    const uint8_t result = journal->isFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+    pthread_mutex_unlock(&journal->mutex);
+
+    return result;
+}
+
+uint8_t wsfs_sync_journal(void) {
+    return wsfs_sync_journal_ctx(get_default_context());
+}
+
+void wsfs_close_journal_ctx(struct WsfsContext* context) {
+    struct Journal* journal = context != NULL ? context->journal : NULL;
+    if (journal == NULL) return;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->isStopping = 1;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->mutex);
+    if (journal->hasFlusher) pthread_join(journal->flusher, NULL);
+
+    pthread_mutex_lock(&journal->mutex);
+    write_batch(journal, journal->policy != JOURNAL_SYNC_NEVER);
+    pthread_mutex_unlock(&journal->mutex);
+
+    context->journal = NULL;
+    free_journal(journal);
+}
+
+void wsfs_close_journal(void) {
+    wsfs_close_journal_ctx(get_default_context());
+}
+
+void get_journal_stats_ctx(struct WsfsContext* context, struct JournalStats* stats) {
+    struct Journal* journal = context->journal;
+    if (journal == NULL) {
+        memset(stats, 0, sizeof(struct JournalStats));
+        return;
+    }
+
+    pthread_mutex_lock(&journal->mutex);
+    *stats = journal->stats;
+    pthread_mutex_unlock(&journal->mutex);
+}
+
+uint8_t rotate_journal(struct WsfsContext* context, const uint64_t checkpoint) {
+    struct Journal* journal = context->journal;
+    if (journal == NULL) return EXIT_FAILURE;
+
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->isWriting) {
+        pthread_cond_wait(&journal->written, &journal->mutex);
+    }
+    const int fd = journal->isFailed || journal->previousFd >= 0
+                   ? -1 : open(journal->nextPath, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) {
+        pthread_mutex_unlock(&journal->mutex);
+        return EXIT_FAILURE;
+    }
+
+    // Records appended before checkpoint stay in previous file
+    if (write_journal_header(fd, checkpoint) != EXIT_SUCCESS ||
+        write_all(journal->fd, journal->active.data, journal->active.size) != EXIT_SUCCESS) {
+        close(fd);
+        unlink(journal->nextPath);
+        pthread_mutex_unlock(&journal->mutex);
+        return EXIT_FAILURE;
+    }
+    if (journal->active.size > 0) journal->stats.writes++;
+    journal->stats.fileSize += journal->active.size;
+    journal->active.size = 0;
+
+    journal->previousFd = journal->fd;
+    journal->previousSize = journal->stats.fileSize;
+    journal->fd = fd;
+    journal->checkpoint = checkpoint;
+    journal->rotatedSequence = journal->appendedSequence;
+    journal->stats.fileSize += sizeof(struct JournalFileHeader);
+    // Nothing is written into next file until previous one is synced
+    journal->isWriting = 1;
+    pthread_mutex_unlock(&journal->mutex);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t sync_rotated_journal(struct WsfsContext* context) {
+    struct Journal* journal = context->journal;
+    const uint8_t result = fdatasync(journal->previousFd) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    pthread_mutex_lock(&journal->mutex);
+    if (result != EXIT_SUCCESS) journal->isFailed = 1;
+    if (result == EXIT_SUCCESS && journal->syncedSequence < journal->rotatedSequence) {
+        journal->syncedSequence = journal->rotatedSequence;
+    }
+    journal->stats.syncs++;
+    journal->isWriting = 0;
+    pthread_cond_broadcast(&journal->written);
+    pthread_mutex_unlock(&journal->mutex);
+
+    return result;
+}
+
+uint8_t finish_journal_rotation(struct WsfsContext* context, const uint8_t isCheckpointSaved) {
+    struct Journal* journal = context->journal;
+    if (isCheckpointSaved) {
+        // Atomic replace drops records which checkpoint holds, fd stays open on the same file
+        const uint8_t result = rename(journal->nextPath, journal->path) == 0
+                               ? sync_parent_directory(journal->path) : EXIT_FAILURE;
+        pthread_mutex_lock(&journal->mutex);
+        if (result == EXIT_SUCCESS) {
+            close(journal->previousFd);
+            journal->previousFd = -1;
+            journal->stats.fileSize -= journal->previousSize;
+        } else {
+            journal->isFailed = 1;
+        }
+        pthread_mutex_unlock(&journal->mutex);
+
+        return result;
+    }
+
+    // Records keep being appended into memory while files are merged
+    pthread_mutex_lock(&journal->mutex);
+    while (journal->isWriting) {
+        pthread_cond_wait(&journal->written, &journal->mutex);
+    }
+    journal->isWriting = 1;
+    const uint64_t checkpoint = journal->checkpoint - 1;
+    pthread_mutex_unlock(&journal->mutex);
+
+    const int fd = merge_journal_files(journal, checkpoint) == EXIT_SUCCESS
+                   ? open(journal->path, O_RDWR | O_APPEND) : -1;
+    const off_t size = fd >= 0 ? lseek(fd, 0, SEEK_END) : -1;
+
+    pthread_mutex_lock(&journal->mutex);
+    if (size >= 0) {
+        close(journal->fd);
+        close(journal->previousFd);
+        journal->fd = fd;
+        journal->previousFd = -1;
+        journal->checkpoint = checkpoint;
+        journal->stats.fileSize = (uint64_t)size;
+    } else {
+        if (fd >= 0) close(fd);
+        journal->isFailed = 1;
+    }
+    journal->isWriting = 0;
+    pthread_cond_broadcast(&journal->written);
+    pthread_mutex_unlock(&journal->mutex);
+
+    return size >= 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+    * Finds child by name, permissions aren't checked because
+    * they were checked when the change was made.
+*/
+static struct FileNode* find_replayed_child(struct FileNode* dir, const char* name) {
+    if (dir == NULL || dir->info.properties.type != FILE_TYPE_DIR) return NULL;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    acquire_read_lock(&dir->lock);
+    struct FileNode* child = find_dir_child(dir, name, hash, length);
+    release_read_lock(&dir->lock);
+
+    return child;
+}
+
+/**
+    * Resolves path of record, it is cut into components in place.
+*/
+static struct FileNode* resolve_replayed_path(struct WsfsContext* context, char* path) {
+    struct FileNode* current = context->root;
+    while (current != NULL && *path != '\0') {
+        const char* name = path;
+        while (*path != '\0' && *path != '\\') path++;
+        if (*path != '\0') *path++ = '\0';
+
+        current = find_replayed_child(current, name);
+    }
+
+    return current;
+}
+
+/**
+    * Cuts the last component off path. Returns the last
+    * component, path holds path of its directory afterwards.
+*/
+static char* split_replayed_path(char* path, char** dirPath) {
+    char* separator = strrchr(path, '\\');
+    if (separator == NULL) {
+        *dirPath = path + strlen(path);
+        return path;
+    }
+
+    *separator = '\0';
+    *dirPath = path;
+
+    return separator + 1;
+}
+
+static uint8_t apply_record(struct WsfsContext* context, const struct JournalRecordHeader* header, char* path,
+                            char* other, const char* data, const uint64_t dataSize) {
+    char* dirPath;
+    const char* name;
+    struct FileNode* node;
+
+    switch (header->type) {
+        case JOURNAL_CREATE:
+            name = split_replayed_path(path, &dirPath);
+            node = resolve_replayed_path(context, dirPath);
+            return node != NULL && create_file_node_ctx(context, node, name, (enum FileType)header->value) != NULL
+                   ? EXIT_SUCCESS : EXIT_FAILURE;
+        case JOURNAL_PERMISSIONS:
+            return change_permissions_ctx(context, resolve_replayed_path(context, path), (enum Permissions)header->value);
+        case JOURNAL_WRITE:
+            return wsfs_pwrite_ctx(context, resolve_replayed_path(context, path), data, dataSize, header->value);
+        case JOURNAL_WRITE_ALL:
+            node = resolve_replayed_path(context, path);
+            return wsfs_pwrite_ctx(context, node, data, dataSize, 0) == EXIT_SUCCESS
+                   ? wsfs_truncate_ctx(context, node, dataSize) : EXIT_FAILURE;
+        case JOURNAL_APPEND:
+            return wsfs_append_ctx(context, resolve_replayed_path(context, path), data, dataSize);
+        case JOURNAL_TRUNCATE:
+            return wsfs_truncate_ctx(context, resolve_replayed_path(context, path), header->value);
+        case JOURNAL_RENAME:
+            if (dataSize == 0 || data[dataSize - 1] != '\0') return EXIT_FAILURE;
+            name = split_replayed_path(path, &dirPath);
+            node = find_replayed_child(resolve_replayed_path(context, dirPath), data);
+            return change_file_node_name_ctx(context, node, name);
+        case JOURNAL_MOVE:
+            if (other == NULL) return EXIT_FAILURE;
+            name = split_replayed_path(path, &dirPath);
+            node = find_replayed_child(resolve_replayed_path(context, other), name);
+            return change_file_node_location_ctx(context, resolve_replayed_path(context, dirPath), node);
+        case JOURNAL_DELETE:
+            node = resolve_replayed_path(context, path);
+            return node != NULL && node != context->root ? delete_file_node_ctx(context, node->parent, node)
+                                                         : EXIT_FAILURE;
+        case JOURNAL_SYMLINK:
+            if (other == NULL) return EXIT_FAILURE;
+            node = resolve_replayed_path(context, path);
+            return set_symlink_target_ctx(context, node, resolve_replayed_path(context, other));
+        default:
+            return EXIT_FAILURE;
+    }
+}
+
+/**
+    * Checks record which was read whole. Returns 1 if it is
+    * torn or corrupted.
+*/
+static uint8_t is_record_valid(const struct JournalRecordHeader* header, const char* payload) {
+    if (header->pathLength == 0 || header->pathLength > header->size ||
+        header->otherLength > header->size - header->pathLength ||
+        get_record_checksum(*header, payload) != header->checksum) return 0;
+
+    return payload[header->pathLength - 1] == '\0' &&
+           (header->otherLength == 0 || payload[header->pathLength + header->otherLength - 1] == '\0');
+}
+
+uint64_t replay_journal(struct WsfsContext* context) {
+    struct Journal* journal = context->journal;
+    struct stat status;
+    if (journal == NULL || context->root == NULL || fstat(journal->fd, &status) != 0) return 0;
+
+    // Replayed changes aren't journaled again
+    context->journal = NULL;
+
+    uint64_t applied = 0;
+    uint64_t offset = sizeof(struct JournalFileHeader);
+    char* payload = NULL;
+    uint64_t capacity = 0;
+    while (offset + sizeof(struct JournalRecordHeader) <= (uint64_t)status.st_size) {
+        struct JournalRecordHeader header;
+        if (pread(journal->fd, &header, sizeof(header), (off_t)offset) != sizeof(header) ||
+            offset + sizeof(header) + header.size > (uint64_t)status.st_size) break;
+
+        if (header.size > capacity) {
+            char* grown = realloc(payload, header.size);
+            if (grown == NULL) break;
+            payload = grown;
+            capacity = header.size;
+        }
+        if (pread(journal->fd, payload, header.size, (off_t)(offset + sizeof(header))) != (ssize_t)header.size ||
+            !is_record_valid(&header, payload)) break;
+
+        char* other = header.otherLength > 0 ? payload + header.pathLength : NULL;
+        const uint64_t dataOffset = header.pathLength + header.otherLength;
+        if (apply_record(context, &header, payload, other, payload + dataOffset, header.size - dataOffset) ==
+            EXIT_SUCCESS) {
+            applied++;
+        }
+        offset += sizeof(header) + header.size;
+    }
+    free(payload);
+
+    // Torn tail is dropped, so new records follow the last complete one
+    if (offset < (uint64_t)status.st_size) {
+        if (ftruncate(journal->fd, (off_t)offset) != 0) journal->isFailed = 1;
+        journal->stats.fileSize = offset;
+    }
+    context->journal = journal;
+
+    return applied;
+}
@@ -0,0 +1,208 @@
+/**
+    * @file: lookup_cache.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the lookup cache.
+*/
+
+#include "../include/lookup_cache.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/rw_lock.h"
+#include "../include/wsfs_macros.h"
+
+/**
+ * @struct LookupCacheEntry
+ * @brief One (parent, name) -> node mapping.
+ */
+struct LookupCacheEntry {
+    const struct FileNode* parent;  /**< Directory where node is located, NULL if entry is empty */
+    struct FileNode* node;          /**< Cached file node */
+    uint32_t hash;                  /**< Hash of node's name */
+};
+
+/**
+ * @struct LookupCacheSet
+ * @brief Ways which share one lock. Counters live next to the lock,
+ * so threads hitting different sets don't share cache lines.
+ */
+struct LookupCacheSet {
+    struct RwLock lock;                                 /**< Guards entries and counters below */
+    uint32_t victim;                                    /**< Way which is replaced next */
+    uint32_t used;                                      /**< Amount of valid entries */
+    _Atomic uint64_t hits;                              /**< Hits, counted under read lock */
+    _Atomic uint64_t misses;                            /**< Misses, counted under read lock */
+    uint64_t evictions;                                 /**< Replaced entries */
+    uint64_t invalidations;                             /**< Dropped entries */
+    struct LookupCacheEntry entries[LOOKUP_CACHE_WAYS]; /**< Ways of set */
+};
+
+static uint32_t round_up_capacity(const uint32_t requested) {
+    if (requested == 0) return 0;
+
+    uint32_t rounded = LOOKUP_CACHE_WAYS;
+    while (rounded < requested && rounded < (1u << 31)) {
+        rounded *= 2;
+    }
+    return rounded;
+}
+
+/**
+    * Gets sets of cache, allocating them on first use. Threads
+    * racing on first use publish with compare-and-swap.
+*/
+static struct LookupCacheSet* get_sets(struct LookupCache* cache, const uint8_t isCreated) {
+    struct LookupCacheSet* current = atomic_load_explicit(&cache->sets, memory_order_acquire);
+    if (current != NULL || !isCreated || cache->capacity == 0) return current;
+
+    struct LookupCacheSet* created = calloc(cache->capacity / LOOKUP_CACHE_WAYS, sizeof(struct LookupCacheSet));
+    if (created == NULL) return NULL;
+
+    if (!atomic_compare_exchange_strong(&cache->sets, &current, created)) {
+        free(created);
+        return current;
+    }
+
+    return created;
+}
+
+static struct LookupCacheSet* get_set(const struct LookupCache* cache, struct LookupCacheSet* all,
+                                      const struct FileNode* parent, const uint32_t hash) {
+    const uint32_t key = (uint32_t)((uintptr_t)parent >> 4) * 2654435761u ^ hash;
+    const uint32_t setCount = cache->capacity / LOOKUP_CACHE_WAYS;
+    return &all[key & (setCount - 1)];
+}
+
+void init_lookup_cache(struct LookupCache* cache) {
+    atomic_init(&cache->sets, NULL);
+    cache->capacity = LOOKUP_CACHE_SIZE;
+    atomic_init(&cache->uncachedMisses, 0);
+    memset(&cache->retiredStats, 0, sizeof(cache->retiredStats));
+}
+
+struct FileNode* lookup_cache_find(struct LookupCache* cache, const struct FileNode* parent,
+                                   const char* name, const uint32_t hash, const uint32_t length) {
+    struct LookupCacheSet* all = get_sets(cache, 0);
+    if (all == NULL || parent == NULL || name == NULL) {
+        atomic_fetch_add_explicit(&cache->uncachedMisses, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    struct LookupCacheSet* set = get_set(cache, all, parent, hash);
+    struct FileNode* found = NULL;
+
+    acquire_read_lock(&set->lock);
+    for (uint32_t way = 0; way < LOOKUP_CACHE_WAYS; way++) {
+        const struct LookupCacheEntry* entry = &set->entries[way];
+        if (entry->parent == parent && entry->hash == hash &&
+            entry->node->info.metadata.nameLength == length &&
+            memcmp(entry->node->info.metadata.name, name, length) == 0) {
+            found = entry->node;
+            break;
+        }
+    }
+    atomic_fetch_add_explicit(found != NULL ? &set->hits : &set->misses, 1, memory_order_relaxed);
+    release_read_lock(&set->lock);
+
+    return found;
+}
+
+void lookup_cache_insert(struct LookupCache* cache, struct FileNode* node) {
+    if (node == NULL || node->parent == NULL) return;
+
+    struct LookupCacheSet* all = get_sets(cache, 1);
+    if (all == NULL) return;
+
+    struct LookupCacheSet* set = get_set(cache, all, node->parent, node->info.metadata.nameHash);
+
+    acquire_write_lock(&set->lock);
+    struct LookupCacheEntry* slot = NULL;
+    for (uint32_t way = 0; way < LOOKUP_CACHE_WAYS; way++) {
+        struct LookupCacheEntry* entry = &set->entries[way];
+        if (entry->node == node && entry->parent == node->parent) {
+            release_write_lock(&set->lock);
+            return;
+        }
+        if (slot == NULL && entry->parent == NULL) slot = entry;
+    }
+
+    if (slot == NULL) {
+        slot = &set->entries[set->victim++ % LOOKUP_CACHE_WAYS];
+        set->evictions++;
+    } else {
+        set->used++;
+    }
+
+    slot->parent = node->parent;
+    slot->node = node;
+    slot->hash = node->info.metadata.nameHash;
+    release_write_lock(&set->lock);
+}
+
+void lookup_cache_invalidate(struct LookupCache* cache, const struct FileNode* node) {
+    struct LookupCacheSet* all = get_sets(cache, 0);
+    if (all == NULL || node == NULL || node->parent == NULL) return;
+
+    struct LookupCacheSet* set = get_set(cache, all, node->parent, node->info.metadata.nameHash);
+
+    acquire_write_lock(&set->lock);
+    for (uint32_t way = 0; way < LOOKUP_CACHE_WAYS; way++) {
+        struct LookupCacheEntry* entry = &set->entries[way];
+        if (entry->node == node && entry->parent == node->parent) {
+            entry->parent = NULL;
+            entry->node = NULL;
+            set->used--;
+            set->invalidations++;
+            break;
+        }
+    }
+    release_write_lock(&set->lock);
+}
+
+uint8_t set_lookup_cache_capacity(struct LookupCache* cache, const uint32_t newCapacity) {
+    free_lookup_cache(cache);
+    cache->capacity = round_up_capacity(newCapacity);
+    memset(&cache->retiredStats, 0, sizeof(cache->retiredStats));
+    atomic_store(&cache->uncachedMisses, 0);
+
+    if (cache->capacity == 0) return EXIT_SUCCESS;
+
+    if (get_sets(cache, 1) == NULL) {
+        cache->capacity = 0;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void add_set_stats(const struct LookupCache* cache, struct LookupCacheStats* outStats,
+                          const struct LookupCacheSet* all) {
+    if (all == NULL) return;
+
+    for (uint32_t i = 0; i < cache->capacity / LOOKUP_CACHE_WAYS; i++) {
+        outStats->hits += atomic_load_explicit(&all[i].hits, memory_order_relaxed);
+        outStats->misses += atomic_load_explicit(&all[i].misses, memory_order_relaxed);
+        outStats->evictions += all[i].evictions;
+        outStats->invalidations += all[i].invalidations;
+        outStats->used += all[i].used;
+    }
+}
+
+void get_lookup_cache_stats(struct LookupCache* cache, struct LookupCacheStats* outStats) {
+    if (outStats == NULL) return;
+
+    *outStats = cache->retiredStats;
+    outStats->misses += atomic_load_explicit(&cache->uncachedMisses, memory_order_relaxed);
+    add_set_stats(cache, outStats, get_sets(cache, 0));
+    outStats->capacity = cache->capacity;
+}
+
+void free_lookup_cache(struct LookupCache* cache) {
+    struct LookupCacheSet* all = atomic_exchange(&cache->sets, NULL);
+    add_set_stats(cache, &cache->retiredStats, all);
+    cache->retiredStats.used = 0;
+    free(all);
+}
@@ -0,0 +1,152 @@
+/**
+    * @file: lz_block.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the LZ block compressor.
+    *
+    * Block is a list of sequences. Every sequence starts with
+    * a token, high 4 bits hold length of literal run and low
+    * 4 bits hold match length - LZ_MIN_MATCH, 15 means more
+    * length bytes follow(each one is added, 255 means one
+    * more). Literals follow, then 2-byte little endian offset
+    * of match and its extra length bytes. The last sequence
+    * may end right after literals, when block is complete.
+*/
+
+#include "../include/lz_block.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ_HASH_BITS 12
+#define LZ_LENGTH_MASK 15
+
+static uint32_t hash_sequence(const uint8_t* position) {
+    uint32_t sequence;
+    memcpy(&sequence, position, sizeof(uint32_t));
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t* write_length(uint8_t* output, uint32_t length) {
+    while (length >= 255) {
+        *output++ = 255;
+        length -= 255;
+    }
+    *output++ = (uint8_t)length;
+
+    return output;
+}
+
+/**
+    * Writes literal run and the match which follows it, match
+    * of length 0 ends the block.
+*/
+static uint8_t* write_sequence(uint8_t* output, const uint8_t* literals, const uint32_t literalLength,
+                               const uint32_t offset, const uint32_t matchLength) {
+    const uint32_t matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    uint8_t* token = output++;
+    *token = (uint8_t)((literalLength < LZ_LENGTH_MASK ? literalLength : LZ_LENGTH_MASK) << 4 |
+                       (matchCode < LZ_LENGTH_MASK ? matchCode : LZ_LENGTH_MASK));
+    if (literalLength >= LZ_LENGTH_MASK) output = write_length(output, literalLength - LZ_LENGTH_MASK);
+    memcpy(output, literals, literalLength);
+    output += literalLength;
+    if (matchLength == 0) return output;
+
+    *output++ = (uint8_t)(offset & 0xFF);
+    *output++ = (uint8_t)(offset >> 8);
+    if (matchCode >= LZ_LENGTH_MASK) output = write_length(output, matchCode - LZ_LENGTH_MASK);
+
+    return output;
+}
+
+uint32_t lz_block_compress(const void* source, const uint32_t size, void* destination) {
+    const uint8_t* input = source;
+    uint8_t* output = destination;
+    uint16_t positions[1 << LZ_HASH_BITS]; // position + 1 of the last sequence with given hash, 0 if none
+    memset(positions, 0, sizeof(positions));
+    uint32_t anchor = 0;
+    uint32_t position = 0;
+
+    while (position + LZ_MIN_MATCH <= size) {
+        const uint32_t hash = hash_sequence(input + position);
+        const uint32_t candidate = positions[hash];
+        positions[hash] = (uint16_t)(position + 1);
+        if (candidate == 0 || memcmp(input + candidate - 1, input + position, LZ_MIN_MATCH) != 0) {
+            position++;
+            continue;
+        }
+
+        const uint32_t matchStart = candidate - 1;
+        uint32_t length = LZ_MIN_MATCH;
+        while (position + length < size && input[matchStart + length] == input[position + length]) {
+            length++;
+        }
+        output = write_sequence(output, input + anchor, position - anchor, position - matchStart, length);
+        position += length;
+        anchor = position;
+    }
+    if (anchor < size) output = write_sequence(output, input + anchor, size - anchor, 0, 0);
+
+    return (uint32_t)(output - (uint8_t*)destination);
+}
+
+static uint8_t read_length(const uint8_t** input, const uint8_t* inputEnd, uint32_t* length) {
+    uint8_t byte;
+    do {
+        if (*input >= inputEnd) return EXIT_FAILURE;
+        byte = *(*input)++;
+        *length += byte;
+    } while (byte == 255);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t lz_block_decompress(const void* source, const uint32_t size, void* destination, const uint32_t originalSize) {
+    const uint8_t* input = source;
+    const uint8_t* inputEnd = input + size;
+    uint8_t* output = destination;
+    uint8_t* outputStart = output;
+    uint8_t* outputEnd = output + originalSize;
+
+    while (output < outputEnd) {
+        if (input >= inputEnd) return EXIT_FAILURE;
+        const uint8_t token = *input++;
+
+        uint32_t literalLength = token >> 4;
+        if (literalLength == LZ_LENGTH_MASK && read_length(&input, inputEnd, &literalLength) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        if (literalLength > (uint64_t)(inputEnd - input) || literalLength > (uint64_t)(outputEnd - output)) {
+            return EXIT_FAILURE;
+        }
+        memcpy(output, input, literalLength);
+        input += literalLength;
+        output += literalLength;
+        if (output == outputEnd) break;
+
+        if (inputEnd - input < 2) return EXIT_FAILURE;
+        const uint32_t offset = (uint32_t)input[0] | (uint32_t)input[1] << 8;
+        input += 2;
+        uint32_t matchLength = token & LZ_LENGTH_MASK;
+        if (matchLength == LZ_LENGTH_MASK && read_length(&input, inputEnd, &matchLength) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        matchLength += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (uint64_t)(output - outputStart) ||
+            matchLength > (uint64_t)(outputEnd - output)) return EXIT_FAILURE;
+
+        // Match may overlap bytes it writes, which repeats them
+        const uint8_t* match = output - offset;
+        if (offset >= matchLength) {
+            memcpy(output, match, matchLength);
+        } else {
+            for (uint32_t i = 0; i < matchLength; i++) {
+                output[i] = match[i];
+            }
+        }
+        output += matchLength;
+    }
+
+    return input == inputEnd ? EXIT_SUCCESS : EXIT_FAILURE;
+}
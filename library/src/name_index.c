@@ -0,0 +1,200 @@
+/**
+    * @file: name_index.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the name index.
+*/
+
+#include "../include/name_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "../include/epoch.h"
+
+#define NAME_INDEX_MIN_CAPACITY 64
+#define NAME_FILTER_RATIO 8 // counters of filter per bucket, about 3% false positives when table is full
+#define NAME_FILTER_HASHES 3
+#define NAME_FILTER_SATURATED UINT8_MAX
+
+/**
+    * Frees filter retired by rehash_name_index(), filters
+    * don't come from allocator of context.
+*/
+static void free_name_filter(struct SlabAllocator* allocator, void* pointer, const size_t size) {
+    (void)allocator;
+    (void)size;
+    free(pointer);
+}
+
+/**
+    * Gets counter of filter for i-th derived hash, derived
+    * hashes step through filter by an odd amount.
+*/
+static uint32_t get_filter_counter(const uint32_t hash, const uint32_t i, const uint32_t mask) {
+    const uint32_t step = (hash >> 17 | hash << 15) | 1;
+    return (hash + i * step) & mask;
+}
+
+/**
+    * Adds hash to filter. The caller holds write lock of
+    * index, readers only load counters.
+*/
+static void add_to_filter(struct NameFilter* filter, const uint32_t hash) {
+    for (uint32_t i = 0; i < NAME_FILTER_HASHES; i++) {
+        _Atomic uint8_t* counter = &filter->counters[get_filter_counter(hash, i, filter->capacity - 1)];
+        const uint8_t value = atomic_load_explicit(counter, memory_order_relaxed);
+        if (value != NAME_FILTER_SATURATED) atomic_store_explicit(counter, value + 1, memory_order_relaxed);
+    }
+}
+
+/**
+    * Removes hash from filter. Saturated counters don't know
+    * their real value, so they stay until filter is rebuilt.
+*/
+static void remove_from_filter(struct NameFilter* filter, const uint32_t hash) {
+    for (uint32_t i = 0; i < NAME_FILTER_HASHES; i++) {
+        _Atomic uint8_t* counter = &filter->counters[get_filter_counter(hash, i, filter->capacity - 1)];
+        const uint8_t value = atomic_load_explicit(counter, memory_order_relaxed);
+        if (value != NAME_FILTER_SATURATED) atomic_store_explicit(counter, value - 1, memory_order_relaxed);
+    }
+}
+
+static void link_to_bucket(struct FileNode** bucket, struct FileNode* node) {
+    node->namePrev = NULL;
+    node->nameNext = *bucket;
+    if (*bucket != NULL) (*bucket)->namePrev = node;
+    *bucket = node;
+}
+
+/**
+    * Moves nodes to buckets of given capacity and rebuilds
+    * filter for them. Readers may still check the old filter,
+    * so it is retired instead of freed.
+*/
+static uint8_t rehash_name_index(struct NameIndex* index, const uint32_t capacity) {
+    struct FileNode** buckets = calloc(capacity, sizeof(struct FileNode*));
+    struct NameFilter* filter = calloc(1, sizeof(struct NameFilter) + capacity * NAME_FILTER_RATIO);
+    if (buckets == NULL || filter == NULL) {
+        free(buckets);
+        free(filter);
+        return EXIT_FAILURE;
+    }
+    filter->capacity = capacity * NAME_FILTER_RATIO;
+
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        struct FileNode* node = index->buckets[i];
+        while (node != NULL) {
+            struct FileNode* next = node->nameNext;
+            link_to_bucket(&buckets[node->info.metadata.nameHash & (capacity - 1)], node);
+            add_to_filter(filter, node->info.metadata.nameHash);
+            node = next;
+        }
+    }
+
+    struct NameFilter* oldFilter = atomic_load_explicit(&index->filter, memory_order_relaxed);
+    atomic_store_explicit(&index->filter, filter, memory_order_release);
+    if (oldFilter != NULL) epoch_retire(free_name_filter, NULL, oldFilter, 0);
+    free(index->buckets);
+    index->buckets = buckets;
+    index->capacity = capacity;
+
+    return EXIT_SUCCESS;
+}
+
+void init_name_index(struct NameIndex* index) {
+    memset(index, 0, sizeof(struct NameIndex));
+    atomic_init(&index->filter, NULL);
+    atomic_init(&index->lookups, 0);
+    atomic_init(&index->filterRejects, 0);
+}
+
+uint8_t name_index_insert(struct NameIndex* index, struct FileNode* node) {
+    if (index == NULL || node == NULL) return EXIT_FAILURE;
+
+    acquire_write_lock(&index->lock);
+    if (index->capacity == 0) {
+        if (rehash_name_index(index, NAME_INDEX_MIN_CAPACITY) != EXIT_SUCCESS) {
+            release_write_lock(&index->lock);
+            return EXIT_FAILURE;
+        }
+    } else if (index->count >= index->capacity && index->capacity <= UINT32_MAX / (2 * NAME_FILTER_RATIO)) {
+        rehash_name_index(index, index->capacity * 2);
+    }
+
+    // Filter learns the name first, so a reader which finds it missing can't miss the node
+    const uint32_t hash = node->info.metadata.nameHash;
+    add_to_filter(atomic_load_explicit(&index->filter, memory_order_relaxed), hash);
+    link_to_bucket(&index->buckets[hash & (index->capacity - 1)], node);
+    index->count++;
+    release_write_lock(&index->lock);
+
+    return EXIT_SUCCESS;
+}
+
+void name_index_remove(struct NameIndex* index, struct FileNode* node) {
+    if (index == NULL || node == NULL) return;
+
+    acquire_write_lock(&index->lock);
+    const uint32_t hash = node->info.metadata.nameHash;
+    if (node->namePrev != NULL) {
+        node->namePrev->nameNext = node->nameNext;
+    } else {
+        index->buckets[hash & (index->capacity - 1)] = node->nameNext;
+    }
+    if (node->nameNext != NULL) node->nameNext->namePrev = node->namePrev;
+    node->nameNext = NULL;
+    node->namePrev = NULL;
+
+    remove_from_filter(atomic_load_explicit(&index->filter, memory_order_relaxed), hash);
+    index->count--;
+    release_write_lock(&index->lock);
+}
+
+uint8_t name_index_may_contain(struct NameIndex* index, const uint32_t hash) {
+    atomic_fetch_add_explicit(&index->lookups, 1, memory_order_relaxed);
+
+    const struct NameFilter* filter = atomic_load_explicit(&index->filter, memory_order_acquire);
+    uint8_t result = filter != NULL;
+    for (uint32_t i = 0; result && i < NAME_FILTER_HASHES; i++) {
+        result = atomic_load_explicit(&filter->counters[get_filter_counter(hash, i, filter->capacity - 1)],
+                                      memory_order_relaxed) != 0;
+    }
+    if (!result) atomic_fetch_add_explicit(&index->filterRejects, 1, memory_order_relaxed);
+
+    return result;
+}
+
+struct FileNode* name_index_find(const struct NameIndex* index, const char* name, const uint32_t hash,
+                                 const uint32_t length, const struct FileNode* previous) {
+    if (index == NULL || name == NULL || index->capacity == 0) return NULL;
+
+    // Names of indexed nodes can't change while the lock is held
+    struct FileNode* node = previous != NULL ? previous->nameNext : index->buckets[hash & (index->capacity - 1)];
+    while (node != NULL && (node->info.metadata.nameHash != hash || node->info.metadata.nameLength != length ||
+                            memcmp(node->info.metadata.name, name, length) != 0)) {
+        node = node->nameNext;
+    }
+
+    return node;
+}
+
+void get_name_index_stats(struct NameIndex* index, struct NameIndexStats* stats) {
+    if (stats == NULL) return;
+
+    acquire_read_lock(&index->lock);
+    stats->nodes = index->count;
+    stats->capacity = index->capacity;
+    release_read_lock(&index->lock);
+    stats->lookups = atomic_load_explicit(&index->lookups, memory_order_relaxed);
+    stats->filterRejects = atomic_load_explicit(&index->filterRejects, memory_order_relaxed);
+}
+
+void free_name_index(struct NameIndex* index) {
+    free(atomic_load_explicit(&index->filter, memory_order_relaxed));
+    free(index->buckets);
+    index->buckets = NULL;
+    atomic_store_explicit(&index->filter, NULL, memory_order_relaxed);
+    index->capacity = 0;
+    index->count = 0;
+}
@@ -0,0 +1,560 @@
+/**
+    * @file: query_index.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the query index.
+*/
+
+#include "../include/query_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "../include/epoch.h"
+#include "../include/file_node_funcs.h"
+#include "../include/tree_walk.h"
+
+#define QUERY_BLOCK_CAPACITY 128 // entries of one block, 2 KB
+#define QUERY_BLOCKS_MIN_CAPACITY 16
+#define QUERY_LAST_NODE ((const struct FileNode*)UINTPTR_MAX) // sorts after every node with equal key
+
+/**
+ * @struct QueryEntry
+ * @brief File node under its value of indexed field. Entries
+ * with equal values are ordered by node address.
+ */
+struct QueryEntry {
+    uint64_t key;               /**< Value of field */
+    const struct FileNode* node; /**< Indexed file node */
+};
+
+/**
+ * @struct QueryBlock
+ * @brief Sorted run of entries, every entry of block sorts
+ * before every entry of the next block.
+ */
+struct QueryBlock {
+    uint32_t count;                                 /**< Amount of entries, never 0 */
+    struct QueryEntry entries[QUERY_BLOCK_CAPACITY]; /**< Entries in ascending order */
+};
+
+/**
+ * @struct KeyIndex
+ * @brief Entries of one field, kept in blocks, so an insert
+ * moves at most one block and blocks are found by binary
+ * search.
+ */
+struct KeyIndex {
+    struct QueryBlock** blocks; /**< Blocks in ascending order, NULL until first insert */
+    uint32_t blockCount;        /**< Amount of blocks */
+    uint32_t blockCapacity;     /**< Capacity of block table */
+    uint64_t count;             /**< Amount of entries */
+};
+
+/**
+ * @struct QueryIndex
+ * @brief Indexes of every indexed field of one context.
+ */
+struct QueryIndex {
+    struct KeyIndex keys[QUERY_INDEXED_FIELDS]; /**< Index of every field before QUERY_ACCESS_TIME */
+    struct RwLock lock;                         /**< Guards all indexes */
+    _Atomic uint64_t queries;                   /**< Amount of queries started */
+    _Atomic uint64_t candidates;                /**< Nodes read from indexes by queries */
+    _Atomic uint64_t droppedUpdates;            /**< Changes which couldn't be indexed */
+};
+
+/**
+ * @struct QueryPosition
+ * @brief Place of entry in index.
+ */
+struct QueryPosition {
+    uint32_t block; /**< Index of block, blockCount if entry is past the end */
+    uint32_t entry; /**< Index of entry in block */
+};
+
+/**
+ * @struct WsfsQuery
+ * @brief Open query, see wsfs_query().
+ */
+struct WsfsQuery {
+    struct WsfsContext* context;        /**< Context which nodes are queried */
+    uint64_t min[QUERY_FIELD_COUNT];    /**< The smallest matching value of every field */
+    uint64_t max[QUERY_FIELD_COUNT];    /**< The largest matching value of every field */
+    enum QueryField field;              /**< Field which index is read */
+    struct QueryEntry last;             /**< The last entry read, next batch starts after it */
+    uint8_t isStarted;                  /**< 1 once an entry was read */
+    uint8_t isFinished;                 /**< 1 once the range of index was read */
+};
+
+static int compare_entries(const struct QueryEntry* left, const struct QueryEntry* right) {
+    if (left->key != right->key) return left->key < right->key ? -1 : 1;
+    if (left->node != right->node) return (uintptr_t)left->node < (uintptr_t)right->node ? -1 : 1;
+    return 0;
+}
+
+/**
+    * Finds the first entry which doesn't sort before given
+    * one. Blocks are searched by their last entries.
+*/
+static struct QueryPosition find_position(const struct KeyIndex* keys, const struct QueryEntry* entry) {
+    uint32_t low = 0;
+    uint32_t high = keys->blockCount;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        const struct QueryBlock* block = keys->blocks[middle];
+        if (compare_entries(&block->entries[block->count - 1], entry) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    struct QueryPosition position = {low, 0};
+    if (low == keys->blockCount) return position;
+
+    const struct QueryBlock* block = keys->blocks[low];
+    high = block->count;
+    while (position.entry < high) {
+        const uint32_t middle = position.entry + (high - position.entry) / 2;
+        if (compare_entries(&block->entries[middle], entry) < 0) {
+            position.entry = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return position;
+}
+
+/**
+    * Counts entries before position, it is used to estimate
+    * how many entries a range has.
+*/
+static uint64_t get_position_rank(const struct KeyIndex* keys, const struct QueryPosition position) {
+    uint64_t rank = position.entry;
+    for (uint32_t i = 0; i < position.block; i++) {
+        rank += keys->blocks[i]->count;
+    }
+
+    return rank;
+}
+
+static uint64_t count_range(const struct KeyIndex* keys, const uint64_t min, const uint64_t max) {
+    const struct QueryEntry first = {min, NULL};
+    const struct QueryEntry last = {max, QUERY_LAST_NODE};
+
+    return get_position_rank(keys, find_position(keys, &last)) - get_position_rank(keys, find_position(keys, &first));
+}
+
+/**
+    * Adds empty block to table at given place.
+*/
+static struct QueryBlock* add_block(struct KeyIndex* keys, const uint32_t place) {
+    if (keys->blockCount == keys->blockCapacity) {
+        if (keys->blockCapacity > UINT32_MAX / 2) return NULL;
+        const uint32_t capacity = keys->blockCapacity == 0 ? QUERY_BLOCKS_MIN_CAPACITY : keys->blockCapacity * 2;
+        struct QueryBlock** blocks = realloc(keys->blocks, capacity * sizeof(struct QueryBlock*));
+        if (blocks == NULL) return NULL;
+        keys->blocks = blocks;
+        keys->blockCapacity = capacity;
+    }
+
+    struct QueryBlock* block = malloc(sizeof(struct QueryBlock));
+    if (block == NULL) return NULL;
+
+    block->count = 0;
+    memmove(&keys->blocks[place + 1], &keys->blocks[place], (keys->blockCount - place) * sizeof(struct QueryBlock*));
+    keys->blocks[place] = block;
+    keys->blockCount++;
+
+    return block;
+}
+
+static void drop_block(struct KeyIndex* keys, const uint32_t place) {
+    free(keys->blocks[place]);
+    keys->blockCount--;
+    memmove(&keys->blocks[place], &keys->blocks[place + 1], (keys->blockCount - place) * sizeof(struct QueryBlock*));
+}
+
+/**
+    * Adds entry to index, entry which is there already isn't
+    * added again. Full block is split in halves first.
+*/
+static uint8_t insert_entry(struct KeyIndex* keys, const struct QueryEntry* entry) {
+    if (keys->blockCount == 0) {
+        struct QueryBlock* first = add_block(keys, 0);
+        if (first == NULL) return EXIT_FAILURE;
+
+        first->entries[0] = *entry;
+        first->count = 1;
+        keys->count = 1;
+        return EXIT_SUCCESS;
+    }
+
+    struct QueryPosition position = find_position(keys, entry);
+    if (position.block == keys->blockCount) {
+        position.block--;
+        position.entry = keys->blocks[position.block]->count;
+    }
+    struct QueryBlock* block = keys->blocks[position.block];
+    if (position.entry < block->count && compare_entries(&block->entries[position.entry], entry) == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    if (block->count == QUERY_BLOCK_CAPACITY) {
+        struct QueryBlock* upper = add_block(keys, position.block + 1);
+        if (upper == NULL) return EXIT_FAILURE;
+
+        const uint32_t half = QUERY_BLOCK_CAPACITY / 2;
+        memcpy(upper->entries, &block->entries[half], (QUERY_BLOCK_CAPACITY - half) * sizeof(struct QueryEntry));
+        upper->count = QUERY_BLOCK_CAPACITY - half;
+        block->count = half;
+        if (position.entry > half) {
+            block = upper;
+            position.entry -= half;
+        }
+    }
+
+    memmove(&block->entries[position.entry + 1], &block->entries[position.entry],
+            (block->count - position.entry) * sizeof(struct QueryEntry));
+    block->entries[position.entry] = *entry;
+    block->count++;
+    keys->count++;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Removes entry from index if it is there. Block which
+    * gets empty is dropped, neighbours which fit into half a
+    * block together are merged.
+*/
+static void remove_entry(struct KeyIndex* keys, const struct QueryEntry* entry) {
+    const struct QueryPosition position = find_position(keys, entry);
+    if (position.block == keys->blockCount) return;
+
+    struct QueryBlock* block = keys->blocks[position.block];
+    if (compare_entries(&block->entries[position.entry], entry) != 0) return;
+
+    block->count--;
+    memmove(&block->entries[position.entry], &block->entries[position.entry + 1],
+            (block->count - position.entry) * sizeof(struct QueryEntry));
+    keys->count--;
+
+    if (block->count == 0) {
+        drop_block(keys, position.block);
+        return;
+    }
+    for (uint32_t first = position.block > 0 ? position.block - 1 : 0; first <= position.block; first++) {
+        if (first + 1 >= keys->blockCount) break;
+
+        struct QueryBlock* lower = keys->blocks[first];
+        const struct QueryBlock* upper = keys->blocks[first + 1];
+        if (lower->count + upper->count <= QUERY_BLOCK_CAPACITY / 2) {
+            memcpy(&lower->entries[lower->count], upper->entries, upper->count * sizeof(struct QueryEntry));
+            lower->count += upper->count;
+            drop_block(keys, first + 1);
+            break;
+        }
+    }
+}
+
+static void free_key_index(struct KeyIndex* keys) {
+    for (uint32_t i = 0; i < keys->blockCount; i++) {
+        free(keys->blocks[i]);
+    }
+    free(keys->blocks);
+    memset(keys, 0, sizeof(struct KeyIndex));
+}
+
+/**
+    * Reads value of indexed field. The caller makes sure
+    * field doesn't change meanwhile.
+*/
+static uint64_t get_field_key(const struct FileNode* node, const enum QueryField field) {
+    switch (field) {
+        case QUERY_TYPE:                return node->info.properties.type;
+        case QUERY_SIZE:                return node->info.data.contentSize;
+        case QUERY_CREATION_TIME:       return node->info.metadata.creationTime;
+        case QUERY_MODIFICATION_TIME:
+            return atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed);
+        default:                        return 0;
+    }
+}
+
+static uint8_t is_field_indexed(const struct FileNode* node, const enum QueryField field) {
+    return field != QUERY_SIZE || node->info.properties.type == FILE_TYPE_FILE;
+}
+
+uint8_t query_index_insert(struct QueryIndex* index, const struct FileNode* node) {
+    if (index == NULL || node->info.properties.isReadOnly) return EXIT_SUCCESS;
+
+    uint8_t result = EXIT_SUCCESS;
+    acquire_write_lock(&index->lock);
+    enum QueryField field = QUERY_TYPE;
+    for (; field < QUERY_INDEXED_FIELDS && result == EXIT_SUCCESS; field++) {
+        const struct QueryEntry entry = {get_field_key(node, field), node};
+        if (is_field_indexed(node, field)) result = insert_entry(&index->keys[field], &entry);
+    }
+    // Node is either in every index or in none
+    while (result != EXIT_SUCCESS && field-- > 0) {
+        const struct QueryEntry entry = {get_field_key(node, field), node};
+        remove_entry(&index->keys[field], &entry);
+    }
+    release_write_lock(&index->lock);
+
+    return result;
+}
+
+void query_index_remove(struct QueryIndex* index, const struct FileNode* node) {
+    if (index == NULL || node->info.properties.isReadOnly) return;
+
+    acquire_write_lock(&index->lock);
+    for (enum QueryField field = QUERY_TYPE; field < QUERY_INDEXED_FIELDS; field++) {
+        const struct QueryEntry entry = {get_field_key(node, field), node};
+        if (is_field_indexed(node, field)) remove_entry(&index->keys[field], &entry);
+    }
+    release_write_lock(&index->lock);
+}
+
+void query_index_rekey(struct QueryIndex* index, const struct FileNode* node, const enum QueryField field,
+                       const uint64_t oldValue) {
+    if (index == NULL || node->info.properties.isReadOnly || field >= QUERY_INDEXED_FIELDS ||
+        !is_field_indexed(node, field)) return;
+
+    const struct QueryEntry oldEntry = {oldValue, node};
+    const struct QueryEntry newEntry = {get_field_key(node, field), node};
+    acquire_write_lock(&index->lock);
+    remove_entry(&index->keys[field], &oldEntry);
+    if (insert_entry(&index->keys[field], &newEntry) != EXIT_SUCCESS) {
+        atomic_fetch_add_explicit(&index->droppedUpdates, 1, memory_order_relaxed);
+    }
+    release_write_lock(&index->lock);
+}
+
+void clear_query_index(struct QueryIndex* index) {
+    if (index == NULL) return;
+
+    for (uint32_t i = 0; i < QUERY_INDEXED_FIELDS; i++) {
+        free_key_index(&index->keys[i]);
+    }
+}
+
+/**
+ * @struct IndexBuild
+ * @brief State of wsfs_enable_queries_ctx() walk.
+ */
+struct IndexBuild {
+    struct QueryIndex* index;   /**< Index which is built */
+    uint8_t isFailed;           /**< 1 once a node couldn't be added */
+};
+
+static enum WalkAction index_walked_node(struct FileNode* node, void* argument) {
+    struct IndexBuild* build = argument;
+    if (query_index_insert(build->index, node) != EXIT_SUCCESS) {
+        build->isFailed = 1;
+        return WALK_STOP;
+    }
+
+    return WALK_CONTINUE;
+}
+
+uint8_t wsfs_enable_queries_ctx(struct WsfsContext* context) {
+    if (context == NULL || context->queryIndex != NULL) return EXIT_FAILURE;
+
+    struct QueryIndex* index = calloc(1, sizeof(struct QueryIndex));
+    if (index == NULL) return EXIT_FAILURE;
+    atomic_init(&index->lock.state, 0);
+    atomic_init(&index->queries, 0);
+    atomic_init(&index->candidates, 0);
+    atomic_init(&index->droppedUpdates, 0);
+
+    // Rename lock stops every change of tree, so it is read without directory locks
+    struct IndexBuild build = {index, 0};
+    acquire_write_lock(&context->renameLock);
+    if (context->root != NULL &&
+        walk_file_node_tree(context->root, WALK_PRE_ORDER, 0, index_walked_node, &build) != EXIT_SUCCESS) {
+        build.isFailed = 1;
+    }
+    if (!build.isFailed) context->queryIndex = index;
+    release_write_lock(&context->renameLock);
+
+    if (build.isFailed) {
+        clear_query_index(index);
+        free(index);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_enable_queries(void) {
+    return wsfs_enable_queries_ctx(get_default_context());
+}
+
+void wsfs_disable_queries_ctx(struct WsfsContext* context) {
+    if (context == NULL || context->queryIndex == NULL) return;
+
+    clear_query_index(context->queryIndex);
+    free(context->queryIndex);
+    context->queryIndex = NULL;
+}
+
+void wsfs_disable_queries(void) {
+    wsfs_disable_queries_ctx(get_default_context());
+}
+
+struct WsfsQuery* wsfs_query_ctx(struct WsfsContext* context, const struct QueryPredicate* predicates,
+                                 const uint32_t count) {
+    if (context == NULL || context->queryIndex == NULL || (predicates == NULL && count > 0)) return NULL;
+
+    struct WsfsQuery* query = calloc(1, sizeof(struct WsfsQuery));
+    if (query == NULL) return NULL;
+
+    query->context = context;
+    for (uint32_t i = 0; i < QUERY_FIELD_COUNT; i++) {
+        query->max[i] = UINT64_MAX;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const enum QueryField field = predicates[i].field;
+        if (field >= QUERY_FIELD_COUNT) {
+            free(query);
+            return NULL;
+        }
+        if (predicates[i].min > query->min[field]) query->min[field] = predicates[i].min;
+        if (predicates[i].max < query->max[field]) query->max[field] = predicates[i].max;
+    }
+
+    // Type index holds every node, the narrowest indexed range is read instead if there is one
+    struct QueryIndex* index = context->queryIndex;
+    acquire_read_lock(&index->lock);
+    uint64_t fewest = UINT64_MAX;
+    for (enum QueryField field = QUERY_TYPE; field < QUERY_INDEXED_FIELDS; field++) {
+        const uint8_t isLimited = query->min[field] > 0 || query->max[field] < UINT64_MAX || field == QUERY_TYPE;
+        if (!isLimited || query->min[field] > query->max[field]) continue;
+
+        const uint64_t rangeCount = count_range(&index->keys[field], query->min[field], query->max[field]);
+        if (rangeCount < fewest) {
+            fewest = rangeCount;
+            query->field = field;
+        }
+    }
+    release_read_lock(&index->lock);
+    for (uint32_t i = 0; i < QUERY_FIELD_COUNT; i++) {
+        query->isFinished |= query->min[i] > query->max[i];
+    }
+    atomic_fetch_add_explicit(&index->queries, 1, memory_order_relaxed);
+
+    return query;
+}
+
+struct WsfsQuery* wsfs_query(const struct QueryPredicate* predicates, const uint32_t count) {
+    return wsfs_query_ctx(get_default_context(), predicates, count);
+}
+
+/**
+    * Reads entries of queried range after the last one read.
+    * The caller holds lock of index.
+*/
+static uint32_t take_candidates(struct WsfsQuery* query, const struct KeyIndex* keys, struct FileNode** nodes,
+                                const uint32_t capacity) {
+    const struct QueryEntry first = {query->min[query->field], NULL};
+    struct QueryPosition position = find_position(keys, query->isStarted ? &query->last : &first);
+    if (query->isStarted && position.block < keys->blockCount &&
+        compare_entries(&keys->blocks[position.block]->entries[position.entry], &query->last) == 0) {
+        position.entry++;
+    }
+
+    uint32_t count = 0;
+    while (count < capacity) {
+        if (position.block < keys->blockCount && position.entry == keys->blocks[position.block]->count) {
+            position.block++;
+            position.entry = 0;
+        }
+        if (position.block == keys->blockCount) {
+            query->isFinished = 1;
+            break;
+        }
+
+        const struct QueryEntry* entry = &keys->blocks[position.block]->entries[position.entry++];
+        if (entry->key > query->max[query->field]) {
+            query->isFinished = 1;
+            break;
+        }
+        // Index only hands out nodes, writes go through functions of file_node_funcs.h
+        nodes[count++] = (struct FileNode*)entry->node;
+        query->last = *entry;
+        query->isStarted = 1;
+    }
+
+    return count;
+}
+
+static uint8_t is_query_matched(const struct WsfsQuery* query, const struct FileNode* node) {
+    struct WsfsStat stat;
+    wsfs_stat(node, &stat);
+    // Files are matched by their real length, wsfs_stat() hides it without READ permission
+    if (stat.type == FILE_TYPE_FILE) {
+        struct RwLock* lock = (struct RwLock*)&node->lock;
+        acquire_read_lock(lock);
+        stat.contentSize = node->info.data.contentSize;
+        release_read_lock(lock);
+    }
+    const uint64_t values[QUERY_FIELD_COUNT] = {stat.type, stat.contentSize, stat.times.creationTime,
+                                                stat.times.modificationTime, stat.times.accessTime};
+    if (stat.type != FILE_TYPE_FILE && (query->min[QUERY_SIZE] > 0 || query->max[QUERY_SIZE] < UINT64_MAX)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < QUERY_FIELD_COUNT; i++) {
+        if (values[i] < query->min[i] || values[i] > query->max[i]) return 0;
+    }
+
+    return 1;
+}
+
+uint32_t wsfs_query_next(struct WsfsQuery* query, struct FileNode** nodes, const uint32_t capacity) {
+    if (query == NULL || nodes == NULL || capacity == 0 || query->isFinished ||
+        wsfs_epoch_enter() != EXIT_SUCCESS) return 0;
+
+    // Candidates are checked outside the index lock, epoch keeps deleted ones readable until then
+    struct QueryIndex* index = query->context->queryIndex;
+    uint32_t count = 0;
+    while (count < capacity && !query->isFinished) {
+        acquire_read_lock(&index->lock);
+        const uint32_t taken = take_candidates(query, &index->keys[query->field], nodes + count, capacity - count);
+        release_read_lock(&index->lock);
+        atomic_fetch_add_explicit(&index->candidates, taken, memory_order_relaxed);
+
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < taken; i++) {
+            if (is_query_matched(query, nodes[count + i])) nodes[count + kept++] = nodes[count + i];
+        }
+        count += kept;
+    }
+    wsfs_epoch_exit();
+
+    return count;
+}
+
+void wsfs_query_close(struct WsfsQuery* query) {
+    free(query);
+}
+
+void get_query_index_stats_ctx(struct WsfsContext* context, struct QueryIndexStats* stats) {
+    if (stats == NULL) return;
+
+    memset(stats, 0, sizeof(struct QueryIndexStats));
+    struct QueryIndex* index = context->queryIndex;
+    if (index == NULL) return;
+
+    acquire_read_lock(&index->lock);
+    stats->nodes = index->keys[QUERY_TYPE].count;
+    stats->files = index->keys[QUERY_SIZE].count;
+    release_read_lock(&index->lock);
+    stats->queries = atomic_load_explicit(&index->queries, memory_order_relaxed);
+    stats->candidates = atomic_load_explicit(&index->candidates, memory_order_relaxed);
+    stats->droppedUpdates = atomic_load_explicit(&index->droppedUpdates, memory_order_relaxed);
+}
+
+void get_query_index_stats(struct QueryIndexStats* stats) {
+    get_query_index_stats_ctx(get_default_context(), stats);
+}
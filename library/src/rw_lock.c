@@ -0,0 +1,65 @@
+/**
+    * @file: rw_lock.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to reader/writer locks.
+*/
+
+#include "../include/rw_lock.h"
+
+#include <sched.h>
+
+#define WRITER_BIT 0x80000000u
+#define WRITER_WAITING_BIT 0x40000000u
+#define READER_MASK 0x3FFFFFFFu
+#define SPINS_BEFORE_YIELD 64
+
+static void wait_a_little(uint32_t* spins) {
+    if (++*spins < SPINS_BEFORE_YIELD) return;
+
+    *spins = 0;
+    sched_yield();
+}
+
+void acquire_read_lock(struct RwLock* lock) {
+    uint32_t spins = 0;
+    uint32_t state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+
+    for (;;) {
+        if (state & (WRITER_BIT | WRITER_WAITING_BIT)) {
+            wait_a_little(&spins);
+            state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&lock->state, &state, state + 1,
+                                                  memory_order_acquire, memory_order_relaxed)) return;
+    }
+}
+
+void release_read_lock(struct RwLock* lock) {
+    atomic_fetch_sub_explicit(&lock->state, 1, memory_order_release);
+}
+
+void acquire_write_lock(struct RwLock* lock) {
+    uint32_t spins = 0;
+    uint32_t state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+
+    for (;;) {
+        if (state & (WRITER_BIT | READER_MASK)) {
+            if (!(state & WRITER_WAITING_BIT)) {
+                atomic_fetch_or_explicit(&lock->state, WRITER_WAITING_BIT, memory_order_relaxed);
+            }
+            wait_a_little(&spins);
+            state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+            continue;
+        }
+        // Waiting bit is cleared on success, other waiting writers set it again
+        if (atomic_compare_exchange_weak_explicit(&lock->state, &state, WRITER_BIT,
+                                                  memory_order_acquire, memory_order_relaxed)) return;
+    }
+}
+
+void release_write_lock(struct RwLock* lock) {
+    atomic_fetch_and_explicit(&lock->state, ~WRITER_BIT, memory_order_release);
+}
@@ -0,0 +1,261 @@
+/**
+    * @file: slab_allocator.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the slab allocator.
+*/
+
+#include "../include/slab_allocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SLAB_HEADER_SIZE 64 // multiple of CACHE_LINE_SIZE
+#define LARGE_HEADER_SIZE 32
+
+/**
+ * @struct Slab
+ * @brief Header placed at the start of every slab.
+ */
+struct Slab {
+    struct Slab* next;      /**< Next slab in class list */
+    struct Slab* prev;      /**< Previous slab in class list */
+    void* freeList;         /**< Freed objects, linked through their first bytes */
+    uint32_t used;          /**< Amount of allocated objects */
+    uint32_t carved;        /**< Amount of objects that were ever handed out */
+};
+
+/**
+ * @struct LargeBlock
+ * @brief Header placed before every block too big for slabs.
+ */
+struct LargeBlock {
+    struct LargeBlock* next;    /**< Next large block */
+    struct LargeBlock* prev;    /**< Previous large block */
+    size_t size;                /**< Size of block without header */
+};
+
+static const uint32_t genericClassSizes[SLAB_CLASS_COUNT - 1] = {16, 32, 64, 128, 256};
+
+static void push_slab(struct Slab** list, struct Slab* slab) {
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list != NULL) (*list)->prev = slab;
+    *list = slab;
+}
+
+static void remove_slab(struct Slab** list, struct Slab* slab) {
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next != NULL) slab->next->prev = slab->prev;
+}
+
+static struct SlabClass* get_slab_class(struct SlabAllocator* allocator, const size_t size) {
+    struct SlabClass* best = NULL;
+    for (uint32_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        struct SlabClass* class = &allocator->classes[i];
+        if (class->objectSize >= size && (best == NULL || class->objectSize < best->objectSize)) {
+            best = class;
+        }
+    }
+    return best;
+}
+
+static void* alloc_large_block(struct SlabAllocator* allocator, const size_t size) {
+    struct LargeBlock* block = malloc(LARGE_HEADER_SIZE + size);
+    if (block == NULL) return NULL;
+
+    block->size = size;
+    block->prev = NULL;
+    block->next = allocator->largeBlocks;
+    if (allocator->largeBlocks != NULL) allocator->largeBlocks->prev = block;
+    allocator->largeBlocks = block;
+    allocator->largeCount++;
+    allocator->largeBytes += size;
+
+    return (char*)block + LARGE_HEADER_SIZE;
+}
+
+static void free_large_block(struct SlabAllocator* allocator, void* pointer) {
+    struct LargeBlock* block = (struct LargeBlock*)((char*)pointer - LARGE_HEADER_SIZE);
+
+    if (block->prev != NULL) {
+        block->prev->next = block->next;
+    } else {
+        allocator->largeBlocks = block->next;
+    }
+    if (block->next != NULL) block->next->prev = block->prev;
+
+    allocator->largeCount--;
+    allocator->largeBytes -= block->size;
+    free(block);
+}
+
+void init_slab_allocator(struct SlabAllocator* allocator, const enum AllocatorMode mode) {
+    memset(allocator, 0, sizeof(struct SlabAllocator));
+    allocator->mode = mode;
+
+    // File nodes are cache line aligned, so node's hot fields never straddle two lines
+    allocator->classes[0].objectSize = (sizeof(struct FileNode) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    for (uint32_t i = 1; i < SLAB_CLASS_COUNT; i++) {
+        allocator->classes[i].objectSize = genericClassSizes[i - 1];
+    }
+    for (uint32_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        allocator->classes[i].objectsPerSlab = (SLAB_SIZE - SLAB_HEADER_SIZE) / allocator->classes[i].objectSize;
+    }
+}
+
+static void* alloc_object(struct SlabAllocator* allocator, size_t size) {
+#ifdef WSFS_FAULT_INJECTION
+    if (allocator->failingAllocations > 0) {
+        allocator->failingAllocations--;
+        return NULL;
+    }
+#endif
+    if (size == 0) size = 1;
+
+    struct SlabClass* class = get_slab_class(allocator, size);
+    if (class == NULL) return alloc_large_block(allocator, size);
+
+    struct Slab* slab = class->partial;
+    if (slab == NULL) {
+        slab = aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+        if (slab == NULL) return NULL;
+        slab->freeList = NULL;
+        slab->used = 0;
+        slab->carved = 0;
+        push_slab(&class->partial, slab);
+        class->slabCount++;
+    }
+
+    void* object;
+    if (slab->freeList != NULL) {
+        object = slab->freeList;
+        slab->freeList = *(void**)object;
+    } else {
+        object = (char*)slab + SLAB_HEADER_SIZE + (size_t)slab->carved * class->objectSize;
+        slab->carved++;
+    }
+
+    slab->used++;
+    class->objectsUsed++;
+    if (slab->used == class->objectsPerSlab) {
+        remove_slab(&class->partial, slab);
+        push_slab(&class->full, slab);
+    }
+
+    return object;
+}
+
+void* slab_alloc(struct SlabAllocator* allocator, const size_t size) {
+    acquire_write_lock(&allocator->lock);
+    void* object = alloc_object(allocator, size);
+    release_write_lock(&allocator->lock);
+
+    return object;
+}
+
+void* slab_calloc(struct SlabAllocator* allocator, const size_t size) {
+    void* pointer = slab_alloc(allocator, size);
+    if (pointer != NULL) memset(pointer, 0, size);
+    return pointer;
+}
+
+char* slab_strdup(struct SlabAllocator* allocator, const char* string) {
+    const size_t size = strlen(string) + 1;
+    char* copy = slab_alloc(allocator, size);
+    if (copy != NULL) memcpy(copy, string, size);
+    return copy;
+}
+
+static void free_object(struct SlabAllocator* allocator, void* pointer, size_t size) {
+    if (size == 0) size = 1;
+
+    struct SlabClass* class = get_slab_class(allocator, size);
+    if (class == NULL) {
+        free_large_block(allocator, pointer);
+        return;
+    }
+
+    struct Slab* slab = (struct Slab*)((uintptr_t)pointer & ~(uintptr_t)(SLAB_SIZE - 1));
+    if (slab->used == class->objectsPerSlab) {
+        remove_slab(&class->full, slab);
+        push_slab(&class->partial, slab);
+    }
+
+    *(void**)pointer = slab->freeList;
+    slab->freeList = pointer;
+    slab->used--;
+    class->objectsUsed--;
+
+    // Keep one empty slab per class, so alloc/free on boundary doesn't hit the system
+    if (slab->used == 0 && (slab->prev != NULL || slab->next != NULL)) {
+        remove_slab(&class->partial, slab);
+        class->slabCount--;
+        free(slab);
+    }
+}
+
+void slab_free(struct SlabAllocator* allocator, void* pointer, const size_t size) {
+    if (pointer == NULL) return;
+
+    acquire_write_lock(&allocator->lock);
+    free_object(allocator, pointer, size);
+    release_write_lock(&allocator->lock);
+}
+
+void release_slab_allocator(struct SlabAllocator* allocator) {
+    acquire_write_lock(&allocator->lock);
+    for (uint32_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        struct SlabClass* class = &allocator->classes[i];
+        struct Slab* lists[2] = {class->partial, class->full};
+        for (uint32_t list = 0; list < 2; list++) {
+            struct Slab* slab = lists[list];
+            while (slab != NULL) {
+                struct Slab* next = slab->next;
+                free(slab);
+                slab = next;
+            }
+        }
+        class->partial = NULL;
+        class->full = NULL;
+        class->slabCount = 0;
+        class->objectsUsed = 0;
+    }
+
+    struct LargeBlock* block = allocator->largeBlocks;
+    while (block != NULL) {
+        struct LargeBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    allocator->largeBlocks = NULL;
+    allocator->largeCount = 0;
+    allocator->largeBytes = 0;
+    release_write_lock(&allocator->lock);
+}
+
+void get_slab_allocator_stats(struct SlabAllocator* allocator, struct AllocatorStats* stats) {
+    memset(stats, 0, sizeof(struct AllocatorStats));
+    acquire_read_lock(&allocator->lock);
+
+    for (uint32_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        const struct SlabClass* class = &allocator->classes[i];
+        stats->classes[i].objectSize = class->objectSize;
+        stats->classes[i].slabs = class->slabCount;
+        stats->classes[i].objectsTotal = class->slabCount * class->objectsPerSlab;
+        stats->classes[i].objectsUsed = class->objectsUsed;
+        stats->reservedBytes += class->slabCount * SLAB_SIZE;
+        stats->usedBytes += class->objectsUsed * class->objectSize;
+    }
+
+    stats->largeBlocks = allocator->largeCount;
+    stats->largeBytes = allocator->largeBytes;
+    stats->reservedBytes += allocator->largeBytes + allocator->largeCount * LARGE_HEADER_SIZE;
+    stats->usedBytes += allocator->largeBytes;
+    release_read_lock(&allocator->lock);
+}
@@ -0,0 +1,653 @@
+/**
+    * @file: snapshot.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions which save
+    * file system into a binary snapshot and load it back.
+*/
+
+#include "../include/snapshot.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/file_content.h"
+#include "../include/image.h"
+#include "../include/wsfs.h"
+#include "../include/wsfs_macros.h"
+
+#define NO_NODE UINT32_MAX
+#define IMAGE_ALIGNMENT 8
+
+/**
+ * @struct SnapshotHeader
+ * @brief First bytes of snapshot, sizes of every section.
+ */
+struct SnapshotHeader {
+    uint32_t magic;             /**< SNAPSHOT_MAGIC */
+    uint32_t version;           /**< SNAPSHOT_VERSION */
+    uint64_t nodeCount;         /**< Amount of entries in node table */
+    uint64_t stringTableSize;   /**< Size of string table in bytes */
+    uint64_t contentSize;       /**< Size of content section in bytes */
+    uint64_t memoryLimit;       /**< Memory limit of saved file system */
+    uint64_t fileCountLimit;    /**< File count limit of saved file system */
+};
+
+/**
+ * @struct SnapshotNode
+ * @brief Entry of node table. Content of regular files follows
+ * in content section in the same order as their entries.
+ */
+struct SnapshotNode {
+    uint64_t contentSize;       /**< Length of content (if regular file) */
+    uint64_t creationTime;      /**< Time of creation, see FileTimes */
+    uint64_t modificationTime;  /**< Time of the last change */
+    uint64_t accessTime;        /**< Time of the last read or write */
+    uint32_t parent;            /**< Index of parent entry, the root is its own parent */
+    uint32_t nameOffset;        /**< Offset of name in string table */
+    uint32_t symlinkTarget;     /**< Index of target entry (if symlink), NO_NODE if target isn't saved */
+    uint8_t type;               /**< Type of file node(FILE_TYPE_*) */
+    uint8_t permissions;        /**< Permissions of file node(PERM_*) */
+    uint8_t reserved[2];        /**< Zero, keeps entry 48 bytes long */
+};
+
+/**
+ * @struct SnapshotStream
+ * @brief Buffered file descriptor, used for writing and reading.
+ */
+struct SnapshotStream {
+    int fd;             /**< File descriptor */
+    char* buffer;       /**< SNAPSHOT_BUFFER_SIZE bytes */
+    size_t position;    /**< Written bytes, or consumed bytes while reading */
+    size_t size;        /**< Bytes available while reading */
+    uint8_t isFailed;   /**< 1 once a write or read failed */
+};
+
+/**
+ * @struct NodeMap
+ * @brief Open addressing map from file node to its entry index,
+ * symbolic link targets are looked up in it.
+ */
+struct NodeMap {
+    const struct FileNode** nodes;  /**< Keys, NULL if slot is empty */
+    uint32_t* indexes;              /**< Entry indexes */
+    uint32_t mask;                  /**< Capacity - 1, capacity is a power of two */
+};
+
+/**
+ * @struct SavedTree
+ * @brief Nodes of tree in breadth first order with sizes of sections.
+ */
+struct SavedTree {
+    const struct FileNode** nodes;  /**< Nodes, the root is the first one */
+    uint64_t* contentSizes;         /**< Length of content of every node */
+    uint32_t count;                 /**< Amount of nodes */
+    struct NodeMap map;             /**< Index of every node */
+    uint64_t stringSize;            /**< Length of all names with terminators */
+    uint64_t contentSize;           /**< Length of all content */
+    uint8_t isFrozen;               /**< 1 if no lock is taken, see save_frozen_snapshot() */
+};
+
+/**
+ * @struct LookupKey
+ * @brief Child in lookup table of image, children of every
+ * directory are sorted by hash.
+ */
+struct LookupKey {
+    uint32_t hash;  /**< Hash of name */
+    uint32_t index; /**< Index of child */
+};
+
+static uint8_t init_stream(struct SnapshotStream* stream, const int fd) {
+    stream->fd = fd;
+    stream->buffer = malloc(SNAPSHOT_BUFFER_SIZE);
+    stream->position = 0;
+    stream->size = 0;
+    stream->isFailed = stream->buffer == NULL;
+
+    return stream->isFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void write_all(struct SnapshotStream* stream, const char* data, size_t size) {
+    while (size > 0 && !stream->isFailed) {
+        const ssize_t written = write(stream->fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            stream->isFailed = 1;
+            return;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+static void flush_stream(struct SnapshotStream* stream) {
+    write_all(stream, stream->buffer, stream->position);
+    stream->position = 0;
+}
+
+static void write_bytes(struct SnapshotStream* stream, const void* data, const size_t size) {
+    if (stream->position + size > SNAPSHOT_BUFFER_SIZE) flush_stream(stream);
+
+    // Blocks bigger than buffer aren't copied
+    if (size >= SNAPSHOT_BUFFER_SIZE) {
+        write_all(stream, data, size);
+        return;
+    }
+    memcpy(stream->buffer + stream->position, data, size);
+    stream->position += size;
+}
+
+/**
+    * Copies file content straight into stream buffer. Returns 1
+    * if file has become shorter than its node table entry says.
+*/
+static uint8_t write_file_content_bytes(struct SnapshotStream* stream, const struct FileNode* file, const uint64_t size) {
+    uint64_t offset = 0;
+    while (offset < size && !stream->isFailed) {
+        if (stream->position == SNAPSHOT_BUFFER_SIZE) flush_stream(stream);
+
+        const uint64_t space = SNAPSHOT_BUFFER_SIZE - stream->position;
+        const uint64_t wanted = size - offset < space ? size - offset : space;
+        const uint64_t copied = read_file_content_range(file, stream->buffer + stream->position, wanted, offset);
+        if (copied == 0) return EXIT_FAILURE;
+
+        stream->position += copied;
+        offset += copied;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint8_t fill_stream(struct SnapshotStream* stream) {
+    stream->position = 0;
+    stream->size = 0;
+    while (!stream->isFailed) {
+        const ssize_t bytesRead = read(stream->fd, stream->buffer, SNAPSHOT_BUFFER_SIZE);
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead <= 0) {
+            stream->isFailed = 1;
+            break;
+        }
+        stream->size = (size_t)bytesRead;
+        break;
+    }
+
+    return stream->isFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+    * Reads exactly size bytes. Returns 1 if stream ended before.
+*/
+static uint8_t read_bytes(struct SnapshotStream* stream, void* data, size_t size) {
+    char* destination = data;
+    while (size > 0) {
+        if (stream->position == stream->size && fill_stream(stream) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+        const size_t available = stream->size - stream->position;
+        const size_t copied = size < available ? size : available;
+        memcpy(destination, stream->buffer + stream->position, copied);
+        stream->position += copied;
+        destination += copied;
+        size -= copied;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Reads content of file straight from stream buffer into
+    * its chunks.
+*/
+static uint8_t read_file_content_bytes(struct SnapshotStream* stream, struct SlabAllocator* allocator,
+                                       struct FileNode* file) {
+    const uint64_t size = file->info.data.contentSize;
+    uint64_t offset = 0;
+    while (offset < size) {
+        if (stream->position == stream->size && fill_stream(stream) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+        const uint64_t available = stream->size - stream->position;
+        const uint64_t copied = size - offset < available ? size - offset : available;
+        if (write_file_content(allocator, file, stream->buffer + stream->position, copied, offset) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
+        }
+        stream->position += copied;
+        offset += copied;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint32_t hash_node_pointer(const struct FileNode* node) {
+    return (uint32_t)((uintptr_t)node >> 6) * 2654435761u;
+}
+
+static uint8_t init_node_map(struct NodeMap* map, const struct FileNode** nodes, const uint32_t count) {
+    uint32_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+
+    map->nodes = calloc(capacity, sizeof(struct FileNode*));
+    map->indexes = malloc(capacity * sizeof(uint32_t));
+    map->mask = capacity - 1;
+    if (map->nodes == NULL || map->indexes == NULL) return EXIT_FAILURE;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t slot = hash_node_pointer(nodes[i]) & map->mask;
+        while (map->nodes[slot] != NULL) slot = (slot + 1) & map->mask;
+        map->nodes[slot] = nodes[i];
+        map->indexes[slot] = i;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint32_t find_node_index(const struct NodeMap* map, const struct FileNode* node) {
+    if (node == NULL) return NO_NODE;
+
+    for (uint32_t slot = hash_node_pointer(node) & map->mask; map->nodes[slot] != NULL;
+         slot = (slot + 1) & map->mask) {
+        if (map->nodes[slot] == node) return map->indexes[slot];
+    }
+
+    return NO_NODE;
+}
+
+static void free_node_map(const struct NodeMap* map) {
+    free(map->nodes);
+    free(map->indexes);
+}
+
+/**
+    * Locks node while it is read. Frozen tree isn't locked,
+    * its lock words may be held by threads which don't exist.
+*/
+static void lock_saved_node(const uint8_t isFrozen, const struct FileNode* node) {
+    if (!isFrozen) acquire_read_lock((struct RwLock*)&node->lock);
+}
+
+static void unlock_saved_node(const uint8_t isFrozen, const struct FileNode* node) {
+    if (!isFrozen) release_read_lock((struct RwLock*)&node->lock);
+}
+
+/**
+    * Lists nodes breadth first, the list itself is the queue,
+    * so depth of tree isn't limited. Returns NULL if memory
+    * allocation failed or tree has more than NO_NODE / 2 nodes.
+*/
+static const struct FileNode** collect_nodes(const struct FileNode* root, const uint8_t isFrozen, uint32_t* count) {
+    uint32_t capacity = 1024;
+    const struct FileNode** nodes = malloc(capacity * sizeof(struct FileNode*));
+    if (nodes == NULL) return NULL;
+
+    nodes[0] = root;
+    *count = 1;
+    for (uint32_t i = 0; i < *count; i++) {
+        const struct FileNode* dir = nodes[i];
+        if (dir->info.properties.type != FILE_TYPE_DIR) continue;
+
+        lock_saved_node(isFrozen, dir);
+        for (const struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+            if (*count == capacity) {
+                const struct FileNode** grown = capacity < NO_NODE / 4
+                                                ? realloc(nodes, capacity * 2 * sizeof(struct FileNode*)) : NULL;
+                if (grown == NULL) {
+                    unlock_saved_node(isFrozen, dir);
+                    free(nodes);
+                    return NULL;
+                }
+                nodes = grown;
+                capacity *= 2;
+            }
+            nodes[(*count)++] = child;
+        }
+        unlock_saved_node(isFrozen, dir);
+    }
+
+    return nodes;
+}
+
+static uint64_t get_saved_content_size(const struct SavedTree* tree, const struct FileNode* node) {
+    if (node->info.properties.type != FILE_TYPE_FILE) return 0;
+
+    lock_saved_node(tree->isFrozen, node);
+    const uint64_t size = node->info.data.contentSize;
+    unlock_saved_node(tree->isFrozen, node);
+
+    return size;
+}
+
+/**
+    * Lists tree and sizes of its sections. Returns 1 if memory
+    * allocation failed or tree is too big to be saved.
+*/
+static uint8_t prepare_saved_tree(const struct WsfsContext* context, struct SavedTree* tree, const uint8_t isFrozen) {
+    memset(tree, 0, sizeof(struct SavedTree));
+    tree->isFrozen = isFrozen;
+    tree->nodes = collect_nodes(context->root, isFrozen, &tree->count);
+    if (tree->nodes == NULL) return EXIT_FAILURE;
+
+    tree->contentSizes = malloc(tree->count * sizeof(uint64_t));
+    if (tree->contentSizes == NULL || init_node_map(&tree->map, tree->nodes, tree->count) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < tree->count; i++) {
+        tree->contentSizes[i] = get_saved_content_size(tree, tree->nodes[i]);
+        tree->stringSize += tree->nodes[i]->info.metadata.nameLength + 1;
+        tree->contentSize += tree->contentSizes[i];
+    }
+
+    return tree->stringSize > NO_NODE ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void free_saved_tree(const struct SavedTree* tree) {
+    free_node_map(&tree->map);
+    free(tree->contentSizes);
+    free(tree->nodes);
+}
+
+static void write_names(struct SnapshotStream* stream, const struct SavedTree* tree) {
+    for (uint32_t i = 0; i < tree->count; i++) {
+        write_bytes(stream, tree->nodes[i]->info.metadata.name, tree->nodes[i]->info.metadata.nameLength + 1);
+    }
+}
+
+static uint8_t write_contents(struct SnapshotStream* stream, const struct SavedTree* tree) {
+    uint8_t result = EXIT_SUCCESS;
+    for (uint32_t i = 0; i < tree->count && result == EXIT_SUCCESS; i++) {
+        if (tree->contentSizes[i] == 0) continue;
+
+        lock_saved_node(tree->isFrozen, tree->nodes[i]);
+        result = write_file_content_bytes(stream, tree->nodes[i], tree->contentSizes[i]);
+        unlock_saved_node(tree->isFrozen, tree->nodes[i]);
+    }
+
+    flush_stream(stream);
+    return stream->isFailed ? EXIT_FAILURE : result;
+}
+
+static void write_node_table(struct SnapshotStream* stream, const struct SavedTree* tree) {
+    uint64_t nameOffset = 0;
+    for (uint32_t i = 0; i < tree->count; i++) {
+        const struct FileNode* node = tree->nodes[i];
+        struct SnapshotNode entry = {0};
+
+        entry.contentSize = tree->contentSizes[i];
+        entry.parent = i == 0 ? 0 : find_node_index(&tree->map, node->parent);
+        entry.nameOffset = (uint32_t)nameOffset;
+        entry.symlinkTarget = node->info.properties.type == FILE_TYPE_SYMLINK
+                              ? find_node_index(&tree->map, node->info.data.symlinkTarget) : NO_NODE;
+        entry.creationTime = node->info.metadata.creationTime;
+        entry.modificationTime = atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed);
+        entry.accessTime = atomic_load_explicit(&node->info.metadata.accessTime, memory_order_relaxed);
+        entry.type = (uint8_t)node->info.properties.type;
+        entry.permissions = (uint8_t)node->info.properties.permissions;
+        write_bytes(stream, &entry, sizeof(entry));
+
+        nameOffset += node->info.metadata.nameLength + 1;
+    }
+}
+
+static uint8_t save_snapshot(struct WsfsContext* context, const int fd, const uint8_t isFrozen) {
+    if (context == NULL || context->root == NULL) return EXIT_FAILURE;
+
+    // Names and parents stay stable until snapshot is written
+    if (!isFrozen) acquire_read_lock(&context->renameLock);
+
+    struct SnapshotStream stream = {0};
+    struct SavedTree tree;
+    uint8_t result = prepare_saved_tree(context, &tree, isFrozen) == EXIT_SUCCESS &&
+                     init_stream(&stream, fd) == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (result == EXIT_SUCCESS) {
+        struct SnapshotHeader header = {0};
+        header.magic = SNAPSHOT_MAGIC;
+        header.version = SNAPSHOT_VERSION;
+        header.nodeCount = tree.count;
+        header.stringTableSize = tree.stringSize;
+        header.contentSize = tree.contentSize;
+        header.memoryLimit = context->memoryLimit;
+        header.fileCountLimit = context->fileCountLimit;
+
+        write_bytes(&stream, &header, sizeof(header));
+        write_names(&stream, &tree);
+        write_node_table(&stream, &tree);
+        result = write_contents(&stream, &tree);
+    }
+    if (!isFrozen) release_read_lock(&context->renameLock);
+
+    free(stream.buffer);
+    free_saved_tree(&tree);
+
+    return result;
+}
+
+uint8_t wsfs_save(struct WsfsContext* context, const int fd) {
+    return save_snapshot(context, fd, 0);
+}
+
+uint8_t save_frozen_snapshot(struct WsfsContext* context, const int fd) {
+    return save_snapshot(context, fd, 1);
+}
+
+static int compare_lookup_keys(const void* left, const void* right) {
+    const struct LookupKey* leftKey = left;
+    const struct LookupKey* rightKey = right;
+    if (leftKey->hash != rightKey->hash) return leftKey->hash < rightKey->hash ? -1 : 1;
+
+    return leftKey->index < rightKey->index ? -1 : leftKey->index > rightKey->index;
+}
+
+/**
+    * Counts children of every node and sorts every directory's
+    * children by name hash. Returns 1 if children of some
+    * directory aren't contiguous, which means tree changed
+    * while it was listed.
+*/
+static uint8_t build_lookup_keys(const struct SavedTree* tree, uint32_t* childCounts, struct LookupKey* keys) {
+    uint32_t previousParent = 0;
+    for (uint32_t i = 1; i < tree->count; i++) {
+        const uint32_t parent = find_node_index(&tree->map, tree->nodes[i]->parent);
+        if (parent >= i || parent < previousParent) return EXIT_FAILURE;
+
+        childCounts[parent]++;
+        keys[i - 1].hash = tree->nodes[i]->info.metadata.nameHash;
+        keys[i - 1].index = i;
+        previousParent = parent;
+    }
+
+    // Children of directory i start right after children of directories before it
+    uint32_t firstKey = 0;
+    for (uint32_t i = 0; i < tree->count; i++) {
+        qsort(keys + firstKey, childCounts[i], sizeof(struct LookupKey), compare_lookup_keys);
+        firstKey += childCounts[i];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void write_image_nodes(struct SnapshotStream* stream, const struct SavedTree* tree,
+                              const uint32_t* childCounts) {
+    uint64_t nameOffset = 0;
+    uint64_t contentOffset = 0;
+    uint32_t firstChild = 1;
+    for (uint32_t i = 0; i < tree->count; i++) {
+        const struct FileNode* node = tree->nodes[i];
+        struct ImageNode entry = {0};
+
+        entry.contentOffset = contentOffset;
+        entry.contentSize = tree->contentSizes[i];
+        entry.parent = i == 0 ? 0 : find_node_index(&tree->map, node->parent);
+        entry.firstChild = childCounts[i] > 0 ? firstChild : 0;
+        entry.childCount = childCounts[i];
+        entry.symlinkTarget = node->info.properties.type == FILE_TYPE_SYMLINK
+                              ? find_node_index(&tree->map, node->info.data.symlinkTarget) : IMAGE_NO_NODE;
+        entry.nameOffset = (uint32_t)nameOffset;
+        entry.nameLength = node->info.metadata.nameLength;
+        entry.nameHash = node->info.metadata.nameHash;
+        entry.creationTime = node->info.metadata.creationTime;
+        entry.modificationTime = atomic_load_explicit(&node->info.metadata.modificationTime, memory_order_relaxed);
+        entry.type = (uint8_t)node->info.properties.type;
+        entry.permissions = (uint8_t)node->info.properties.permissions;
+        write_bytes(stream, &entry, sizeof(entry));
+
+        nameOffset += entry.nameLength + 1;
+        contentOffset += entry.contentSize;
+        firstChild += childCounts[i];
+    }
+}
+
+uint8_t wsfs_save_image(struct WsfsContext* context, const int fd) {
+    if (context == NULL || context->root == NULL) return EXIT_FAILURE;
+
+    acquire_read_lock(&context->renameLock);
+
+    struct SnapshotStream stream = {0};
+    struct SavedTree tree;
+    uint8_t result = prepare_saved_tree(context, &tree, 0);
+    uint32_t* childCounts = result == EXIT_SUCCESS ? calloc(tree.count, sizeof(uint32_t)) : NULL;
+    struct LookupKey* keys = childCounts != NULL ? malloc(tree.count * sizeof(struct LookupKey)) : NULL;
+    if (keys == NULL || build_lookup_keys(&tree, childCounts, keys) != EXIT_SUCCESS ||
+        init_stream(&stream, fd) != EXIT_SUCCESS) {
+        result = EXIT_FAILURE;
+    }
+
+    if (result == EXIT_SUCCESS) {
+        struct ImageHeader header = {0};
+        header.magic = IMAGE_MAGIC;
+        header.version = IMAGE_VERSION;
+        header.nodeCount = tree.count;
+        header.lookupOffset = sizeof(struct ImageHeader) + (uint64_t)tree.count * sizeof(struct ImageNode);
+        header.stringOffset = header.lookupOffset + (uint64_t)(tree.count - 1) * sizeof(uint32_t);
+        header.stringSize = tree.stringSize;
+        header.contentOffset = (header.stringOffset + header.stringSize + IMAGE_ALIGNMENT - 1) &
+                               ~(uint64_t)(IMAGE_ALIGNMENT - 1);
+        header.contentSize = tree.contentSize;
+        header.memoryLimit = context->memoryLimit;
+        header.fileCountLimit = context->fileCountLimit;
+
+        write_bytes(&stream, &header, sizeof(header));
+        write_image_nodes(&stream, &tree, childCounts);
+        for (uint32_t i = 0; i + 1 < tree.count; i++) {
+            write_bytes(&stream, &keys[i].index, sizeof(uint32_t));
+        }
+        write_names(&stream, &tree);
+
+        const char padding[IMAGE_ALIGNMENT] = {0};
+        write_bytes(&stream, padding, header.contentOffset - header.stringOffset - header.stringSize);
+        result = write_contents(&stream, &tree);
+    }
+    release_read_lock(&context->renameLock);
+
+    free(stream.buffer);
+    free(keys);
+    free(childCounts);
+    free_saved_tree(&tree);
+
+    return result;
+}
+
+/**
+    * Checks entry against already restored nodes. Parents must
+    * precede their children and names must lie in string table.
+*/
+static uint8_t is_entry_valid(const struct SnapshotNode* entry, const uint32_t index, struct FileNode** nodes,
+                              const struct SnapshotHeader* header) {
+    if (entry->nameOffset >= header->stringTableSize) return 0;
+    if (entry->type != FILE_TYPE_FILE && entry->type != FILE_TYPE_DIR &&
+        entry->type != FILE_TYPE_SYMLINK && entry->type != FILE_TYPE_UNKNOWN) return 0;
+    if (entry->type != FILE_TYPE_FILE && entry->contentSize != 0) return 0;
+    if (entry->symlinkTarget != NO_NODE && entry->symlinkTarget >= header->nodeCount) return 0;
+    if (index == 0) return entry->parent == 0 && entry->type == FILE_TYPE_DIR;
+
+    return entry->parent < index && nodes[entry->parent]->info.properties.type == FILE_TYPE_DIR;
+}
+
+/**
+    * Restores node table, remembers symbolic link targets until
+    * every node exists. Returns total content size, or
+    * UINT64_MAX if table is malformed.
+*/
+static uint64_t read_node_table(struct SnapshotStream* stream, struct WsfsContext* context,
+                                const struct SnapshotHeader* header, const char* names,
+                                struct FileNode** nodes, uint32_t* symlinkTargets) {
+    uint64_t contentSize = 0;
+    for (uint32_t i = 0; i < header->nodeCount; i++) {
+        struct SnapshotNode entry;
+        if (read_bytes(stream, &entry, sizeof(entry)) != EXIT_SUCCESS ||
+            !is_entry_valid(&entry, i, nodes, header)) return UINT64_MAX;
+
+        const struct FileProperties properties = {(enum FileType)entry.type,
+                                                  (enum Permissions)(entry.permissions & PERM_DEFAULT), 0};
+        const struct FileTimes times = {entry.creationTime, entry.modificationTime, entry.accessTime};
+        nodes[i] = restore_file_node_ctx(context, i == 0 ? NULL : nodes[entry.parent], names + entry.nameOffset,
+                                         properties, times, entry.contentSize);
+        if (nodes[i] == NULL) return UINT64_MAX;
+
+        symlinkTargets[i] = entry.type == FILE_TYPE_SYMLINK ? entry.symlinkTarget : NO_NODE;
+
+        if (contentSize + entry.contentSize < contentSize) return UINT64_MAX;
+        contentSize += entry.contentSize;
+    }
+
+    return contentSize;
+}
+
+static uint8_t restore_tree(struct SnapshotStream* stream, struct WsfsContext* context,
+                            const struct SnapshotHeader* header) {
+    char* names = malloc(header->stringTableSize);
+    struct FileNode** nodes = malloc(header->nodeCount * sizeof(struct FileNode*));
+    uint32_t* symlinkTargets = malloc(header->nodeCount * sizeof(uint32_t));
+    uint8_t result = EXIT_FAILURE;
+
+    if (names != NULL && nodes != NULL && symlinkTargets != NULL &&
+        read_bytes(stream, names, header->stringTableSize) == EXIT_SUCCESS &&
+        names[header->stringTableSize - 1] == '\0' &&
+        read_node_table(stream, context, header, names, nodes, symlinkTargets) == header->contentSize) {
+        result = EXIT_SUCCESS;
+        for (uint32_t i = 0; i < header->nodeCount && result == EXIT_SUCCESS; i++) {
+            if (symlinkTargets[i] != NO_NODE) {
+                atomic_store_explicit(&nodes[i]->info.data.symlinkTarget, nodes[symlinkTargets[i]],
+                                      memory_order_relaxed);
+            }
+            if (nodes[i]->info.properties.type == FILE_TYPE_FILE) {
+                result = read_file_content_bytes(stream, &context->allocator, nodes[i]);
+            }
+        }
+        if (result == EXIT_SUCCESS) set_root_node_ctx(context, nodes[0]);
+    }
+
+    free(symlinkTargets);
+    free(nodes);
+    free(names);
+
+    return result;
+}
+
+struct WsfsContext* wsfs_load(const int fd) {
+    struct SnapshotStream stream;
+    if (init_stream(&stream, fd) != EXIT_SUCCESS) return NULL;
+
+    struct SnapshotHeader header;
+    struct WsfsContext* context = NULL;
+    if (read_bytes(&stream, &header, sizeof(header)) == EXIT_SUCCESS &&
+        header.magic == SNAPSHOT_MAGIC && header.version == SNAPSHOT_VERSION &&
+        header.nodeCount > 0 && header.nodeCount <= NO_NODE &&
+        header.stringTableSize >= header.nodeCount && header.stringTableSize <= NO_NODE) {
+        context = create_wsfs_context();
+    }
+
+    if (context != NULL) {
+        set_memory_limit_ctx(context, header.memoryLimit);
+        set_file_count_limit_ctx(context, header.fileCountLimit);
+        if (restore_tree(&stream, context, &header) != EXIT_SUCCESS) {
+            free_wsfs_context(context);
+            context = NULL;
+        }
+    }
+    free(stream.buffer);
+
+    return context;
+}
@@ -0,0 +1,132 @@
+/**
+    * @file: tree_walk.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to tree walks.
+*/
+
+#include "../include/tree_walk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define WALK_INLINE_CAPACITY 64 // nodes which wait for visit without heap allocation
+
+/**
+ * @struct WalkFrame
+ * @brief Node which waits for its visit.
+ */
+struct WalkFrame {
+    struct FileNode* node;  /**< Node which will be visited */
+    uint8_t isExpanded;     /**< 1 once children of node were listed (post-order only) */
+};
+
+/**
+ * @struct WalkList
+ * @brief Stack(depth first walks) or queue(breadth first walk) of nodes.
+ */
+struct WalkList {
+    struct WalkFrame* frames;   /**< Waiting nodes, points to inlineFrames until list grows */
+    uint32_t head;              /**< First waiting node of queue, always 0 for stack */
+    uint32_t count;             /**< End of waiting nodes */
+    uint32_t capacity;          /**< Amount of frames */
+    struct WalkFrame inlineFrames[WALK_INLINE_CAPACITY]; /**< Frames of small walks */
+};
+
+/**
+    * Makes room for one more frame. Queue is moved to the
+    * beginning if most of its frames were already taken, else
+    * frames are doubled.
+*/
+static uint8_t reserve_frame(struct WalkList* list) {
+    if (list->count < list->capacity) return EXIT_SUCCESS;
+
+    if (list->head >= list->capacity / 2) {
+        list->count -= list->head;
+        memmove(list->frames, list->frames + list->head, list->count * sizeof(struct WalkFrame));
+        list->head = 0;
+        return EXIT_SUCCESS;
+    }
+
+    if (list->capacity > UINT32_MAX / 2) return EXIT_FAILURE;
+    const uint32_t capacity = list->capacity * 2;
+    struct WalkFrame* frames;
+    if (list->frames == list->inlineFrames) {
+        frames = malloc(capacity * sizeof(struct WalkFrame));
+        if (frames != NULL) memcpy(frames, list->inlineFrames, list->count * sizeof(struct WalkFrame));
+    } else {
+        frames = realloc(list->frames, capacity * sizeof(struct WalkFrame));
+    }
+    if (frames == NULL) return EXIT_FAILURE;
+
+    list->frames = frames;
+    list->capacity = capacity;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Adds children of directory to list. Stack gets them
+    * reversed, so they are taken in directory order.
+*/
+static uint8_t push_children(struct WalkList* list, struct FileNode* dir, const uint8_t isLocked,
+                             const uint8_t isReversed) {
+    if (dir->info.properties.type != FILE_TYPE_DIR) return EXIT_SUCCESS;
+
+    uint8_t result = EXIT_SUCCESS;
+    const uint32_t first = list->count;
+    if (isLocked) acquire_read_lock(&dir->lock);
+    for (struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        result = reserve_frame(list);
+        if (result != EXIT_SUCCESS) break;
+        list->frames[list->count++] = (struct WalkFrame){child, 0};
+    }
+    if (isLocked) release_read_lock(&dir->lock);
+
+    for (uint32_t left = first, right = list->count; isReversed && left + 1 < right; left++, right--) {
+        const struct WalkFrame frame = list->frames[left];
+        list->frames[left] = list->frames[right - 1];
+        list->frames[right - 1] = frame;
+    }
+
+    return result;
+}
+
+uint8_t walk_file_node_tree(struct FileNode* root, const enum WalkOrder order, const uint8_t isLocked,
+                            const WalkVisitor visitor, void* argument) {
+    if (root == NULL || visitor == NULL) return EXIT_FAILURE;
+
+    struct WalkList list;
+    list.frames = list.inlineFrames;
+    list.head = 0;
+    list.count = 0;
+    list.capacity = WALK_INLINE_CAPACITY;
+    list.frames[list.count++] = (struct WalkFrame){root, 0};
+
+    uint8_t result = EXIT_SUCCESS;
+    while (result == EXIT_SUCCESS && list.head < list.count) {
+        if (order == WALK_POST_ORDER) {
+            // Node stays listed under its children and is visited once they are gone
+            struct WalkFrame* frame = &list.frames[list.count - 1];
+            if (!frame->isExpanded) {
+                frame->isExpanded = 1;
+                result = push_children(&list, frame->node, isLocked, 1);
+                continue;
+            }
+            list.count--;
+            if (visitor(frame->node, argument) == WALK_STOP) break;
+            continue;
+        }
+
+        struct FileNode* node = order == WALK_BREADTH_FIRST ? list.frames[list.head++].node
+                                                            : list.frames[--list.count].node;
+        const enum WalkAction action = visitor(node, argument);
+        if (action == WALK_STOP) break;
+        if (action == WALK_CONTINUE) result = push_children(&list, node, isLocked, order == WALK_PRE_ORDER);
+    }
+
+    if (list.frames != list.inlineFrames) free(list.frames);
+
+    return result;
+}
@@ -0,0 +1,347 @@
+/**
+    * @file: work_pool.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to the work pool.
+*/
+
+#include "../include/work_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORK_DEQUE_MIN_CAPACITY 64
+
+/**
+ * @struct WorkDeque
+ * @brief Tasks of one worker. Owner takes them from the end,
+ * other workers steal them from the beginning.
+ */
+struct WorkDeque {
+    struct WorkTask* tasks;     /**< Waiting tasks, NULL until the first one is pushed */
+    uint32_t head;              /**< First waiting task */
+    uint32_t tail;              /**< End of waiting tasks */
+    uint32_t capacity;          /**< Amount of task slots */
+    pthread_mutex_t mutex;      /**< Protects every field above */
+};
+
+struct WorkJob {
+    WorkFunction function;      /**< Function which handles every task */
+    void* argument;             /**< Argument of function */
+    struct WorkDeque* deques;   /**< Deque of every worker */
+    uint32_t workerCount;       /**< Amount of deques */
+    _Atomic uint64_t pending;   /**< Tasks handed out but not handled yet, job is finished at 0 */
+    _Atomic uint64_t tasks;     /**< Handled tasks */
+    _Atomic uint64_t steals;    /**< Tasks taken from deque of another worker */
+};
+
+/**
+ * @struct WorkerThread
+ * @brief Pool thread and the number of its deque.
+ */
+struct WorkerThread {
+    struct WorkPool* pool;  /**< Pool of thread */
+    uint32_t worker;        /**< Number of worker, pool threads start at 1 */
+    pthread_t thread;       /**< Thread itself */
+};
+
+struct WorkPool {
+    uint32_t threadCount;           /**< Amount of pool threads */
+    struct WorkerThread* threads;   /**< Pool threads */
+    struct WorkDeque* deques;       /**< Deque of every worker, the first one is of the thread which runs job */
+    pthread_mutex_t runMutex;       /**< Held while a job runs on pool */
+    pthread_mutex_t mutex;          /**< Protects every field below */
+    pthread_cond_t wake;            /**< Wakes pool threads for a job or stop */
+    pthread_cond_t done;            /**< Signaled once the last pool thread left job */
+    struct WorkJob* job;            /**< Job in progress, NULL if there is none */
+    uint64_t jobNumber;             /**< Number of the last job, threads wait for the next one */
+    uint32_t busyThreads;           /**< Pool threads which haven't left job yet */
+    uint8_t isStopping;             /**< 1 once pool threads have to stop */
+    struct WorkPoolStats stats;     /**< Counters */
+};
+
+static void init_work_deque(struct WorkDeque* deque) {
+    memset(deque, 0, sizeof(struct WorkDeque));
+    pthread_mutex_init(&deque->mutex, NULL);
+}
+
+static void free_work_deque(struct WorkDeque* deque) {
+    free(deque->tasks);
+    pthread_mutex_destroy(&deque->mutex);
+}
+
+/**
+    * Adds task to the end of deque. Tasks are moved to the
+    * beginning if most of them were stolen, else deque is
+    * doubled. Returns 1 if memory allocation failed.
+*/
+static uint8_t push_to_deque(struct WorkDeque* deque, const struct WorkTask task) {
+    uint8_t result = EXIT_SUCCESS;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->tail == deque->capacity && deque->head >= deque->capacity / 2 && deque->head > 0) {
+        deque->tail -= deque->head;
+        memmove(deque->tasks, deque->tasks + deque->head, deque->tail * sizeof(struct WorkTask));
+        deque->head = 0;
+    } else if (deque->tail == deque->capacity) {
+        const uint32_t capacity = deque->capacity > 0 ? 2 * deque->capacity : WORK_DEQUE_MIN_CAPACITY;
+        struct WorkTask* tasks = capacity > deque->capacity ? realloc(deque->tasks, capacity * sizeof(struct WorkTask))
+                                                            : NULL;
+        if (tasks != NULL) {
+            deque->tasks = tasks;
+            deque->capacity = capacity;
+        } else {
+            result = EXIT_FAILURE;
+        }
+    }
+    if (result == EXIT_SUCCESS) deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->mutex);
+
+    return result;
+}
+
+/**
+    * Takes task from the end(isStolen is 0) or from the
+    * beginning of deque. Returns 1 if deque is empty.
+*/
+static uint8_t take_from_deque(struct WorkDeque* deque, const uint8_t isStolen, struct WorkTask* task) {
+    pthread_mutex_lock(&deque->mutex);
+    const uint8_t result = deque->tail > deque->head ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (result == EXIT_SUCCESS) *task = isStolen ? deque->tasks[deque->head++] : deque->tasks[--deque->tail];
+    if (deque->head == deque->tail) {
+        deque->head = 0;
+        deque->tail = 0;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return result;
+}
+
+/**
+    * Steals the oldest task of another worker, they are
+    * tried one after another starting after worker itself.
+*/
+static uint8_t steal_task(struct WorkJob* job, const uint32_t worker, struct WorkTask* task) {
+    for (uint32_t i = 1; i < job->workerCount; i++) {
+        if (take_from_deque(&job->deques[(worker + i) % job->workerCount], 1, task) == EXIT_SUCCESS) {
+            atomic_fetch_add_explicit(&job->steals, 1, memory_order_relaxed);
+            return EXIT_SUCCESS;
+        }
+    }
+
+    return EXIT_FAILURE;
+}
+
+/**
+    * Handles tasks of job until every one of them is handled.
+    * Worker which finds no task waits for the ones which are
+    * still handled, they may hand out more.
+*/
+static void work_on_job(struct WorkJob* job, const uint32_t worker) {
+    while (atomic_load_explicit(&job->pending, memory_order_acquire) > 0) {
+        struct WorkTask task;
+        if (take_from_deque(&job->deques[worker], 0, &task) != EXIT_SUCCESS &&
+            steal_task(job, worker, &task) != EXIT_SUCCESS) {
+            sched_yield();
+            continue;
+        }
+
+        job->function(job, worker, task, job->argument);
+        atomic_fetch_add_explicit(&job->tasks, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&job->pending, 1, memory_order_release);
+    }
+}
+
+static void* run_worker_thread(void* argument) {
+    struct WorkerThread* self = argument;
+    struct WorkPool* pool = self->pool;
+    uint64_t jobNumber = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        while (!pool->isStopping && pool->jobNumber == jobNumber) {
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->isStopping) break;
+
+        // Job isn't finished until every pool thread left it, so it can't be replaced meanwhile
+        jobNumber = pool->jobNumber;
+        struct WorkJob* job = pool->job;
+        pthread_mutex_unlock(&pool->mutex);
+        work_on_job(job, self->worker);
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->busyThreads == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/**
+    * Stops threads which were started and frees pool.
+*/
+static void free_work_pool(struct WorkPool* pool, const uint32_t startedThreads) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->isStopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (uint32_t i = 0; i < startedThreads; i++) {
+        pthread_join(pool->threads[i].thread, NULL);
+    }
+
+    for (uint32_t i = 0; i <= pool->threadCount; i++) {
+        free_work_deque(&pool->deques[i]);
+    }
+    pthread_mutex_destroy(&pool->runMutex);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+uint8_t wsfs_start_workers_ctx(struct WsfsContext* context, const uint32_t threadCount) {
+    if (context == NULL || threadCount == 0 || threadCount == UINT32_MAX ||
+        context->workPool != NULL) return EXIT_FAILURE;
+
+    struct WorkPool* pool = calloc(1, sizeof(struct WorkPool));
+    if (pool == NULL) return EXIT_FAILURE;
+
+    pool->threads = calloc(threadCount, sizeof(struct WorkerThread));
+    pool->deques = calloc(threadCount + 1, sizeof(struct WorkDeque));
+    if (pool->threads == NULL || pool->deques == NULL) {
+        free(pool->threads);
+        free(pool->deques);
+        free(pool);
+        return EXIT_FAILURE;
+    }
+    pool->threadCount = threadCount;
+    pool->stats.threads = threadCount;
+    for (uint32_t i = 0; i <= threadCount; i++) {
+        init_work_deque(&pool->deques[i]);
+    }
+    pthread_mutex_init(&pool->runMutex, NULL);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+        pool->threads[i].pool = pool;
+        pool->threads[i].worker = i + 1;
+        if (pthread_create(&pool->threads[i].thread, NULL, run_worker_thread, &pool->threads[i]) != 0) {
+            free_work_pool(pool, i);
+            return EXIT_FAILURE;
+        }
+    }
+    context->workPool = pool;
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_start_workers(const uint32_t threadCount) {
+    return wsfs_start_workers_ctx(get_default_context(), threadCount);
+}
+
+void wsfs_stop_workers_ctx(struct WsfsContext* context) {
+    struct WorkPool* pool = context != NULL ? context->workPool : NULL;
+    if (pool == NULL) return;
+
+    context->workPool = NULL;
+    free_work_pool(pool, pool->threadCount);
+}
+
+void wsfs_stop_workers(void) {
+    wsfs_stop_workers_ctx(get_default_context());
+}
+
+void get_work_pool_stats_ctx(struct WsfsContext* context, struct WorkPoolStats* stats) {
+    if (stats == NULL) return;
+
+    struct WorkPool* pool = context->workPool;
+    if (pool == NULL) {
+        memset(stats, 0, sizeof(struct WorkPoolStats));
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void get_work_pool_stats(struct WorkPoolStats* stats) {
+    get_work_pool_stats_ctx(get_default_context(), stats);
+}
+
+uint32_t get_work_pool_worker_count(const struct WsfsContext* context) {
+    return context->workPool != NULL ? context->workPool->threadCount + 1 : 1;
+}
+
+uint8_t run_work_job(struct WsfsContext* context, const struct WorkTask task, const WorkFunction function,
+                     void* argument) {
+    if (context == NULL || function == NULL) return EXIT_FAILURE;
+
+    struct WorkJob job;
+    job.function = function;
+    job.argument = argument;
+    atomic_init(&job.pending, 0);
+    atomic_init(&job.tasks, 0);
+    atomic_init(&job.steals, 0);
+
+    // Job which finds pool busy doesn't wait, it runs alone
+    struct WorkPool* pool = context->workPool;
+    struct WorkDeque ownDeque;
+    if (pool != NULL && pthread_mutex_trylock(&pool->runMutex) == 0) {
+        job.deques = pool->deques;
+        job.workerCount = pool->threadCount + 1;
+    } else {
+        pool = NULL;
+        init_work_deque(&ownDeque);
+        job.deques = &ownDeque;
+        job.workerCount = 1;
+    }
+
+    push_work_task(&job, 0, task);
+    if (pool != NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->job = &job;
+        pool->jobNumber++;
+        pool->busyThreads = pool->threadCount;
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    work_on_job(&job, 0);
+
+    if (pool == NULL) {
+        free_work_deque(&ownDeque);
+        return EXIT_SUCCESS;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->busyThreads > 0) {
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pool->job = NULL;
+    pool->stats.jobs++;
+    pool->stats.tasks += atomic_load_explicit(&job.tasks, memory_order_relaxed);
+    pool->stats.steals += atomic_load_explicit(&job.steals, memory_order_relaxed);
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_mutex_unlock(&pool->runMutex);
+
+    return EXIT_SUCCESS;
+}
+
+void push_work_task(struct WorkJob* job, const uint32_t worker, const struct WorkTask task) {
+    atomic_fetch_add_explicit(&job->pending, 1, memory_order_relaxed);
+    if (push_to_deque(&job->deques[worker], task) == EXIT_SUCCESS) return;
+
+    // Deque can't grow, so task is handled before the one which handed it out
+    job->function(job, worker, task, job->argument);
+    atomic_fetch_add_explicit(&job->tasks, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&job->pending, 1, memory_order_release);
+}
@@ -11,13 +11,396 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../include/checkpoint.h"
+#include "../include/dir_index.h"
+#include "../include/journal.h"
+#include "../include/query_index.h"
+#include "../include/work_pool.h"
+#include "../include/wsfs_macros.h"
 
-struct FileNode* wsfs_init(void) {
-    struct FileNode* root = create_file_node(NULL, "\\", FILE_TYPE_DIR);
-    set_root_node(root);
+#define PATH_BUFFER_SIZE 256
+#define HANDLE_TABLE_MIN_CAPACITY 16
+
+struct FileHandle {
+    struct FileNode* file;      /**< Resolved regular file, NULL if handle is free */
+    char* buffer;               /**< Write buffer, allocated on first small write */
+    uint64_t position;          /**< Offset of next read or write */
+    uint64_t bufferOffset;      /**< Offset in file of the first buffered byte */
+    uint32_t bufferedSize;      /**< Amount of buffered bytes */
+    uint32_t nextFree;          /**< Next free handle if handle is free */
+    enum OpenFlags flags;       /**< Flags which file was opened with */
+};
+
+static struct FileNode* follow_symlink(struct FileNode* node) {
+    for (uint32_t depth = 0; node != NULL && node->info.properties.type == FILE_TYPE_SYMLINK; depth++) {
+        if (depth == MAX_SYMLINK_DEPTH ||
+            !is_permissions_equal(node->info.properties.permissions, PERM_READ)) return NULL;
+        node = node->info.data.symlinkTarget;
+    }
+
+    return node;
+}
+
+static struct FileNode* lookup_child(struct WsfsContext* context, struct FileNode* dir, const char* name) {
+    if (dir->info.properties.type != FILE_TYPE_DIR ||
+        !is_permissions_equal(dir->info.properties.permissions, PERM_READ) ||
+        !is_permissions_equal(dir->info.properties.permissions, PERM_EXEC)) return NULL;
+
+    if (strcmp(name, ".") == 0) return dir;
+    if (strcmp(name, "..") == 0) return dir->parent;
+
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+
+    // Entries are dropped before a name changes or node is retired, the caller's epoch keeps hit alive
+    struct FileNode* child = lookup_cache_find(&context->lookupCache, dir, name, hash, length);
+    if (child != NULL) return child;
+
+    // Directory stays read locked, so child can't be unlinked or forgotten before it is cached
+    acquire_read_lock(&dir->lock);
+    child = find_dir_child(dir, name, hash, length);
+    if (child != NULL && !dir->info.data.isForgotten) lookup_cache_insert(&context->lookupCache, child);
+    release_read_lock(&dir->lock);
+
+    return child;
+}
+
+/**
+    * Gets open handle of context. Handle table is read locked
+    * while handle is used and write locked while it changes.
+*/
+static struct FileHandle* get_handle(const struct WsfsContext* context, const uint32_t handle) {
+    if (handle >= context->handleCapacity || context->handles[handle].file == NULL) return NULL;
+
+    return &context->handles[handle];
+}
+
+static uint8_t grow_handle_table(struct WsfsContext* context) {
+    const uint32_t oldCapacity = context->handleCapacity;
+    const uint32_t capacity = oldCapacity == 0 ? HANDLE_TABLE_MIN_CAPACITY : oldCapacity * 2;
+    struct FileHandle* table = realloc(context->handles, capacity * sizeof(struct FileHandle));
+    if (table == NULL) return EXIT_FAILURE;
+
+    // New handles are chained so the lowest one is given out first
+    for (uint32_t i = capacity; i-- > oldCapacity;) {
+        table[i].file = NULL;
+        table[i].buffer = NULL;
+        table[i].nextFree = context->firstFreeHandle;
+        context->firstFreeHandle = i;
+    }
+    context->handles = table;
+    context->handleCapacity = capacity;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+    * Gets length of file as seen through handle, buffered
+    * bytes past the end of file are counted too.
+*/
+static uint64_t get_handle_file_size(const struct FileHandle* handle) {
+    const uint64_t size = get_file_content_size(handle->file);
+    const uint64_t bufferEnd = handle->bufferOffset + handle->bufferedSize;
+
+    return handle->bufferedSize > 0 && bufferEnd > size ? bufferEnd : size;
+}
+
+static uint8_t flush_handle(struct WsfsContext* context, struct FileHandle* handle) {
+    if (handle->bufferedSize == 0) return EXIT_SUCCESS;
+
+    const uint8_t result = wsfs_pwrite_ctx(context, handle->file, handle->buffer, handle->bufferedSize,
+                                           handle->bufferOffset);
+    handle->bufferedSize = 0;
+
+    return result;
+}
+
+static void free_file_handles(struct WsfsContext* context) {
+    for (uint32_t i = 0; i < context->handleCapacity; i++) {
+        free(context->handles[i].buffer);
+    }
+    free(context->handles);
+    context->handles = NULL;
+    context->handleCapacity = 0;
+    context->firstFreeHandle = NO_FREE_HANDLE;
+}
+
+struct WsfsContext* create_wsfs_context(void) {
+    struct WsfsContext* context = malloc(sizeof(struct WsfsContext));
+    if (context == NULL) return NULL;
+
+    init_wsfs_context(context);
+
+    return context;
+}
+
+void free_wsfs_context(struct WsfsContext* context) {
+    if (context == NULL) return;
+
+    wsfs_stop_checkpoints_ctx(context);
+    wsfs_close_journal_ctx(context);
+    wsfs_stop_workers_ctx(context);
+    wsfs_disable_queries_ctx(context);
+    free_file_handles(context);
+    release_all_file_nodes_ctx(context);
+    free(context);
+}
+
+struct FileNode* wsfs_init_ctx(struct WsfsContext* context) {
+    struct FileNode* root = create_file_node_ctx(context, NULL, "\\", FILE_TYPE_DIR);
+    set_root_node_ctx(context, root);
+    if (root != NULL) replay_journal(context);
     return root;
 }
 
+struct FileNode* wsfs_init(void) {
+    return wsfs_init_ctx(get_default_context());
+}
+
+void wsfs_deinit_ctx(struct WsfsContext* context, struct FileNode* root) {
+    if (context == NULL) return;
+
+    if (get_allocator_mode_ctx(context) == ALLOCATOR_MODE_ARENA) {
+        release_all_file_nodes_ctx(context);
+    } else {
+        free_file_node_recursive_ctx(context, root);
+    }
+    free_lookup_cache(&context->lookupCache);
+    free_file_handles(context);
+}
+
 void wsfs_deinit(struct FileNode* root) {
-    free_file_node_recursive(root);
-}
\ No newline at end of file
+    wsfs_deinit_ctx(get_default_context(), root);
+}
+
+struct FileNode* wsfs_lookup_path_ctx(struct WsfsContext* context, struct FileNode* root, const char* path,
+                                      const enum LookupFlags flags) {
+    if (context == NULL || root == NULL || path == NULL) return NULL;
+
+    // Components are cut in place, so path is copied into writable buffer
+    char buffer[PATH_BUFFER_SIZE];
+    const size_t pathLength = strlen(path);
+    char* components = pathLength < PATH_BUFFER_SIZE ? buffer : malloc(pathLength + 1);
+    if (components == NULL) return NULL;
+    memcpy(components, path, pathLength + 1);
+    if (wsfs_epoch_enter() != EXIT_SUCCESS) {
+        if (components != buffer) free(components);
+        return NULL;
+    }
+
+    // Nodes of the walk may be deleted meanwhile, epoch keeps them from being freed
+    struct FileNode* current = root;
+    char* position = components;
+    while (current != NULL) {
+        while (*position == '\\') position++;
+        if (*position == '\0') break;
+
+        const char* name = position;
+        while (*position != '\0' && *position != '\\') position++;
+        if (*position != '\0') *position++ = '\0';
+
+        if (current->info.properties.type == FILE_TYPE_SYMLINK) {
+            current = flags & LOOKUP_FOLLOW_INTERMEDIATE ? follow_symlink(current) : NULL;
+            if (current == NULL) break;
+        }
+
+        current = lookup_child(context, current, name);
+    }
+
+    if (current != NULL && flags & LOOKUP_FOLLOW_LAST) {
+        current = follow_symlink(current);
+    }
+    wsfs_epoch_exit();
+
+    if (components != buffer) free(components);
+
+    return current;
+}
+
+struct FileNode* wsfs_lookup_path(struct FileNode* root, const char* path, const enum LookupFlags flags) {
+    return wsfs_lookup_path_ctx(get_default_context(), root, path, flags);
+}
+
+uint8_t wsfs_open_ctx(struct WsfsContext* context, struct FileNode* node, const enum OpenFlags flags,
+                      uint32_t* handle) {
+    if (context == NULL || node == NULL || handle == NULL || !(flags & (OPEN_READ | OPEN_WRITE))) return EXIT_FAILURE;
+
+    struct FileNode* file = get_symlink_target(node);
+    if (file == NULL || file->info.properties.type != FILE_TYPE_FILE ||
+        !is_permissions_equal(file->info.properties.permissions, PERM_READ) ||
+        (flags & OPEN_WRITE && !is_file_node_writable(file))) return EXIT_FAILURE;
+
+    if (flags & OPEN_TRUNCATE &&
+        (!(flags & OPEN_WRITE) || wsfs_truncate_ctx(context, file, 0) != EXIT_SUCCESS)) return EXIT_FAILURE;
+
+    acquire_write_lock(&context->handleLock);
+    if (context->firstFreeHandle == NO_FREE_HANDLE && grow_handle_table(context) != EXIT_SUCCESS) {
+        release_write_lock(&context->handleLock);
+        return EXIT_FAILURE;
+    }
+
+    *handle = context->firstFreeHandle;
+    struct FileHandle* opened = &context->handles[context->firstFreeHandle];
+    context->firstFreeHandle = opened->nextFree;
+
+    opened->file = file;
+    opened->buffer = NULL;
+    opened->position = 0;
+    opened->bufferOffset = 0;
+    opened->bufferedSize = 0;
+    opened->flags = flags;
+    release_write_lock(&context->handleLock);
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_open(struct FileNode* node, const enum OpenFlags flags, uint32_t* handle) {
+    return wsfs_open_ctx(get_default_context(), node, flags, handle);
+}
+
+static uint64_t read_from_handle(struct WsfsContext* context, struct FileHandle* opened, void* buffer,
+                                 const uint64_t size) {
+    if (opened == NULL || buffer == NULL || !(opened->flags & OPEN_READ) ||
+        flush_handle(context, opened) != EXIT_SUCCESS) return 0;
+
+    const uint64_t readSize = wsfs_pread(opened->file, buffer, size, opened->position);
+    opened->position += readSize;
+
+    return readSize;
+}
+
+uint64_t wsfs_read_ctx(struct WsfsContext* context, const uint32_t handle, void* buffer, const uint64_t size) {
+    if (context == NULL) return 0;
+
+    acquire_read_lock(&context->handleLock);
+    const uint64_t readSize = read_from_handle(context, get_handle(context, handle), buffer, size);
+    release_read_lock(&context->handleLock);
+
+    return readSize;
+}
+
+uint64_t wsfs_read(const uint32_t handle, void* buffer, const uint64_t size) {
+    return wsfs_read_ctx(get_default_context(), handle, buffer, size);
+}
+
+static uint8_t write_to_handle(struct WsfsContext* context, struct FileHandle* opened, const void* buffer,
+                               const uint64_t size) {
+    if (opened == NULL || buffer == NULL || !(opened->flags & OPEN_WRITE)) return EXIT_FAILURE;
+
+    if (opened->flags & OPEN_APPEND) opened->position = get_handle_file_size(opened);
+    if (opened->position + size < opened->position) return EXIT_FAILURE;
+
+    // Buffer holds one contiguous range, any other write flushes it
+    if (opened->bufferedSize > 0 &&
+        (opened->position != opened->bufferOffset + opened->bufferedSize ||
+         opened->bufferedSize + size > HANDLE_BUFFER_SIZE) &&
+        flush_handle(context, opened) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    if (size >= HANDLE_BUFFER_SIZE) {
+        if (wsfs_pwrite_ctx(context, opened->file, buffer, size, opened->position) != EXIT_SUCCESS) return EXIT_FAILURE;
+        opened->position += size;
+        return EXIT_SUCCESS;
+    }
+
+    if (opened->buffer == NULL) {
+        opened->buffer = malloc(HANDLE_BUFFER_SIZE);
+        if (opened->buffer == NULL) return EXIT_FAILURE;
+    }
+
+    if (opened->bufferedSize == 0) opened->bufferOffset = opened->position;
+    memcpy(opened->buffer + opened->bufferedSize, buffer, size);
+    opened->bufferedSize += (uint32_t)size;
+    opened->position += size;
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_write_ctx(struct WsfsContext* context, const uint32_t handle, const void* buffer, const uint64_t size) {
+    if (context == NULL) return EXIT_FAILURE;
+
+    acquire_read_lock(&context->handleLock);
+    const uint8_t result = write_to_handle(context, get_handle(context, handle), buffer, size);
+    release_read_lock(&context->handleLock);
+
+    return result;
+}
+
+uint8_t wsfs_write(const uint32_t handle, const void* buffer, const uint64_t size) {
+    return wsfs_write_ctx(get_default_context(), handle, buffer, size);
+}
+
+static uint8_t seek_handle(struct FileHandle* opened, const int64_t offset, const enum SeekOrigin origin, uint64_t* position) {
+    if (opened == NULL) return EXIT_FAILURE;
+
+    uint64_t base;
+    switch (origin) {
+        case SEEK_ORIGIN_SET:       base = 0; break;
+        case SEEK_ORIGIN_CURRENT:   base = opened->position; break;
+        case SEEK_ORIGIN_END:       base = get_handle_file_size(opened); break;
+        default:                    return EXIT_FAILURE;
+    }
+
+    if (offset < 0 && (uint64_t)-(offset + 1) >= base) return EXIT_FAILURE;
+    if (offset > 0 && base + (uint64_t)offset < base) return EXIT_FAILURE;
+
+    opened->position = base + (uint64_t)offset;
+    if (position != NULL) *position = opened->position;
+
+    return EXIT_SUCCESS;
+}
+
+uint8_t wsfs_seek_ctx(struct WsfsContext* context, const uint32_t handle, const int64_t offset,
+                      const enum SeekOrigin origin, uint64_t* position) {
+    if (context == NULL) return EXIT_FAILURE;
+
+    acquire_read_lock(&context->handleLock);
+    const uint8_t result = seek_handle(get_handle(context, handle), offset, origin, position);
+    release_read_lock(&context->handleLock);
+
+    return result;
+}
+
+uint8_t wsfs_seek(const uint32_t handle, const int64_t offset, const enum SeekOrigin origin, uint64_t* position) {
+    return wsfs_seek_ctx(get_default_context(), handle, offset, origin, position);
+}
+
+uint8_t wsfs_flush_ctx(struct WsfsContext* context, const uint32_t handle) {
+    if (context == NULL) return EXIT_FAILURE;
+
+    acquire_read_lock(&context->handleLock);
+    struct FileHandle* opened = get_handle(context, handle);
+    const uint8_t result = opened != NULL ? flush_handle(context, opened) : EXIT_FAILURE;
+    release_read_lock(&context->handleLock);
+
+    return result;
+}
+
+uint8_t wsfs_flush(const uint32_t handle) {
+    return wsfs_flush_ctx(get_default_context(), handle);
+}
+
+uint8_t wsfs_close_ctx(struct WsfsContext* context, const uint32_t handle) {
+    if (context == NULL) return EXIT_FAILURE;
+
+    acquire_write_lock(&context->handleLock);
+    struct FileHandle* opened = get_handle(context, handle);
+    if (opened == NULL) {
+        release_write_lock(&context->handleLock);
+        return EXIT_FAILURE;
+    }
+
+    const uint8_t result = flush_handle(context, opened);
+
+    free(opened->buffer);
+    opened->buffer = NULL;
+    opened->file = NULL;
+    opened->nextFree = context->firstFreeHandle;
+    context->firstFreeHandle = handle;
+    release_write_lock(&context->handleLock);
+
+    return result;
+}
+
+uint8_t wsfs_close(const uint32_t handle) {
+    return wsfs_close_ctx(get_default_context(), handle);
+}
@@ -0,0 +1,47 @@
+/**
+    * @file: wsfs_context.c
+    * @author: without eyes
+    *
+    * This file contains definition of functions related
+    * to file system contexts.
+*/
+
+#include "../include/wsfs_context.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include "../include/wsfs_macros.h"
+
+#define CONTEXT_UNINITIALIZED 0
+#define CONTEXT_INITIALIZING 1
+#define CONTEXT_READY 2
+
+static struct WsfsContext defaultContext;
+static _Atomic uint8_t defaultContextState = CONTEXT_UNINITIALIZED;
+
+void init_wsfs_context(struct WsfsContext* context) {
+    memset(context, 0, sizeof(struct WsfsContext));
+    atomic_init(&context->fileCount, 0);
+    atomic_init(&context->usedMemory, 0);
+    context->fileCountLimit = MAX_FILE_COUNT;
+    context->memoryLimit = MAX_MEMORY_SIZE;
+    init_slab_allocator(&context->allocator, ALLOCATOR_MODE_SLAB);
+    init_lookup_cache(&context->lookupCache);
+    init_name_index(&context->nameIndex);
+    atomic_init(&context->renameSequence, 0);
+    context->firstFreeHandle = NO_FREE_HANDLE;
+    context->compressor.windowMs = COMPRESSION_DISABLED;
+}
+
+struct WsfsContext* get_default_context(void) {
+    if (atomic_load_explicit(&defaultContextState, memory_order_acquire) == CONTEXT_READY) return &defaultContext;
+
+    uint8_t expected = CONTEXT_UNINITIALIZED;
+    if (atomic_compare_exchange_strong(&defaultContextState, &expected, CONTEXT_INITIALIZING)) {
+        init_wsfs_context(&defaultContext);
+        atomic_store_explicit(&defaultContextState, CONTEXT_READY, memory_order_release);
+    }
+    while (atomic_load_explicit(&defaultContextState, memory_order_acquire) != CONTEXT_READY) {}
+
+    return &defaultContext;
+}
@@ -0,0 +1,283 @@
+/**
+    * @file: checkpoint_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions which save
+    * checkpoints and restore file system from them.
+*/
+
+#include "../include/checkpoint.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/journal.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+#define WRITER_COUNT 4
+#define APPENDS_PER_WRITER 2000
+#define RENAMER_COUNT 3
+#define CHECKPOINT_ROUNDS 200
+
+struct CheckpointPaths {
+    char journal[64];
+    char checkpoint[80];
+};
+
+static void create_paths(struct CheckpointPaths* paths) {
+    strcpy(paths->journal, "/tmp/wsfs_checkpoint_XXXXXX");
+    const int fd = mkstemp(paths->journal);
+    cr_assert_geq(fd, 0);
+    close(fd);
+    sprintf(paths->checkpoint, "%s.checkpoint", paths->journal);
+}
+
+static void remove_paths(const struct CheckpointPaths* paths) {
+    unlink(paths->journal);
+    unlink(paths->checkpoint);
+}
+
+/**
+    * Restores context as it is done after restart: checkpoint
+    * if there is one, then journal.
+*/
+static struct WsfsContext* restore_context(const struct CheckpointPaths* paths) {
+    struct WsfsContext* context = wsfs_load_checkpoint(paths->checkpoint);
+    if (context == NULL) {
+        context = create_wsfs_context();
+        set_memory_limit_ctx(context, 1024 * 1024);
+        set_file_count_limit_ctx(context, 100);
+    }
+    cr_assert_eq(wsfs_open_journal_ctx(context, paths->journal, JOURNAL_SYNC_ALWAYS, 0), EXIT_SUCCESS);
+    if (get_root_node_ctx(context) == NULL) {
+        struct FileNode* root = wsfs_init_ctx(context);
+        cr_assert_not_null(root);
+        change_permissions_ctx(context, root, PERM_DEFAULT);
+    }
+
+    return context;
+}
+
+static const char* read_path(struct WsfsContext* context, const char* path) {
+    struct FileNode* file = wsfs_lookup_path_ctx(context, get_root_node_ctx(context), path, LOOKUP_FOLLOW_ALL);
+    return file != NULL ? read_file_content_ctx(context, file) : NULL;
+}
+
+Test(wsfs_checkpoint_ctx, journal_holds_later_changes) {
+    struct CheckpointPaths paths;
+    create_paths(&paths);
+    struct WsfsContext* context = restore_context(&paths);
+    struct FileNode* root = get_root_node_ctx(context);
+    struct CheckpointStats stats;
+
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "before", FILE_TYPE_FILE), "saved");
+    cr_assert_eq(wsfs_checkpoint_ctx(context), EXIT_FAILURE);
+    cr_assert_eq(wsfs_start_checkpoints_ctx(context, paths.checkpoint, 0, 0), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_checkpoint_ctx(context), EXIT_SUCCESS);
+    get_checkpoint_stats_ctx(context, &stats);
+    cr_assert_eq(stats.checkpoints, 1);
+    cr_assert_eq(stats.failures, 0);
+    cr_assert_gt(stats.lastBytes, 0);
+    cr_assert_eq(stats.totalBytes, stats.lastBytes);
+    cr_assert_geq(stats.lastDurationNs, stats.lastPauseNs);
+    const uint64_t emptySize = stats.journalSize;
+
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "after", FILE_TYPE_FILE), "journaled");
+    get_checkpoint_stats_ctx(context, &stats);
+    cr_assert_gt(stats.journalSize, emptySize);
+    free_wsfs_context(context);
+
+    context = restore_context(&paths);
+    cr_assert_eq(context->checkpoint, 1);
+    cr_assert_str_eq(read_path(context, "before"), "saved");
+    cr_assert_str_eq(read_path(context, "after"), "journaled");
+
+    // The next checkpoint follows the restored one
+    cr_assert_eq(wsfs_start_checkpoints_ctx(context, paths.checkpoint, 0, 0), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_checkpoint_ctx(context), EXIT_SUCCESS);
+    cr_assert_eq(context->checkpoint, 2);
+    free_wsfs_context(context);
+
+    context = restore_context(&paths);
+    cr_assert_str_eq(read_path(context, "after"), "journaled");
+    cr_assert_eq(get_file_count_ctx(context), 3);
+
+    free_wsfs_context(context);
+    remove_paths(&paths);
+}
+
+Test(wsfs_checkpoint_ctx, failed_checkpoint_keeps_records) {
+    struct CheckpointPaths paths;
+    create_paths(&paths);
+    struct WsfsContext* context = restore_context(&paths);
+    struct FileNode* root = get_root_node_ctx(context);
+    struct CheckpointStats stats;
+
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "before", FILE_TYPE_FILE), "first");
+    cr_assert_eq(wsfs_start_checkpoints_ctx(context, "/nonexistent/checkpoint", 0, 0), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_checkpoint_ctx(context), EXIT_FAILURE);
+    get_checkpoint_stats_ctx(context, &stats);
+    cr_assert_eq(stats.checkpoints, 0);
+    cr_assert_eq(stats.failures, 1);
+    cr_assert_eq(context->checkpoint, 0);
+
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "after", FILE_TYPE_FILE), "second");
+    free_wsfs_context(context);
+    cr_assert_neq(access(paths.journal, F_OK), -1);
+
+    context = restore_context(&paths);
+    cr_assert_str_eq(read_path(context, "before"), "first");
+    cr_assert_str_eq(read_path(context, "after"), "second");
+
+    free_wsfs_context(context);
+    remove_paths(&paths);
+}
+
+Test(wsfs_open_journal_ctx, merges_files_left_by_crash) {
+    struct CheckpointPaths paths;
+    create_paths(&paths);
+    struct WsfsContext* context = restore_context(&paths);
+    struct FileNode* root = get_root_node_ctx(context);
+
+    // Crash after journal was rotated, checkpoint was never saved
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "before", FILE_TYPE_FILE), "first");
+    acquire_write_lock(&context->renameLock);
+    cr_assert_eq(rotate_journal(context, 1), EXIT_SUCCESS);
+    release_write_lock(&context->renameLock);
+    cr_assert_eq(sync_rotated_journal(context), EXIT_SUCCESS);
+    write_to_file_ctx(context, create_file_node_ctx(context, root, "after", FILE_TYPE_FILE), "second");
+    free_wsfs_context(context);
+
+    char nextPath[80];
+    sprintf(nextPath, "%s%s", paths.journal, JOURNAL_NEXT_SUFFIX);
+    cr_assert_neq(access(nextPath, F_OK), -1);
+
+    context = restore_context(&paths);
+    cr_assert_eq(access(nextPath, F_OK), -1);
+    cr_assert_str_eq(read_path(context, "before"), "first");
+    cr_assert_str_eq(read_path(context, "after"), "second");
+    free_wsfs_context(context);
+
+    context = restore_context(&paths);
+    cr_assert_eq(get_file_count_ctx(context), 3);
+
+    free_wsfs_context(context);
+    remove_paths(&paths);
+}
+
+static void* append_pieces(void* argument) {
+    struct WsfsContext* context = argument;
+    char name[32];
+    sprintf(name, "file%lu", (unsigned long)pthread_self());
+    struct FileNode* file = create_file_node_ctx(context, get_root_node_ctx(context), name, FILE_TYPE_FILE);
+
+    for (int i = 0; i < APPENDS_PER_WRITER; i++) {
+        wsfs_append_ctx(context, file, "x", 1);
+    }
+
+    return NULL;
+}
+
+Test(wsfs_start_checkpoints_ctx, background_checkpoints_while_changing) {
+    struct CheckpointPaths paths;
+    create_paths(&paths);
+    struct WsfsContext* context = restore_context(&paths);
+    cr_assert_eq(wsfs_start_checkpoints_ctx(context, paths.checkpoint, 1, 0), EXIT_SUCCESS);
+
+    pthread_t writers[WRITER_COUNT];
+    for (int i = 0; i < WRITER_COUNT; i++) {
+        pthread_create(&writers[i], NULL, append_pieces, context);
+    }
+    for (int i = 0; i < WRITER_COUNT; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    struct CheckpointStats stats;
+    get_checkpoint_stats_ctx(context, &stats);
+    cr_assert_eq(stats.failures, 0);
+    const uint64_t usedMemory = get_used_memory_ctx(context);
+    free_wsfs_context(context);
+
+    context = restore_context(&paths);
+    cr_assert_eq(get_file_count_ctx(context), 1 + WRITER_COUNT);
+    cr_assert_eq(get_used_memory_ctx(context), usedMemory);
+
+    free_wsfs_context(context);
+    remove_paths(&paths);
+}
+
+/**
+ * @struct RenameLoop
+ * @brief Argument of thread which changes tree until it is stopped.
+ */
+struct RenameLoop {
+    struct WsfsContext* context;    /**< Changed context */
+    struct FileNode* file;          /**< File which is renamed or read */
+    _Atomic uint8_t* isStopping;    /**< Set to 1 once thread has to stop */
+};
+
+static void* rename_until_stopped(void* argument) {
+    const struct RenameLoop* loop = argument;
+    char names[2][32];
+    sprintf(names[0], "first%p", (void*)loop->file);
+    sprintf(names[1], "second%p", (void*)loop->file);
+    for (uint32_t i = 0; !atomic_load(loop->isStopping); i++) {
+        change_file_node_name_ctx(loop->context, loop->file, names[i % 2]);
+    }
+
+    return NULL;
+}
+
+static void* read_until_stopped(void* argument) {
+    const struct RenameLoop* loop = argument;
+    while (!atomic_load(loop->isStopping)) {
+        // Every write drops flat content, so the next read flattens it under file lock
+        wsfs_append_ctx(loop->context, loop->file, "y", 1);
+        cr_assert_not_null(read_file_content_ctx(loop->context, loop->file));
+    }
+
+    return NULL;
+}
+
+Test(wsfs_checkpoint_ctx, checkpoints_during_renames_and_reads) {
+    struct CheckpointPaths paths;
+    create_paths(&paths);
+    struct WsfsContext* context = restore_context(&paths);
+    struct FileNode* root = get_root_node_ctx(context);
+    cr_assert_eq(wsfs_start_checkpoints_ctx(context, paths.checkpoint, 0, 0), EXIT_SUCCESS);
+    _Atomic uint8_t isStopping = 0;
+
+    pthread_t threads[RENAMER_COUNT + 1];
+    struct RenameLoop loops[RENAMER_COUNT + 1];
+    for (int i = 0; i <= RENAMER_COUNT; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        loops[i] = (struct RenameLoop){context, create_file_node_ctx(context, root, name, FILE_TYPE_FILE),
+                                       &isStopping};
+        write_to_file_ctx(context, loops[i].file, "x");
+        pthread_create(&threads[i], NULL, i < RENAMER_COUNT ? rename_until_stopped : read_until_stopped, &loops[i]);
+    }
+    for (int i = 0; i < CHECKPOINT_ROUNDS; i++) {
+        cr_assert_eq(wsfs_checkpoint_ctx(context), EXIT_SUCCESS);
+    }
+    atomic_store(&isStopping, 1);
+    for (int i = 0; i <= RENAMER_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    struct CheckpointStats stats;
+    get_checkpoint_stats_ctx(context, &stats);
+    cr_assert_eq(stats.checkpoints, CHECKPOINT_ROUNDS);
+    cr_assert_eq(stats.failures, 0);
+    const uint64_t usedMemory = get_used_memory_ctx(context);
+    free_wsfs_context(context);
+
+    context = restore_context(&paths);
+    cr_assert_eq(get_file_count_ctx(context), 2 + RENAMER_COUNT);
+    cr_assert_eq(get_used_memory_ctx(context), usedMemory);
+
+    free_wsfs_context(context);
+    remove_paths(&paths);
+}
@@ -0,0 +1,218 @@
+/**
+    * @file: dir_index_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to hashed directory indexes.
+*/
+
+#include "../include/dir_index.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+static struct SlabAllocator allocator;
+
+static struct FileNode* create_dir_with_files(const int count) {
+    set_file_count_limit(count + 1);
+    set_memory_limit(UINT64_MAX);
+
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    for (int i = 0; i < count; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        create_file_node(dir, name, FILE_TYPE_FILE);
+    }
+
+    return dir;
+}
+
+Test(hash_file_node_name, same_names_same_hash) {
+    uint32_t length;
+
+    const uint32_t hash = hash_file_node_name("file", &length);
+
+    cr_assert_eq(length, 4);
+    cr_assert_eq(hash, hash_file_node_name("file", NULL));
+    cr_assert_neq(hash, hash_file_node_name("elif", NULL));
+}
+
+Test(build_dir_index, indexes_all_children) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* dir = create_dir_with_files(100);
+
+    struct DirIndex* index = build_dir_index(dir, &allocator);
+
+    cr_assert_eq(index->count, 100);
+    cr_assert_geq(index->capacity, 200);
+    for (const struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        cr_assert_eq(dir_index_find(index, child->info.metadata.name,
+                                    child->info.metadata.nameHash, child->info.metadata.nameLength), child);
+    }
+
+    free_dir_index(index);
+    free_file_node_recursive(dir);
+    release_slab_allocator(&allocator);
+}
+
+Test(dir_index_find, missing_name) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* dir = create_dir_with_files(10);
+    struct DirIndex* index = build_dir_index(dir, &allocator);
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name("missing", &length);
+
+    cr_assert_null(dir_index_find(index, "missing", hash, length));
+    cr_assert_null(dir_index_find(index, NULL, hash, length));
+
+    free_dir_index(index);
+    free_file_node_recursive(dir);
+    release_slab_allocator(&allocator);
+}
+
+Test(dir_index_insert, grows_table) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* dir = create_dir_with_files(0);
+    struct DirIndex* index = build_dir_index(dir, &allocator);
+    const uint32_t capacity = index->capacity;
+    free_file_node_recursive(dir);
+
+    dir = create_dir_with_files(capacity);
+    for (struct FileNode* child = dir->info.data.directoryContent; child != NULL; child = child->next) {
+        cr_assert_eq(dir_index_insert(index, child), 0);
+    }
+
+    cr_assert_eq(index->count, capacity);
+    cr_assert_gt(index->capacity, capacity);
+
+    free_dir_index(index);
+    free_file_node_recursive(dir);
+    release_slab_allocator(&allocator);
+}
+
+Test(dir_index_remove, removed_node_is_not_found) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* dir = create_dir_with_files(20);
+    struct DirIndex* index = build_dir_index(dir, &allocator);
+    const struct FileNode* file = dir->info.data.directoryContent->next;
+
+    cr_assert_eq(dir_index_remove(index, file), 0);
+    cr_assert_eq(dir_index_remove(index, file), 1);
+
+    cr_assert_null(dir_index_find(index, file->info.metadata.name,
+                                  file->info.metadata.nameHash, file->info.metadata.nameLength));
+    cr_assert_eq(index->count, 19);
+
+    free_dir_index(index);
+    free_file_node_recursive(dir);
+    release_slab_allocator(&allocator);
+}
+
+Test(list_dir_children, order_matches_scan) {
+    struct FileNode* dir = create_dir_with_files(600);
+    struct DirIndex* index = dir->info.data.directoryIndex;
+    struct FileNode* ordered[600];
+    struct FileNode* scanned[600];
+
+    cr_assert_not_null(index);
+    cr_assert_eq(index->isOrdered, 1);
+    cr_assert_gt(index->orderBlockCount, 1);
+    for (int round = 0; round < 2; round++) {
+        const uint32_t count = list_dir_children(dir, NULL, 0, ordered, 600);
+        dir->info.data.directoryIndex = NULL;
+        cr_assert_eq(list_dir_children(dir, NULL, 0, scanned, 600), count);
+        dir->info.data.directoryIndex = index;
+        cr_assert_eq(count, index->count);
+        cr_assert_eq(memcmp(ordered, scanned, count * sizeof(struct FileNode*)), 0);
+        for (uint32_t i = 1; i < count; i++) {
+            cr_assert_lt(strcmp(ordered[i - 1]->info.metadata.name, ordered[i]->info.metadata.name), 0);
+        }
+
+        // Listing resumes after given child, blocks merge once most children are gone
+        const struct FileNode* middle = ordered[count / 2];
+        cr_assert_eq(list_dir_children(dir, middle->info.metadata.name, (uintptr_t)middle, scanned, 600),
+                     count - count / 2 - 1);
+        cr_assert_eq(scanned[0], ordered[count / 2 + 1]);
+        for (uint32_t i = 0; i < count; i += 1 + round) {
+            if (i % 4 != 0) delete_file_node(dir, ordered[i]);
+        }
+    }
+    cr_assert_lt(index->orderBlockCount, 600 / DIR_ORDER_BLOCK_CAPACITY);
+
+    free_file_node_recursive(dir);
+}
+
+#ifdef WSFS_FAULT_INJECTION
+Test(find_dir_child, finds_child_after_index_failed_to_grow) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* moved = create_file_node_ctx(context, root, "moved", FILE_TYPE_FILE);
+    char name[16];
+    // Index is built at 16 children with 32 slots, the 25th child needs a bigger table
+    for (int i = 0; i < 24; i++) {
+        sprintf(name, "file%d", i);
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+    const struct DirIndex* index = dir->info.data.directoryIndex;
+    cr_assert_not_null(index);
+    cr_assert_eq(index->capacity, 32);
+
+    context->allocator.failingAllocations = 1;
+    cr_assert_eq(change_file_node_location_ctx(context, dir, moved), EXIT_SUCCESS);
+    cr_assert_eq(context->allocator.failingAllocations, 0);
+    cr_assert_null(dir->info.data.directoryIndex);
+    cr_assert_eq(find_file_node_in_curr_dir_ctx(context, dir, "moved"), moved);
+
+    // The next child indexes directory again
+    struct FileNode* last = create_file_node_ctx(context, dir, "last", FILE_TYPE_FILE);
+    cr_assert_not_null(dir->info.data.directoryIndex);
+    cr_assert_eq(find_file_node_in_curr_dir_ctx(context, dir, "moved"), moved);
+    cr_assert_eq(find_file_node_in_curr_dir_ctx(context, dir, "last"), last);
+    free_wsfs_context(context);
+}
+
+Test(list_dir_children, order_is_rebuilt_after_allocation_failed) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* moved = create_file_node_ctx(context, root, "moved", FILE_TYPE_FILE);
+    char name[16];
+    // Children fill one block, the next one splits it
+    for (int i = 0; i < DIR_ORDER_BLOCK_CAPACITY; i++) {
+        sprintf(name, "file%d", i);
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+    const struct DirIndex* index = dir->info.data.directoryIndex;
+    cr_assert_eq(index->orderBlockCount, 1);
+
+    context->allocator.failingAllocations = 1;
+    cr_assert_eq(change_file_node_location_ctx(context, dir, moved), EXIT_SUCCESS);
+    cr_assert_eq(context->allocator.failingAllocations, 0);
+    cr_assert_eq(dir->info.data.directoryIndex, index);
+    cr_assert_eq(index->isOrdered, 0);
+
+    // The next child orders directory again
+    create_file_node_ctx(context, dir, "last", FILE_TYPE_FILE);
+    cr_assert_eq(index->isOrdered, 1);
+    struct FileNode* children[DIR_ORDER_BLOCK_CAPACITY + 2];
+    cr_assert_eq(list_dir_children(dir, NULL, 0, children, DIR_ORDER_BLOCK_CAPACITY + 2), DIR_ORDER_BLOCK_CAPACITY + 2);
+    for (uint32_t i = 1; i < DIR_ORDER_BLOCK_CAPACITY + 2; i++) {
+        cr_assert_lt(strcmp(children[i - 1]->info.metadata.name, children[i]->info.metadata.name), 0);
+    }
+    free_wsfs_context(context);
+}
+#endif
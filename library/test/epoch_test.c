@@ -0,0 +1,82 @@
+/**
+    * @file: epoch_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to epoch-based memory reclamation.
+*/
+
+#include "../include/epoch.h"
+
+#include <stdlib.h>
+
+#include "criterion/criterion.h"
+
+static int reclaimedCount;
+static int object;
+
+static void count_reclaim(struct SlabAllocator* allocator, void* pointer, size_t size) {
+    (void)allocator;
+    (void)pointer;
+    (void)size;
+    reclaimedCount++;
+}
+
+Test(wsfs_epoch_enter, nested_calls) {
+    cr_assert(is_epoch_idle());
+
+    cr_assert_eq(wsfs_epoch_enter(), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_epoch_enter(), EXIT_SUCCESS);
+    cr_assert_not(is_epoch_idle());
+
+    wsfs_epoch_exit();
+    cr_assert_not(is_epoch_idle());
+
+    wsfs_epoch_exit();
+    cr_assert(is_epoch_idle());
+}
+
+Test(wsfs_epoch_exit, without_enter_does_nothing) {
+    wsfs_epoch_exit();
+
+    cr_assert(is_epoch_idle());
+}
+
+Test(epoch_retire, reclaims_at_once_when_idle) {
+    reclaimedCount = 0;
+
+    epoch_retire(count_reclaim, NULL, &object, sizeof(object));
+
+    cr_assert_eq(reclaimedCount, 1);
+    cr_assert_eq(get_epoch_pending_count(), 0);
+}
+
+Test(epoch_retire, waits_for_reader) {
+    reclaimedCount = 0;
+
+    wsfs_epoch_enter();
+    epoch_retire(count_reclaim, NULL, &object, sizeof(object));
+    epoch_collect();
+    epoch_collect();
+    cr_assert_eq(reclaimedCount, 0);
+    cr_assert_eq(get_epoch_pending_count(), 1);
+    wsfs_epoch_exit();
+
+    epoch_collect();
+    epoch_collect();
+    cr_assert_eq(reclaimedCount, 1);
+    cr_assert_eq(get_epoch_pending_count(), 0);
+}
+
+Test(epoch_reclaim_all, reclaims_pending) {
+    reclaimedCount = 0;
+
+    wsfs_epoch_enter();
+    epoch_retire(count_reclaim, NULL, &object, sizeof(object));
+    epoch_retire(count_reclaim, NULL, &object, sizeof(object));
+    wsfs_epoch_exit();
+    epoch_reclaim_all();
+
+    cr_assert_eq(reclaimedCount, 2);
+    cr_assert_eq(get_epoch_pending_count(), 0);
+}
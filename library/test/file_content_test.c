@@ -0,0 +1,370 @@
+/**
+    * @file: file_content_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to chunked file content.
+*/
+
+#include "../include/file_content.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/file_node_funcs.h"
+#include "criterion/criterion.h"
+
+static struct SlabAllocator allocator;
+
+static void fill_pattern(char* buffer, const uint64_t size) {
+    for (uint64_t i = 0; i < size; i++) {
+        buffer[i] = (char)('a' + i % 26);
+    }
+}
+
+Test(resize_file_content, grows_with_zeros) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char buffer[8];
+
+    cr_assert_eq(resize_file_content(&allocator, file, sizeof(buffer)), EXIT_SUCCESS);
+
+    cr_assert_eq(file->info.data.contentSize, sizeof(buffer));
+    cr_assert_eq(file->info.data.contentChunkCount, 1);
+    cr_assert_eq(read_file_content_range(file, buffer, sizeof(buffer), 0), sizeof(buffer));
+    for (uint64_t i = 0; i < sizeof(buffer); i++) {
+        cr_assert_eq(buffer[i], 0);
+    }
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(resize_file_content, spans_several_chunks) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+
+    resize_file_content(&allocator, file, 3 * FILE_CHUNK_SIZE + 1);
+    cr_assert_eq(file->info.data.contentChunkCount, 4);
+    cr_assert_geq(file->info.data.contentTableCapacity, 4);
+
+    resize_file_content(&allocator, file, FILE_CHUNK_SIZE / 2);
+    cr_assert_eq(file->info.data.contentChunkCount, 1);
+    cr_assert_leq(file->info.data.contentTableCapacity, 1);
+    cr_assert_eq(file->info.data.fileContent[FILE_CHUNK_SIZE / 2], '\0');
+
+    resize_file_content(&allocator, file, 0);
+    cr_assert_null(file->info.data.fileContent);
+    cr_assert_eq(file->info.data.contentChunkCount, 0);
+
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(write_file_content, crosses_chunk_border) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char data[100];
+    char buffer[100];
+    fill_pattern(data, sizeof(data));
+    resize_file_content(&allocator, file, 2 * FILE_CHUNK_SIZE);
+
+    write_file_content(&allocator, file, data, sizeof(data), FILE_CHUNK_SIZE - 50);
+
+    cr_assert_eq(read_file_content_range(file, buffer, sizeof(buffer), FILE_CHUNK_SIZE - 50), sizeof(buffer));
+    cr_assert_eq(memcmp(buffer, data, sizeof(data)), 0);
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(read_file_content_range, stops_at_end) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char buffer[16];
+    resize_file_content(&allocator, file, 10);
+
+    cr_assert_eq(read_file_content_range(file, buffer, sizeof(buffer), 4), 6);
+    cr_assert_eq(read_file_content_range(file, buffer, sizeof(buffer), 10), 0);
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(flatten_file_content, single_chunk_is_not_copied) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+
+    cr_assert_null(flatten_file_content(&allocator, file));
+
+    resize_file_content(&allocator, file, 5);
+    write_file_content(&allocator, file, "Hello", 5, 0);
+
+    cr_assert_eq(flatten_file_content(&allocator, file), file->info.data.fileContent);
+    cr_assert_str_eq(flatten_file_content(&allocator, file), "Hello");
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(flatten_file_content, several_chunks_are_joined) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    const uint64_t size = 2 * FILE_CHUNK_SIZE + 7;
+    char data[2 * FILE_CHUNK_SIZE + 7];
+    fill_pattern(data, size);
+    resize_file_content(&allocator, file, size);
+    write_file_content(&allocator, file, data, size, 0);
+
+    const char* flat = flatten_file_content(&allocator, file);
+
+    cr_assert_not_null(flat);
+    cr_assert_eq(memcmp(flat, data, size), 0);
+    cr_assert_eq(flat[size], '\0');
+
+    write_file_content(&allocator, file, "X", 1, 0);
+    cr_assert_null(file->info.data.contentFlat);
+    cr_assert_eq(flatten_file_content(&allocator, file)[0], 'X');
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(copy_file_content, copy_is_independent) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* source = create_file_node(NULL, "source", FILE_TYPE_FILE);
+    struct FileNode* destination = create_file_node(NULL, "destination", FILE_TYPE_FILE);
+    const uint64_t size = FILE_CHUNK_SIZE + 3;
+    char data[FILE_CHUNK_SIZE + 3];
+    char buffer[FILE_CHUNK_SIZE + 3];
+    fill_pattern(data, size);
+    resize_file_content(&allocator, source, size);
+    write_file_content(&allocator, source, data, size, 0);
+
+    cr_assert_eq(copy_file_content(&allocator, destination, source), EXIT_SUCCESS);
+    write_file_content(&allocator, source, "XYZ", 3, 0);
+
+    cr_assert_eq(read_file_content_range(destination, buffer, size, 0), size);
+    cr_assert_eq(memcmp(buffer, data, size), 0);
+
+    free_file_content(&allocator, source);
+    free_file_content(&allocator, destination);
+    free_file_node_recursive(source);
+    free_file_node_recursive(destination);
+    release_slab_allocator(&allocator);
+}
+
+Test(copy_file_content, chunks_are_shared_until_write) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* source = create_file_node(NULL, "source", FILE_TYPE_FILE);
+    struct FileNode* destination = create_file_node(NULL, "destination", FILE_TYPE_FILE);
+    const uint64_t size = FILE_CHUNK_SIZE * 2;
+    char data[FILE_CHUNK_SIZE * 2];
+    char buffer[FILE_CHUNK_SIZE * 2];
+    fill_pattern(data, size);
+    resize_file_content(&allocator, source, size);
+    write_file_content(&allocator, source, data, size, 0);
+
+    cr_assert_eq(copy_file_content(&allocator, destination, source), EXIT_SUCCESS);
+    cr_assert(is_file_content_shared(source));
+    cr_assert(is_file_content_shared(destination));
+    cr_assert_eq(destination->info.data.contentChunks, source->info.data.contentChunks);
+
+    // Destination copies chunks for itself, source becomes the only owner of the old ones
+    cr_assert_eq(write_file_content(&allocator, destination, "XYZ", 3, FILE_CHUNK_SIZE), EXIT_SUCCESS);
+    cr_assert_not(is_file_content_shared(destination));
+    cr_assert_neq(destination->info.data.contentChunks, source->info.data.contentChunks);
+    cr_assert_eq(read_file_content_range(source, buffer, size, 0), size);
+    cr_assert_eq(memcmp(buffer, data, size), 0);
+
+    cr_assert_eq(resize_file_content(&allocator, source, 1), EXIT_SUCCESS);
+    cr_assert_not(is_file_content_shared(source));
+    cr_assert_eq(read_file_content_range(destination, buffer, size, 0), size);
+    cr_assert_eq(memcmp(buffer + FILE_CHUNK_SIZE, "XYZ", 3), 0);
+    cr_assert_eq(memcmp(buffer, data, FILE_CHUNK_SIZE), 0);
+
+    free_file_content(&allocator, source);
+    free_file_content(&allocator, destination);
+    free_file_node_recursive(source);
+    free_file_node_recursive(destination);
+    release_slab_allocator(&allocator);
+}
+
+Test(free_file_content, last_owner_frees_chunks) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct FileNode* source = create_file_node(NULL, "source", FILE_TYPE_FILE);
+    struct FileNode* first = create_file_node(NULL, "first", FILE_TYPE_FILE);
+    struct FileNode* second = create_file_node(NULL, "second", FILE_TYPE_FILE);
+    struct AllocatorStats stats;
+    resize_file_content(&allocator, source, FILE_CHUNK_SIZE + 1);
+    write_file_content(&allocator, source, "shared", 6, 0);
+    copy_file_content(&allocator, first, source);
+    copy_file_content(&allocator, second, first);
+
+    free_file_content(&allocator, source);
+    free_file_content(&allocator, first);
+    cr_assert_eq(flatten_file_content(&allocator, second)[0], 's');
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_gt(stats.usedBytes, 0);
+
+    free_file_content(&allocator, second);
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_eq(stats.usedBytes, 0);
+
+    free_file_node_recursive(source);
+    free_file_node_recursive(first);
+    free_file_node_recursive(second);
+    release_slab_allocator(&allocator);
+}
+
+Test(store_file_content, equal_contents_share_chunks) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct ContentStore store = {0};
+    struct FileNode* first = create_file_node(NULL, "first", FILE_TYPE_FILE);
+    struct FileNode* second = create_file_node(NULL, "second", FILE_TYPE_FILE);
+    const uint64_t size = FILE_CHUNK_SIZE * 2;
+    char data[FILE_CHUNK_SIZE * 2];
+    char buffer[FILE_CHUNK_SIZE * 2];
+    struct ContentStoreStats stats;
+    fill_pattern(data, size);
+
+    cr_assert_eq(store_file_content(&store, &allocator, first, data, size), EXIT_SUCCESS);
+    cr_assert_eq(store_file_content(&store, &allocator, second, data, size), EXIT_SUCCESS);
+    cr_assert_eq(first->info.data.contentChunks, second->info.data.contentChunks);
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.contents, 1);
+    cr_assert_eq(stats.uniqueBytes, size);
+    cr_assert_eq(stats.logicalBytes, size * 2);
+    cr_assert_eq(stats.savedBytes, size);
+    cr_assert_eq(stats.hits, 1);
+
+    // Writer copies chunks for itself, stored content stays as it was
+    cr_assert_eq(write_file_content(&allocator, first, "XYZ", 3, 0), EXIT_SUCCESS);
+    cr_assert_neq(first->info.data.contentChunks, second->info.data.contentChunks);
+    cr_assert_eq(read_file_content_range(second, buffer, size, 0), size);
+    cr_assert_eq(memcmp(buffer, data, size), 0);
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.logicalBytes, size);
+    cr_assert_eq(stats.savedBytes, 0);
+
+    // The only owner changes chunks in place, so they leave the store
+    cr_assert_eq(resize_file_content(&allocator, second, 1), EXIT_SUCCESS);
+    cr_assert_not(is_file_content_shared(second));
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.contents, 0);
+
+    free_file_content(&allocator, first);
+    free_file_content(&allocator, second);
+    free_file_node_recursive(first);
+    free_file_node_recursive(second);
+    release_slab_allocator(&allocator);
+}
+
+Test(store_file_content, last_owner_removes_content) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct ContentStore store = {0};
+    struct FileNode* first = create_file_node(NULL, "first", FILE_TYPE_FILE);
+    struct FileNode* second = create_file_node(NULL, "second", FILE_TYPE_FILE);
+    struct ContentStoreStats stats;
+
+    store_file_content(&store, &allocator, first, "shared", 6);
+    copy_file_content(&allocator, second, first);
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.logicalBytes, 12);
+
+    // Writing other content leaves the stored one
+    cr_assert_eq(store_file_content(&store, &allocator, first, "other", 5), EXIT_SUCCESS);
+    cr_assert_str_eq(flatten_file_content(&allocator, first), "other");
+    free_file_content(&allocator, second);
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.contents, 1);
+    cr_assert_eq(stats.uniqueBytes, 5);
+    cr_assert_eq(stats.hits, 0);
+
+    free_file_content(&allocator, first);
+    get_content_store_stats(&store, &stats);
+    cr_assert_eq(stats.contents, 0);
+
+    free_file_node_recursive(first);
+    free_file_node_recursive(second);
+    release_slab_allocator(&allocator);
+}
+
+Test(compress_file_content, reads_decode_and_write_decompresses) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct ContentCompressor compressor = {0};
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    const uint64_t size = FILE_CHUNK_SIZE * 2 + 100;
+    char data[FILE_CHUNK_SIZE * 2 + 100];
+    char buffer[FILE_CHUNK_SIZE * 2 + 100];
+    struct CompressionStats stats;
+    fill_pattern(data, size);
+    resize_file_content(&allocator, file, size);
+    write_file_content(&allocator, file, data, size, 0);
+
+    cr_assert_eq(compress_file_content(&compressor, &allocator, file), 1);
+    cr_assert_eq(file->info.data.contentChunkCount, 0);
+    cr_assert_lt(get_compressed_content_size(file), size / 10);
+    get_content_compressor_stats(&compressor, &stats);
+    cr_assert_eq(stats.files, 1);
+    cr_assert_eq(stats.uncompressedBytes, size);
+    cr_assert_eq(stats.compressedBytes, get_compressed_content_size(file));
+
+    // Range across chunk border is decoded without decompressing the file
+    cr_assert_eq(read_file_content_range(file, buffer, 200, FILE_CHUNK_SIZE - 100), 200);
+    cr_assert_eq(memcmp(buffer, data + FILE_CHUNK_SIZE - 100, 200), 0);
+    cr_assert_eq(memcmp(flatten_file_content(&allocator, file), data, size), 0);
+    cr_assert_neq(get_compressed_content_size(file), 0);
+
+    cr_assert_eq(write_file_content(&allocator, file, "XYZ", 3, 0), EXIT_SUCCESS);
+    cr_assert_eq(get_compressed_content_size(file), 0);
+    cr_assert_eq(read_file_content_range(file, buffer, size, 0), size);
+    cr_assert_eq(memcmp(buffer, "XYZ", 3), 0);
+    cr_assert_eq(memcmp(buffer + 3, data + 3, size - 3), 0);
+    get_content_compressor_stats(&compressor, &stats);
+    cr_assert_eq(stats.files, 0);
+    cr_assert_eq(stats.compressedBytes, 0);
+    cr_assert_eq(stats.decompressions, 1);
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    release_slab_allocator(&allocator);
+}
+
+Test(compress_file_content, hot_shared_or_random_content_stays) {
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct ContentCompressor compressor = {0};
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    struct FileNode* copy = create_file_node(NULL, "copy", FILE_TYPE_FILE);
+    char data[FILE_CHUNK_SIZE];
+    fill_pattern(data, sizeof(data));
+    resize_file_content(&allocator, file, sizeof(data));
+    write_file_content(&allocator, file, data, sizeof(data), 0);
+
+    compressor.windowMs = 60000;
+    touch_file_content(file);
+    cr_assert_eq(compress_file_content(&compressor, &allocator, file), 0);
+
+    compressor.windowMs = 0;
+    copy_file_content(&allocator, copy, file);
+    cr_assert_eq(compress_file_content(&compressor, &allocator, file), 0);
+    free_file_content(&allocator, copy);
+
+    srand(1);
+    for (uint64_t i = 0; i < sizeof(data); i++) {
+        data[i] = (char)rand();
+    }
+    write_file_content(&allocator, file, data, sizeof(data), 0);
+    cr_assert_eq(compress_file_content(&compressor, &allocator, file), 0);
+    cr_assert_eq(get_compressed_content_size(file), 0);
+
+    free_file_content(&allocator, file);
+    free_file_node_recursive(file);
+    free_file_node_recursive(copy);
+    release_slab_allocator(&allocator);
+}
@@ -8,23 +8,29 @@
 
 #include "../include/file_node_funcs.h"
 
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
+#include "../include/wsfs.h"
 #include "../include/wsfs_macros.h"
 #include "criterion/criterion.h"
+#include "test_helpers.h"
 
 Test(create_file_node, standart_creation) {
     struct FileNode* parent = create_file_node(NULL, "\\", FILE_TYPE_DIR);
     char name[5] = "node";
     enum FileType type = FILE_TYPE_FILE;
 
+    const uint64_t before = get_current_time();
     struct FileNode* child = create_file_node(parent, name, type);
 
-    struct Timestamp timestamp = get_current_time();
     cr_assert_str_eq(child->info.metadata.name, name);
-    cr_assert_eq(child->info.metadata.creationTime.hour, timestamp.hour);
-    cr_assert_eq(child->info.metadata.creationTime.minute, timestamp.minute);
+    cr_assert_geq(child->info.metadata.creationTime, before);
+    cr_assert_leq(child->info.metadata.creationTime, get_current_time());
+    cr_assert_eq(child->info.metadata.modificationTime, child->info.metadata.creationTime);
+    cr_assert_eq(child->info.metadata.accessTime, child->info.metadata.creationTime);
     cr_assert_eq(child->info.properties.type, type);
     cr_assert_eq(child->info.properties.permissions, PERM_DEFAULT - PERMISSION_MASK);
     cr_assert_eq(child->parent, parent);
@@ -40,12 +46,12 @@ Test(create_file_node, root_creation) {
     char name[2] = "\\";
     enum FileType type = FILE_TYPE_DIR;
 
+    const uint64_t before = get_current_time();
     struct FileNode* root = create_file_node(NULL, name, type);
 
-    struct Timestamp timestamp = get_current_time();
     cr_assert_str_eq(root->info.metadata.name, name);
-    cr_assert_eq(root->info.metadata.creationTime.hour, timestamp.hour);
-    cr_assert_eq(root->info.metadata.creationTime.minute, timestamp.minute);
+    cr_assert_geq(root->info.metadata.creationTime, before);
+    cr_assert_leq(root->info.metadata.creationTime, get_current_time());
     cr_assert_eq(root->info.properties.type, type);
     cr_assert_eq(root->info.properties.permissions, PERM_DEFAULT - PERMISSION_MASK);
     cr_assert_eq(root->parent, root);
@@ -160,6 +166,122 @@ Test(get_file_node_size, directory_with_files) {
     free_file_node_recursive(dir);
 }
 
+Test(wsfs_stat, totals_follow_changes) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* inner = create_file_node_ctx(context, dir, "inner", FILE_TYPE_DIR);
+    change_permissions_ctx(context, inner, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, inner, "file", FILE_TYPE_FILE);
+    struct WsfsStat stat;
+
+    cr_assert_eq(wsfs_stat(NULL, &stat), EXIT_FAILURE);
+    cr_assert_eq(wsfs_stat(root, &stat), EXIT_SUCCESS);
+    cr_assert_eq(stat.type, FILE_TYPE_DIR);
+    cr_assert_eq(stat.childCount, 1);
+    cr_assert_eq(stat.subtreeCount, 4);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+
+    write_to_file_ctx(context, file, "content");
+    wsfs_append_ctx(context, file, "!", 1);
+    wsfs_stat(file, &stat);
+    cr_assert_eq(stat.contentSize, 8);
+    cr_assert_eq(stat.subtreeCount, 1);
+    change_permissions_ctx(context, inner, PERM_WRITE | PERM_EXEC);
+    cr_assert_eq(wsfs_stat(inner, &stat), EXIT_SUCCESS);
+    cr_assert_eq(stat.permissions, PERM_WRITE | PERM_EXEC);
+    cr_assert_eq(stat.childCount, 0);
+    cr_assert_eq(stat.subtreeSize, 0);
+    cr_assert_eq(stat.subtreeCount, 0);
+    change_permissions_ctx(context, inner, PERM_DEFAULT);
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+    wsfs_truncate_ctx(context, file, 2);
+    change_file_node_name_ctx(context, inner, "inner directory with a long name");
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+
+    // Moved subtree leaves totals of its old directory
+    cr_assert_eq(change_file_node_location_ctx(context, root, inner), EXIT_SUCCESS);
+    wsfs_stat(dir, &stat);
+    cr_assert_eq(stat.subtreeCount, 1);
+    cr_assert_eq(stat.subtreeSize, sizeof(struct FileNode) + strlen("dir") + 1);
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+
+    cr_assert_eq(copy_file_node_ctx(context, dir, inner), EXIT_SUCCESS);
+    wsfs_stat(dir, &stat);
+    cr_assert_eq(stat.subtreeCount, 3);
+    cr_assert_eq(stat.subtreeSize, get_file_node_size(dir));
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeCount, 6);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+
+    cr_assert_eq(delete_file_node_ctx(context, root, inner), EXIT_SUCCESS);
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeCount, 4);
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+
+    free_wsfs_context(context);
+}
+
+Test(wsfs_stat, times_follow_changes) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE);
+    change_permissions_ctx(context, file, PERM_DEFAULT);
+    struct WsfsStat stat;
+
+    wsfs_stat(file, &stat);
+    const struct FileTimes created = stat.times;
+    cr_assert_eq(created.modificationTime, created.creationTime);
+    cr_assert_eq(created.accessTime, created.creationTime);
+    wsfs_stat(dir, &stat);
+    cr_assert_geq(stat.times.modificationTime, created.creationTime);
+
+    wait_for_clock_tick();
+    write_to_file_ctx(context, file, "content");
+    wsfs_stat(file, &stat);
+    cr_assert_eq(stat.times.creationTime, created.creationTime);
+    cr_assert_gt(stat.times.modificationTime, created.modificationTime);
+    cr_assert_geq(stat.times.accessTime, stat.times.modificationTime);
+    const uint64_t written = stat.times.modificationTime;
+
+    // Reading moves only access time
+    wait_for_clock_tick();
+    cr_assert_str_eq(read_file_content_ctx(context, file), "content");
+    wsfs_stat(file, &stat);
+    cr_assert_eq(stat.times.modificationTime, written);
+    cr_assert_gt(stat.times.accessTime, written);
+
+    // Rename changes child list of directory, not file itself
+    wsfs_stat(dir, &stat);
+    const uint64_t listed = stat.times.modificationTime;
+    wait_for_clock_tick();
+    cr_assert_eq(change_file_node_name_ctx(context, file, "renamed"), EXIT_SUCCESS);
+    wsfs_stat(dir, &stat);
+    cr_assert_gt(stat.times.modificationTime, listed);
+    wsfs_stat(file, &stat);
+    cr_assert_eq(stat.times.modificationTime, written);
+
+    // Copy keeps times of original
+    cr_assert_eq(copy_file_node_ctx(context, root, file), EXIT_SUCCESS);
+    struct WsfsStat copyStat;
+    wsfs_stat(root->info.data.directoryTail, &copyStat);
+    wsfs_stat(file, &stat);
+    cr_assert_eq(copyStat.times.creationTime, stat.times.creationTime);
+    cr_assert_eq(copyStat.times.modificationTime, stat.times.modificationTime);
+
+    free_wsfs_context(context);
+}
+
 Test(change_current_dir, dir_exists) {
     struct FileNode* currentDir = create_file_node(NULL, "\\", FILE_TYPE_DIR);
     struct FileNode* newCurrentDir = create_file_node(currentDir, "dir", FILE_TYPE_DIR);
@@ -169,8 +291,7 @@ Test(change_current_dir, dir_exists) {
 
     cr_assert_eq(currentDir, newCurrentDir);
     cr_assert_str_eq(currentDir->info.metadata.name, newCurrentDir->info.metadata.name);
-    cr_assert_eq(currentDir->info.metadata.creationTime.hour, newCurrentDir->info.metadata.creationTime.hour);
-    cr_assert_eq(currentDir->info.metadata.creationTime.minute, newCurrentDir->info.metadata.creationTime.minute);
+    cr_assert_eq(currentDir->info.metadata.creationTime, newCurrentDir->info.metadata.creationTime);
     cr_assert_eq(currentDir->info.properties.type, newCurrentDir->info.properties.type);
     cr_assert_eq(currentDir->info.data.directoryContent, newCurrentDir->info.data.directoryContent);
     cr_assert_eq(currentDir->info.data.fileContent, newCurrentDir->info.data.fileContent);
@@ -187,8 +308,7 @@ Test(change_current_dir, dir_not_exists) {
     change_current_dir(&currentDir, NULL);
 
     cr_assert_str_eq(currentDir->info.metadata.name, currentDir->info.metadata.name);
-    cr_assert_eq(currentDir->info.metadata.creationTime.hour, currentDir->info.metadata.creationTime.hour);
-    cr_assert_eq(currentDir->info.metadata.creationTime.minute, currentDir->info.metadata.creationTime.minute);
+    cr_assert_eq(currentDir->info.metadata.creationTime, currentDir->info.metadata.creationTime);
     cr_assert_eq(currentDir->info.properties.type, currentDir->info.properties.type);
     cr_assert_eq(currentDir->info.data.directoryContent, currentDir->info.data.directoryContent);
     cr_assert_eq(currentDir->info.data.fileContent, currentDir->info.data.fileContent);
@@ -210,8 +330,7 @@ Test(change_current_dir, symlink) {
     change_current_dir(&currentDir, symlink);
 
     cr_assert_str_eq(currentDir->info.metadata.name, newCurrentDir->info.metadata.name);
-    cr_assert_eq(currentDir->info.metadata.creationTime.hour, newCurrentDir->info.metadata.creationTime.hour);
-    cr_assert_eq(currentDir->info.metadata.creationTime.minute, newCurrentDir->info.metadata.creationTime.minute);
+    cr_assert_eq(currentDir->info.metadata.creationTime, newCurrentDir->info.metadata.creationTime);
     cr_assert_eq(currentDir->info.properties.type, newCurrentDir->info.properties.type);
     cr_assert_eq(currentDir->info.data.directoryContent, newCurrentDir->info.data.directoryContent);
     cr_assert_eq(currentDir->info.data.fileContent, newCurrentDir->info.data.fileContent);
@@ -512,6 +631,81 @@ Test(find_file_node_in_fs, root_or_name_is_null) {
     cr_assert_null(find_file_node_in_fs((struct FileNode*)1, NULL));
 }
 
+Test(find_file_node_in_fs, finds_nodes_of_subtree_only) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* left = create_file_node_ctx(context, root, "left", FILE_TYPE_DIR);
+    struct FileNode* right = create_file_node_ctx(context, root, "right", FILE_TYPE_DIR);
+    change_permissions_ctx(context, left, PERM_DEFAULT);
+    change_permissions_ctx(context, right, PERM_DEFAULT);
+    struct FileNode* nested = create_file_node_ctx(context, left, "nested", FILE_TYPE_DIR);
+    change_permissions_ctx(context, nested, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, nested, "file", FILE_TYPE_FILE);
+    struct NameIndexStats stats;
+
+    cr_assert_eq(find_file_node_in_fs_ctx(context, root, "file"), file);
+    cr_assert_eq(find_file_node_in_fs_ctx(context, left, "file"), file);
+    cr_assert_null(find_file_node_in_fs_ctx(context, right, "file"));
+    cr_assert_eq(find_file_node_in_fs_ctx(context, root, "\\"), root);
+
+    cr_assert_eq(change_file_node_location_ctx(context, right, nested), EXIT_SUCCESS);
+    cr_assert_null(find_file_node_in_fs_ctx(context, left, "file"));
+    cr_assert_eq(find_file_node_in_fs_ctx(context, right, "file"), file);
+
+    // Missing name is answered by filter
+    cr_assert_null(find_file_node_in_fs_ctx(context, root, "missing"));
+    get_name_lookup_stats_ctx(context, &stats);
+    cr_assert_eq(stats.filterRejects, 1);
+    cr_assert_eq(stats.nodes, 5);
+
+    cr_assert_eq(delete_file_node_ctx(context, right, nested), EXIT_SUCCESS);
+    cr_assert_null(find_file_node_in_fs_ctx(context, root, "file"));
+    free_wsfs_context(context);
+}
+
+Test(find_file_nodes_in_fs, finds_every_node_with_name) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dirs[3];
+    for (int i = 0; i < 3; i++) {
+        char name[16];
+        sprintf(name, "dir%d", i);
+        dirs[i] = create_file_node_ctx(context, i == 2 ? dirs[0] : root, name, FILE_TYPE_DIR);
+        change_permissions_ctx(context, dirs[i], PERM_DEFAULT);
+        create_file_node_ctx(context, dirs[i], "notes", FILE_TYPE_FILE);
+    }
+    uint32_t count;
+
+    struct FileNode** nodes = find_file_nodes_in_fs_ctx(context, root, "notes", &count);
+    cr_assert_eq(count, 3);
+    for (uint32_t i = 0; i < count; i++) {
+        cr_assert_str_eq(nodes[i]->info.metadata.name, "notes");
+    }
+    free(nodes);
+
+    cr_assert_eq(create_tree_snapshot_ctx(context, "before"), EXIT_SUCCESS);
+    nodes = find_file_nodes_in_fs_ctx(context, get_tree_snapshot_ctx(context, "before"), "notes", &count);
+    cr_assert_eq(count, 3);
+    cr_assert(nodes[0]->info.properties.isReadOnly);
+    free(nodes);
+
+    cr_assert_eq(change_file_node_name_ctx(context, dirs[1]->info.data.directoryContent, "renamed"), EXIT_SUCCESS);
+    cr_assert_eq(delete_file_node_ctx(context, root, dirs[0]), EXIT_SUCCESS);
+    nodes = find_file_nodes_in_fs_ctx(context, root, "notes", &count);
+    cr_assert_eq(count, 0);
+    cr_assert_null(nodes);
+    nodes = find_file_nodes_in_fs_ctx(context, root, "renamed", &count);
+    cr_assert_eq(count, 1);
+    cr_assert_eq(nodes[0], dirs[1]->info.data.directoryContent);
+    free(nodes);
+
+    free_wsfs_context(context);
+}
+
 Test(get_file_node_path, existing_file) {
     struct FileNode* root = create_file_node(NULL, "\\", FILE_TYPE_DIR);
     const struct FileNode* file = create_file_node(root, "file", FILE_TYPE_FILE);
@@ -610,6 +804,26 @@ Test(change_file_node_location, node_without_permissions) {
     free_file_node_recursive(location);
 }
 
+Test(change_file_node_location, into_own_subtree) {
+    struct FileNode* root = create_file_node(NULL, "\\", FILE_TYPE_DIR);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    struct FileNode* inner = create_file_node(dir, "inner", FILE_TYPE_DIR);
+    struct FileNode* deepest = create_file_node(inner, "deepest", FILE_TYPE_DIR);
+    const size_t size = get_file_node_size(root);
+
+    cr_assert_eq(change_file_node_location(deepest, dir), 1);
+    cr_assert_eq(change_file_node_location(inner, root), 1);
+    cr_assert_eq(dir->parent, root);
+    cr_assert_eq(get_file_node_size(root), size);
+
+    cr_assert_eq(change_file_node_location(root, deepest), 0);
+    cr_assert_eq(change_file_node_location(deepest, dir), 0);
+    cr_assert_eq(inner->parent, dir);
+    cr_assert_eq(get_file_node_size(root), size);
+
+    free_file_node_recursive(root);
+}
+
 Test(copy_file_node, copy_single_file) {
     struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
     struct FileNode* file = create_file_node(root, "file", FILE_TYPE_FILE);
@@ -687,24 +901,14 @@ Test(delete_file_node, delete_existing) {
 }
 
 Test(get_current_time, basic) {
-    time_t rawTime;
-    time(&rawTime);
-    const struct tm* timeInfo = localtime(&rawTime);
-
-    const struct Timestamp currentTime1 = {
-        .year=timeInfo->tm_year + 1900,
-        .month=timeInfo->tm_mon + 1,
-        .day=timeInfo->tm_mday,
-        .hour=timeInfo->tm_hour,
-        .minute=timeInfo->tm_min,
-    };
-    const struct Timestamp currentTime2 = get_current_time();
-
-    cr_assert_eq(currentTime1.year, currentTime2.year);
-    cr_assert_eq(currentTime1.month, currentTime2.month);
-    cr_assert_eq(currentTime1.day, currentTime2.day);
-    cr_assert_eq(currentTime1.hour, currentTime2.hour);
-    cr_assert_eq(currentTime1.minute, currentTime2.minute);
+    const uint64_t before = (uint64_t)time(NULL);
+    const uint64_t currentTime = get_current_time();
+    const uint64_t after = (uint64_t)time(NULL);
+
+    // Coarse clock may lag one tick behind time()
+    cr_assert_geq(currentTime / 1000000000u + 1, before);
+    cr_assert_leq(currentTime / 1000000000u, after);
+    cr_assert_geq(get_current_time(), currentTime);
 }
 
 Test(is_enough_memory, memory_under_limit) {
@@ -724,4 +928,1008 @@ Test(is_enough_memory, memory_over_limit)
     cr_assert_eq(is_enough_memory(MAX_MEMORY_SIZE), 0);
 
     free(allocatedMemory);
-}
\ No newline at end of file
+}
+
+Test(is_enough_memory, runtime_limit) {
+    set_memory_limit(100);
+
+    cr_assert_eq(is_enough_memory(99), 1);
+    cr_assert_eq(is_enough_memory(100), 0);
+
+    set_memory_limit(MAX_MEMORY_SIZE);
+}
+
+Test(set_memory_limit, blocks_creation) {
+    set_memory_limit(sizeof(struct FileNode));
+
+    cr_assert_null(create_file_node(NULL, "file", FILE_TYPE_FILE));
+    cr_assert_eq(get_memory_limit(), sizeof(struct FileNode));
+
+    set_memory_limit(MAX_MEMORY_SIZE);
+}
+
+Test(set_file_count_limit, blocks_creation) {
+    set_file_count_limit(1);
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+
+    cr_assert_not_null(dir);
+    cr_assert_null(create_file_node(dir, "file", FILE_TYPE_FILE));
+    cr_assert_eq(get_file_count_limit(), 1);
+
+    free_file_node_recursive(dir);
+    set_file_count_limit(MAX_FILE_COUNT);
+}
+
+Test(get_used_memory, tracks_create_and_free) {
+    const uint64_t before = get_used_memory();
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    create_file_node(dir, "file", FILE_TYPE_FILE);
+
+    cr_assert_eq(get_used_memory() - before, get_file_node_size(dir));
+    cr_assert_eq(get_file_count(), 2);
+
+    free_file_node_recursive(dir);
+
+    cr_assert_eq(get_used_memory(), before);
+    cr_assert_eq(get_file_count(), 0);
+}
+
+Test(get_used_memory, tracks_write_and_rename) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+
+    write_to_file(file, "Hello");
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    write_to_file(file, "Hi");
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    change_file_node_name(file, "longer name");
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    free_file_node_recursive(file);
+    cr_assert_eq(get_used_memory(), 0);
+}
+
+Test(get_used_memory, tracks_copy) {
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    struct FileNode* subdir = create_file_node(root, "subdir", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(subdir, "file", FILE_TYPE_FILE);
+    write_to_file(file, "World");
+
+    copy_file_node(root, subdir);
+
+    cr_assert_eq(get_used_memory(), get_file_node_size(root));
+    cr_assert_eq(get_file_count(), 5);
+
+    free_file_node_recursive(root);
+}
+
+static struct FileNode* create_big_dir(const int count) {
+    set_file_count_limit(count + 2);
+    set_memory_limit(UINT64_MAX);
+
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    for (int i = 0; i < count; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        create_file_node(dir, name, FILE_TYPE_FILE);
+    }
+
+    return dir;
+}
+
+Test(find_file_node_in_curr_dir, builds_index_in_big_dir) {
+    struct FileNode* dir = create_big_dir(DIR_INDEX_THRESHOLD * 4);
+
+    cr_assert_null(find_file_node_in_curr_dir(dir, "not exist"));
+    cr_assert_not_null(dir->info.data.directoryIndex);
+
+    const struct FileNode* found = find_file_node_in_curr_dir(dir, "file42");
+    cr_assert_not_null(found);
+    cr_assert_str_eq(found->info.metadata.name, "file42");
+
+    const struct FileNode* added = create_file_node(dir, "added", FILE_TYPE_FILE);
+    cr_assert_eq(find_file_node_in_curr_dir(dir, "added"), added);
+
+    free_file_node_recursive(dir);
+}
+
+Test(find_file_node_in_curr_dir, small_dir_has_no_index) {
+    struct FileNode* dir = create_big_dir(2);
+
+    cr_assert_not_null(find_file_node_in_curr_dir(dir, "file1"));
+    cr_assert_null(dir->info.data.directoryIndex);
+
+    free_file_node_recursive(dir);
+}
+
+Test(find_file_node_in_curr_dir, index_follows_rename_move_and_delete) {
+    struct FileNode* dir = create_big_dir(DIR_INDEX_THRESHOLD * 2);
+    struct FileNode* location = create_file_node(NULL, "location", FILE_TYPE_DIR);
+    find_file_node_in_curr_dir(dir, "not exist");
+
+    struct FileNode* renamed = find_file_node_in_curr_dir(dir, "file3");
+    change_file_node_name(renamed, "renamed");
+    cr_assert_null(find_file_node_in_curr_dir(dir, "file3"));
+    cr_assert_eq(find_file_node_in_curr_dir(dir, "renamed"), renamed);
+
+    struct FileNode* moved = find_file_node_in_curr_dir(dir, "file5");
+    change_file_node_location(location, moved);
+    cr_assert_null(find_file_node_in_curr_dir(dir, "file5"));
+
+    delete_file_node(dir, find_file_node_in_curr_dir(dir, "file7"));
+    cr_assert_null(find_file_node_in_curr_dir(dir, "file7"));
+    cr_assert_not_null(find_file_node_in_curr_dir(dir, "file8"));
+
+    free_file_node_recursive(dir);
+    free_file_node_recursive(location);
+}
+
+Test(add_to_dir, keeps_tail_and_count) {
+    struct FileNode* parent = create_file_node(NULL, "parent", FILE_TYPE_DIR);
+    struct FileNode* child1 = create_file_node(parent, "child1", FILE_TYPE_FILE);
+    struct FileNode* child2 = create_file_node(parent, "child2", FILE_TYPE_FILE);
+
+    cr_assert_eq(parent->info.data.directoryTail, child2);
+    cr_assert_eq(child2->prev, child1);
+    cr_assert_null(child1->prev);
+    cr_assert_eq(get_dir_child_count(parent), 2);
+
+    free_file_node_recursive(parent);
+}
+
+Test(get_dir_child_count, not_a_directory) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+
+    cr_assert_eq(get_dir_child_count(file), 0);
+    cr_assert_eq(get_dir_child_count(NULL), 0);
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_readdir, pages_through_changing_dir) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    char name[16];
+    for (int i = 0; i < 500; i++) {
+        sprintf(name, "f%03d", i * 7919 % 500);
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+    struct WsfsDirCookie cookie = WSFS_DIR_COOKIE_INIT;
+    struct FileNode* children[7];
+    char last[16] = "";
+    uint32_t total = 0;
+    uint32_t count;
+
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 7), 7);
+    cr_assert_str_eq(cookie.name, "f006");
+    // Children before cookie aren't listed, children after it are
+    create_file_node_ctx(context, dir, "a", FILE_TYPE_FILE);
+    create_file_node_ctx(context, dir, "g", FILE_TYPE_FILE);
+    delete_file_node_ctx(context, dir, find_file_node_in_curr_dir_ctx(context, dir, "f499"));
+    change_file_node_name_ctx(context, find_file_node_in_curr_dir_ctx(context, dir, "f300"), "e300");
+    // Cookie doesn't point to its child, so it survives its deletion
+    delete_file_node_ctx(context, dir, children[6]);
+    total = 7;
+    strcpy(last, "f006");
+    while ((count = wsfs_readdir(dir, &cookie, children, 7)) > 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            cr_assert_lt(strcmp(last, children[i]->info.metadata.name), 0);
+            strcpy(last, children[i]->info.metadata.name);
+        }
+        total += count;
+    }
+
+    cr_assert_eq(total, 500 - 2 + 1);
+    cr_assert_str_eq(last, "g");
+    cr_assert_null(cookie.name);
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 7), 7);
+    cr_assert_str_eq(children[0]->info.metadata.name, "a");
+    wsfs_release_dir_cookie(&cookie);
+    cr_assert_null(cookie.name);
+    free_wsfs_context(context);
+}
+
+Test(wsfs_readdir, small_dir) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(dir, "c", FILE_TYPE_FILE);
+    create_file_node(dir, "a", FILE_TYPE_FILE);
+    create_file_node(dir, "b", FILE_TYPE_FILE);
+    struct WsfsDirCookie cookie = WSFS_DIR_COOKIE_INIT;
+    struct FileNode* children[3];
+
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 2), 2);
+    cr_assert_str_eq(children[0]->info.metadata.name, "a");
+    cr_assert_str_eq(children[1]->info.metadata.name, "b");
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 2), 1);
+    cr_assert_eq(children[0], file);
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 2), 0);
+    cr_assert_eq(wsfs_readdir(file, &cookie, children, 2), 0);
+    cr_assert_eq(wsfs_readdir(dir, &cookie, children, 0), 0);
+    cr_assert_eq(wsfs_readdir(dir, NULL, children, 2), 0);
+
+    free_file_node_recursive(dir);
+}
+
+Test(delete_file_node, delete_middle_and_last) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* file1 = create_file_node(dir, "file1", FILE_TYPE_FILE);
+    struct FileNode* file2 = create_file_node(dir, "file2", FILE_TYPE_FILE);
+    struct FileNode* file3 = create_file_node(dir, "file3", FILE_TYPE_FILE);
+
+    delete_file_node(dir, file2);
+    cr_assert_eq(file1->next, file3);
+    cr_assert_eq(file3->prev, file1);
+
+    delete_file_node(dir, file3);
+    cr_assert_eq(dir->info.data.directoryTail, file1);
+    cr_assert_null(file1->next);
+    cr_assert_eq(get_dir_child_count(dir), 1);
+
+    free_file_node_recursive(dir);
+}
+
+Test(delete_file_node, node_from_other_dir) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* other = create_file_node(NULL, "other", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(other, "file", FILE_TYPE_FILE);
+
+    cr_assert_eq(delete_file_node(dir, file), 1);
+    cr_assert_eq(other->info.data.directoryContent, file);
+
+    free_file_node_recursive(dir);
+    free_file_node_recursive(other);
+}
+
+Test(change_file_node_location, updates_tail_and_count) {
+    struct FileNode* parent = create_file_node(NULL, "\\", FILE_TYPE_DIR);
+    struct FileNode* location = create_file_node(NULL, "new location", FILE_TYPE_DIR);
+    struct FileNode* node1 = create_file_node(parent, "file1", FILE_TYPE_FILE);
+    struct FileNode* node2 = create_file_node(parent, "file2", FILE_TYPE_FILE);
+    struct FileNode* node3 = create_file_node(location, "file3", FILE_TYPE_FILE);
+
+    change_file_node_location(location, node2);
+
+    cr_assert_eq(parent->info.data.directoryTail, node1);
+    cr_assert_eq(get_dir_child_count(parent), 1);
+    cr_assert_eq(location->info.data.directoryTail, node2);
+    cr_assert_eq(node2->prev, node3);
+    cr_assert_eq(get_dir_child_count(location), 2);
+
+    free_file_node_recursive(parent);
+    free_file_node_recursive(location);
+}
+
+Test(get_allocator_stats, nodes_come_from_slabs) {
+    struct AllocatorStats stats;
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    create_file_node(dir, "file", FILE_TYPE_FILE);
+
+    get_allocator_stats(&stats);
+    cr_assert_eq(stats.classes[0].objectsUsed, 2);
+    cr_assert_geq(stats.usedBytes, 2 * sizeof(struct FileNode));
+
+    free_file_node_recursive(dir);
+    get_allocator_stats(&stats);
+    cr_assert_eq(stats.usedBytes, 0);
+}
+
+Test(create_file_node, short_name_is_inline) {
+    struct FileNode* node = create_file_node(NULL, "short", FILE_TYPE_FILE);
+
+    cr_assert_eq(node->info.metadata.name, node->info.metadata.inlineName);
+    cr_assert_eq(node->info.metadata.nameLength, 5);
+
+    free_file_node_recursive(node);
+}
+
+Test(create_file_node, long_name_is_allocated) {
+    const char name[] = "name that doesn't fit into file node";
+    struct FileNode* node = create_file_node(NULL, name, FILE_TYPE_FILE);
+
+    cr_assert_neq(node->info.metadata.name, node->info.metadata.inlineName);
+    cr_assert_str_eq(node->info.metadata.name, name);
+
+    free_file_node_recursive(node);
+}
+
+Test(change_file_node_name, switch_between_inline_and_allocated) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* file = create_file_node(NULL, "old", FILE_TYPE_FILE);
+    const char longName[] = "name that doesn't fit into file node";
+
+    change_file_node_name(file, longName);
+    cr_assert_str_eq(file->info.metadata.name, longName);
+    cr_assert_neq(file->info.metadata.name, file->info.metadata.inlineName);
+
+    change_file_node_name(file, "new");
+    cr_assert_str_eq(file->info.metadata.name, "new");
+    cr_assert_eq(file->info.metadata.name, file->info.metadata.inlineName);
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    free_file_node_recursive(file);
+}
+
+Test(copy_file_node, copy_has_own_inline_name) {
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(root, "file", FILE_TYPE_FILE);
+
+    copy_file_node(root, file);
+    struct FileNode* fileCopy = root->info.data.directoryTail;
+    change_file_node_name(file, "renamed");
+
+    cr_assert_eq(fileCopy->info.metadata.name, fileCopy->info.metadata.inlineName);
+    cr_assert_str_eq(fileCopy->info.metadata.name, "file");
+
+    free_file_node_recursive(root);
+}
+
+Test(get_file_node_path, long_names) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "\\", FILE_TYPE_DIR);
+    struct FileNode* dir = create_file_node(root, "directory with a very long name", FILE_TYPE_DIR);
+    const struct FileNode* file = create_file_node(dir, "file", FILE_TYPE_FILE);
+
+    char* path = get_file_node_path(file);
+    cr_assert_str_eq(path, "\\directory with a very long name\\file");
+
+    free(path);
+    free_file_node_recursive(root);
+}
+
+Test(wsfs_pwrite, write_at_offset) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    write_to_file(file, "Hello world");
+
+    cr_assert_eq(wsfs_pwrite(file, "W", 1, 6), EXIT_SUCCESS);
+
+    cr_assert_str_eq(read_file_content(file), "Hello World");
+    cr_assert_eq(get_file_content_size(file), 11);
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_pwrite, past_end_fills_gap_with_zeros) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char buffer[8];
+
+    wsfs_pwrite(file, "ab", 2, 6);
+
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), 0), 8);
+    cr_assert_eq(memcmp(buffer, "\0\0\0\0\0\0ab", sizeof(buffer)), 0);
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_pwrite, memory_limit_is_reached) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    const uint64_t usedMemory = get_used_memory();
+    char buffer[MAX_MEMORY_SIZE];
+    memset(buffer, 'a', sizeof(buffer));
+
+    cr_assert_eq(wsfs_pwrite(file, buffer, sizeof(buffer), 0), EXIT_FAILURE);
+    cr_assert_eq(get_file_content_size(file), 0);
+    cr_assert_eq(get_used_memory(), usedMemory);
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_pwrite, file_without_permissions) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    change_permissions(file, PERM_READ);
+
+    cr_assert_eq(wsfs_pwrite(file, "a", 1, 0), EXIT_FAILURE);
+    cr_assert_eq(wsfs_pwrite(NULL, "a", 1, 0), EXIT_FAILURE);
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_pread, binary_content) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    const char data[] = {'a', '\0', 'b', '\0'};
+    char buffer[sizeof(data)];
+    wsfs_pwrite(file, data, sizeof(data), 0);
+
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), 0), sizeof(data));
+    cr_assert_eq(memcmp(buffer, data, sizeof(data)), 0);
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), 2), 2);
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), 4), 0);
+
+    free_file_node_recursive(file);
+}
+
+Test(wsfs_pread, symlink) {
+    struct FileNode* symlink = create_file_node(NULL, "symlink", FILE_TYPE_SYMLINK);
+    struct FileNode* target = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    set_symlink_target(symlink, target);
+    char buffer[5];
+    write_to_file(target, "Hello");
+
+    cr_assert_eq(wsfs_pread(symlink, buffer, sizeof(buffer), 0), 5);
+    cr_assert_eq(memcmp(buffer, "Hello", 5), 0);
+
+    free_file_node_recursive(target);
+    free_file_node_recursive(symlink);
+}
+
+Test(wsfs_append, many_small_appends) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char buffer[10];
+
+    for (int i = 0; i < 10000; i++) {
+        const char digit = (char)('0' + i % 10);
+        cr_assert_eq(wsfs_append(file, &digit, 1), EXIT_SUCCESS);
+    }
+
+    cr_assert_eq(get_file_content_size(file), 10000);
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), FILE_CHUNK_SIZE - 6), sizeof(buffer));
+    cr_assert_eq(memcmp(buffer, "0123456789", sizeof(buffer)), 0);
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+    cr_assert_eq(strlen(read_file_content(file)), 10000);
+
+    free_file_node_recursive(file);
+    cr_assert_eq(get_used_memory(), 0);
+}
+
+Test(wsfs_truncate, shrink_and_grow) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char buffer[4];
+    write_to_file(file, "Hello");
+
+    cr_assert_eq(wsfs_truncate(file, 2), EXIT_SUCCESS);
+    cr_assert_str_eq(read_file_content(file), "He");
+
+    cr_assert_eq(wsfs_truncate(file, 4), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_pread(file, buffer, sizeof(buffer), 0), 4);
+    cr_assert_eq(memcmp(buffer, "He\0\0", sizeof(buffer)), 0);
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    cr_assert_eq(wsfs_truncate(file, 0), EXIT_SUCCESS);
+    cr_assert_null(read_file_content(file));
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    free_file_node_recursive(file);
+}
+
+Test(write_to_file, shorter_content_replaces_longer) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    char content[FILE_CHUNK_SIZE * 2];
+    memset(content, 'a', sizeof(content) - 1);
+    content[sizeof(content) - 1] = '\0';
+    write_to_file(file, content);
+
+    write_to_file(file, "short");
+
+    cr_assert_str_eq(read_file_content(file), "short");
+    cr_assert_eq(get_used_memory(), get_file_node_size(file));
+
+    free_file_node_recursive(file);
+}
+
+Test(copy_file_node, content_is_copied) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(root, "file", FILE_TYPE_FILE);
+    char buffer[3];
+    wsfs_pwrite(file, "end", 3, FILE_CHUNK_SIZE * 2);
+
+    copy_file_node(root, file);
+    struct FileNode* fileCopy = root->info.data.directoryTail;
+    wsfs_truncate(file, 0);
+
+    cr_assert_eq(get_file_content_size(fileCopy), FILE_CHUNK_SIZE * 2 + 3);
+    cr_assert_eq(wsfs_pread(fileCopy, buffer, sizeof(buffer), FILE_CHUNK_SIZE * 2), 3);
+    cr_assert_eq(memcmp(buffer, "end", sizeof(buffer)), 0);
+    cr_assert_eq(get_used_memory(), get_file_node_size(root));
+
+    free_file_node_recursive(root);
+}
+
+Test(copy_file_node, copies_whole_subtree) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    struct FileNode* subdir = create_file_node(dir, "subdir", FILE_TYPE_DIR);
+    struct FileNode* deepest = create_file_node(subdir, "deepest", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(deepest, "file", FILE_TYPE_FILE);
+    write_to_file(file, "deep");
+
+    cr_assert_eq(copy_file_node(subdir, dir), EXIT_SUCCESS);
+
+    // Copy of directory into itself holds the subtree as it was before
+    const struct FileNode* dirCopy = subdir->info.data.directoryTail;
+    cr_assert_str_eq(dirCopy->info.metadata.name, "dir");
+    const struct FileNode* fileCopy = dirCopy->info.data.directoryContent->info.data.directoryContent
+                                      ->info.data.directoryContent;
+    cr_assert_str_eq(fileCopy->info.metadata.name, "file");
+    cr_assert_str_eq(fileCopy->info.data.fileContent, "deep");
+    cr_assert_eq(fileCopy->info.data.fileContent, file->info.data.fileContent);
+    cr_assert_eq(get_dir_child_count(dirCopy->info.data.directoryContent), 1);
+    cr_assert_eq(get_file_count(), 9);
+    cr_assert_eq(get_used_memory(), get_file_node_size(root));
+
+    free_file_node_recursive(root);
+}
+
+Test(copy_file_node, limit_leaves_nothing_copied) {
+    set_memory_limit(UINT64_MAX);
+    set_file_count_limit(5);
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    create_file_node(dir, "first", FILE_TYPE_FILE);
+    create_file_node(dir, "second", FILE_TYPE_FILE);
+
+    cr_assert_eq(copy_file_node(root, dir), EXIT_FAILURE);
+
+    cr_assert_eq(get_dir_child_count(root), 1);
+    cr_assert_eq(get_file_count(), 4);
+    cr_assert_eq(get_used_memory(), get_file_node_size(root));
+
+    free_file_node_recursive(root);
+    set_file_count_limit(MAX_FILE_COUNT);
+}
+
+Test(set_dedup_enabled, equal_writes_share_content) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_dedup_enabled_ctx(context, 1);
+    struct FileNode* first = create_file_node_ctx(context, NULL, "first", FILE_TYPE_FILE);
+    struct FileNode* second = create_file_node_ctx(context, NULL, "second", FILE_TYPE_FILE);
+    struct ContentStoreStats stats;
+
+    cr_assert_eq(write_to_file_ctx(context, first, "template"), EXIT_SUCCESS);
+    cr_assert_eq(write_to_file_ctx(context, second, "template"), EXIT_SUCCESS);
+    cr_assert_eq(first->info.data.fileContent, second->info.data.fileContent);
+    get_dedup_stats_ctx(context, &stats);
+    cr_assert_eq(stats.contents, 1);
+    cr_assert_eq(stats.savedBytes, 8);
+    cr_assert_eq(stats.hits, 1);
+    // Every file is charged as if it had its own copy
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(first) + get_file_node_size(second));
+
+    cr_assert_eq(wsfs_append_ctx(context, first, "!", 1), EXIT_SUCCESS);
+    cr_assert_str_eq(read_file_content_ctx(context, first), "template!");
+    cr_assert_str_eq(read_file_content_ctx(context, second), "template");
+    cr_assert_eq(write_to_file_ctx(context, first, ""), EXIT_SUCCESS);
+    cr_assert_eq(get_file_content_size(first), 0);
+    get_dedup_stats_ctx(context, &stats);
+    cr_assert_eq(stats.savedBytes, 0);
+
+    free_file_node_recursive_ctx(context, first);
+    free_file_node_recursive_ctx(context, second);
+    get_dedup_stats_ctx(context, &stats);
+    cr_assert_eq(stats.contents, 0);
+    cr_assert_eq(get_used_memory_ctx(context), 0);
+    free_wsfs_context(context);
+}
+
+Test(compress_cold_files, charges_compressed_size) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_file_count_limit_ctx(context, 100);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE);
+    char content[FILE_CHUNK_SIZE * 4];
+    for (uint64_t i = 0; i < sizeof(content) - 1; i++) {
+        content[i] = (char)('a' + i % 7);
+    }
+    content[sizeof(content) - 1] = '\0';
+    write_to_file_ctx(context, file, content);
+    struct CompressionStats stats;
+
+    cr_assert_eq(compress_cold_files_ctx(context), 0);
+    set_compression_window_ctx(context, 0);
+    cr_assert_eq(compress_cold_files_ctx(context), 1);
+    cr_assert_gt(get_file_compressed_size(file), 0);
+    cr_assert_eq(get_file_content_size(file), sizeof(content) - 1);
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(root));
+    cr_assert_lt(get_used_memory_ctx(context), sizeof(content));
+
+    // Copy keeps content compressed, reads decode it
+    cr_assert_eq(copy_file_node_ctx(context, root, file), EXIT_SUCCESS);
+    struct FileNode* copy = find_file_node_in_curr_dir_ctx(context, root, "file");
+    cr_assert_gt(get_file_compressed_size(copy), 0);
+    cr_assert_str_eq(read_file_content_ctx(context, copy), content);
+    get_compression_stats_ctx(context, &stats);
+    cr_assert_eq(stats.files, 2);
+    cr_assert_eq(stats.uncompressedBytes, 2 * (sizeof(content) - 1));
+
+    cr_assert_eq(wsfs_append_ctx(context, file, "!", 1), EXIT_SUCCESS);
+    cr_assert_eq(get_file_compressed_size(file), 0);
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(root));
+    get_compression_stats_ctx(context, &stats);
+    cr_assert_eq(stats.files, 1);
+    cr_assert_eq(stats.decompressions, 1);
+
+    // Copy was just read, it stays compressed but its decoded copy is dropped once it is cold
+    cr_assert_eq(compress_cold_files_ctx(context), 1);
+    cr_assert_eq(copy->info.data.contentFlat, NULL);
+    cr_assert_eq(delete_file_node_ctx(context, root, copy), EXIT_SUCCESS);
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(root));
+    free_wsfs_context(context);
+}
+
+static struct WsfsContext* create_snapshot_context(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_file_count_limit_ctx(context, 100);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    write_to_file_ctx(context, create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE), "before");
+
+    return context;
+}
+
+Test(create_tree_snapshot, unchanged_by_later_changes) {
+    struct WsfsContext* context = create_snapshot_context();
+    struct FileNode* root = get_root_node_ctx(context);
+    struct FileNode* dir = find_file_node_in_curr_dir_ctx(context, root, "dir");
+    struct FileNode* file = find_file_node_in_curr_dir_ctx(context, dir, "file");
+
+    cr_assert_eq(create_tree_snapshot_ctx(context, "first"), EXIT_SUCCESS);
+    cr_assert_eq(create_tree_snapshot_ctx(context, "first"), EXIT_FAILURE);
+    write_to_file_ctx(context, file, "after");
+    create_file_node_ctx(context, dir, "new", FILE_TYPE_FILE);
+    cr_assert_eq(create_tree_snapshot_ctx(context, "second"), EXIT_SUCCESS);
+    delete_file_node_ctx(context, root, dir);
+
+    struct FileNode* first = get_tree_snapshot_ctx(context, "first");
+    struct FileNode* second = get_tree_snapshot_ctx(context, "second");
+    cr_assert_not_null(first);
+    cr_assert_eq(first->parent, first);
+    cr_assert_str_eq(read_file_content_ctx(context, wsfs_lookup_path_ctx(context, first, "dir\\file",
+                                                                         LOOKUP_FOLLOW_ALL)), "before");
+    cr_assert_null(wsfs_lookup_path_ctx(context, first, "dir\\new", LOOKUP_FOLLOW_ALL));
+    cr_assert_str_eq(read_file_content_ctx(context, wsfs_lookup_path_ctx(context, second, "dir\\file",
+                                                                         LOOKUP_FOLLOW_ALL)), "after");
+    cr_assert_not_null(wsfs_lookup_path_ctx(context, second, "dir\\new", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(get_tree_snapshot_ctx(context, "third"));
+
+    cr_assert_eq(delete_tree_snapshot_ctx(context, "first"), EXIT_SUCCESS);
+    cr_assert_eq(delete_tree_snapshot_ctx(context, "first"), EXIT_FAILURE);
+    cr_assert_eq(delete_tree_snapshot_ctx(context, "second"), EXIT_SUCCESS);
+    cr_assert_eq(get_file_count_ctx(context), 1);
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(root));
+
+    free_wsfs_context(context);
+}
+
+Test(create_tree_snapshot, nodes_are_read_only) {
+    struct WsfsContext* context = create_snapshot_context();
+    struct FileNode* root = get_root_node_ctx(context);
+    cr_assert_eq(create_tree_snapshot_ctx(context, "snapshot"), EXIT_SUCCESS);
+    struct FileNode* snapshot = get_tree_snapshot_ctx(context, "snapshot");
+    struct FileNode* dir = find_file_node_in_curr_dir_ctx(context, snapshot, "dir");
+    struct FileNode* file = find_file_node_in_curr_dir_ctx(context, dir, "file");
+    uint32_t handle;
+
+    cr_assert_not(is_file_node_writable(file));
+    cr_assert_eq(write_to_file_ctx(context, file, "changed"), EXIT_FAILURE);
+    cr_assert_eq(wsfs_append_ctx(context, file, "!", 1), EXIT_FAILURE);
+    cr_assert_eq(wsfs_open_ctx(context, file, OPEN_WRITE, &handle), EXIT_FAILURE);
+    cr_assert_eq(change_permissions_ctx(context, file, PERM_DEFAULT), EXIT_FAILURE);
+    cr_assert_eq(change_file_node_name_ctx(context, file, "renamed"), EXIT_FAILURE);
+    cr_assert_eq(change_file_node_location_ctx(context, root, file), EXIT_FAILURE);
+    cr_assert_eq(delete_file_node_ctx(context, dir, file), EXIT_FAILURE);
+    cr_assert_eq(copy_file_node_ctx(context, dir, file), EXIT_FAILURE);
+    cr_assert_str_eq(read_file_content_ctx(context, file), "before");
+
+    // Copy restored from snapshot may be changed again
+    cr_assert_eq(copy_file_node_ctx(context, root, dir), EXIT_SUCCESS);
+    struct FileNode* restored = wsfs_lookup_path_ctx(context, root->info.data.directoryTail, "file",
+                                                     LOOKUP_FOLLOW_ALL);
+    cr_assert_eq(write_to_file_ctx(context, restored, "restored"), EXIT_SUCCESS);
+    cr_assert_str_eq(read_file_content_ctx(context, file), "before");
+
+    free_wsfs_context(context);
+}
+
+#define CONCURRENT_THREADS 4
+#define FILES_PER_THREAD 100
+
+static struct FileNode* sharedDir;
+
+static void* create_and_find_files(void* argument) {
+    const int thread = *(const int*)argument;
+    char name[32];
+
+    for (int i = 0; i < FILES_PER_THREAD; i++) {
+        sprintf(name, "file%d_%d", thread, i);
+        create_file_node(sharedDir, name, FILE_TYPE_FILE);
+        if (find_file_node_in_curr_dir(sharedDir, name) == NULL) return argument;
+    }
+
+    return NULL;
+}
+
+Test(create_file_node, concurrent_creates_in_one_dir) {
+    set_memory_limit(UINT64_MAX);
+    set_file_count_limit(UINT64_MAX);
+    sharedDir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    change_permissions(sharedDir, PERM_DEFAULT);
+    pthread_t threads[CONCURRENT_THREADS];
+    int ids[CONCURRENT_THREADS];
+
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        ids[i] = i;
+        pthread_create(&threads[i], NULL, create_and_find_files, &ids[i]);
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        cr_assert_null(result);
+    }
+
+    cr_assert_eq(get_dir_child_count(sharedDir), CONCURRENT_THREADS * FILES_PER_THREAD);
+    cr_assert_eq(get_file_count(), CONCURRENT_THREADS * FILES_PER_THREAD + 1);
+    cr_assert_eq(get_used_memory(), get_file_node_size(sharedDir));
+
+    free_file_node_recursive(sharedDir);
+    cr_assert_eq(get_file_count(), 0);
+    cr_assert_eq(get_used_memory(), 0);
+}
+
+Test(delete_file_node, memory_kept_for_reader) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    change_permissions(root, PERM_DEFAULT);
+    create_file_node(root, "file", FILE_TYPE_FILE);
+
+    wsfs_epoch_enter();
+    struct FileNode* file = find_file_node_in_curr_dir(root, "file");
+    cr_assert_eq(delete_file_node(root, file), EXIT_SUCCESS);
+
+    cr_assert_eq(get_file_count(), 1);
+    cr_assert_str_eq(file->info.metadata.name, "file");
+    cr_assert_gt(get_epoch_pending_count(), 0);
+    wsfs_epoch_exit();
+
+    epoch_reclaim_all();
+    cr_assert_eq(get_epoch_pending_count(), 0);
+    free_file_node_recursive(root);
+}
+
+Test(change_file_node_name, old_name_kept_for_reader) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "root", FILE_TYPE_DIR);
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* file = create_file_node(root, "name that doesn't fit into file node", FILE_TYPE_FILE);
+
+    wsfs_epoch_enter();
+    const char* oldName = file->info.metadata.name;
+    change_file_node_name(file, "new");
+
+    cr_assert_str_eq(oldName, "name that doesn't fit into file node");
+    cr_assert_str_eq(file->info.metadata.name, "new");
+    cr_assert_neq(file->info.metadata.name, file->info.metadata.inlineName);
+    wsfs_epoch_exit();
+
+    cr_assert_eq(find_file_node_in_curr_dir(root, "new"), file);
+    epoch_reclaim_all();
+    free_file_node_recursive(root);
+}
+
+Test(read_file_content, published_until_change) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    change_permissions(file, PERM_DEFAULT);
+    write_to_file(file, "content");
+
+    char* content = read_file_content(file);
+    cr_assert_eq(file->info.data.contentFlat, content);
+    cr_assert_eq(read_file_content(file), content);
+
+    wsfs_append(file, "!", 1);
+    cr_assert_null(file->info.data.contentFlat);
+    cr_assert_str_eq(read_file_content(file), "content!");
+
+    free_file_node_recursive(file);
+}
+
+#define RENAME_ROUNDS 2000
+
+static struct FileNode* otherDir;
+static _Atomic int isRenaming;
+
+static void* rename_and_move_files(void* argument) {
+    struct FileNode* moved = argument;
+    struct FileNode* renamed = find_file_node_in_curr_dir(sharedDir, "renamed");
+
+    for (int i = 0; i < RENAME_ROUNDS; i++) {
+        change_file_node_location(i % 2 == 0 ? otherDir : sharedDir, moved);
+        change_file_node_name(renamed, i % 2 == 0 ? "renamed with a name longer than inline one" : "renamed");
+    }
+    atomic_store(&isRenaming, 0);
+
+    return NULL;
+}
+
+static void* find_stable_file(void* argument) {
+    (void)argument;
+    while (atomic_load(&isRenaming)) {
+        struct FileNode* stable = find_file_node_in_curr_dir(sharedDir, "stable");
+        if (stable == NULL || stable->parent != sharedDir) return stable;
+
+        char* path = get_file_node_path(stable);
+        const int isPathValid = path != NULL && strcmp(path, "\\dir\\stable") == 0;
+        free(path);
+        if (!isPathValid) return sharedDir;
+    }
+
+    return NULL;
+}
+
+Test(find_file_node_in_curr_dir, lock_free_during_renames) {
+    set_memory_limit(UINT64_MAX);
+    set_file_count_limit(UINT64_MAX);
+    struct FileNode* root = create_file_node(NULL, "\\", FILE_TYPE_DIR);
+    change_permissions(root, PERM_DEFAULT);
+    sharedDir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    otherDir = create_file_node(root, "other", FILE_TYPE_DIR);
+    change_permissions(sharedDir, PERM_DEFAULT);
+    change_permissions(otherDir, PERM_DEFAULT);
+    struct FileNode* moved = create_file_node(sharedDir, "moved", FILE_TYPE_FILE);
+    create_file_node(sharedDir, "renamed", FILE_TYPE_FILE);
+    create_file_node(sharedDir, "stable", FILE_TYPE_FILE);
+    atomic_store(&isRenaming, 1);
+    pthread_t threads[CONCURRENT_THREADS];
+
+    pthread_create(&threads[0], NULL, rename_and_move_files, moved);
+    for (int i = 1; i < CONCURRENT_THREADS; i++) {
+        pthread_create(&threads[i], NULL, find_stable_file, NULL);
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        cr_assert_null(result);
+    }
+
+    cr_assert_eq(get_used_memory(), get_file_node_size(root));
+    epoch_reclaim_all();
+    free_file_node_recursive(root);
+}
+
+#define SNAPSHOT_ROUNDS 50
+#define APPENDS_PER_ROUND 20
+
+static void* append_and_read_pieces(void* argument) {
+    struct WsfsContext* context = argument;
+    char name[32];
+    sprintf(name, "file%lu", (unsigned long)pthread_self());
+    struct FileNode* file = create_file_node_ctx(context, get_root_node_ctx(context), name, FILE_TYPE_FILE);
+
+    for (int i = 0; i < SNAPSHOT_ROUNDS * APPENDS_PER_ROUND; i++) {
+        wsfs_append_ctx(context, file, "piece", 5);
+        if (read_file_content_ctx(context, file) == NULL) return file;
+    }
+
+    return NULL;
+}
+
+Test(create_tree_snapshot, concurrent_with_writes) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    change_permissions_ctx(context, wsfs_init_ctx(context), PERM_DEFAULT);
+    pthread_t threads[CONCURRENT_THREADS];
+
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_create(&threads[i], NULL, append_and_read_pieces, context);
+    }
+    for (int i = 0; i < SNAPSHOT_ROUNDS; i++) {
+        cr_assert_eq(create_tree_snapshot_ctx(context, "snapshot"), EXIT_SUCCESS);
+        struct FileNode* snapshot = get_tree_snapshot_ctx(context, "snapshot");
+        for (struct FileNode* file = snapshot->info.data.directoryContent; file != NULL; file = file->next) {
+            cr_assert_eq(get_file_content_size(file) % 5, 0);
+        }
+        cr_assert_eq(delete_tree_snapshot_ctx(context, "snapshot"), EXIT_SUCCESS);
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        cr_assert_null(result);
+    }
+
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(get_root_node_ctx(context)));
+    free_wsfs_context(context);
+}
+
+#define DEDUP_WRITES_PER_THREAD 500
+
+static void* write_shared_contents(void* argument) {
+    struct WsfsContext* context = argument;
+    char name[32];
+    sprintf(name, "file%lu", (unsigned long)pthread_self());
+    struct FileNode* file = create_file_node_ctx(context, get_root_node_ctx(context), name, FILE_TYPE_FILE);
+
+    for (int i = 0; i < DEDUP_WRITES_PER_THREAD; i++) {
+        write_to_file_ctx(context, file, i % 2 == 0 ? "even content" : "odd content");
+        if (i % 10 == 0) wsfs_append_ctx(context, file, "!", 1);
+    }
+
+    return NULL;
+}
+
+Test(set_dedup_enabled, concurrent_equal_writes) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    set_dedup_enabled_ctx(context, 1);
+    change_permissions_ctx(context, wsfs_init_ctx(context), PERM_DEFAULT);
+    pthread_t threads[CONCURRENT_THREADS];
+    struct ContentStoreStats stats;
+
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_create(&threads[i], NULL, write_shared_contents, context);
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Every file ends with the odd content
+    get_dedup_stats_ctx(context, &stats);
+    cr_assert_eq(stats.contents, 1);
+    cr_assert_eq(stats.logicalBytes, 11 * CONCURRENT_THREADS);
+    for (struct FileNode* file = get_root_node_ctx(context)->info.data.directoryContent; file != NULL;
+         file = file->next) {
+        cr_assert_str_eq(read_file_content_ctx(context, file), "odd content");
+    }
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(get_root_node_ctx(context)));
+    free_wsfs_context(context);
+}
+
+#define STAT_ROUNDS 200
+
+static void* change_own_subtree(void* argument) {
+    struct WsfsContext* context = argument;
+    char name[32];
+    sprintf(name, "dir%lu", (unsigned long)pthread_self());
+    struct FileNode* dir = create_file_node_ctx(context, get_root_node_ctx(context), name, FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+
+    for (int i = 0; i < STAT_ROUNDS; i++) {
+        sprintf(name, "file%d", i);
+        struct FileNode* file = create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+        wsfs_append_ctx(context, file, "piece", 5);
+        if (i % 3 == 0) delete_file_node_ctx(context, dir, file);
+    }
+
+    return NULL;
+}
+
+Test(wsfs_stat, concurrent_changes_in_subtrees) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    pthread_t threads[CONCURRENT_THREADS];
+    struct WsfsStat stat;
+
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_create(&threads[i], NULL, change_own_subtree, context);
+    }
+    for (int i = 0; i < CONCURRENT_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    wsfs_stat(root, &stat);
+    cr_assert_eq(stat.subtreeCount, get_file_count_ctx(context));
+    cr_assert_eq(stat.subtreeSize, get_used_memory_ctx(context));
+    free_wsfs_context(context);
+}
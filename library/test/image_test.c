@@ -0,0 +1,165 @@
+/**
+    * @file: image_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions which serve
+    * file system from a memory mapped image.
+*/
+
+#include "../include/image.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/snapshot.h"
+#include "../include/wsfs.h"
+#include "../include/wsfs_macros.h"
+#include "criterion/criterion.h"
+
+#define BIG_CONTENT_SIZE (FILE_CHUNK_SIZE * 2 + 10)
+
+static FILE* create_image(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_file_count_limit_ctx(context, 100);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions(root, PERM_DEFAULT);
+
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE);
+    change_permissions(file, PERM_DEFAULT);
+    write_to_file_ctx(context, file, "content");
+    for (int i = 0; i < 50; i++) {
+        char name[32];
+        sprintf(name, "other%d", i);
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+
+    struct FileNode* big = create_file_node_ctx(context, root, "big", FILE_TYPE_FILE);
+    change_permissions(big, PERM_DEFAULT);
+    char content[BIG_CONTENT_SIZE];
+    for (int i = 0; i < BIG_CONTENT_SIZE; i++) {
+        content[i] = (char)i;
+    }
+    wsfs_pwrite_ctx(context, big, content, BIG_CONTENT_SIZE, 0);
+
+    struct FileNode* link = create_file_node_ctx(context, root, "link", FILE_TYPE_SYMLINK);
+    change_permissions(link, PERM_DEFAULT);
+    set_symlink_target(link, dir);
+
+    FILE* image = tmpfile();
+    cr_assert_eq(wsfs_save_image(context, fileno(image)), EXIT_SUCCESS);
+    free_wsfs_context(context);
+
+    return image;
+}
+
+Test(wsfs_image_lookup, reads_from_mapping) {
+    FILE* file = create_image();
+    struct WsfsImage* image = wsfs_open_image(fileno(file));
+    cr_assert_not_null(image);
+    struct ImageEntry entry;
+    char buffer[BIG_CONTENT_SIZE];
+
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\file", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    cr_assert_null(entry.overlay);
+    cr_assert_eq(wsfs_image_get_content_size(image, &entry), 7);
+    cr_assert_eq(wsfs_image_read(image, &entry, buffer, sizeof(buffer), 0), 7);
+    cr_assert_eq(memcmp(buffer, "content", 7), 0);
+    cr_assert_eq(wsfs_image_read(image, &entry, buffer, 3, 4), 3);
+    cr_assert_eq(memcmp(buffer, "ent", 3), 0);
+
+    cr_assert_eq(wsfs_image_lookup(image, "big", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_image_read(image, &entry, buffer, sizeof(buffer), 0), BIG_CONTENT_SIZE);
+    for (int i = 0; i < BIG_CONTENT_SIZE; i++) {
+        cr_assert_eq(buffer[i], (char)i);
+    }
+
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\other49", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_image_lookup(image, "link\\.\\..\\dir\\file", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_image_lookup(image, "link\\file", LOOKUP_FOLLOW_NONE, &entry), EXIT_FAILURE);
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\missing", LOOKUP_FOLLOW_ALL, &entry), EXIT_FAILURE);
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\file\\file", LOOKUP_FOLLOW_ALL, &entry), EXIT_FAILURE);
+    cr_assert_null(wsfs_image_get_overlay(image));
+
+    wsfs_close_image(image);
+    fclose(file);
+}
+
+Test(wsfs_image_take_over, file_written_through_overlay) {
+    FILE* file = create_image();
+    struct WsfsImage* image = wsfs_open_image(fileno(file));
+    struct ImageEntry entry;
+    char buffer[16] = {0};
+
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\file", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    struct FileNode* copy = wsfs_image_take_over(image, &entry);
+    cr_assert_not_null(copy);
+    cr_assert_eq(entry.overlay, copy);
+    cr_assert_eq(wsfs_image_take_over(image, &entry), copy);
+
+    struct WsfsContext* overlay = wsfs_image_get_overlay(image);
+    cr_assert_eq(wsfs_pwrite_ctx(overlay, copy, "changed", 7, 0), EXIT_SUCCESS);
+    // Root, "dir" and "file" are copied, siblings stay in image
+    cr_assert_eq(get_file_count_ctx(overlay), 3);
+
+    struct ImageEntry found;
+    cr_assert_eq(wsfs_image_lookup(image, "link\\file", LOOKUP_FOLLOW_ALL, &found), EXIT_SUCCESS);
+    cr_assert_eq(found.overlay, copy);
+    cr_assert_eq(wsfs_image_read(image, &found, buffer, sizeof(buffer), 0), 7);
+    cr_assert_str_eq(buffer, "changed");
+    cr_assert_eq(wsfs_image_lookup(image, "dir\\other0", LOOKUP_FOLLOW_ALL, &found), EXIT_SUCCESS);
+    cr_assert_null(found.overlay);
+
+    wsfs_close_image(image);
+    fclose(file);
+}
+
+Test(wsfs_image_take_over, directory_with_symlink) {
+    FILE* file = create_image();
+    struct WsfsImage* image = wsfs_open_image(fileno(file));
+    struct ImageEntry entry;
+
+    // Taking over root copies the whole tree, symbolic link points to copy of its target
+    cr_assert_eq(wsfs_image_lookup(image, "", LOOKUP_FOLLOW_ALL, &entry), EXIT_SUCCESS);
+    struct FileNode* root = wsfs_image_take_over(image, &entry);
+    cr_assert_not_null(root);
+    struct WsfsContext* overlay = wsfs_image_get_overlay(image);
+    cr_assert_eq(get_root_node_ctx(overlay), root);
+    cr_assert_eq(get_file_count_ctx(overlay), 55);
+
+    struct FileNode* dir = wsfs_lookup_path_ctx(overlay, root, "link", LOOKUP_FOLLOW_ALL);
+    cr_assert_eq(dir, wsfs_lookup_path_ctx(overlay, root, "dir", LOOKUP_FOLLOW_ALL));
+    cr_assert_not_null(create_file_node_ctx(overlay, dir, "new", FILE_TYPE_FILE));
+
+    struct ImageEntry found;
+    cr_assert_eq(wsfs_image_lookup(image, "link\\new", LOOKUP_FOLLOW_ALL, &found), EXIT_SUCCESS);
+    cr_assert_eq(found.node, IMAGE_NO_NODE);
+    cr_assert_eq(found.overlay, wsfs_lookup_path_ctx(overlay, dir, "new", LOOKUP_FOLLOW_ALL));
+
+    wsfs_close_image(image);
+    fclose(file);
+}
+
+Test(wsfs_open_image, malformed_header) {
+    FILE* file = tmpfile();
+    struct ImageHeader header = {0};
+    header.magic = IMAGE_MAGIC + 1;
+    header.version = IMAGE_VERSION;
+    header.nodeCount = 1;
+    fwrite(&header, sizeof(header), 1, file);
+    fflush(file);
+
+    cr_assert_null(wsfs_open_image(fileno(file)));
+
+    // Node table runs past the end of file
+    header.magic = IMAGE_MAGIC;
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+    fflush(file);
+    cr_assert_null(wsfs_open_image(fileno(file)));
+
+    fclose(file);
+}
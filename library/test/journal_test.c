@@ -0,0 +1,195 @@
+/**
+    * @file: journal_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions which journal
+    * changes and replay them.
+*/
+
+#include "../include/journal.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+static void create_journal_path(char* path) {
+    strcpy(path, "/tmp/wsfs_journal_XXXXXX");
+    const int fd = mkstemp(path);
+    cr_assert_geq(fd, 0);
+    close(fd);
+}
+
+static struct WsfsContext* open_journaled_context(const char* path, const enum JournalSyncPolicy policy) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_file_count_limit_ctx(context, 100);
+    cr_assert_eq(wsfs_open_journal_ctx(context, path, policy, 10), EXIT_SUCCESS);
+    struct FileNode* root = wsfs_init_ctx(context);
+    cr_assert_not_null(root);
+
+    return context;
+}
+
+static void change_journaled_tree(struct WsfsContext* context) {
+    struct FileNode* root = get_root_node_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE);
+    write_to_file_ctx(context, file, "hello world");
+    wsfs_pwrite_ctx(context, file, "W", 1, 6);
+    wsfs_append_ctx(context, file, "!!", 2);
+    wsfs_truncate_ctx(context, file, 12);
+    change_file_node_name_ctx(context, file, "renamed_file_with_long_name");
+
+    struct FileNode* other = create_file_node_ctx(context, root, "other", FILE_TYPE_DIR);
+    change_permissions_ctx(context, other, PERM_DEFAULT);
+    change_file_node_location_ctx(context, other, file);
+    copy_file_node_ctx(context, root, file);
+
+    struct FileNode* link = create_file_node_ctx(context, root, "link", FILE_TYPE_SYMLINK);
+    set_symlink_target_ctx(context, link, file);
+    change_permissions_ctx(context, link, PERM_READ);
+
+    struct FileNode* deleted = create_file_node_ctx(context, root, "deleted", FILE_TYPE_FILE);
+    delete_file_node_ctx(context, root, deleted);
+    change_permissions_ctx(context, dir, PERM_READ | PERM_EXEC);
+}
+
+Test(replay_journal, restores_changes) {
+    char path[32];
+    create_journal_path(path);
+
+    struct WsfsContext* journaled = open_journaled_context(path, JOURNAL_SYNC_ALWAYS);
+    change_journaled_tree(journaled);
+    const uint64_t fileCount = get_file_count_ctx(journaled);
+    const uint64_t usedMemory = get_used_memory_ctx(journaled);
+    free_wsfs_context(journaled);
+
+    struct WsfsContext* replayed = open_journaled_context(path, JOURNAL_SYNC_ALWAYS);
+    struct FileNode* root = get_root_node_ctx(replayed);
+    cr_assert_eq(get_file_count_ctx(replayed), fileCount);
+    cr_assert_eq(get_used_memory_ctx(replayed), usedMemory);
+
+    struct FileNode* file = wsfs_lookup_path_ctx(replayed, root, "other\\renamed_file_with_long_name",
+                                                 LOOKUP_FOLLOW_ALL);
+    cr_assert_not_null(file);
+    cr_assert_str_eq(read_file_content_ctx(replayed, file), "hello World!");
+    cr_assert_str_eq(read_file_content_ctx(replayed, wsfs_lookup_path_ctx(replayed, root,
+                                           "renamed_file_with_long_name", LOOKUP_FOLLOW_ALL)), "hello World!");
+    cr_assert_eq(wsfs_lookup_path_ctx(replayed, root, "link", LOOKUP_FOLLOW_ALL), file);
+    cr_assert_eq(wsfs_lookup_path_ctx(replayed, root, "link", LOOKUP_FOLLOW_NONE)->info.properties.permissions,
+                 PERM_READ);
+    cr_assert_null(wsfs_lookup_path_ctx(replayed, root, "deleted", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(wsfs_lookup_path_ctx(replayed, root, "dir\\renamed_file_with_long_name", LOOKUP_FOLLOW_ALL));
+    cr_assert_eq(wsfs_lookup_path_ctx(replayed, root, "dir", LOOKUP_FOLLOW_ALL)->info.properties.permissions,
+                 PERM_READ | PERM_EXEC);
+
+    free_wsfs_context(replayed);
+    unlink(path);
+}
+
+Test(replay_journal, attached_subtree) {
+    char path[32];
+    create_journal_path(path);
+
+    struct WsfsContext* journaled = open_journaled_context(path, JOURNAL_SYNC_NEVER);
+    struct FileNode* root = get_root_node_ctx(journaled);
+    change_permissions_ctx(journaled, root, PERM_DEFAULT);
+
+    // Subtree built outside the tree is journaled when it is added
+    struct FileNode* dir = create_file_node_ctx(journaled, NULL, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(journaled, dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(journaled, dir, "file", FILE_TYPE_FILE);
+    write_to_file_ctx(journaled, file, "content");
+    change_permissions_ctx(journaled, dir, PERM_READ | PERM_EXEC);
+    cr_assert_eq(add_to_dir_ctx(journaled, root, dir), EXIT_SUCCESS);
+    free_wsfs_context(journaled);
+
+    struct WsfsContext* replayed = open_journaled_context(path, JOURNAL_SYNC_NEVER);
+    root = get_root_node_ctx(replayed);
+    file = wsfs_lookup_path_ctx(replayed, root, "dir\\file", LOOKUP_FOLLOW_ALL);
+    cr_assert_not_null(file);
+    cr_assert_str_eq(read_file_content_ctx(replayed, file), "content");
+    cr_assert_eq(file->parent->info.properties.permissions, PERM_READ | PERM_EXEC);
+
+    free_wsfs_context(replayed);
+    unlink(path);
+}
+
+Test(replay_journal, torn_tail_dropped) {
+    char path[32];
+    create_journal_path(path);
+
+    struct WsfsContext* journaled = open_journaled_context(path, JOURNAL_SYNC_ALWAYS);
+    struct FileNode* root = get_root_node_ctx(journaled);
+    change_permissions_ctx(journaled, root, PERM_DEFAULT);
+    create_file_node_ctx(journaled, root, "kept", FILE_TYPE_FILE);
+    create_file_node_ctx(journaled, root, "torn", FILE_TYPE_FILE);
+    free_wsfs_context(journaled);
+
+    // Crash in the middle of the last record
+    const int fd = open(path, O_RDWR);
+    const off_t size = lseek(fd, 0, SEEK_END);
+    cr_assert_eq(ftruncate(fd, size - 3), 0);
+
+    struct WsfsContext* replayed = open_journaled_context(path, JOURNAL_SYNC_ALWAYS);
+    root = get_root_node_ctx(replayed);
+    cr_assert_not_null(wsfs_lookup_path_ctx(replayed, root, "kept", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(wsfs_lookup_path_ctx(replayed, root, "torn", LOOKUP_FOLLOW_ALL));
+
+    // New records follow the last complete one
+    create_file_node_ctx(replayed, root, "after", FILE_TYPE_FILE);
+    free_wsfs_context(replayed);
+    replayed = open_journaled_context(path, JOURNAL_SYNC_ALWAYS);
+    cr_assert_not_null(wsfs_lookup_path_ctx(replayed, get_root_node_ctx(replayed), "after", LOOKUP_FOLLOW_ALL));
+
+    free_wsfs_context(replayed);
+    close(fd);
+    unlink(path);
+}
+
+Test(wsfs_sync_journal_ctx, never_policy_writes_on_sync) {
+    char path[32];
+    create_journal_path(path);
+    struct WsfsContext* context = open_journaled_context(path, JOURNAL_SYNC_NEVER);
+    change_permissions_ctx(context, get_root_node_ctx(context), PERM_DEFAULT);
+    struct JournalStats stats;
+
+    get_journal_stats_ctx(context, &stats);
+    cr_assert_eq(stats.records, 1);
+    cr_assert_eq(stats.writes, 0);
+    cr_assert_eq(wsfs_sync_journal_ctx(context), EXIT_SUCCESS);
+    get_journal_stats_ctx(context, &stats);
+    cr_assert_eq(stats.writes, 1);
+    cr_assert_eq(stats.syncs, 1);
+
+    wsfs_close_journal_ctx(context);
+    get_journal_stats_ctx(context, &stats);
+    cr_assert_eq(stats.records, 0);
+    cr_assert_eq(wsfs_sync_journal_ctx(context), EXIT_FAILURE);
+
+    free_wsfs_context(context);
+    unlink(path);
+}
+
+Test(wsfs_open_journal_ctx, not_a_journal) {
+    char path[32];
+    create_journal_path(path);
+    const int fd = open(path, O_WRONLY);
+    cr_assert_eq(write(fd, "not a journal file", 18), 18);
+    close(fd);
+    struct WsfsContext* context = create_wsfs_context();
+
+    cr_assert_eq(wsfs_open_journal_ctx(context, path, JOURNAL_SYNC_ALWAYS, 0), EXIT_FAILURE);
+    cr_assert_eq(wsfs_open_journal_ctx(context, "/nonexistent/journal", JOURNAL_SYNC_ALWAYS, 0), EXIT_FAILURE);
+    cr_assert_null(context->journal);
+
+    free_wsfs_context(context);
+    unlink(path);
+}
@@ -0,0 +1,107 @@
+/**
+    * @file: lookup_cache_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the lookup cache.
+*/
+
+#include "../include/lookup_cache.h"
+
+#include <stdio.h>
+
+#include "../include/dir_index.h"
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs_macros.h"
+#include "criterion/criterion.h"
+
+static struct LookupCache* get_cache(void) {
+    return &get_default_context()->lookupCache;
+}
+
+static struct FileNode* find_in_cache(const struct FileNode* parent, const char* name) {
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    return lookup_cache_find(get_cache(), parent, name, hash, length);
+}
+
+Test(lookup_cache_find, hit_after_insert) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(dir, "file", FILE_TYPE_FILE);
+    struct LookupCacheStats stats;
+
+    cr_assert_null(find_in_cache(dir, "file"));
+    lookup_cache_insert(get_cache(), file);
+    cr_assert_eq(find_in_cache(dir, "file"), file);
+
+    get_lookup_cache_stats(get_cache(), &stats);
+    cr_assert_eq(stats.hits, 1);
+    cr_assert_eq(stats.misses, 1);
+    cr_assert_eq(stats.used, 1);
+
+    free_file_node_recursive(dir);
+    free_lookup_cache(get_cache());
+}
+
+Test(lookup_cache_invalidate, rename_move_and_delete) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* location = create_file_node(NULL, "location", FILE_TYPE_DIR);
+    struct FileNode* renamed = create_file_node(dir, "renamed", FILE_TYPE_FILE);
+    struct FileNode* moved = create_file_node(dir, "moved", FILE_TYPE_FILE);
+    struct FileNode* deleted = create_file_node(dir, "deleted", FILE_TYPE_FILE);
+    lookup_cache_insert(get_cache(), renamed);
+    lookup_cache_insert(get_cache(), moved);
+    lookup_cache_insert(get_cache(), deleted);
+
+    change_file_node_name(renamed, "new name");
+    change_file_node_location(location, moved);
+    delete_file_node(dir, deleted);
+
+    cr_assert_null(find_in_cache(dir, "renamed"));
+    cr_assert_null(find_in_cache(dir, "moved"));
+    cr_assert_null(find_in_cache(dir, "deleted"));
+    struct LookupCacheStats stats;
+    get_lookup_cache_stats(get_cache(), &stats);
+    cr_assert_eq(stats.invalidations, 3);
+    cr_assert_eq(stats.used, 0);
+
+    free_file_node_recursive(dir);
+    free_file_node_recursive(location);
+    free_lookup_cache(get_cache());
+}
+
+Test(set_lookup_cache_capacity, bounded_and_evicts) {
+    set_file_count_limit(100);
+    set_memory_limit(UINT64_MAX);
+    set_lookup_cache_capacity(get_cache(), LOOKUP_CACHE_WAYS);
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct LookupCacheStats stats;
+
+    for (int i = 0; i < 10; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        lookup_cache_insert(get_cache(), create_file_node(dir, name, FILE_TYPE_FILE));
+    }
+
+    get_lookup_cache_stats(get_cache(), &stats);
+    cr_assert_eq(stats.capacity, LOOKUP_CACHE_WAYS);
+    cr_assert_eq(stats.used, LOOKUP_CACHE_WAYS);
+    cr_assert_eq(stats.evictions, 10 - LOOKUP_CACHE_WAYS);
+
+    free_file_node_recursive(dir);
+    free_lookup_cache(get_cache());
+}
+
+Test(set_lookup_cache_capacity, zero_disables_cache) {
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    struct FileNode* file = create_file_node(dir, "file", FILE_TYPE_FILE);
+
+    set_lookup_cache_capacity(get_cache(), 0);
+    lookup_cache_insert(get_cache(), file);
+
+    cr_assert_null(find_in_cache(dir, "file"));
+
+    free_file_node_recursive(dir);
+    set_lookup_cache_capacity(get_cache(), LOOKUP_CACHE_SIZE);
+    free_lookup_cache(get_cache());
+}
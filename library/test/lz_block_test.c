@@ -0,0 +1,69 @@
+/**
+    * @file: lz_block_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the LZ block compressor.
+*/
+
+#include "../include/lz_block.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "criterion/criterion.h"
+
+#define BLOCK_SIZE 4096
+
+static uint8_t compressed[LZ_BLOCK_BOUND(BLOCK_SIZE)];
+static uint8_t restored[BLOCK_SIZE];
+
+static uint32_t round_trip(const uint8_t* block, const uint32_t size) {
+    const uint32_t compressedSize = lz_block_compress(block, size, compressed);
+    cr_assert_leq(compressedSize, LZ_BLOCK_BOUND(size));
+    cr_assert_eq(lz_block_decompress(compressed, compressedSize, restored, size), EXIT_SUCCESS);
+    cr_assert_eq(memcmp(restored, block, size), 0);
+
+    return compressedSize;
+}
+
+Test(lz_block_compress, repeated_text_shrinks) {
+    uint8_t block[BLOCK_SIZE];
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+        block[i] = (uint8_t)"<div class=\"row\">template</div>\n"[i % 32];
+    }
+
+    cr_assert_lt(round_trip(block, BLOCK_SIZE), BLOCK_SIZE / 10);
+}
+
+Test(lz_block_compress, random_bytes_stay_within_bound) {
+    uint8_t block[BLOCK_SIZE];
+    srand(1);
+    for (uint32_t i = 0; i < BLOCK_SIZE; i++) {
+        block[i] = (uint8_t)rand();
+    }
+
+    round_trip(block, BLOCK_SIZE);
+    round_trip(block, 3);
+    round_trip(block, 0);
+}
+
+Test(lz_block_compress, long_runs_and_short_tails) {
+    uint8_t block[BLOCK_SIZE];
+    memset(block, 'a', BLOCK_SIZE);
+    memcpy(block + 1000, "literal run which is longer than fifteen bytes", 46);
+
+    cr_assert_lt(round_trip(block, BLOCK_SIZE), 96);
+    round_trip(block, LZ_MIN_MATCH + 1);
+}
+
+Test(lz_block_decompress, malformed_block) {
+    const uint8_t block[] = "abcdabcdabcdabcdabcd";
+    const uint32_t compressedSize = lz_block_compress(block, sizeof(block), compressed);
+
+    cr_assert_eq(lz_block_decompress(compressed, compressedSize - 1, restored, sizeof(block)), EXIT_FAILURE);
+    cr_assert_eq(lz_block_decompress(compressed, compressedSize, restored, sizeof(block) - 1), EXIT_FAILURE);
+    // Match which points before the block
+    const uint8_t badOffset[] = {0x10, 'a', 0x09, 0x00};
+    cr_assert_eq(lz_block_decompress(badOffset, sizeof(badOffset), restored, 5), EXIT_FAILURE);
+}
@@ -0,0 +1,98 @@
+/**
+    * @file: name_index_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the name index.
+*/
+
+#include "../include/name_index.h"
+
+#include <stdio.h>
+
+#include "../include/dir_index.h"
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+#define NAMED_FILE_COUNT 200
+#define DISTINCT_NAME_COUNT 20
+
+static struct FileNode* create_dir_with_named_files(struct WsfsContext* context) {
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, NAMED_FILE_COUNT + 1);
+
+    struct FileNode* dir = create_file_node_ctx(context, NULL, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    for (int i = 0; i < NAMED_FILE_COUNT; i++) {
+        char name[16];
+        sprintf(name, "file%d", i % DISTINCT_NAME_COUNT);
+        create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+    }
+
+    return dir;
+}
+
+static uint32_t count_named_nodes(struct NameIndex* index, const char* name) {
+    uint32_t length;
+    const uint32_t hash = hash_file_node_name(name, &length);
+    uint32_t count = 0;
+
+    acquire_read_lock(&index->lock);
+    for (const struct FileNode* node = name_index_find(index, name, hash, length, NULL); node != NULL;
+         node = name_index_find(index, name, hash, length, node)) {
+        cr_assert_str_eq(node->info.metadata.name, name);
+        count++;
+    }
+    release_read_lock(&index->lock);
+
+    return count;
+}
+
+Test(name_index_insert, grows_and_chains_equal_names) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct NameIndexStats stats;
+
+    struct FileNode* dir = create_dir_with_named_files(context);
+
+    get_name_index_stats(&context->nameIndex, &stats);
+    cr_assert_eq(stats.nodes, NAMED_FILE_COUNT + 1);
+    cr_assert_geq(stats.capacity, NAMED_FILE_COUNT);
+    cr_assert_eq(count_named_nodes(&context->nameIndex, "file3"), NAMED_FILE_COUNT / DISTINCT_NAME_COUNT);
+    cr_assert_eq(count_named_nodes(&context->nameIndex, "dir"), 1);
+    cr_assert_eq(count_named_nodes(&context->nameIndex, "file"), 0);
+
+    cr_assert_eq(change_file_node_name_ctx(context, dir->info.data.directoryContent, "renamed"), EXIT_SUCCESS);
+    cr_assert_eq(count_named_nodes(&context->nameIndex, "file0"), NAMED_FILE_COUNT / DISTINCT_NAME_COUNT - 1);
+    cr_assert_eq(count_named_nodes(&context->nameIndex, "renamed"), 1);
+
+    free_wsfs_context(context);
+}
+
+Test(name_index_may_contain, removed_names_are_rejected) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct NameIndexStats stats;
+    uint32_t hashes[DISTINCT_NAME_COUNT];
+    for (int i = 0; i < DISTINCT_NAME_COUNT; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        hashes[i] = hash_file_node_name(name, NULL);
+    }
+
+    cr_assert_eq(name_index_may_contain(&context->nameIndex, hashes[0]), 0);
+    struct FileNode* dir = create_dir_with_named_files(context);
+    for (int i = 0; i < DISTINCT_NAME_COUNT; i++) {
+        cr_assert_eq(name_index_may_contain(&context->nameIndex, hashes[i]), 1);
+    }
+
+    free_file_node_recursive_ctx(context, dir);
+    for (int i = 0; i < DISTINCT_NAME_COUNT; i++) {
+        cr_assert_eq(name_index_may_contain(&context->nameIndex, hashes[i]), 0);
+    }
+    get_name_index_stats(&context->nameIndex, &stats);
+    cr_assert_eq(stats.nodes, 0);
+    cr_assert_eq(stats.lookups, 2 * DISTINCT_NAME_COUNT + 1);
+    cr_assert_eq(stats.filterRejects, DISTINCT_NAME_COUNT + 1);
+
+    free_wsfs_context(context);
+}
@@ -0,0 +1,244 @@
+/**
+    * @file: query_index_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the query index.
+*/
+
+#include "../include/query_index.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+#include "test_helpers.h"
+
+#define QUERY_DIR_COUNT 10
+#define QUERY_FILES_PER_DIR 60
+#define QUERY_BATCH 7
+#define QUERY_WRITER_ROUNDS 300
+
+/**
+    * Builds root with QUERY_DIR_COUNT directories, each one
+    * holds QUERY_FILES_PER_DIR files with i * 10 bytes and a
+    * symbolic link.
+*/
+static struct FileNode* build_queried_tree(struct WsfsContext* context) {
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    char name[32];
+    char content[QUERY_FILES_PER_DIR * 10 + 1];
+    for (int i = 0; i < QUERY_DIR_COUNT; i++) {
+        sprintf(name, "dir%d", i);
+        struct FileNode* dir = create_file_node_ctx(context, root, name, FILE_TYPE_DIR);
+        change_permissions_ctx(context, dir, PERM_DEFAULT);
+        for (int j = 0; j < QUERY_FILES_PER_DIR; j++) {
+            sprintf(name, "file%d", j);
+            struct FileNode* file = create_file_node_ctx(context, dir, name, FILE_TYPE_FILE);
+            change_permissions_ctx(context, file, PERM_DEFAULT);
+            memset(content, 'x', j * 10);
+            content[j * 10] = '\0';
+            write_to_file_ctx(context, file, content);
+        }
+        set_symlink_target_ctx(context, create_file_node_ctx(context, dir, "link", FILE_TYPE_SYMLINK), dir);
+    }
+
+    return root;
+}
+
+/**
+    * Reads query in small batches, checks that no node is
+    * found twice and closes it.
+*/
+static uint32_t count_query(struct WsfsContext* context, const struct QueryPredicate* predicates,
+                            const uint32_t count) {
+    struct WsfsQuery* query = wsfs_query_ctx(context, predicates, count);
+    cr_assert_not_null(query);
+
+    struct FileNode* found[QUERY_DIR_COUNT * (QUERY_FILES_PER_DIR + 2) + 1];
+    uint32_t total = 0;
+    uint32_t taken;
+    while ((taken = wsfs_query_next(query, &found[total], QUERY_BATCH)) > 0) {
+        total += taken;
+    }
+    for (uint32_t i = 0; i < total; i++) {
+        for (uint32_t j = i + 1; j < total; j++) {
+            cr_assert_neq(found[i], found[j]);
+        }
+    }
+    wsfs_query_close(query);
+
+    return total;
+}
+
+Test(wsfs_query, combines_indexed_predicates) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_queried_tree(context);
+    struct QueryIndexStats stats;
+
+    cr_assert_null(wsfs_query_ctx(context, NULL, 0));
+    cr_assert_eq(wsfs_enable_queries_ctx(context), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_enable_queries_ctx(context), EXIT_FAILURE);
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.nodes, get_file_count_ctx(context));
+    cr_assert_eq(stats.files, QUERY_DIR_COUNT * QUERY_FILES_PER_DIR);
+
+    cr_assert_eq(count_query(context, NULL, 0), get_file_count_ctx(context));
+    const struct QueryPredicate symlinks = {QUERY_TYPE, FILE_TYPE_SYMLINK, FILE_TYPE_SYMLINK};
+    cr_assert_eq(count_query(context, &symlinks, 1), QUERY_DIR_COUNT);
+
+    // Only the largest files are read from size index
+    const struct QueryPredicate large = {QUERY_SIZE, (QUERY_FILES_PER_DIR - 5) * 10, UINT64_MAX};
+    get_query_index_stats_ctx(context, &stats);
+    const uint64_t candidates = stats.candidates;
+    cr_assert_eq(count_query(context, &large, 1), QUERY_DIR_COUNT * 5);
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.candidates - candidates, QUERY_DIR_COUNT * 5);
+
+    // Size predicates never match directories, empty range matches nothing
+    const struct QueryPredicate small[] = {{QUERY_SIZE, 0, 50}, {QUERY_SIZE, 20, 100}};
+    cr_assert_eq(count_query(context, small, 2), QUERY_DIR_COUNT * 4);
+    const struct QueryPredicate empty[] = {{QUERY_SIZE, 0, 50}, {QUERY_SIZE, 60, 100}};
+    cr_assert_eq(count_query(context, empty, 2), 0);
+
+    wait_for_clock_tick();
+    const uint64_t mark = get_current_time();
+    struct FileNode* newDir = create_file_node_ctx(context, root, "new", FILE_TYPE_DIR);
+    change_permissions_ctx(context, newDir, PERM_DEFAULT);
+    create_file_node_ctx(context, newDir, "newer", FILE_TYPE_FILE);
+    const struct QueryPredicate recent[] = {{QUERY_CREATION_TIME, mark, UINT64_MAX}, {QUERY_TYPE, FILE_TYPE_FILE,
+                                                                                      FILE_TYPE_FILE}};
+    cr_assert_eq(count_query(context, recent, 1), 2);
+    cr_assert_eq(count_query(context, recent, 2), 1);
+    // Root and the new directory changed their child lists
+    const struct QueryPredicate changed = {QUERY_MODIFICATION_TIME, mark, UINT64_MAX};
+    cr_assert_eq(count_query(context, &changed, 1), 3);
+
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.droppedUpdates, 0);
+    free_wsfs_context(context);
+}
+
+Test(wsfs_query, follows_changes_between_batches) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_queried_tree(context);
+    wsfs_enable_queries_ctx(context);
+    struct FileNode* dir = find_file_node_in_curr_dir_ctx(context, root, "dir0");
+    struct FileNode* file = find_file_node_in_curr_dir_ctx(context, dir, "file1");
+    const struct QueryPredicate large = {QUERY_SIZE, 1000, UINT64_MAX};
+    struct QueryIndexStats stats;
+
+    cr_assert_eq(count_query(context, &large, 1), 0);
+    char content[1001];
+    memset(content, 'y', 1000);
+    content[1000] = '\0';
+    write_to_file_ctx(context, file, content);
+    cr_assert_eq(count_query(context, &large, 1), 1);
+    // Unreadable file is still matched by its length
+    change_permissions_ctx(context, file, PERM_WRITE);
+    cr_assert_eq(count_query(context, &large, 1), 1);
+    change_permissions_ctx(context, file, PERM_DEFAULT);
+    wsfs_append_ctx(context, find_file_node_in_curr_dir_ctx(context, dir, "file2"), content, 1000);
+    cr_assert_eq(count_query(context, &large, 1), 2);
+    wsfs_truncate_ctx(context, file, 10);
+    cr_assert_eq(count_query(context, &large, 1), 1);
+
+    // Copy is indexed, deleted subtree is dropped
+    cr_assert_eq(copy_file_node_ctx(context, root, dir), EXIT_SUCCESS);
+    cr_assert_eq(count_query(context, &large, 1), 2);
+    const struct QueryPredicate files = {QUERY_TYPE, FILE_TYPE_FILE, FILE_TYPE_FILE};
+    struct WsfsQuery* query = wsfs_query_ctx(context, &files, 1);
+    struct FileNode* found[QUERY_BATCH];
+    cr_assert_eq(wsfs_query_next(query, found, QUERY_BATCH), QUERY_BATCH);
+    cr_assert_eq(delete_file_node_ctx(context, root, root->info.data.directoryTail), EXIT_SUCCESS);
+    cr_assert_eq(delete_file_node_ctx(context, root, dir), EXIT_SUCCESS);
+    uint32_t total = QUERY_BATCH;
+    uint32_t taken;
+    while ((taken = wsfs_query_next(query, found, QUERY_BATCH)) > 0) {
+        total += taken;
+    }
+    wsfs_query_close(query);
+    cr_assert_leq(total, QUERY_DIR_COUNT * QUERY_FILES_PER_DIR);
+    cr_assert_geq(total, (QUERY_DIR_COUNT - 1) * QUERY_FILES_PER_DIR);
+    cr_assert_eq(count_query(context, &files, 1), (QUERY_DIR_COUNT - 1) * QUERY_FILES_PER_DIR);
+    cr_assert_eq(count_query(context, &large, 1), 0);
+
+    // Tree snapshots aren't indexed
+    get_query_index_stats_ctx(context, &stats);
+    const uint64_t nodes = stats.nodes;
+    cr_assert_eq(create_tree_snapshot_ctx(context, "before"), EXIT_SUCCESS);
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.nodes, nodes);
+    cr_assert_eq(count_query(context, &files, 1), (QUERY_DIR_COUNT - 1) * QUERY_FILES_PER_DIR);
+
+    wsfs_disable_queries_ctx(context);
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.nodes, 0);
+    cr_assert_null(wsfs_query_ctx(context, &files, 1));
+    free_wsfs_context(context);
+}
+
+/**
+ * @struct QueryWriter
+ * @brief Argument of thread which resizes files while they are queried.
+ */
+struct QueryWriter {
+    struct WsfsContext* context;    /**< Queried context */
+    struct FileNode* dir;           /**< Directory which files are resized */
+};
+
+static void* resize_files(void* argument) {
+    const struct QueryWriter* writer = argument;
+    char content[QUERY_FILES_PER_DIR * 10 + 1];
+    memset(content, 'z', sizeof(content) - 1);
+    content[sizeof(content) - 1] = '\0';
+    for (int round = 0; round < QUERY_WRITER_ROUNDS; round++) {
+        struct FileNode* file = find_file_node_in_curr_dir_ctx(writer->context, writer->dir, "file3");
+        wsfs_truncate_ctx(writer->context, file, round % 2 == 0 ? sizeof(content) - 1 : 0);
+        char name[32];
+        sprintf(name, "temp%d", round);
+        struct FileNode* temp = create_file_node_ctx(writer->context, writer->dir, name, FILE_TYPE_FILE);
+        write_to_file_ctx(writer->context, temp, content);
+        delete_file_node_ctx(writer->context, writer->dir, temp);
+    }
+
+    return NULL;
+}
+
+Test(wsfs_query, concurrent_changes) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_queried_tree(context);
+    wsfs_enable_queries_ctx(context);
+    struct QueryWriter writer = {context, find_file_node_in_curr_dir_ctx(context, root, "dir4")};
+    const struct QueryPredicate large = {QUERY_SIZE, QUERY_FILES_PER_DIR * 10, UINT64_MAX};
+    struct FileNode* found[QUERY_BATCH];
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, resize_files, &writer);
+    for (int round = 0; round < QUERY_WRITER_ROUNDS; round++) {
+        struct WsfsQuery* query = wsfs_query_ctx(context, &large, 1);
+        uint32_t taken;
+        // Writer deletes files meanwhile, epoch keeps found nodes allocated while they are checked
+        cr_assert_eq(wsfs_epoch_enter(), EXIT_SUCCESS);
+        while ((taken = wsfs_query_next(query, found, QUERY_BATCH)) > 0) {
+            for (uint32_t i = 0; i < taken; i++) {
+                cr_assert_eq(found[i]->info.properties.type, FILE_TYPE_FILE);
+            }
+        }
+        wsfs_epoch_exit();
+        wsfs_query_close(query);
+    }
+    pthread_join(thread, NULL);
+
+    struct QueryIndexStats stats;
+    get_query_index_stats_ctx(context, &stats);
+    cr_assert_eq(stats.nodes, get_file_count_ctx(context));
+    cr_assert_eq(count_query(context, &large, 1), 0);
+    free_wsfs_context(context);
+}
@@ -0,0 +1,67 @@
+/**
+    * @file: rw_lock_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to reader/writer locks.
+*/
+
+#include "../include/rw_lock.h"
+
+#include <pthread.h>
+
+#include "criterion/criterion.h"
+
+#define THREAD_COUNT 4
+#define INCREMENTS 100000
+
+static struct RwLock lock;
+static uint64_t counter;
+
+static void* increment_counter(void* argument) {
+    (void)argument;
+    for (int i = 0; i < INCREMENTS; i++) {
+        acquire_write_lock(&lock);
+        counter++;
+        release_write_lock(&lock);
+    }
+    return NULL;
+}
+
+Test(acquire_read_lock, readers_share_lock) {
+    struct RwLock readLock = {0};
+
+    acquire_read_lock(&readLock);
+    acquire_read_lock(&readLock);
+    cr_assert_eq(atomic_load(&readLock.state), 2);
+
+    release_read_lock(&readLock);
+    release_read_lock(&readLock);
+    cr_assert_eq(atomic_load(&readLock.state), 0);
+}
+
+Test(acquire_write_lock, unlocked_after_release) {
+    struct RwLock writeLock = {0};
+
+    acquire_write_lock(&writeLock);
+    cr_assert_neq(atomic_load(&writeLock.state), 0);
+    release_write_lock(&writeLock);
+
+    acquire_read_lock(&writeLock);
+    release_read_lock(&writeLock);
+    cr_assert_eq(atomic_load(&writeLock.state), 0);
+}
+
+Test(acquire_write_lock, writers_exclude_each_other) {
+    pthread_t threads[THREAD_COUNT];
+    counter = 0;
+
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        pthread_create(&threads[i], NULL, increment_counter, NULL);
+    }
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    cr_assert_eq(counter, (uint64_t)THREAD_COUNT * INCREMENTS);
+}
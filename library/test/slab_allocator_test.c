@@ -0,0 +1,109 @@
+/**
+    * @file: slab_allocator_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the slab allocator.
+*/
+
+#include "../include/slab_allocator.h"
+
+#include <string.h>
+
+#include "criterion/criterion.h"
+
+Test(slab_alloc, node_size_has_own_class) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct AllocatorStats stats;
+
+    void* node = slab_alloc(&allocator, sizeof(struct FileNode));
+
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_not_null(node);
+    cr_assert_geq(stats.classes[0].objectSize, sizeof(struct FileNode));
+    cr_assert_lt(stats.classes[0].objectSize, sizeof(struct FileNode) + CACHE_LINE_SIZE);
+    cr_assert_eq((uintptr_t)node % CACHE_LINE_SIZE, 0);
+    cr_assert_eq(stats.classes[0].objectsUsed, 1);
+    cr_assert_eq(stats.reservedBytes, SLAB_SIZE);
+
+    slab_free(&allocator, node, sizeof(struct FileNode));
+    release_slab_allocator(&allocator);
+}
+
+Test(slab_alloc, reuses_freed_objects) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+
+    void* first = slab_alloc(&allocator, 10);
+    slab_free(&allocator, first, 10);
+    void* second = slab_alloc(&allocator, 12);
+
+    cr_assert_eq(first, second);
+
+    release_slab_allocator(&allocator);
+}
+
+Test(slab_alloc, large_blocks_are_tracked) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct AllocatorStats stats;
+
+    char* block = slab_alloc(&allocator, 10000);
+    memset(block, 1, 10000);
+
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_eq(stats.largeBlocks, 1);
+    cr_assert_eq(stats.largeBytes, 10000);
+
+    slab_free(&allocator, block, 10000);
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_eq(stats.largeBlocks, 0);
+    cr_assert_eq(stats.reservedBytes, 0);
+}
+
+Test(slab_free, empty_slabs_are_released) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+    struct AllocatorStats stats;
+    const int count = 3 * (SLAB_SIZE / 16);
+    void** objects = malloc(count * sizeof(void*));
+
+    for (int i = 0; i < count; i++) objects[i] = slab_alloc(&allocator, 16);
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_geq(stats.classes[1].slabs, 3);
+
+    for (int i = 0; i < count; i++) slab_free(&allocator, objects[i], 16);
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_eq(stats.classes[1].slabs, 1);
+    cr_assert_eq(stats.classes[1].objectsUsed, 0);
+    cr_assert_eq(stats.usedBytes, 0);
+
+    free(objects);
+    release_slab_allocator(&allocator);
+}
+
+Test(slab_strdup, copies_string) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_SLAB);
+
+    char* copy = slab_strdup(&allocator, "name");
+
+    cr_assert_str_eq(copy, "name");
+
+    slab_free(&allocator, copy, strlen(copy) + 1);
+    release_slab_allocator(&allocator);
+}
+
+Test(release_slab_allocator, frees_everything) {
+    struct SlabAllocator allocator;
+    init_slab_allocator(&allocator, ALLOCATOR_MODE_ARENA);
+    struct AllocatorStats stats;
+
+    for (int i = 0; i < 1000; i++) slab_alloc(&allocator, i % 300);
+    release_slab_allocator(&allocator);
+
+    get_slab_allocator_stats(&allocator, &stats);
+    cr_assert_eq(stats.reservedBytes, 0);
+    cr_assert_eq(stats.usedBytes, 0);
+}
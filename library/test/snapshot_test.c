@@ -0,0 +1,134 @@
+/**
+    * @file: snapshot_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions which save
+    * file system into a snapshot and load it back.
+*/
+
+#include "../include/snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/wsfs.h"
+#include "../include/wsfs_macros.h"
+#include "criterion/criterion.h"
+
+#define BIG_CONTENT_SIZE (FILE_CHUNK_SIZE * 3 + 100)
+
+static struct WsfsContext* create_saved_context(void) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, 1024 * 1024);
+    set_file_count_limit_ctx(context, 100);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions(root, PERM_DEFAULT);
+
+    struct FileNode* dir = create_file_node_ctx(context, root, "directory_with_long_name", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, dir, "file", FILE_TYPE_FILE);
+    change_permissions(file, PERM_DEFAULT);
+    write_to_file_ctx(context, file, "content");
+
+    struct FileNode* big = create_file_node_ctx(context, root, "big", FILE_TYPE_FILE);
+    change_permissions(big, PERM_DEFAULT);
+    char content[BIG_CONTENT_SIZE];
+    for (int i = 0; i < BIG_CONTENT_SIZE; i++) {
+        content[i] = (char)i;
+    }
+    wsfs_pwrite_ctx(context, big, content, BIG_CONTENT_SIZE, 0);
+
+    struct FileNode* link = create_file_node_ctx(context, root, "link", FILE_TYPE_SYMLINK);
+    change_permissions(link, PERM_DEFAULT);
+    set_symlink_target(link, file);
+    change_permissions(link, PERM_READ);
+    create_file_node_ctx(context, root, "empty", FILE_TYPE_FILE);
+
+    return context;
+}
+
+Test(wsfs_save, round_trip) {
+    struct WsfsContext* saved = create_saved_context();
+    FILE* snapshot = tmpfile();
+
+    cr_assert_eq(wsfs_save(saved, fileno(snapshot)), EXIT_SUCCESS);
+    lseek(fileno(snapshot), 0, SEEK_SET);
+    struct WsfsContext* loaded = wsfs_load(fileno(snapshot));
+    cr_assert_not_null(loaded);
+
+    cr_assert_eq(get_file_count_ctx(loaded), get_file_count_ctx(saved));
+    cr_assert_eq(get_used_memory_ctx(loaded), get_used_memory_ctx(saved));
+    cr_assert_eq(get_memory_limit_ctx(loaded), 1024 * 1024);
+    cr_assert_eq(get_file_count_limit_ctx(loaded), 100);
+
+    struct FileNode* root = get_root_node_ctx(loaded);
+    cr_assert_str_eq(root->info.metadata.name, "\\");
+    cr_assert_eq(root->parent, root);
+    cr_assert_eq(root->info.metadata.creationTime, get_root_node_ctx(saved)->info.metadata.creationTime);
+    cr_assert_eq(root->info.metadata.modificationTime, get_root_node_ctx(saved)->info.metadata.modificationTime);
+
+    struct FileNode* file = wsfs_lookup_path_ctx(loaded, root, "directory_with_long_name\\file", LOOKUP_FOLLOW_ALL);
+    cr_assert_not_null(file);
+    cr_assert_str_eq(read_file_content_ctx(loaded, file), "content");
+    cr_assert_eq(wsfs_lookup_path_ctx(loaded, root, "link", LOOKUP_FOLLOW_ALL), file);
+    cr_assert_eq(wsfs_lookup_path_ctx(loaded, root, "link", LOOKUP_FOLLOW_NONE)->info.properties.permissions,
+                 PERM_READ);
+
+    struct FileNode* big = wsfs_lookup_path_ctx(loaded, root, "big", LOOKUP_FOLLOW_ALL);
+    char content[BIG_CONTENT_SIZE];
+    cr_assert_eq(wsfs_pread(big, content, BIG_CONTENT_SIZE, 0), BIG_CONTENT_SIZE);
+    for (int i = 0; i < BIG_CONTENT_SIZE; i++) {
+        cr_assert_eq(content[i], (char)i);
+    }
+
+    // Children keep their order
+    const struct FileNode* child = root->info.data.directoryContent;
+    cr_assert_str_eq(child->info.metadata.name, "directory_with_long_name");
+    cr_assert_str_eq(child->next->info.metadata.name, "big");
+    cr_assert_str_eq(child->next->next->info.metadata.name, "link");
+    cr_assert_str_eq(root->info.data.directoryTail->info.metadata.name, "empty");
+    cr_assert_eq(get_file_content_size(wsfs_lookup_path_ctx(loaded, root, "empty", LOOKUP_FOLLOW_ALL)), 0);
+
+    fclose(snapshot);
+    free_wsfs_context(saved);
+    free_wsfs_context(loaded);
+}
+
+Test(wsfs_save, without_root) {
+    struct WsfsContext* context = create_wsfs_context();
+    FILE* snapshot = tmpfile();
+
+    cr_assert_eq(wsfs_save(context, fileno(snapshot)), EXIT_FAILURE);
+    cr_assert_eq(wsfs_save(NULL, fileno(snapshot)), EXIT_FAILURE);
+
+    fclose(snapshot);
+    free_wsfs_context(context);
+}
+
+Test(wsfs_load, truncated_snapshot) {
+    struct WsfsContext* saved = create_saved_context();
+    FILE* snapshot = tmpfile();
+    wsfs_save(saved, fileno(snapshot));
+    const off_t size = lseek(fileno(snapshot), 0, SEEK_CUR);
+
+    cr_assert_eq(ftruncate(fileno(snapshot), size - 1), 0);
+    lseek(fileno(snapshot), 0, SEEK_SET);
+
+    cr_assert_null(wsfs_load(fileno(snapshot)));
+
+    fclose(snapshot);
+    free_wsfs_context(saved);
+}
+
+Test(wsfs_load, wrong_magic) {
+    FILE* snapshot = tmpfile();
+    const uint32_t header[12] = {SNAPSHOT_MAGIC + 1, SNAPSHOT_VERSION, 1};
+    fwrite(header, sizeof(header), 1, snapshot);
+    fflush(snapshot);
+    lseek(fileno(snapshot), 0, SEEK_SET);
+
+    cr_assert_null(wsfs_load(fileno(snapshot)));
+
+    fclose(snapshot);
+}
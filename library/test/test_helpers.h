@@ -0,0 +1,29 @@
+/**
+    * @file: test_helpers.h
+    * @author: without eyes
+    *
+    * This file contains helpers which are shared by
+    * several test files.
+*/
+
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "../include/file_node_funcs.h"
+
+/**
+    * Waits until get_current_time() changes, so nodes changed
+    * after it get times strictly greater than the ones before.
+*/
+static inline void wait_for_clock_tick(void) {
+    const uint64_t start = get_current_time();
+    const struct timespec pause = {0, 1000000};
+    while (get_current_time() == start) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+#endif //TEST_HELPERS_H
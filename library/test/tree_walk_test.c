@@ -0,0 +1,110 @@
+/**
+    * @file: tree_walk_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to tree walks.
+*/
+
+#include "../include/tree_walk.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+#define WIDE_DIR_SIZE 2000
+#define DEEP_TREE_DEPTH 2000
+
+/**
+ * @struct VisitLog
+ * @brief Names of visited nodes and where walk is cut.
+ */
+struct VisitLog {
+    char names[64];             /**< Names of visited nodes, one letter each */
+    const char* prunedName;     /**< Name of node which children are skipped */
+    const char* stopName;       /**< Name of node after which walk stops */
+};
+
+static enum WalkAction log_visit(struct FileNode* node, void* argument) {
+    struct VisitLog* log = argument;
+    const size_t length = strlen(log->names);
+    log->names[length] = node->info.metadata.name[0];
+    log->names[length + 1] = '\0';
+
+    if (log->stopName != NULL && strcmp(node->info.metadata.name, log->stopName) == 0) return WALK_STOP;
+    if (log->prunedName != NULL && strcmp(node->info.metadata.name, log->prunedName) == 0) return WALK_PRUNE;
+    return WALK_CONTINUE;
+}
+
+/**
+    * Builds r(a(c, d), b(e)), names of nodes are single letters.
+*/
+static struct FileNode* create_small_tree(struct WsfsContext* context) {
+    set_memory_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = create_file_node_ctx(context, NULL, "r", FILE_TYPE_DIR);
+    struct FileNode* a = create_file_node_ctx(context, root, "a", FILE_TYPE_DIR);
+    struct FileNode* b = create_file_node_ctx(context, root, "b", FILE_TYPE_DIR);
+    create_file_node_ctx(context, a, "c", FILE_TYPE_FILE);
+    create_file_node_ctx(context, a, "d", FILE_TYPE_FILE);
+    create_file_node_ctx(context, b, "e", FILE_TYPE_FILE);
+
+    return root;
+}
+
+static const char* walk_small_tree(const enum WalkOrder order, const char* prunedName, const char* stopName) {
+    static struct VisitLog log;
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = create_small_tree(context);
+    memset(&log, 0, sizeof(log));
+    log.prunedName = prunedName;
+    log.stopName = stopName;
+
+    cr_assert_eq(walk_file_node_tree(root, order, 1, log_visit, &log), EXIT_SUCCESS);
+
+    free_wsfs_context(context);
+    return log.names;
+}
+
+Test(walk_file_node_tree, orders) {
+    cr_assert_str_eq(walk_small_tree(WALK_PRE_ORDER, NULL, NULL), "racdbe");
+    cr_assert_str_eq(walk_small_tree(WALK_POST_ORDER, NULL, NULL), "cdaebr");
+    cr_assert_str_eq(walk_small_tree(WALK_BREADTH_FIRST, NULL, NULL), "rabcde");
+}
+
+Test(walk_file_node_tree, prune_and_stop) {
+    cr_assert_str_eq(walk_small_tree(WALK_PRE_ORDER, "a", NULL), "rabe");
+    cr_assert_str_eq(walk_small_tree(WALK_BREADTH_FIRST, "a", NULL), "rabe");
+    cr_assert_str_eq(walk_small_tree(WALK_POST_ORDER, "a", NULL), "cdaebr");
+    cr_assert_str_eq(walk_small_tree(WALK_PRE_ORDER, NULL, "d"), "racd");
+    cr_assert_str_eq(walk_small_tree(WALK_POST_ORDER, NULL, "a"), "cda");
+    cr_assert_eq(walk_file_node_tree(NULL, WALK_PRE_ORDER, 0, log_visit, NULL), EXIT_FAILURE);
+}
+
+Test(walk_file_node_tree, wide_and_deep_trees) {
+    struct WsfsContext* context = create_wsfs_context();
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = create_file_node_ctx(context, NULL, "root", FILE_TYPE_DIR);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* wide = create_file_node_ctx(context, root, "wide", FILE_TYPE_DIR);
+    for (int i = 0; i < WIDE_DIR_SIZE; i++) {
+        char name[16];
+        sprintf(name, "file%d", i);
+        create_file_node_ctx(context, wide, name, FILE_TYPE_FILE);
+    }
+    struct FileNode* deep = root;
+    for (int i = 0; i < DEEP_TREE_DEPTH; i++) {
+        deep = create_file_node_ctx(context, deep, "deep", FILE_TYPE_DIR);
+    }
+    cr_assert_eq(get_file_count_ctx(context), 2 + WIDE_DIR_SIZE + DEEP_TREE_DEPTH);
+
+    cr_assert_eq(get_file_node_size(root), get_used_memory_ctx(context));
+    cr_assert_eq(free_file_node_recursive_ctx(context, root), EXIT_SUCCESS);
+    cr_assert_eq(get_file_count_ctx(context), 0);
+    cr_assert_eq(get_used_memory_ctx(context), 0);
+
+    free_wsfs_context(context);
+}
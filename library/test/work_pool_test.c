@@ -0,0 +1,154 @@
+/**
+    * @file: work_pool_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to the work pool.
+*/
+
+#include "../include/work_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/file_node_funcs.h"
+#include "../include/wsfs.h"
+#include "criterion/criterion.h"
+
+#define POOL_THREADS 3
+#define TREE_DIRS 40
+#define TREE_FILES 25
+
+/**
+    * Builds root with TREE_DIRS directories, each one holds
+    * TREE_FILES files and the next directory, so tree is
+    * both wide and deep.
+*/
+static struct FileNode* build_tree(struct WsfsContext* context) {
+    set_memory_limit_ctx(context, UINT64_MAX);
+    set_file_count_limit_ctx(context, UINT64_MAX);
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = root;
+    char name[32];
+    for (int i = 0; i < TREE_DIRS; i++) {
+        sprintf(name, "dir%d", i);
+        struct FileNode* next = create_file_node_ctx(context, dir, name, FILE_TYPE_DIR);
+        change_permissions_ctx(context, next, PERM_DEFAULT);
+        for (int j = 0; j < TREE_FILES; j++) {
+            sprintf(name, "file%d", (i * 7 + j) % TREE_FILES);
+            write_to_file_ctx(context, create_file_node_ctx(context, next, name, FILE_TYPE_FILE), name);
+        }
+        dir = next;
+    }
+
+    return root;
+}
+
+static void count_children(struct WorkJob* job, const uint32_t worker, const struct WorkTask task, void* argument) {
+    _Atomic uint64_t* count = argument;
+    for (struct FileNode* child = task.node->info.data.directoryContent; child != NULL; child = child->next) {
+        atomic_fetch_add(count, 1);
+        if (child->info.properties.type == FILE_TYPE_DIR) push_work_task(job, worker, (struct WorkTask){child, NULL});
+    }
+}
+
+static uint8_t has_odd_file_name(const struct FileNode* node, void* argument) {
+    (void)argument;
+    const char* name = node->info.metadata.name;
+    return node->info.properties.type == FILE_TYPE_FILE && (name[strlen(name) - 1] - '0') % 2 == 1;
+}
+
+Test(run_work_job, handles_every_task) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_tree(context);
+    struct WorkPoolStats stats;
+    _Atomic uint64_t count = 0;
+
+    cr_assert_eq(get_work_pool_worker_count(context), 1);
+    run_work_job(context, (struct WorkTask){root, NULL}, count_children, &count);
+    cr_assert_eq(count, get_file_count_ctx(context) - 1);
+
+    cr_assert_eq(wsfs_start_workers_ctx(context, POOL_THREADS), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_start_workers_ctx(context, POOL_THREADS), EXIT_FAILURE);
+    cr_assert_eq(get_work_pool_worker_count(context), POOL_THREADS + 1);
+    for (int i = 0; i < 10; i++) {
+        atomic_store(&count, 0);
+        run_work_job(context, (struct WorkTask){root, NULL}, count_children, &count);
+        cr_assert_eq(count, get_file_count_ctx(context) - 1);
+    }
+    get_work_pool_stats_ctx(context, &stats);
+    cr_assert_eq(stats.threads, POOL_THREADS);
+    cr_assert_eq(stats.jobs, 10);
+    cr_assert_eq(stats.tasks, 10 * (TREE_DIRS + 1));
+
+    wsfs_stop_workers_ctx(context);
+    get_work_pool_stats_ctx(context, &stats);
+    cr_assert_eq(stats.jobs, 0);
+    cr_assert_eq(wsfs_start_workers_ctx(context, 0), EXIT_FAILURE);
+    free_wsfs_context(context);
+}
+
+Test(find_file_nodes_matching, same_order_with_workers) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_tree(context);
+    uint32_t count;
+    uint32_t orderedCount;
+
+    struct FileNode** alone = find_file_nodes_matching_ctx(context, root, has_odd_file_name, NULL, 1, &count);
+    cr_assert_not_null(alone);
+    cr_assert_eq(count, TREE_DIRS * (TREE_FILES / 2));
+    // Subdirectory sorts before files of its directory, so the deepest files come first
+    char expected[512] = "";
+    for (int i = 0; i < TREE_DIRS; i++) {
+        sprintf(expected + strlen(expected), "\\dir%d", i);
+    }
+    strcat(expected, "\\file1");
+    char* first = get_file_node_path_ctx(context, alone[0]);
+    cr_assert_str_eq(first, expected);
+    free(first);
+
+    wsfs_start_workers_ctx(context, POOL_THREADS);
+    struct FileNode** shared = find_file_nodes_matching_ctx(context, root, has_odd_file_name, NULL, 1, &orderedCount);
+    cr_assert_eq(orderedCount, count);
+    cr_assert_eq(memcmp(alone, shared, count * sizeof(struct FileNode*)), 0);
+    free(shared);
+
+    shared = find_file_nodes_matching_ctx(context, root, has_odd_file_name, NULL, 0, &orderedCount);
+    cr_assert_eq(orderedCount, count);
+    free(shared);
+    cr_assert_null(find_file_nodes_matching_ctx(context, root, has_odd_file_name, NULL, 1, NULL));
+
+    free(alone);
+    free_wsfs_context(context);
+}
+
+Test(copy_file_node, copies_and_frees_on_workers) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = build_tree(context);
+    wsfs_start_workers_ctx(context, POOL_THREADS);
+    const uint64_t usedMemory = get_used_memory_ctx(context);
+    const uint64_t fileCount = get_file_count_ctx(context);
+    struct FileNode* dir = find_file_node_in_curr_dir_ctx(context, root, "dir0");
+    struct FileNode* inner = find_file_node_in_curr_dir_ctx(context, dir, "dir1");
+
+    // Subtree is copied into its own directory, copy is linked only once it is complete
+    cr_assert_eq(copy_file_node_ctx(context, inner, dir), EXIT_SUCCESS);
+    cr_assert_eq(get_file_count_ctx(context), 2 * fileCount - 1);
+    cr_assert_eq(get_used_memory_ctx(context), get_file_node_size(root));
+    struct FileNode* copy = inner->info.data.directoryTail;
+    cr_assert_str_eq(read_file_content_ctx(context, find_file_node_in_curr_dir_ctx(context, copy, "file3")), "file3");
+
+    cr_assert_eq(delete_file_node_ctx(context, inner, copy), EXIT_SUCCESS);
+    cr_assert_eq(get_file_count_ctx(context), fileCount);
+    cr_assert_eq(get_used_memory_ctx(context), usedMemory);
+
+    // Copy which reaches the limit is freed whole
+    set_file_count_limit_ctx(context, fileCount + TREE_FILES);
+    cr_assert_eq(copy_file_node_ctx(context, root, dir), EXIT_FAILURE);
+    cr_assert_eq(get_file_count_ctx(context), fileCount);
+    cr_assert_eq(get_used_memory_ctx(context), usedMemory);
+
+    free_wsfs_context(context);
+}
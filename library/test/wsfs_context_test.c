@@ -0,0 +1,132 @@
+/**
+    * @file: wsfs_context_test.c
+    * @author: without eyes
+    *
+    * This file contains tests for functions related
+    * to file system contexts.
+*/
+
+#include "../include/wsfs_context.h"
+
+#include <string.h>
+
+#include "../include/wsfs.h"
+#include "../include/wsfs_macros.h"
+#include "criterion/criterion.h"
+
+Test(get_default_context, used_by_plain_functions) {
+    struct WsfsContext* context = get_default_context();
+    const uint64_t fileCount = get_file_count_ctx(context);
+
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    cr_assert_eq(get_default_context(), context);
+    cr_assert_eq(get_file_count_ctx(context), fileCount + 1);
+    cr_assert_eq(get_file_count(), fileCount + 1);
+
+    free_file_node_recursive(file);
+    cr_assert_eq(get_file_count_ctx(context), fileCount);
+}
+
+Test(create_wsfs_context, independent_counters_and_limits) {
+    struct WsfsContext* first = create_wsfs_context();
+    struct WsfsContext* second = create_wsfs_context();
+    const uint64_t defaultCount = get_file_count();
+    set_file_count_limit_ctx(first, 2);
+
+    struct FileNode* firstRoot = wsfs_init_ctx(first);
+    struct FileNode* secondRoot = wsfs_init_ctx(second);
+    change_permissions(firstRoot, PERM_DEFAULT);
+    change_permissions(secondRoot, PERM_DEFAULT);
+
+    cr_assert_not_null(create_file_node_ctx(first, firstRoot, "a", FILE_TYPE_FILE));
+    cr_assert_null(create_file_node_ctx(first, firstRoot, "b", FILE_TYPE_FILE));
+    cr_assert_not_null(create_file_node_ctx(second, secondRoot, "a", FILE_TYPE_FILE));
+    cr_assert_not_null(create_file_node_ctx(second, secondRoot, "b", FILE_TYPE_FILE));
+
+    cr_assert_eq(get_root_node_ctx(first), firstRoot);
+    cr_assert_eq(get_root_node_ctx(second), secondRoot);
+    cr_assert_eq(get_file_count_ctx(first), 2);
+    cr_assert_eq(get_file_count_ctx(second), 3);
+    cr_assert_eq(get_file_count_limit_ctx(second), MAX_FILE_COUNT);
+    cr_assert_eq(get_file_count(), defaultCount);
+
+    free_wsfs_context(first);
+    free_wsfs_context(second);
+}
+
+Test(wsfs_lookup_path_ctx, separate_lookup_caches) {
+    struct WsfsContext* first = create_wsfs_context();
+    struct WsfsContext* second = create_wsfs_context();
+    struct FileNode* firstRoot = wsfs_init_ctx(first);
+    struct FileNode* secondRoot = wsfs_init_ctx(second);
+    change_permissions(firstRoot, PERM_DEFAULT);
+    change_permissions(secondRoot, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(first, firstRoot, "file", FILE_TYPE_FILE);
+    create_file_node_ctx(second, secondRoot, "file", FILE_TYPE_FILE);
+    struct LookupCacheStats stats;
+
+    cr_assert_eq(wsfs_lookup_path_ctx(first, firstRoot, "file", LOOKUP_FOLLOW_ALL), file);
+    cr_assert_eq(wsfs_lookup_path_ctx(first, firstRoot, "file", LOOKUP_FOLLOW_ALL), file);
+
+    get_lookup_cache_stats(&first->lookupCache, &stats);
+    cr_assert_eq(stats.hits, 1);
+    cr_assert_eq(stats.used, 1);
+    get_lookup_cache_stats(&second->lookupCache, &stats);
+    cr_assert_eq(stats.hits, 0);
+    cr_assert_eq(stats.used, 0);
+
+    free_wsfs_context(first);
+    free_wsfs_context(second);
+}
+
+Test(wsfs_open_ctx, handles_numbered_per_context) {
+    struct WsfsContext* first = create_wsfs_context();
+    struct WsfsContext* second = create_wsfs_context();
+    struct FileNode* firstRoot = wsfs_init_ctx(first);
+    struct FileNode* secondRoot = wsfs_init_ctx(second);
+    change_permissions(firstRoot, PERM_DEFAULT);
+    change_permissions(secondRoot, PERM_DEFAULT);
+    struct FileNode* firstFile = create_file_node_ctx(first, firstRoot, "file", FILE_TYPE_FILE);
+    struct FileNode* secondFile = create_file_node_ctx(second, secondRoot, "file", FILE_TYPE_FILE);
+    change_permissions(firstFile, PERM_DEFAULT);
+    change_permissions(secondFile, PERM_DEFAULT);
+    uint32_t firstHandle;
+    uint32_t secondHandle;
+
+    cr_assert_eq(wsfs_open_ctx(first, firstFile, OPEN_READ | OPEN_WRITE, &firstHandle), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_open_ctx(second, secondFile, OPEN_READ | OPEN_WRITE, &secondHandle), EXIT_SUCCESS);
+    cr_assert_eq(firstHandle, secondHandle);
+
+    cr_assert_eq(wsfs_write_ctx(first, firstHandle, "first", 5), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_close_ctx(first, firstHandle), EXIT_SUCCESS);
+    cr_assert_eq(get_file_content_size(firstFile), 5);
+    cr_assert_eq(get_file_content_size(secondFile), 0);
+    cr_assert_eq(get_used_memory_ctx(first), get_used_memory_ctx(second) + 6);
+
+    // Handle left open is freed together with its context
+    cr_assert_eq(wsfs_write_ctx(second, secondHandle, "second", 6), EXIT_SUCCESS);
+
+    free_wsfs_context(first);
+    free_wsfs_context(second);
+}
+
+Test(free_wsfs_context, after_deinit) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, root, "file", FILE_TYPE_FILE);
+    change_permissions(file, PERM_DEFAULT);
+    char name[] = "file_with_name_longer_than_inline_storage";
+
+    // Reader keeps renamed name and deleted nodes pending until context is freed
+    wsfs_epoch_enter();
+    cr_assert_eq(change_file_node_name_ctx(context, file, name), EXIT_SUCCESS);
+    cr_assert_eq(change_file_node_name_ctx(context, file, "file"), EXIT_SUCCESS);
+    wsfs_deinit_ctx(context, root);
+    wsfs_epoch_exit();
+
+    cr_assert_eq(get_file_count_ctx(context), 0);
+    cr_assert_eq(get_used_memory_ctx(context), 0);
+    free_wsfs_context(context);
+    cr_assert_eq(get_epoch_pending_count(), 0);
+}
@@ -8,15 +8,19 @@
 
 #include "../include/wsfs.h"
 
+#include <string.h>
+
+#include "../include/wsfs_macros.h"
 #include "criterion/criterion.h"
 
 Test(wsfs_init, basic) {
+    const uint64_t before = get_current_time();
     struct FileNode* result = wsfs_init();
 
     cr_assert_eq(get_root_node(), result);
     cr_assert_str_eq(result->info.metadata.name, "\\");
-    cr_assert_eq(result->info.metadata.creationTime.hour, get_current_time().hour);
-    cr_assert_eq(result->info.metadata.creationTime.minute, get_current_time().minute);
+    cr_assert_geq(result->info.metadata.creationTime, before);
+    cr_assert_leq(result->info.metadata.creationTime, get_current_time());
     cr_assert_eq(result->info.properties.type, FILE_TYPE_DIR);
     cr_assert_eq(result->parent, result);
     cr_assert_null(result->info.data.directoryContent);
@@ -24,6 +28,298 @@ Test(wsfs_init, basic) {
     cr_assert_null(result->info.data.symlinkTarget);
     cr_assert_null(result->next);
 
-    free(result->info.metadata.name);
-    free(result);
-}
\ No newline at end of file
+    wsfs_deinit(result);
+}
+Test(wsfs_deinit, arena_mode_drops_everything) {
+    set_allocator_mode(ALLOCATOR_MODE_ARENA);
+    struct FileNode* root = wsfs_init();
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    write_to_file(create_file_node(dir, "file", FILE_TYPE_FILE), "content");
+    struct AllocatorStats stats;
+
+    wsfs_deinit(root);
+
+    get_allocator_stats(&stats);
+    cr_assert_eq(stats.reservedBytes, 0);
+    cr_assert_eq(get_file_count(), 0);
+    cr_assert_eq(get_used_memory(), 0);
+    cr_assert_null(get_root_node());
+}
+
+Test(wsfs_lookup_path, nested_path) {
+    struct FileNode* root = wsfs_init();
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node(dir, "file", FILE_TYPE_FILE);
+    change_permissions(root, PERM_DEFAULT);
+
+    cr_assert_eq(wsfs_lookup_path(root, "dir\\file", LOOKUP_FOLLOW_ALL), file);
+    cr_assert_eq(wsfs_lookup_path(root, "\\dir\\\\file\\", LOOKUP_FOLLOW_ALL), file);
+    cr_assert_eq(wsfs_lookup_path(root, "dir\\.\\..\\dir", LOOKUP_FOLLOW_ALL), dir);
+    cr_assert_eq(wsfs_lookup_path(root, "", LOOKUP_FOLLOW_ALL), root);
+    cr_assert_null(wsfs_lookup_path(root, "dir\\missing", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(wsfs_lookup_path(root, "dir\\file\\file", LOOKUP_FOLLOW_ALL));
+
+    char* path = get_file_node_path(file);
+    cr_assert_eq(wsfs_lookup_path(root, path, LOOKUP_FOLLOW_ALL), file);
+    free(path);
+
+    wsfs_deinit(root);
+}
+
+Test(wsfs_lookup_path, symlinks) {
+    struct FileNode* root = wsfs_init();
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    struct FileNode* file = create_file_node(dir, "file", FILE_TYPE_FILE);
+    struct FileNode* link = create_file_node(root, "link", FILE_TYPE_SYMLINK);
+    set_symlink_target(link, dir);
+
+    cr_assert_eq(wsfs_lookup_path(root, "link\\file", LOOKUP_FOLLOW_INTERMEDIATE), file);
+    cr_assert_null(wsfs_lookup_path(root, "link\\file", LOOKUP_FOLLOW_NONE));
+    cr_assert_eq(wsfs_lookup_path(root, "link", LOOKUP_FOLLOW_NONE), link);
+    cr_assert_eq(wsfs_lookup_path(root, "link", LOOKUP_FOLLOW_LAST), dir);
+
+    set_symlink_target(link, link);
+    cr_assert_null(wsfs_lookup_path(root, "link", LOOKUP_FOLLOW_ALL));
+
+    wsfs_deinit(root);
+}
+
+Test(wsfs_lookup_path, repeated_lookup_hits_cache) {
+    struct FileNode* root = wsfs_init();
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    change_permissions(dir, PERM_DEFAULT);
+    create_file_node(dir, "file", FILE_TYPE_FILE);
+    struct LookupCacheStats stats;
+
+    wsfs_lookup_path(root, "dir\\file", LOOKUP_FOLLOW_ALL);
+    wsfs_lookup_path(root, "dir\\file", LOOKUP_FOLLOW_ALL);
+
+    get_lookup_cache_stats(&get_default_context()->lookupCache, &stats);
+    cr_assert_eq(stats.misses, 2);
+    cr_assert_eq(stats.hits, 2);
+
+    wsfs_deinit(root);
+}
+
+Test(wsfs_lookup_path, inside_deleted_dir) {
+    struct WsfsContext* context = create_wsfs_context();
+    struct FileNode* root = wsfs_init_ctx(context);
+    change_permissions_ctx(context, root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node_ctx(context, root, "dir", FILE_TYPE_DIR);
+    change_permissions_ctx(context, dir, PERM_DEFAULT);
+    struct FileNode* sub = create_file_node_ctx(context, dir, "sub", FILE_TYPE_DIR);
+    change_permissions_ctx(context, sub, PERM_DEFAULT);
+    struct FileNode* file = create_file_node_ctx(context, sub, "file", FILE_TYPE_FILE);
+
+    // Lookup which stood inside subtree when it was deleted doesn't cache it again
+    cr_assert_eq(wsfs_epoch_enter(), EXIT_SUCCESS);
+    cr_assert_eq(delete_file_node_ctx(context, root, dir), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_lookup_path_ctx(context, dir, "sub\\file", LOOKUP_FOLLOW_ALL), file);
+    wsfs_epoch_exit();
+
+    struct LookupCacheStats stats;
+    get_lookup_cache_stats(&context->lookupCache, &stats);
+    cr_assert_eq(stats.used, 0);
+
+    free_wsfs_context(context);
+}
+
+Test(wsfs_lookup_path, without_permissions) {
+    struct FileNode* root = wsfs_init();
+    change_permissions(root, PERM_DEFAULT);
+    struct FileNode* dir = create_file_node(root, "dir", FILE_TYPE_DIR);
+    create_file_node(dir, "file", FILE_TYPE_FILE);
+
+    cr_assert_null(wsfs_lookup_path(root, "dir\\file", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(wsfs_lookup_path(NULL, "dir", LOOKUP_FOLLOW_ALL));
+    cr_assert_null(wsfs_lookup_path(root, NULL, LOOKUP_FOLLOW_ALL));
+
+    wsfs_deinit(root);
+}
+
+Test(wsfs_open, symlink_is_resolved) {
+    struct FileNode* symlink = create_file_node(NULL, "symlink", FILE_TYPE_SYMLINK);
+    struct FileNode* target = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    set_symlink_target(symlink, target);
+    uint32_t handle;
+    char buffer[5];
+
+    cr_assert_eq(wsfs_open(symlink, OPEN_READ | OPEN_WRITE, &handle), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_write(handle, "Hello", 5), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_close(handle), EXIT_SUCCESS);
+
+    cr_assert_eq(wsfs_open(target, OPEN_READ, &handle), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_read(handle, buffer, sizeof(buffer)), 5);
+    cr_assert_eq(memcmp(buffer, "Hello", 5), 0);
+    cr_assert_eq(wsfs_read(handle, buffer, sizeof(buffer)), 0);
+    cr_assert_eq(wsfs_close(handle), EXIT_SUCCESS);
+
+    free_file_node_recursive(target);
+    free_file_node_recursive(symlink);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_open, preconditions_are_checked) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    struct FileNode* dir = create_file_node(NULL, "dir", FILE_TYPE_DIR);
+    uint32_t handle;
+
+    cr_assert_eq(wsfs_open(NULL, OPEN_READ, &handle), EXIT_FAILURE);
+    cr_assert_eq(wsfs_open(file, OPEN_APPEND, &handle), EXIT_FAILURE);
+    cr_assert_eq(wsfs_open(dir, OPEN_READ, &handle), EXIT_FAILURE);
+    change_permissions(file, PERM_READ);
+    cr_assert_eq(wsfs_open(file, OPEN_WRITE, &handle), EXIT_FAILURE);
+
+    cr_assert_eq(wsfs_open(file, OPEN_READ, &handle), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_write(handle, "a", 1), EXIT_FAILURE);
+    cr_assert_eq(wsfs_close(handle), EXIT_SUCCESS);
+    cr_assert_eq(wsfs_close(handle), EXIT_FAILURE);
+
+    free_file_node_recursive(file);
+    free_file_node_recursive(dir);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_open, closed_handles_are_reused) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t first;
+    uint32_t second;
+    uint32_t third;
+
+    wsfs_open(file, OPEN_READ, &first);
+    wsfs_open(file, OPEN_READ, &second);
+    cr_assert_neq(first, second);
+    wsfs_close(first);
+    wsfs_open(file, OPEN_READ, &third);
+    cr_assert_eq(third, first);
+
+    wsfs_close(second);
+    wsfs_close(third);
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_write, small_writes_are_buffered) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    wsfs_open(file, OPEN_WRITE, &handle);
+
+    for (int i = 0; i < 10; i++) {
+        wsfs_write(handle, "ab", 2);
+    }
+    cr_assert_eq(get_file_content_size(file), 0);
+
+    cr_assert_eq(wsfs_flush(handle), EXIT_SUCCESS);
+    cr_assert_eq(get_file_content_size(file), 20);
+    cr_assert_str_eq(read_file_content(file), "abababababababababab");
+
+    wsfs_close(handle);
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_write, read_sees_buffered_bytes) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    char buffer[5];
+    wsfs_open(file, OPEN_READ | OPEN_WRITE, &handle);
+
+    wsfs_write(handle, "Hello", 5);
+    wsfs_seek(handle, 0, SEEK_ORIGIN_SET, NULL);
+
+    cr_assert_eq(wsfs_read(handle, buffer, sizeof(buffer)), 5);
+    cr_assert_eq(memcmp(buffer, "Hello", 5), 0);
+
+    wsfs_close(handle);
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_write, append_and_truncate) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    write_to_file(file, "old");
+
+    wsfs_open(file, OPEN_WRITE | OPEN_APPEND, &handle);
+    wsfs_seek(handle, 0, SEEK_ORIGIN_SET, NULL);
+    wsfs_write(handle, "er", 2);
+    wsfs_write(handle, "!", 1);
+    wsfs_close(handle);
+    cr_assert_str_eq(read_file_content(file), "older!");
+
+    wsfs_open(file, OPEN_WRITE | OPEN_TRUNCATE, &handle);
+    wsfs_write(handle, "new", 3);
+    wsfs_close(handle);
+    cr_assert_str_eq(read_file_content(file), "new");
+
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_write, big_write_bypasses_buffer) {
+    set_memory_limit(UINT64_MAX);
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    char data[HANDLE_BUFFER_SIZE * 2];
+    memset(data, 'a', sizeof(data));
+    wsfs_open(file, OPEN_WRITE, &handle);
+
+    wsfs_write(handle, "b", 1);
+    cr_assert_eq(wsfs_write(handle, data, sizeof(data)), EXIT_SUCCESS);
+
+    cr_assert_eq(get_file_content_size(file), sizeof(data) + 1);
+    cr_assert_eq(read_file_content(file)[0], 'b');
+
+    wsfs_close(handle);
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_write, memory_limit_is_reported_on_close) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    char data[MAX_MEMORY_SIZE / 2];
+    memset(data, 'a', sizeof(data));
+    wsfs_open(file, OPEN_WRITE, &handle);
+
+    wsfs_write(handle, data, sizeof(data));
+    wsfs_write(handle, data, sizeof(data));
+
+    cr_assert_eq(wsfs_close(handle), EXIT_FAILURE);
+    cr_assert_eq(get_file_content_size(file), 0);
+
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}
+
+Test(wsfs_seek, origins) {
+    struct FileNode* file = create_file_node(NULL, "file", FILE_TYPE_FILE);
+    uint32_t handle;
+    uint64_t position;
+    char buffer[3];
+    write_to_file(file, "abcdef");
+    wsfs_open(file, OPEN_READ | OPEN_WRITE, &handle);
+
+    cr_assert_eq(wsfs_seek(handle, -2, SEEK_ORIGIN_END, &position), EXIT_SUCCESS);
+    cr_assert_eq(position, 4);
+    cr_assert_eq(wsfs_seek(handle, -1, SEEK_ORIGIN_CURRENT, &position), EXIT_SUCCESS);
+    cr_assert_eq(position, 3);
+    cr_assert_eq(wsfs_read(handle, buffer, sizeof(buffer)), 3);
+    cr_assert_eq(memcmp(buffer, "def", 3), 0);
+    cr_assert_eq(wsfs_seek(handle, -7, SEEK_ORIGIN_END, NULL), EXIT_FAILURE);
+
+    wsfs_seek(handle, 8, SEEK_ORIGIN_SET, NULL);
+    wsfs_write(handle, "z", 1);
+    cr_assert_eq(wsfs_seek(handle, 0, SEEK_ORIGIN_END, &position), EXIT_SUCCESS);
+    cr_assert_eq(position, 9);
+
+    wsfs_close(handle);
+    cr_assert_eq(get_file_content_size(file), 9);
+    free_file_node_recursive(file);
+    wsfs_deinit(NULL);
+}